@@ -0,0 +1,380 @@
+/*
+ * Kernel Debugger Architecture Independent Symbol and Line Table Blob
+ *
+ * This file is subject to the terms and conditions of the GNU General Public
+ * License.  See the file "COPYING" in the main directory of this archive
+ * for more details.
+ *
+ * kallsyms has no file and line information and, without
+ * CONFIG_KALLSYMS_ALL, no static data.  tools/lkmd-symblob turns the
+ * vmlinux of the running kernel into a blob (see lkmd_blob.h) with the
+ * full symbol table and the DWARF line table.  Load it with
+ *
+ *	insmod lkmd.ko symblob=lkmd-vmlinux.blob
+ *
+ * after copying the blob to the firmware directory.  The blob is used
+ * where it is loaded, nothing is unpacked.  It is checked against the
+ * running kernel before it is used: the banner must be the same and
+ * sampled global functions must be where kallsyms says they are, once
+ * the KASLR slide of _text is applied.
+ */
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/firmware.h>
+#include <linux/device.h>
+#include <linux/vmalloc.h>
+#include <linux/string.h>
+#include "lkmd.h"
+#include "lkmd_private.h"
+#include "lkmd_blob.h"
+
+static char *symblob;
+module_param(symblob, charp, 0444);
+MODULE_PARM_DESC(symblob, "Symbol and line table blob, loaded with request_firmware");
+
+/* Number of global functions checked against kallsyms at load time */
+#define KDB_BLOB_SAMPLES	32
+
+static const struct lkmd_blob_hdr *kdb_blob;
+static unsigned long kdb_blob_text;	/* run time address of _text */
+
+#define KDB_BLOB_PTR(b, off)	((const void *)((const char *)(b) + (off)))
+#define KDB_BLOB_STR(b, off)	((const char *)(b) + (b)->strings + (off))
+
+/* An array of n elements of size bytes at off must be inside the blob */
+static int kdb_blob_array_ok(const struct lkmd_blob_hdr *b, __u32 off, __u32 n, size_t size)
+{
+	return !(off & 3) && off <= b->size && n <= (b->size - off) / size;
+}
+
+/*
+ * kdb_blob_check
+ *
+ *	Check that a blob is well formed.
+ *
+ * Inputs:
+ *	b	The blob.
+ *	size	Its size in bytes.
+ * Returns:
+ *	0 if it is, otherwise a message for the log.
+ * Locking:
+ *	none.
+ * Remarks:
+ *	Every offset is checked here so that the lookups only need to check
+ *	the line table encoding, which is variable length.
+ */
+
+static const char *kdb_blob_check(const struct lkmd_blob_hdr *b, size_t size)
+{
+	const struct lkmd_blob_sym *sym;
+	const struct lkmd_blob_lblock *blk;
+	const __u32 *files;
+	__u32 i;
+
+	if (size < sizeof(*b) || memcmp(b->magic, LKMD_BLOB_MAGIC, sizeof(b->magic)))
+		return "not a symbol blob";
+	if (b->version != LKMD_BLOB_VERSION)
+		return "unsupported version";
+	if (b->size != size)
+		return "wrong size";
+	if (!kdb_blob_array_ok(b, b->syms, b->nsyms, sizeof(*sym)) ||
+	    !kdb_blob_array_ok(b, b->files, b->nfiles, sizeof(*files)) ||
+	    !kdb_blob_array_ok(b, b->blocks, b->nblocks, sizeof(*blk)) ||
+	    b->strings > size || b->strings_size > size - b->strings ||
+	    !b->strings_size || KDB_BLOB_STR(b, b->strings_size - 1)[0] ||
+	    b->lines > size || b->lines_size > size - b->lines)
+		return "bad section offsets";
+	if (b->banner >= b->strings_size)
+		return "bad banner";
+	if (b->nblocks != (b->nrows + LKMD_BLOB_LBLOCK - 1) / LKMD_BLOB_LBLOCK)
+		return "bad line table";
+
+	sym = KDB_BLOB_PTR(b, b->syms);
+	for (i = 0; i < b->nsyms; ++i) {
+		if (sym[i].name >= b->strings_size || sym[i].off >= b->image_size ||
+		    (i && sym[i].off <= sym[i-1].off))
+			return "bad symbol table";
+	}
+	files = KDB_BLOB_PTR(b, b->files);
+	for (i = 0; i < b->nfiles; ++i) {
+		if (files[i] >= b->strings_size)
+			return "bad file table";
+	}
+	blk = KDB_BLOB_PTR(b, b->blocks);
+	for (i = 0; i < b->nblocks; ++i) {
+		if (blk[i].file >= b->nfiles || blk[i].pos > b->lines_size ||
+		    (i && blk[i].off <= blk[i-1].off))
+			return "bad line table";
+	}
+	return NULL;
+}
+
+/*
+ * kdb_blob_match
+ *
+ *	Check that a blob was built from the running kernel.
+ *
+ * Inputs:
+ *	b	The blob, already checked by kdb_blob_check.
+ * Outputs:
+ *	text	The run time address of _text.
+ * Returns:
+ *	0 if it was, otherwise a message for the log.
+ * Locking:
+ *	none.
+ * Remarks:
+ *	The KASLR slide is the same for the whole image, so every address
+ *	in the blob is an offset from _text.  Functions are checked, not
+ *	data, kallsyms always has the functions.
+ */
+
+static const char *kdb_blob_match(const struct lkmd_blob_hdr *b, unsigned long *text)
+{
+	const struct lkmd_blob_sym *sym = KDB_BLOB_PTR(b, b->syms);
+	const char *banner;
+	unsigned long end, addr;
+	__u32 i, step, checked = 0;
+
+	*text = kdb_sym_name_lookup("_text");
+	end = kdb_sym_name_lookup("_end");
+	if (!*text || end - *text != b->image_size)
+		return "the kernel image size differs";
+	if (b->banner) {
+		banner = (const char *)kdb_sym_name_lookup("linux_banner");
+		if (!banner || strcmp(banner, KDB_BLOB_STR(b, b->banner)))
+			return "the kernel banner differs";
+	}
+	step = b->nsyms / KDB_BLOB_SAMPLES + 1;
+	for (i = 0; i < b->nsyms; i += step) {
+		/* Move on to the next global function */
+		while (i < b->nsyms && (sym[i].flags & (LKMD_BLOB_GLOBAL|LKMD_BLOB_FUNC)) !=
+		       (LKMD_BLOB_GLOBAL|LKMD_BLOB_FUNC))
+			++i;
+		if (i >= b->nsyms)
+			break;
+		addr = kdb_sym_name_lookup(KDB_BLOB_STR(b, sym[i].name));
+		if (addr != *text + sym[i].off)
+			return "symbol addresses differ";
+		++checked;
+	}
+	if (!checked)
+		return "no symbols to check";
+	return NULL;
+}
+
+/*
+ * kdb_blob_lookup
+ *
+ *	Find the symbol that contains an address in the blob.
+ *
+ * Inputs:
+ *	addr	Address to look up.
+ * Outputs:
+ *	symtab	sym_name, sym_start, sym_end and mod_name are filled in
+ *		when a symbol is found.
+ * Returns:
+ *	1 if a symbol was found, -1 if the blob can not tell and the
+ *	caller must look elsewhere.
+ * Locking:
+ *	none.
+ */
+
+int kdb_blob_lookup(unsigned long addr, kdb_symtab_t *symtab)
+{
+	const struct lkmd_blob_hdr *b = kdb_blob;
+	const struct lkmd_blob_sym *sym;
+	unsigned long off;
+	__u32 lo, hi, mid;
+
+	if (!b || addr < kdb_blob_text || addr - kdb_blob_text >= b->image_size)
+		return -1;
+	off = addr - kdb_blob_text;
+	sym = KDB_BLOB_PTR(b, b->syms);
+
+	/* Find the last symbol that starts at or below off */
+	lo = 0;
+	hi = b->nsyms;
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (sym[mid].off <= off)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (!lo || off - sym[lo-1].off >= sym[lo-1].size)
+		return -1;
+	sym += lo - 1;
+	symtab->sym_name = KDB_BLOB_STR(b, sym->name);
+	symtab->sym_start = kdb_blob_text + sym->off;
+	symtab->sym_end = symtab->sym_start + sym->size;
+	symtab->mod_name = "kernel";
+	return 1;
+}
+
+static int kdb_blob_uleb(const unsigned char **p, const unsigned char *end, __u32 *val)
+{
+	unsigned int shift = 0;
+	unsigned char c;
+
+	*val = 0;
+	do {
+		if (*p >= end || shift > 28)
+			return -1;
+		c = *(*p)++;
+		*val |= (__u32)(c & 0x7f) << shift;
+		shift += 7;
+	} while (c & 0x80);
+	return 0;
+}
+
+static int kdb_blob_sleb(const unsigned char **p, const unsigned char *end, int *val)
+{
+	unsigned int shift = 0;
+	unsigned char c;
+	__u32 v = 0;
+
+	do {
+		if (*p >= end || shift > 28)
+			return -1;
+		c = *(*p)++;
+		v |= (__u32)(c & 0x7f) << shift;
+		shift += 7;
+	} while (c & 0x80);
+	if (shift < 32 && (c & 0x40))
+		v |= ~0U << shift;
+	*val = (int)v;
+	return 0;
+}
+
+/*
+ * kdb_blob_line
+ *
+ *	Find the source line of an address.
+ *
+ * Inputs:
+ *	addr	Address to look up.
+ * Outputs:
+ *	file	Source file name.
+ *	line	Line number.
+ * Returns:
+ *	1 if the line is known, 0 if not.
+ * Locking:
+ *	none.
+ * Remarks:
+ *	A binary search finds the block, then at most LKMD_BLOB_LBLOCK - 1
+ *	rows are decoded.
+ */
+
+int kdb_blob_line(unsigned long addr, const char **file, unsigned int *line)
+{
+	const struct lkmd_blob_hdr *b = kdb_blob;
+	const struct lkmd_blob_lblock *blk;
+	const unsigned char *p, *end;
+	unsigned long off;
+	__u32 lo, hi, mid, n, delta, roff, rfile, rline;
+	int ldelta;
+
+	if (!b || !b->nblocks || addr < kdb_blob_text ||
+	    addr - kdb_blob_text >= b->image_size)
+		return 0;
+	off = addr - kdb_blob_text;
+	blk = KDB_BLOB_PTR(b, b->blocks);
+	lo = 0;
+	hi = b->nblocks;
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (blk[mid].off <= off)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (!lo)
+		return 0;
+	blk += lo - 1;
+	roff = blk->off;
+	rfile = blk->file;
+	rline = blk->line;
+	p = (const unsigned char *)KDB_BLOB_PTR(b, b->lines) + blk->pos;
+	end = (const unsigned char *)KDB_BLOB_PTR(b, b->lines) + b->lines_size;
+	n = min_t(__u32, LKMD_BLOB_LBLOCK, b->nrows - (lo - 1) * LKMD_BLOB_LBLOCK);
+	while (--n) {
+		if (kdb_blob_uleb(&p, end, &delta) || kdb_blob_sleb(&p, end, &ldelta))
+			return 0;
+		if (roff + (delta >> 1) > off)
+			break;
+		roff += delta >> 1;
+		rline += ldelta;
+		if ((delta & 1) && (kdb_blob_uleb(&p, end, &rfile) || rfile >= b->nfiles))
+			return 0;
+	}
+	if (!rline)
+		return 0;
+	*file = KDB_BLOB_STR(b, ((const __u32 *)KDB_BLOB_PTR(b, b->files))[rfile]);
+	*line = rline;
+	return 1;
+}
+
+/*
+ * kdb_blob_init
+ *
+ *	Load the blob named by the symblob parameter.
+ *
+ * Inputs:
+ *	None.
+ * Returns:
+ *	None.
+ * Locking:
+ *	none.
+ * Remarks:
+ *	Called after kdb_sym_init, the blob is checked against the symbol
+ *	index.  lkmd works without the blob, any problem is only logged.
+ */
+
+void __init kdb_blob_init(void)
+{
+	const struct firmware *fw;
+	struct device *dev;
+	struct lkmd_blob_hdr *b;
+	const char *err;
+	unsigned long text;
+	int ret;
+
+	if (!symblob || !*symblob)
+		return;
+	dev = root_device_register("lkmd");
+	if (IS_ERR(dev)) {
+		printk(KERN_WARNING "lkmd: cannot load %s, no device\n", symblob);
+		return;
+	}
+	ret = request_firmware(&fw, symblob, dev);
+	if (ret) {
+		root_device_unregister(dev);
+		printk(KERN_WARNING "lkmd: cannot load %s, error %d\n", symblob, ret);
+		return;
+	}
+	b = vmalloc(fw->size);
+	if (b)
+		memcpy(b, fw->data, fw->size);
+	err = b ? kdb_blob_check(b, fw->size) : "out of memory";
+	if (!err)
+		err = kdb_blob_match(b, &text);
+	release_firmware(fw);
+	root_device_unregister(dev);
+	if (err) {
+		printk(KERN_WARNING "lkmd: %s not used, %s\n", symblob, err);
+		vfree(b);
+		return;
+	}
+	kdb_blob_text = text;
+	kdb_blob = b;
+	printk(KERN_INFO "lkmd: %s: %u symbols, %u line rows\n",
+	       symblob, b->nsyms, b->nrows);
+}
+
+void kdb_blob_exit(void)
+{
+	vfree((void *)kdb_blob);
+	kdb_blob = NULL;
+}
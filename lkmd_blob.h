@@ -0,0 +1,80 @@
+#ifndef _LKMD_BLOB_H
+#define _LKMD_BLOB_H
+
+/*
+ * Kernel Debugger Symbol and Line Table Blob Format
+ *
+ * This file is subject to the terms and conditions of the GNU General Public
+ * License.  See the file "COPYING" in the main directory of this archive
+ * for more details.
+ *
+ * The blob is written by tools/lkmd-symblob from a vmlinux and read by
+ * lkmd_blob.c.  It is used where it is loaded, there are no pointers and
+ * every part is found through an offset from the start of the blob.  All
+ * values are little endian.  Addresses are offsets from _text, the blob
+ * is valid for any KASLR slide of the kernel it was built from.
+ *
+ *	header
+ *	syms	lkmd_blob_sym[nsyms], sorted by off
+ *	files	__u32[nfiles], string offsets of the source file names
+ *	blocks	lkmd_blob_lblock[nblocks], sorted by off
+ *	strings	string pool, starts with an empty string
+ *	lines	encoded line table rows
+ *
+ * The line table is a list of rows {off, file, line} sorted by off, a row
+ * holds for every address up to the next row, line 0 marks addresses
+ * without line information.  The rows are cut into blocks of
+ * LKMD_BLOB_LBLOCK, the first row of a block is kept in the block, the
+ * others are encoded at lines + pos as
+ *
+ *	uleb128((off delta << 1) | file changed)
+ *	sleb128(line delta)
+ *	uleb128(file)		only if the file changed
+ */
+
+#include <linux/types.h>
+
+#define LKMD_BLOB_MAGIC		"LKMDSYM1"
+#define LKMD_BLOB_VERSION	1
+#define LKMD_BLOB_LBLOCK	64	/* rows per line table block */
+
+/* lkmd_blob_sym.flags */
+#define LKMD_BLOB_GLOBAL	0x1	/* global or weak binding */
+#define LKMD_BLOB_FUNC		0x2	/* function */
+
+struct lkmd_blob_hdr {
+	char	magic[8];
+	__u32	version;
+	__u32	size;		/* of the whole blob */
+	__u64	text;		/* link address of _text */
+	__u32	image_size;	/* _end - _text */
+	__u32	banner;		/* string offset of linux_banner, 0 if unknown */
+	__u32	nsyms;
+	__u32	syms;
+	__u32	nfiles;
+	__u32	files;
+	__u32	nrows;
+	__u32	nblocks;
+	__u32	blocks;
+	__u32	strings;
+	__u32	strings_size;
+	__u32	lines;
+	__u32	lines_size;
+	__u32	pad;
+};
+
+struct lkmd_blob_sym {
+	__u32	off;		/* from _text */
+	__u32	size;
+	__u32	name;		/* string offset */
+	__u32	flags;
+};
+
+struct lkmd_blob_lblock {
+	__u32	off;		/* first row of the block */
+	__u32	file;
+	__u32	line;
+	__u32	pos;		/* of the other rows, from lines */
+};
+
+#endif	/* !_LKMD_BLOB_H */
@@ -13,6 +13,8 @@
 #include <linux/init.h>
 #include <linux/ctype.h>
 #include <linux/string.h>
+#include <linux/crc32.h>
+#include <linux/atomic.h>
 #include "lkmd.h"
 #include "lkmd_private.h"
 
@@ -35,6 +37,8 @@ disassemble_info kdb_di;
  * Locking:
  *	None.
  * Remarks:
+ *	When a symbol blob is loaded the source line is printed before
+ *	the first instruction of each line.
  */
 
 int
@@ -51,6 +55,8 @@ kdb_id(int argc, const char **argv)
 	struct disassemble_info *dip = &kdb_di;
 	char lastbuf[50];
 	unsigned long word;
+	const char *file, *lastfile = NULL;
+	unsigned int line, lastline = 0;
 
 	kdb_di.fprintf_func = kdb_dis_fprintf;
 	kdba_id_init(&kdb_di);
@@ -92,6 +98,12 @@ kdb_id(int argc, const char **argv)
 	}
 
 	for(i=0; i<icount; i++) {
+		if (kdb_blob_line(pc, &file, &line) &&
+		    (line != lastline || file != lastfile)) {
+			lkmd_printf("%s:%u\n", file, line);
+			lastfile = file;
+			lastline = line;
+		}
 		pc += kdba_id_printinsn(pc, &kdb_di);
 		lkmd_printf("\n");
 	}
@@ -101,6 +113,695 @@ kdb_id(int argc, const char **argv)
 	return 0;
 }
 
+/*
+ * Decoded function cache.  idf and ssb decode whole functions, bounded
+ * by kdbnearsym, and keep the result with the basic block boundaries
+ * worked out.  A slot is keyed by the function's address range and the
+ * crc32 of its text.  The crc is checked again whenever
+ * kdb_getarea_generation has moved, i.e. after any write through kdb
+ * and on every return to the kernel, so patched or reloaded text is
+ * decoded afresh.
+ */
+
+#define KDB_FCACHE_FUNCS	4
+#define KDB_FCACHE_INSNS	2048	/* longest function that is cached */
+
+static struct kdb_fcache {
+	unsigned long start;		/* 0 if the slot is empty */
+	unsigned long end;
+	u32 crc;			/* of the text from start to end */
+	unsigned long generation;	/* kdb_getarea_generation at last check */
+	int count;			/* instructions */
+	int blocks;			/* basic blocks */
+	kdb_insn_t insn[KDB_FCACHE_INSNS];
+} kdb_fcache[KDB_FCACHE_FUNCS];
+static int kdb_fcache_next;		/* next slot to replace */
+static unsigned long kdb_fcache_failed;	/* last function that could not be cached */
+static unsigned long kdb_fcache_failed_gen;
+static unsigned char kdb_fcache_buf[256];
+
+/*
+ * kdb_fcache_crc
+ *
+ *	Checksum the text of a function.
+ * Inputs:
+ *	start	First byte of the function.
+ *	end	First byte after the function.
+ * Outputs:
+ *	*crc	crc32 of the text.
+ * Returns:
+ *	0 for success, KDB_BADADDR if the text could not be read.
+ * Locking:
+ *	none.
+ */
+
+static int kdb_fcache_crc(unsigned long start, unsigned long end, u32 *crc)
+{
+	unsigned long a;
+	size_t n;
+
+	*crc = ~0;
+	for (a = start; a < end; a += n) {
+		n = min_t(unsigned long, end - a, sizeof(kdb_fcache_buf));
+		if (kdb_getarea_bulk(kdb_fcache_buf, a, n, NULL))
+			return KDB_BADADDR;
+		*crc = crc32_le(*crc, kdb_fcache_buf, n);
+	}
+	return 0;
+}
+
+/*
+ * kdb_fcache_insn
+ *
+ *	Find the instruction that starts at an address in a cached
+ *	function.
+ * Inputs:
+ *	f	Cache slot.
+ *	addr	Address inside the function.
+ * Outputs:
+ *	none.
+ * Returns:
+ *	Index of the instruction, -1 if addr is not the start of one.
+ * Locking:
+ *	none.
+ */
+
+static int kdb_fcache_insn(const struct kdb_fcache *f, unsigned long addr)
+{
+	unsigned long offset = addr - f->start;
+	int lo = 0, hi = f->count - 1, mid;
+
+	while (lo <= hi) {
+		mid = (lo + hi) / 2;
+		if (f->insn[mid].offset == offset)
+			return mid;
+		if (f->insn[mid].offset < offset)
+			lo = mid + 1;
+		else
+			hi = mid - 1;
+	}
+	return -1;
+}
+
+/*
+ * kdb_fcache_find
+ *
+ *	Find the cached function containing an address.
+ * Inputs:
+ *	addr	Address.
+ * Outputs:
+ *	none.
+ * Returns:
+ *	The cache slot, NULL if no valid slot covers addr.
+ * Locking:
+ *	none.
+ * Remarks:
+ *	A slot whose text no longer matches its crc is dropped.
+ */
+
+static struct kdb_fcache *kdb_fcache_find(unsigned long addr)
+{
+	struct kdb_fcache *f;
+	u32 crc;
+
+	for (f = kdb_fcache; f < kdb_fcache + KDB_FCACHE_FUNCS; ++f) {
+		if (!f->start || addr < f->start || addr >= f->end)
+			continue;
+		if (f->generation == kdb_getarea_generation)
+			return f;
+		if (kdb_fcache_crc(f->start, f->end, &crc) || crc != f->crc) {
+			f->start = 0;
+			return NULL;
+		}
+		f->generation = kdb_getarea_generation;
+		return f;
+	}
+	return NULL;
+}
+
+/*
+ * kdb_fcache_fill
+ *
+ *	Decode a function into the cache and find its basic blocks.
+ * Inputs:
+ *	start	First byte of the function.
+ *	end	First byte after the function.
+ * Outputs:
+ *	none.
+ * Returns:
+ *	The cache slot, NULL if the text could not be read or the
+ *	function is too long to cache.
+ * Locking:
+ *	none.
+ * Remarks:
+ *	A block starts at the function entry, after every jump, return,
+ *	int or syscall and at every direct branch target inside the
+ *	function.  Calls do not end a block.
+ */
+
+static struct kdb_fcache *kdb_fcache_fill(unsigned long start, unsigned long end)
+{
+	struct kdb_fcache *f = &kdb_fcache[kdb_fcache_next];
+	unsigned long pc;
+	kdb_insn_t *insn;
+	int i, j, len;
+
+	f->start = 0;
+	if (end - start > USHRT_MAX || kdb_fcache_crc(start, end, &f->crc))
+		return NULL;
+	f->count = 0;
+	for (pc = start; pc < end; pc += len) {
+		if (f->count == KDB_FCACHE_INSNS)
+			return NULL;
+		insn = &f->insn[f->count];
+		if ((len = kdba_id_classify(pc, insn)) < 0)
+			return NULL;
+		insn->offset = pc - start;
+		f->count++;
+	}
+	f->start = start;
+	f->end = end;
+	f->generation = kdb_getarea_generation;
+
+	f->insn[0].flags |= KDB_INSN_BLOCK;
+	for (i = 0; i < f->count; ++i) {
+		insn = &f->insn[i];
+		if ((insn->flags & KDB_INSN_BRANCH) && i + 1 < f->count)
+			f->insn[i + 1].flags |= KDB_INSN_BLOCK;
+		if ((insn->flags & (KDB_INSN_TARGET | KDB_INSN_CALL)) != KDB_INSN_TARGET ||
+		    insn->target < start || insn->target >= end)
+			continue;
+		if ((j = kdb_fcache_insn(f, insn->target)) >= 0)
+			f->insn[j].flags |= KDB_INSN_BLOCK | KDB_INSN_JOIN;
+	}
+	for (i = f->blocks = 0; i < f->count; ++i)
+		if (f->insn[i].flags & KDB_INSN_BLOCK)
+			f->blocks++;
+
+	if (KDB_DEBUG(BB_SUMM))
+		lkmd_printf("kdb_fcache: decoded 0x%lx-0x%lx, %d insns, %d blocks\n",
+			    start, end, f->count, f->blocks);
+	kdb_fcache_next = (kdb_fcache_next + 1) % KDB_FCACHE_FUNCS;
+	return f;
+}
+
+/*
+ * kdb_fcache_get
+ *
+ *	Return the cached function containing an address, decoding it
+ *	first if necessary.
+ * Inputs:
+ *	addr	Address inside the function.
+ * Outputs:
+ *	symtab	Filled in by kdbnearsym.
+ * Returns:
+ *	The cache slot, NULL if addr is not in a known function or the
+ *	function cannot be cached.
+ * Locking:
+ *	none.
+ */
+
+static struct kdb_fcache *kdb_fcache_get(unsigned long addr, kdb_symtab_t *symtab)
+{
+	struct kdb_fcache *f;
+
+	if (!kdbnearsym(addr, symtab) || symtab->sym_end <= symtab->sym_start)
+		return NULL;
+	if ((f = kdb_fcache_find(addr)) &&
+	    f->start == symtab->sym_start && f->end == symtab->sym_end)
+		return f;
+	if (f)
+		f->start = 0;
+	/* Do not decode a function that is too long again at every step */
+	if (symtab->sym_start == kdb_fcache_failed &&
+	    kdb_fcache_failed_gen == kdb_getarea_generation)
+		return NULL;
+	if (!(f = kdb_fcache_fill(symtab->sym_start, symtab->sym_end))) {
+		kdb_fcache_failed = symtab->sym_start;
+		kdb_fcache_failed_gen = kdb_getarea_generation;
+	}
+	return f;
+}
+
+/*
+ * kdb_id_lookup
+ *
+ *	Return the decoded instruction at an address from the function
+ *	cache.
+ * Inputs:
+ *	pc	Address of the instruction.
+ * Outputs:
+ *	none.
+ * Returns:
+ *	The instruction, NULL if pc is not the start of an instruction
+ *	in a function that can be cached.  The pointer is only valid
+ *	until the next call.
+ * Locking:
+ *	none.
+ * Remarks:
+ *	Used when stepping, so that the stops within one function share
+ *	a single decode of it.
+ */
+
+const kdb_insn_t *kdb_id_lookup(unsigned long pc)
+{
+	struct kdb_fcache *f;
+	kdb_symtab_t symtab;
+	int i;
+
+	if (!(f = kdb_fcache_find(pc)) && !(f = kdb_fcache_get(pc, &symtab)))
+		return NULL;
+	if ((i = kdb_fcache_insn(f, pc)) < 0)
+		return NULL;
+	return &f->insn[i];
+}
+
+/*
+ * kdb_idf
+ *
+ * 	Handle the idf (instruction display, function) command.
+ *
+ *	idf <func>
+ *
+ * Parameters:
+ *	argc	Count of arguments in argv
+ *	argv	Space delimited command line arguments
+ * Outputs:
+ *	None.
+ * Returns:
+ *	Zero for success, a kdb diagnostic if failure.
+ * Locking:
+ *	None.
+ * Remarks:
+ *	Disassembles the whole function containing the address, with a
+ *	label in front of each basic block and the block that each
+ *	branch inside the function goes to.
+ */
+
+int
+kdb_idf(int argc, const char **argv)
+{
+	static unsigned short block[KDB_FCACHE_INSNS];
+	struct kdb_fcache *f;
+	kdb_symtab_t symtab;
+	const kdb_insn_t *insn;
+	kdb_machreg_t addr;
+	long offset = 0;
+	int nextarg, diag, i, j, b;
+	char *mode;
+	const char *file, *lastfile = NULL;
+	unsigned int line, lastline = 0;
+
+	if (argc != 1)
+		return KDB_ARGCOUNT;
+	nextarg = 1;
+	diag = kdbgetaddrarg(argc, argv, &nextarg, &addr, &offset, NULL);
+	if (diag)
+		return diag;
+	kdba_check_pc(&addr);
+
+	kdb_di.fprintf_func = kdb_dis_fprintf;
+	kdba_id_init(&kdb_di);
+	mode = kdbgetenv("IDMODE");
+	diag = kdba_id_parsemode(mode, &kdb_di);
+	if (diag)
+		return diag;
+
+	if (!(f = kdb_fcache_get(addr, &symtab))) {
+		if (!symtab.sym_name)
+			lkmd_printf("idf: no function at 0x%lx\n", addr);
+		else
+			lkmd_printf("idf: cannot decode %s, use id\n", symtab.sym_name);
+		return 0;
+	}
+
+	for (i = 0, b = -1; i < f->count; ++i) {
+		if (f->insn[i].flags & KDB_INSN_BLOCK)
+			++b;
+		block[i] = b;
+	}
+	lkmd_printf("%s: %d instructions, %d basic blocks\n",
+		    symtab.sym_name, f->count, f->blocks);
+
+	for (i = 0; i < f->count; ++i) {
+		insn = &f->insn[i];
+		addr = f->start + insn->offset;
+		if (insn->flags & KDB_INSN_BLOCK) {
+			lkmd_printf("bb%d:%s\n", block[i],
+				    insn->flags & KDB_INSN_JOIN ? "\t\t<- branch target" : "");
+			if (KDB_DEBUG(BB)) {
+				for (j = i + 1; j < f->count && block[j] == block[i]; ++j)
+					;
+				lkmd_printf("  [0x%lx-0x%lx) %d insns\n", addr,
+					    j < f->count ? f->start + f->insn[j].offset : f->end,
+					    j - i);
+			}
+		}
+		if (kdb_blob_line(addr, &file, &line) &&
+		    (line != lastline || file != lastfile)) {
+			lkmd_printf("%s:%u\n", file, line);
+			lastfile = file;
+			lastline = line;
+		}
+		kdba_id_printinsn(addr, &kdb_di);
+		if ((insn->flags & (KDB_INSN_TARGET | KDB_INSN_CALL)) == KDB_INSN_TARGET &&
+		    insn->target >= f->start && insn->target < f->end &&
+		    (j = kdb_fcache_insn(f, insn->target)) >= 0)
+			lkmd_printf("\t-> bb%d", block[j]);
+		lkmd_printf("\n");
+	}
+	return 0;
+}
+
+/*
+ * Cross reference search.  xref finds the direct calls, jumps and
+ * conditional jumps to an address by running the length decoder over
+ * all kernel and module text, split into chunks for the worker pool.
+ * Each chunk starts decoding at the start of the symbol that contains
+ * it, and realigns at every following symbol start, so that it sees
+ * the same instructions as a scan of each function from its entry.
+ * Each chunk keeps its own lowest sites and the chunks are merged in
+ * address order, so when there are too many the lowest ones are kept.
+ * The sites found for the last few targets are kept until memory is
+ * written, kdb resumes the kernel or a module comes or goes.
+ */
+
+#define KDB_XREF_SLOTS		32		/* chunks per round */
+#define KDB_XREF_CHUNK		(256*1024)	/* bytes of text per chunk */
+#define KDB_XREF_BUFSIZE	PAGE_SIZE
+#define KDB_XREF_MAXSITES	512		/* sites kept for one target */
+#define KDB_XREF_CACHE		8		/* targets kept */
+
+static struct kdb_xref {
+	unsigned long target;
+	unsigned long generation;	/* kdb_getarea_generation */
+	unsigned int symgen;		/* kdb_sym_generation */
+	int valid;
+	int nsites;			/* sites found, may exceed KDB_XREF_MAXSITES */
+	unsigned long site[KDB_XREF_MAXSITES];
+} kdb_xref_cache[KDB_XREF_CACHE];
+static int kdb_xref_next;		/* next entry to replace */
+
+static unsigned char kdb_xref_buf[KDB_XREF_SLOTS][KDB_XREF_BUFSIZE];
+
+/* Sites found by each chunk of a round, and room to merge them */
+static unsigned long kdb_xref_found[KDB_XREF_SLOTS][KDB_XREF_MAXSITES];
+static int kdb_xref_nfound[KDB_XREF_SLOTS];
+static unsigned long kdb_xref_merged[KDB_XREF_MAXSITES];
+
+/* The search being run, read by the worker function */
+static struct {
+	struct kdb_xref *x;
+	unsigned long round;		/* start of the current round */
+	unsigned long start;		/* text being searched */
+	unsigned long end;
+} kdb_xref_job;
+
+static unsigned long kdb_xref_next_mapped(unsigned long addr)
+{
+#ifdef kdba_next_mapped
+	return kdba_next_mapped(addr);
+#else
+	return (addr | ~PAGE_MASK) + 1;
+#endif	/* kdba_next_mapped */
+}
+
+/*
+ * kdb_xref_chunk
+ *
+ *	Worker function, find the branches to the target in one chunk
+ *	of text.
+ *
+ * Inputs:
+ *	start	Start of the chunk.
+ *	end	End of the chunk, instructions must start before end.
+ *	data	Unused.
+ * Outputs:
+ *	The lowest sites are stored in the chunk's kdb_xref_found slot.
+ * Returns:
+ *	The number of sites found.
+ * Locking:
+ *	none.
+ * Remarks:
+ *	Runs on any cpu in kdb, must not print.  A fault skips to the
+ *	next address that may be mapped.
+ */
+
+static long kdb_xref_chunk(unsigned long start, unsigned long end, void *data)
+{
+	int slot = (start - kdb_xref_job.round) / KDB_XREF_CHUNK;
+	unsigned char *buf = kdb_xref_buf[slot];
+	unsigned long pos, next, base = 0, off;
+	size_t valid = 0, want;
+	kdb_insn_t insn;
+	long found = 0;
+	int len;
+
+	pos = kdb_sym_span(start, &next);
+	if (pos < kdb_xref_job.start || start - pos > KDB_XREF_CHUNK)
+		pos = start;
+	while (pos < end) {
+		if (pos >= next) {
+			pos = next;
+			kdb_sym_span(pos, &next);
+			continue;
+		}
+		off = pos - base;
+		len = -1;
+		if (pos >= base && off < valid)
+			len = kdba_insn_len(buf + off, valid - off, pos, &insn);
+		if (len < 0) {
+			if (pos == base && valid) {
+				/* Cut short by a fault or the end of the text */
+				pos = base + valid;
+				continue;
+			}
+			want = min_t(unsigned long, KDB_XREF_BUFSIZE, kdb_xref_job.end - pos);
+			kdb_getarea_bulk(buf, pos, want, &valid);
+			base = pos;
+			if (!valid) {
+				pos = kdb_xref_next_mapped(pos);
+				if (pos <= base)
+					break;
+			}
+			continue;
+		}
+		if ((insn.flags & KDB_INSN_TARGET) &&
+		    insn.target == kdb_xref_job.x->target && pos >= start) {
+			/* pos only grows, the first sites are the lowest */
+			if (found < KDB_XREF_MAXSITES)
+				kdb_xref_found[slot][found] = pos;
+			++found;
+		}
+		pos += len;
+	}
+	kdb_xref_nfound[slot] = min_t(long, found, KDB_XREF_MAXSITES);
+	return found;
+}
+
+/*
+ * kdb_xref_merge
+ *
+ *	Merge the sites of one round into the sites kept so far.
+ *
+ * Inputs:
+ *	x	Cache entry being searched.
+ *	kept	Number of sites in x->site, sorted.
+ * Outputs:
+ *	x->site holds the lowest sites of both, sorted.
+ * Returns:
+ *	The number of sites now in x->site.
+ * Locking:
+ *	none.
+ * Remarks:
+ *	The chunks of a round are in address order, so each slot is
+ *	merged in turn.
+ */
+
+static int kdb_xref_merge(struct kdb_xref *x, int kept)
+{
+	unsigned long *a, *b;
+	int slot, i, j, k, na, nb;
+
+	for (slot = 0; slot < KDB_XREF_SLOTS; ++slot) {
+		a = x->site;
+		na = kept;
+		b = kdb_xref_found[slot];
+		nb = kdb_xref_nfound[slot];
+		if (!nb)
+			continue;
+		for (i = j = k = 0; k < KDB_XREF_MAXSITES && (i < na || j < nb); ++k) {
+			if (j == nb || (i < na && a[i] < b[j]))
+				kdb_xref_merged[k] = a[i++];
+			else
+				kdb_xref_merged[k] = b[j++];
+		}
+		memcpy(x->site, kdb_xref_merged, k * sizeof(x->site[0]));
+		kept = k;
+	}
+	return kept;
+}
+
+/*
+ * kdb_xref_searched
+ *
+ *	Has a text range already been searched?
+ *
+ * Inputs:
+ *	i	Index of the range for kdb_sym_text.
+ *	start	Start of the range.
+ *	end	End of the range.
+ * Returns:
+ *	1 if an earlier range covers it, otherwise 0.
+ * Remarks:
+ *	A module whose symbols kallsyms lists twice has its text listed
+ *	twice, it is only searched once.
+ */
+
+static int kdb_xref_searched(unsigned long i, unsigned long start, unsigned long end)
+{
+	unsigned long j, s, e;
+
+	for (j = 0; j < i; ++j) {
+		if (kdb_sym_text(j, &s, &e) > 0 && s <= start && end <= e)
+			return 1;
+	}
+	return 0;
+}
+
+/*
+ * kdb_xref_search
+ *
+ *	Search all text for the branches to a target.
+ *
+ * Inputs:
+ *	x	Cache entry, target is set.
+ * Outputs:
+ *	The sites are stored in x, sorted, the lowest ones if there are
+ *	more than KDB_XREF_MAXSITES.
+ * Returns:
+ *	0 for success, 1 if interrupted, a kdb diagnostic if error.
+ * Locking:
+ *	none.
+ */
+
+static int kdb_xref_search(struct kdb_xref *x)
+{
+	unsigned long i, start, end, round_end;
+	long ret;
+	int kept = 0;
+
+	kdb_xref_job.x = x;
+	x->nsites = 0;
+	for (i = 0; kdb_sym_text(i, &start, &end) > 0; ++i) {
+		if (kdb_xref_searched(i, start, end))
+			continue;
+		kdb_xref_job.start = start;
+		kdb_xref_job.end = end;
+		for (kdb_xref_job.round = start; kdb_xref_job.round < end;
+		     kdb_xref_job.round = round_end) {
+			round_end = kdb_xref_job.round +
+				min(end - kdb_xref_job.round,
+				    (unsigned long)KDB_XREF_SLOTS * KDB_XREF_CHUNK);
+			memset(kdb_xref_nfound, 0, sizeof(kdb_xref_nfound));
+			ret = kdb_work_run(kdb_xref_chunk, NULL, kdb_xref_job.round,
+					   round_end, KDB_XREF_CHUNK);
+			if (ret < 0)
+				return ret;
+			x->nsites += ret;
+			kept = kdb_xref_merge(x, kept);
+			if (kdb_poll_interrupt())
+				return 1;
+		}
+	}
+	return 0;
+}
+
+/*
+ * kdb_xref
+ *
+ * 	Handle the xref (cross reference) command.
+ *
+ *	xref <vaddr>
+ *
+ * Parameters:
+ *	argc	Count of arguments in argv
+ *	argv	Space delimited command line arguments
+ * Outputs:
+ *	None.
+ * Returns:
+ *	Zero for success, a kdb diagnostic if failure.
+ * Locking:
+ *	None.
+ * Remarks:
+ *	Lists every direct call, jump and conditional jump to the
+ *	address in kernel and module text, one disassembled line each.
+ *	Indirect branches and branches through the PLT of a module are
+ *	not found.  A repeated search in the same session is answered
+ *	from the cache.
+ */
+
+int
+kdb_xref(int argc, const char **argv)
+{
+	struct kdb_xref *x;
+	kdb_machreg_t addr;
+	unsigned int symgen = kdb_sym_generation();
+	unsigned long start, end;
+	long offset = 0;
+	int nextarg, diag, i, n, cached = 0;
+
+	if (argc != 1)
+		return KDB_ARGCOUNT;
+	nextarg = 1;
+	diag = kdbgetaddrarg(argc, argv, &nextarg, &addr, &offset, NULL);
+	if (diag)
+		return diag;
+	if (kdb_sym_text(0, &start, &end) <= 0) {
+		lkmd_printf("xref: no symbol index, text ranges unknown\n");
+		return 0;
+	}
+
+	for (x = kdb_xref_cache; x < kdb_xref_cache + KDB_XREF_CACHE; ++x) {
+		if (x->valid && x->target == addr && x->symgen == symgen &&
+		    x->generation == kdb_getarea_generation) {
+			cached = 1;
+			break;
+		}
+	}
+	if (!cached) {
+		x = &kdb_xref_cache[kdb_xref_next];
+		kdb_xref_next = (kdb_xref_next + 1) % KDB_XREF_CACHE;
+		x->valid = 0;
+		x->target = addr;
+		x->symgen = symgen;
+		x->generation = kdb_getarea_generation;
+		diag = kdb_xref_search(x);
+		if (diag < 0)
+			return diag;
+		if (diag) {
+			lkmd_printf("xref: interrupted\n");
+			return 0;
+		}
+		x->valid = 1;
+	}
+
+	kdb_di.fprintf_func = kdb_dis_fprintf;
+	kdba_id_init(&kdb_di);
+	n = min(x->nsites, KDB_XREF_MAXSITES);
+	for (i = 0; i < n; ++i) {
+		kdba_id_printinsn(x->site[i], &kdb_di);
+		lkmd_printf("\n");
+	}
+	lkmd_printf("%d site%s", x->nsites, x->nsites == 1 ? "" : "s");
+	if (n < x->nsites)
+		lkmd_printf(", lowest %d shown", n);
+	lkmd_printf("%s\n", cached ? " (cached)" : "");
+	if (kdb_sym_text(1, &start, &end) < 0)
+		lkmd_printf("xref: modules changed since the symbol index was built, module text not searched\n");
+	return 0;
+}
+
 /*
  * kdb_id1
  *
@@ -121,6 +822,8 @@ void kdb_id1(unsigned long pc)
 {
 	char *mode;
 	int diag;
+	const char *file;
+	unsigned int line;
 
 	kdb_di.fprintf_func = kdb_dis_fprintf;
 	kdba_id_init(&kdb_di);
@@ -132,6 +835,9 @@ void kdb_id1(unsigned long pc)
 		lkmd_printf("kdb_id: bad value in 'IDMODE' environment variable ignored\n");
 	}
 
+	if (kdb_blob_line(pc, &file, &line))
+		lkmd_printf("%s:%u\n", file, line);
+
 	(void) kdba_id_printinsn(pc, &kdb_di);
 	lkmd_printf("\n");
 }
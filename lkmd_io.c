@@ -9,6 +9,8 @@
  */
 
 #include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/version.h>
 #include <linux/types.h>
 #include <linux/ctype.h>
 #include <linux/kernel.h>
@@ -23,6 +25,10 @@
 #include <linux/kallsyms.h>
 #include <linux/input.h>
 #include <linux/tty.h>
+#include <linux/vmalloc.h>
+#include <linux/proc_fs.h>
+#include <linux/uaccess.h>
+#include <linux/log2.h>
 #include "lkmd.h"
 #include "lkmd_private.h"
 
@@ -38,7 +44,11 @@ char *lkmd_read(char *buffer, size_t bufsize)
 	char *lastchar;
 	char tmp;
 	static char tmpbuffer[CMD_BUFLEN];
+	static int tab;
 	int len = strlen(buffer);
+	int count, i, dtab_count, n;
+	const char *name;
+	char *p;
 	get_char_func *f;
 
 	if (len > 0 ) {
@@ -50,6 +60,7 @@ char *lkmd_read(char *buffer, size_t bufsize)
 	lastchar = cp;
 	*cp = '\0';
 	lkmd_printf("%s", buffer);
+	kdb_output_flush();	/* Show any command output before waiting */
 
 	for (;;) {
 		int key;
@@ -74,6 +85,8 @@ char *lkmd_read(char *buffer, size_t bufsize)
 			break;	/* A key to process */
 		}
 
+		if (key != 9)
+			tab = 0;
 		switch (key) {
 		case 8: /* backspace */
 			if (cp > buffer) {
@@ -91,6 +104,65 @@ char *lkmd_read(char *buffer, size_t bufsize)
 				*cp = tmp;
 			}
 			break;
+		case 9: /* Tab */
+			if (tab < 2)
+				++tab;
+			/* Complete the word that ends at the cursor */
+			for (p = cp; p > buffer && p[-1] != ' '; --p)
+				;
+			len = cp - p;
+			if (len >= sizeof(tmpbuffer))
+				break;
+			memcpy(tmpbuffer, p, len);
+			tmpbuffer[len] = '\0';
+			n = min_t(int, sizeof(tmpbuffer), len + (bufend - lastchar) + 1);
+			count = kdb_sym_complete(tmpbuffer, n);
+			if (tab == 2 && count > 0) {
+				if (kdbgetintenv("DTABCOUNT", &dtab_count) || dtab_count <= 0)
+					dtab_count = 30;
+				lkmd_printf("\n%d symbols are found.", count);
+				if (count > dtab_count) {
+					count = dtab_count;
+					lkmd_printf(" But only first %d symbols will be printed.\n"
+						    "You can change the environment variable DTABCOUNT.", count);
+				}
+				lkmd_printf("\n");
+				for (i = 0; i < count; i++) {
+					name = kdb_sym_complete_next(tmpbuffer, i);
+					if (!name)
+						break;
+					lkmd_printf("%s ", name);
+				}
+				if (i >= dtab_count)
+					lkmd_printf("...");
+				lkmd_printf("\n");
+				lkmd_printf(kdb_prompt_str);
+				lkmd_printf("%s\r", buffer);
+				tmp = *cp;
+				*cp = '\0';
+				lkmd_printf(kdb_prompt_str);
+				lkmd_printf("%s", buffer);
+				*cp = tmp;
+			} else if (tab != 2 && count > 0) {
+				n = strlen(tmpbuffer) - len;
+				if (n > 0) {
+					memmove(cp + n, cp, lastchar - cp + 1);
+					memcpy(cp, tmpbuffer + len, n);
+					lastchar += n;
+					lkmd_printf("%s", cp);
+					cp += n;
+					if (cp < lastchar) {
+						tmp = *cp;
+						*cp = '\0';
+						lkmd_printf("\r");
+						lkmd_printf(kdb_prompt_str);
+						lkmd_printf("%s", buffer);
+						*cp = tmp;
+					}
+				}
+			}
+			kdb_nextline = 1;	/* Reset output line number */
+			break;
 		case 13: /* enter \r */
 		case 10: /* enter \n */
 			*lastchar++ = '\n';
@@ -242,138 +314,955 @@ empty:
 }
 
 /*
- * lkmd_printf
+ * kdb_poll_interrupt
  *
- *	Print a string to the output device(s).
+ *	Check whether a key has been pressed, used by long running
+ *	commands that print nothing for a long time.
  *
  * Parameters:
- *	printf-like format and optional args.
+ *	None.
  * Returns:
- *	0
+ *	1 if a key was pressed, the key is discarded and the command
+ *	interrupt flag is set, 0 otherwise.
  * Locking:
- *	None.
+ *	none
  * Remarks:
- *	use 'kdbcons->write()' to avoid polluting 'log_buf' with kdb output.
+ *	Only a single poll of each input device, this does not wait.
+ */
+
+int kdb_poll_interrupt(void)
+{
+	get_char_func *f;
+
+	for (f = &poll_funcs[0]; *f; ++f) {
+		if ((*f)() != -1) {
+			KDB_FLAG_SET(CMD_INTERRUPT);
+			kdb_input_flush();
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/*
+ * Output engine
+ *
+ *	While a command runs its output is collected in kdb_obuf and written
+ *	to the consoles a block of whole lines at a time, instead of one
+ *	console write per lkmd_printf.  Outside commands (prompt, echo of
+ *	the input, entry messages) and on recursion the text is written
+ *	through at once.  The pager counts the lines as they are added to
+ *	the buffer and writes out everything up to the line that fills the
+ *	screen before it prompts.
+ *
+ *	LINES and LOGGING are read from the environment when a command
+ *	starts, not on every call.  Within a kdb session output only goes
+ *	to the printk log when LOGGING is set.  Outside one (messages at
+ *	module load and the like) it goes to printk alone, which writes it
+ *	to the consoles under the console lock.
+ *
+ *	A command can be followed by a pipeline of output filters, see
+ *	kdb_output_filter, they see each complete line before the pager.
+ *	With capture on, everything written also goes to a ring that is
+ *	read from /proc/lkmd_capture after kdb resumes, see kdb_capture.
  */
 
-static char kdb_buffer[256];	/* A bit too big to go on stack */
+#define KDB_OBUF_SIZE	16384
+#define KDB_OBUF_FLUSH	(KDB_OBUF_SIZE - 512)	/* write out lines past here */
+
+static char kdb_obuf[KDB_OBUF_SIZE];
+static int kdb_obuf_len;
+static int kdb_obuf_line;		/* start of the incomplete last line */
+static int kdb_obuf_depth;		/* kdb_output_begin nesting */
+static int kdb_obuf_lines;		/* cached LINES */
+static int kdb_obuf_logging;		/* cached LOGGING */
+static char kdb_nested_buf[256];	/* recursive calls, written through */
+static DEFINE_SPINLOCK(kdb_printf_lock);
+
+static unsigned long capture_size = 4 << 20;
+module_param(capture_size, ulong, 0444);
+MODULE_PARM_DESC(capture_size, "Bytes of kdb output kept for /proc/lkmd_capture, 0 disables capture");
+
+#define KDB_CAPTURE_OFF		0
+#define KDB_CAPTURE_ON		1	/* console and ring */
+#define KDB_CAPTURE_ONLY	2	/* command output only to the ring */
+
+static struct {
+	char *data;
+	unsigned long size;		/* power of 2 */
+	u64 head;			/* bytes ever captured */
+	int mode;
+	int quiet;			/* this command is not shown */
+} kdb_capture_ring;
+
+static void kdb_capture_add(const char *s, unsigned len)
+{
+	unsigned long off, n;
+
+	while (len) {
+		off = kdb_capture_ring.head & (kdb_capture_ring.size - 1);
+		n = min_t(unsigned long, len, kdb_capture_ring.size - off);
+		memcpy(kdb_capture_ring.data + off, s, n);
+		kdb_capture_ring.head += n;
+		s += n;
+		len -= n;
+	}
+}
 
 static void lkmd_console_write(const char *s, unsigned len)
 {
 	struct console *c = console_drivers;
 
-	/* Write to all consoles. */
+	if (!len)
+		return;
+	if (kdb_capture_ring.mode)
+		kdb_capture_add(s, len);
+	if (kdb_capture_ring.quiet)
+		return;
+	if (!KDB_IS_RUNNING()) {
+		printk("%.*s", len, s);
+		return;
+	}
+	/*
+	 * Write to all consoles, the keyboard kdb reads from is not
+	 * necessarily on the CON_CONSDEV console (console=tty0
+	 * console=ttyS0).  One watchdog touch per block.
+	 */
 	while (c) {
-		if ((c->flags & CON_ENABLED) && c->write) {
+		if ((c->flags & CON_ENABLED) && c->write)
 			c->write(c, s, len);
-		}
-		touch_nmi_watchdog();
 		c = c->next;
 	}
+	touch_nmi_watchdog();
+	if (kdb_obuf_logging)
+		printk("%.*s", len, s);
+}
 
-	printk(s);
+static void kdb_output_setup(void)
+{
+	if (kdbgetintenv("LINES", &kdb_obuf_lines) || kdb_obuf_lines <= 1)
+		kdb_obuf_lines = 22;
+	if (kdbgetintenv("LOGGING", &kdb_obuf_logging))
+		kdb_obuf_logging = 0;
 }
 
-void lkmd_printf(const char *fmt, ...)
+/* Write out the first len bytes of kdb_obuf and keep the rest */
+static void kdb_obuf_drain(int len)
 {
-	va_list ap;
-	int diag;
-	int linecount;
-	int do_longjmp = 0;
-	int got_printf_lock = 0;
-	char *moreprompt = "more> ";
-	static DEFINE_SPINLOCK(kdb_printf_lock);
-	unsigned long uninitialized_var(flags);
+	lkmd_console_write(kdb_obuf, len);
+	kdb_obuf_len -= len;
+	if (kdb_obuf_len)
+		memmove(kdb_obuf, kdb_obuf + len, kdb_obuf_len);
+	kdb_obuf_line = kdb_obuf_line > len ? kdb_obuf_line - len : 0;
+}
 
-	preempt_disable();
-	/* Serialize kdb_printf if multiple cpus try to write at once.
-	 * But if any cpu goes recursive in kdb, just print the output,
-	 * even if it is interleaved with any other text.
-	 */
-	if (!KDB_STATE(PRINTF_LOCK)) {
-		KDB_STATE_SET(PRINTF_LOCK);
-		spin_lock_irqsave(&kdb_printf_lock, flags);
-		got_printf_lock = 1;
-	} else {
-		__acquire(kdb_printf_lock);
-	}
+/*
+ * Output filters
+ *
+ *	cmd | grep [-v] <re> | head <n> | tail <n> | count | field <n>
+ *
+ *	grep keeps the lines that match a small regular expression, '^' and
+ *	'$' anchor it, '.' matches any character and '*' repeats the one
+ *	before it, anything else matches itself.  field keeps the n'th
+ *	blank separated word of each line, lines without one are dropped.
+ *	tail and count can only be the last filter, they print at the end
+ *	of the command.  Once head has passed its lines the command is
+ *	aborted like 'q' at the more prompt, the lines after them would
+ *	all be dropped anyway.
+ */
 
-	diag = kdbgetintenv("LINES", &linecount);
-	if (diag || linecount <= 1)
-		linecount = 22;
+#define KDB_FILTER_MAX		4
+#define KDB_FILTER_PATLEN	64
+#define KDB_TAIL_LINES		64
+#define KDB_TAIL_LINELEN	256
 
-	va_start(ap, fmt);
-	vsnprintf(kdb_buffer, sizeof(kdb_buffer), fmt, ap);
-	va_end(ap);
+enum kdb_filter_type {
+	KDB_FILTER_GREP,
+	KDB_FILTER_HEAD,
+	KDB_FILTER_TAIL,
+	KDB_FILTER_COUNT,
+	KDB_FILTER_FIELD,
+};
 
-	lkmd_console_write(kdb_buffer, strlen(kdb_buffer));
+struct kdb_filter {
+	enum kdb_filter_type type;
+	int invert;			/* grep -v */
+	unsigned long n;		/* head, tail and field argument */
+	unsigned long seen;		/* lines passed by head or count */
+	char pat[KDB_FILTER_PATLEN];
+};
 
-	if (KDB_STATE(LONGJMP) && strchr(kdb_buffer, '\n'))
-		kdb_nextline++;
+static struct kdb_filter kdb_filter[KDB_FILTER_MAX];
+static int kdb_nfilter;
+static int kdb_filter_done;		/* head has passed all its lines */
 
-	/* check for having reached the LINES number of printed lines */
-	if (kdb_nextline == linecount) {
-		char buf1[16]="";
-#if defined(CONFIG_SMP)
-		char buf2[32];
-#endif
+static struct {
+	char line[KDB_TAIL_LINES][KDB_TAIL_LINELEN];
+	unsigned short len[KDB_TAIL_LINES];
+	unsigned long next;		/* lines stored so far */
+} kdb_tail;
 
-		/* Watch out for recursion here.  Any routine that calls
-		 * kdb_printf will come back through here.  And kdb_read
-		 * uses kdb_printf to echo on serial consoles ...
-		 */
-		kdb_nextline = 1;	/* In case of recursion */
+static int kdb_match_here(const char *re, const char *s, const char *e);
 
-		/*
-		 * Pause until cr.
-		 */
-		moreprompt = kdbgetenv("MOREPROMPT");
-		if (moreprompt == NULL) {
-			moreprompt = "more> ";
+static int kdb_match_star(int c, const char *re, const char *s, const char *e)
+{
+	do {
+		if (kdb_match_here(re, s, e))
+			return 1;
+	} while (s < e && (*s++ == c || c == '.'));
+	return 0;
+}
+
+static int kdb_match_here(const char *re, const char *s, const char *e)
+{
+	if (!re[0])
+		return 1;
+	if (re[1] == '*')
+		return kdb_match_star(re[0], re + 2, s, e);
+	if (re[0] == '$' && !re[1])
+		return s == e;
+	if (s < e && (re[0] == '.' || re[0] == *s))
+		return kdb_match_here(re + 1, s + 1, e);
+	return 0;
+}
+
+/* Does re match anywhere in the text from s to e */
+static int kdb_match(const char *re, const char *s, const char *e)
+{
+	if (re[0] == '^')
+		return kdb_match_here(re + 1, s, e);
+	do {
+		if (kdb_match_here(re, s, e))
+			return 1;
+	} while (s++ < e);
+	return 0;
+}
+
+/* Move the n'th blank separated word to the start of s, return its length */
+static int kdb_field(char *s, int len, unsigned long n)
+{
+	int i = 0, start;
+
+	for (;;) {
+		while (i < len && isspace(s[i]))
+			i++;
+		if (i == len)
+			return -1;
+		start = i;
+		while (i < len && !isspace(s[i]))
+			i++;
+		if (--n == 0) {
+			memmove(s, s + start, i - start);
+			return i - start;
 		}
+	}
+}
 
-#if defined(CONFIG_SMP)
-		if (strchr(moreprompt, '%')) {
-			sprintf(buf2, moreprompt, get_cpu());
-			put_cpu();
-			moreprompt = buf2;
+/*
+ * kdb_filter_line
+ *
+ *	Run one line, without its newline, through the filters.
+ *
+ * Returns:
+ *	The new length of the line, -1 if the line is dropped.
+ * Locking:
+ *	Called with the printf lock held.
+ */
+
+static int kdb_filter_line(char *s, int len)
+{
+	struct kdb_filter *f;
+	int slot;
+
+	for (f = kdb_filter; f < kdb_filter + kdb_nfilter; f++) {
+		switch (f->type) {
+		case KDB_FILTER_GREP:
+			if (kdb_match(f->pat, s, s + len) == f->invert)
+				return -1;
+			break;
+		case KDB_FILTER_HEAD:
+			if (f->seen >= f->n)
+				return -1;
+			if (++f->seen == f->n)
+				kdb_filter_done = 1;
+			break;
+		case KDB_FILTER_FIELD:
+			len = kdb_field(s, len, f->n);
+			if (len < 0)
+				return -1;
+			break;
+		case KDB_FILTER_TAIL:
+			slot = kdb_tail.next++ % KDB_TAIL_LINES;
+			kdb_tail.len[slot] = min_t(int, len, KDB_TAIL_LINELEN);
+			memcpy(kdb_tail.line[slot], s, kdb_tail.len[slot]);
+			return -1;
+		case KDB_FILTER_COUNT:
+			f->seen++;
+			return -1;
 		}
-#endif
+	}
+	return len;
+}
 
-		kdb_input_flush();
-		lkmd_console_write(moreprompt, strlen(moreprompt));
+/*
+ * A line with no newline that has to be written out now, e.g. at the
+ * end of the command, goes through the filters as if it was complete.
+ */
+static void kdb_obuf_partial(void)
+{
+	int len;
 
-		lkmd_read(buf1, 2); /* '2' indicates to return immediately after getting one key. */
-		kdb_nextline = 1;	/* Really set output line 1 */
+	if (!kdb_nfilter || kdb_obuf_len == kdb_obuf_line)
+		return;
+	len = kdb_filter_line(kdb_obuf + kdb_obuf_line,
+			      kdb_obuf_len - kdb_obuf_line);
+	kdb_obuf_len = kdb_obuf_line + (len < 0 ? 0 : len);
+}
 
-		/* empty and reset the buffer: */
-		kdb_buffer[0] = '\0';
-		if ((buf1[0] == 'q') || (buf1[0] == 'Q')) {
-			/* user hit q or Q */
-			do_longjmp = 1;
-			KDB_FLAG_SET(CMD_INTERRUPT);	/* command was interrupted */
-			/* end of command output; back to normal mode */
-			lkmd_printf("\n");
-		} else if (buf1[0] && buf1[0] != '\n') {
-			/* user hit something other than enter */
-			lkmd_printf("\nOnly 'q' or 'Q' are processed at more prompt, input ignored\n");
+/* Make room for need more bytes, writing out complete lines first */
+static void kdb_obuf_room(int need)
+{
+	if (kdb_obuf_line)
+		kdb_obuf_drain(kdb_obuf_line);
+	if (KDB_OBUF_SIZE - kdb_obuf_len <= need) {
+		kdb_obuf_partial();
+		kdb_obuf_drain(kdb_obuf_len);
+	}
+}
+
+/* Print what tail and count collected and remove the filters */
+static void kdb_filter_end(void)
+{
+	struct kdb_filter *f = kdb_filter + kdb_nfilter - 1;
+	unsigned long i;
+	char buf[24];
+
+	if (!kdb_nfilter)
+		return;
+	kdb_obuf_partial();
+	kdb_obuf_drain(kdb_obuf_len);
+	if (f->type == KDB_FILTER_COUNT) {
+		snprintf(buf, sizeof(buf), "%lu\n", f->seen);
+		lkmd_console_write(buf, strlen(buf));
+	} else if (f->type == KDB_FILTER_TAIL) {
+		i = kdb_tail.next > f->n ? kdb_tail.next - f->n : 0;
+		for (; i < kdb_tail.next; i++) {
+			lkmd_console_write(kdb_tail.line[i % KDB_TAIL_LINES],
+					   kdb_tail.len[i % KDB_TAIL_LINES]);
+			lkmd_console_write("\n", 1);
 		}
-		kdb_input_flush();
 	}
+	kdb_nfilter = 0;
+	kdb_filter_done = 0;
+}
 
+/*
+ * Serialize kdb output if multiple cpus try to write at once.  But if
+ * any cpu goes recursive in kdb, just print the output, even if it is
+ * interleaved with any other text.
+ */
+static int kdb_printf_lock_get(unsigned long *flags)
+{
+	preempt_disable();
+	if (!KDB_STATE(PRINTF_LOCK)) {
+		KDB_STATE_SET(PRINTF_LOCK);
+		spin_lock_irqsave(&kdb_printf_lock, *flags);
+		return 1;
+	}
+	__acquire(kdb_printf_lock);
+	return 0;
+}
+
+static void kdb_printf_lock_put(int got_printf_lock, unsigned long flags)
+{
 	if (KDB_STATE(PRINTF_LOCK) && got_printf_lock) {
-		got_printf_lock = 0;
 		spin_unlock_irqrestore(&kdb_printf_lock, flags);
 		KDB_STATE_CLEAR(PRINTF_LOCK);
 	} else {
 		__release(kdb_printf_lock);
 	}
 	preempt_enable();
-	if (do_longjmp)
+}
+
+/*
+ * kdb_more
+ *
+ *	The screen is full, prompt and wait for a key.
+ *
+ * Returns:
+ *	1 if the user asked to abort the command, 0 to continue.
+ * Locking:
+ *	Called with the printf lock held, any output from here on this cpu
+ *	is written through.
+ */
+
+static int kdb_more(void)
+{
+	char buf1[16]="";
+	char *moreprompt;
+#if defined(CONFIG_SMP)
+	char buf2[32];
+#endif
+	int quit = 0;
+
+	/* Watch out for recursion here.  Any routine that calls
+	 * kdb_printf will come back through here.  And kdb_read
+	 * uses kdb_printf to echo on serial consoles ...
+	 */
+	kdb_nextline = 1;	/* In case of recursion */
+
+	/*
+	 * Pause until cr.
+	 */
+	moreprompt = kdbgetenv("MOREPROMPT");
+	if (moreprompt == NULL) {
+		moreprompt = "more> ";
+	}
+
+#if defined(CONFIG_SMP)
+	if (strchr(moreprompt, '%')) {
+		sprintf(buf2, moreprompt, get_cpu());
+		put_cpu();
+		moreprompt = buf2;
+	}
+#endif
+
+	kdb_input_flush();
+	lkmd_console_write(moreprompt, strlen(moreprompt));
+
+	lkmd_read(buf1, 2); /* '2' indicates to return immediately after getting one key. */
+	kdb_nextline = 1;	/* Really set output line 1 */
+
+	if ((buf1[0] == 'q') || (buf1[0] == 'Q')) {
+		/* user hit q or Q */
+		quit = 1;
+		KDB_FLAG_SET(CMD_INTERRUPT);	/* command was interrupted */
+		/* end of command output; back to normal mode */
+		lkmd_printf("\n");
+	} else if (buf1[0] && buf1[0] != '\n') {
+		/* user hit something other than enter */
+		lkmd_printf("\nOnly 'q' or 'Q' are processed at more prompt, input ignored\n");
+	}
+	kdb_input_flush();
+	return quit;
+}
+
+/*
+ * kdb_obuf_added
+ *
+ *	Account for the text added to kdb_obuf from start, run the filters
+ *	and the pager over its lines and write out what should not wait in
+ *	the buffer.
+ *
+ * Returns:
+ *	1 if the command is to be aborted, the user quit at the more
+ *	prompt or head has all its lines.  The caller must longjmp after
+ *	dropping the printf lock.
+ * Locking:
+ *	Called with the printf lock held.
+ */
+
+static int kdb_obuf_added(int start)
+{
+	int i, len, old;
+
+	for (i = start; i < kdb_obuf_len; i++) {
+		if (kdb_obuf[i] != '\n')
+			continue;
+		if (kdb_nfilter) {
+			old = i - kdb_obuf_line;
+			len = kdb_filter_line(kdb_obuf + kdb_obuf_line, old);
+			if (len != old) {
+				/* Line dropped or shortened, close the gap */
+				if (len >= 0)
+					kdb_obuf[kdb_obuf_line + len++] = '\n';
+				else
+					len = 0;
+				memmove(kdb_obuf + kdb_obuf_line + len,
+					kdb_obuf + i + 1, kdb_obuf_len - i - 1);
+				kdb_obuf_len -= old + 1 - len;
+				i = kdb_obuf_line + len - 1;
+				if (!len) {
+					if (kdb_filter_done && KDB_STATE(LONGJMP))
+						return 1;
+					continue;
+				}
+			}
+		}
+		kdb_obuf_line = i + 1;
+
+		/* check for having reached the LINES number of printed lines,
+		 * there is no pager while the output is captured
+		 */
+		if (KDB_STATE(LONGJMP) && !kdb_capture_ring.mode &&
+		    ++kdb_nextline == kdb_obuf_lines) {
+			kdb_obuf_drain(i + 1);
+			i = -1;
+			if (kdb_more()) {
+				/* drop the rest of the command output */
+				kdb_obuf_len = kdb_obuf_line = 0;
+				return 1;
+			}
+		}
+		if (kdb_filter_done && KDB_STATE(LONGJMP)) {
+			kdb_obuf_len = kdb_obuf_line;
+			return 1;
+		}
+	}
+
+	if (!kdb_obuf_depth) {
+		kdb_obuf_drain(kdb_obuf_len);
+	} else if (kdb_obuf_len >= KDB_OBUF_FLUSH) {
+		/* Write out the complete lines, or all of it if there are none */
+		kdb_obuf_room(KDB_OBUF_SIZE - KDB_OBUF_FLUSH);
+	}
+	return 0;
+}
+
+static void kdb_more_longjmp(void)
+{
 #ifdef kdba_setjmp
-		kdba_longjmp(&kdbjmpbuf[smp_processor_id()], 1)
+	kdba_longjmp(&kdbjmpbuf[smp_processor_id()], 1);
 #endif	/* kdba_setjmp */
-		;
+}
+
+/*
+ * lkmd_printf
+ *
+ *	Print a string to the output device(s).
+ *
+ * Parameters:
+ *	printf-like format and optional args.
+ * Returns:
+ *	0
+ * Locking:
+ *	None.
+ * Remarks:
+ *	use 'kdbcons->write()' to avoid polluting 'log_buf' with kdb output.
+ *	Inside a command the text is only added to kdb_obuf, see
+ *	kdb_output_begin.
+ */
+
+void lkmd_printf(const char *fmt, ...)
+{
+	va_list ap, ap2;
+	int got_printf_lock, start, room, n;
+	int do_longjmp;
+	unsigned long uninitialized_var(flags);
+
+	got_printf_lock = kdb_printf_lock_get(&flags);
+	if (!kdb_obuf_lines)
+		kdb_output_setup();
+
+	va_start(ap, fmt);
+	if (!got_printf_lock) {
+		/* Recursive, from the pager or a re-entry of kdb */
+		n = vsnprintf(kdb_nested_buf, sizeof(kdb_nested_buf), fmt, ap);
+		va_end(ap);
+		lkmd_console_write(kdb_nested_buf,
+				   min_t(int, n, sizeof(kdb_nested_buf) - 1));
+		kdb_printf_lock_put(got_printf_lock, flags);
+		return;
+	}
+
+	va_copy(ap2, ap);
+	room = KDB_OBUF_SIZE - kdb_obuf_len;
+	n = vsnprintf(kdb_obuf + kdb_obuf_len, room, fmt, ap);
+	if (n >= room && kdb_obuf_len) {
+		/* Does not fit behind the pending text, write that out first */
+		kdb_obuf_room(n);
+		room = KDB_OBUF_SIZE - kdb_obuf_len;
+		n = vsnprintf(kdb_obuf + kdb_obuf_len, room, fmt, ap2);
+	}
+	va_end(ap2);
+	va_end(ap);
+	if (n >= room)
+		n = room - 1;
+	start = kdb_obuf_len;
+	kdb_obuf_len += n;
+	do_longjmp = kdb_obuf_added(start);
+
+	kdb_printf_lock_put(got_printf_lock, flags);
+	if (do_longjmp)
+		kdb_more_longjmp();
+}
+
+/*
+ * kdb_output_write
+ *
+ *	Add text that is already formatted to the output, without going
+ *	through vsnprintf.
+ *
+ * Parameters:
+ *	s	Text, need not be NUL terminated
+ *	len	Length of the text
+ * Returns:
+ *	Nothing.
+ * Locking:
+ *	None.
+ * Remarks:
+ *	For renderers that build whole lines themselves, e.g. md.  The
+ *	pager and buffering are the same as for lkmd_printf.
+ */
+
+void kdb_output_write(const char *s, size_t len)
+{
+	int got_printf_lock, start, n;
+	int do_longjmp = 0;
+	unsigned long uninitialized_var(flags);
+
+	got_printf_lock = kdb_printf_lock_get(&flags);
+	if (!kdb_obuf_lines)
+		kdb_output_setup();
+
+	if (!got_printf_lock) {
+		lkmd_console_write(s, len);
+		kdb_printf_lock_put(got_printf_lock, flags);
+		return;
+	}
+
+	while (len && !do_longjmp) {
+		if (kdb_obuf_len >= KDB_OBUF_SIZE - 1)
+			kdb_obuf_room(1);
+		n = min_t(size_t, len, KDB_OBUF_SIZE - 1 - kdb_obuf_len);
+		start = kdb_obuf_len;
+		memcpy(kdb_obuf + start, s, n);
+		kdb_obuf_len += n;
+		s += n;
+		len -= n;
+		do_longjmp = kdb_obuf_added(start);
+	}
+
+	kdb_printf_lock_put(got_printf_lock, flags);
+	if (do_longjmp)
+		kdb_more_longjmp();
+}
+
+/*
+ * kdb_output_flush
+ *
+ *	Write out any output that is still in the kdb output buffer.
+ *
+ * Parameters:
+ *	None.
+ * Returns:
+ *	Nothing.
+ * Locking:
+ *	Takes the printf lock.  Does nothing when this cpu already holds
+ *	it, e.g. when reading a key for the pager.
+ * Remarks:
+ *	Call before waiting for input in the middle of a command.
+ */
+
+void kdb_output_flush(void)
+{
+	int got_printf_lock;
+	unsigned long uninitialized_var(flags);
+
+	got_printf_lock = kdb_printf_lock_get(&flags);
+	if (got_printf_lock)
+		kdb_obuf_drain(kdb_obuf_len);
+	kdb_printf_lock_put(got_printf_lock, flags);
+}
+
+/*
+ * kdb_output_begin
+ *
+ *	Start collecting the output of a command.
+ *
+ * Parameters:
+ *	None.
+ * Returns:
+ *	Nothing.
+ * Locking:
+ *	None.
+ * Remarks:
+ *	Calls nest, as kdb_parse does for defined commands, only the
+ *	outermost kdb_output_end writes the output.  The pager and
+ *	LOGGING settings are read here, once per command.
+ */
+
+void kdb_output_begin(void)
+{
+	if (kdb_obuf_depth++ == 0) {
+		kdb_output_setup();
+		kdb_capture_ring.quiet =
+			kdb_capture_ring.mode == KDB_CAPTURE_ONLY;
+	}
+}
+
+/*
+ * kdb_output_finish
+ *
+ *	Run what is left of the filters and write out the buffer, for
+ *	kdb_output_end and kdb_output_reset.
+ */
+
+static void kdb_output_finish(void)
+{
+	int got_printf_lock;
+	unsigned long uninitialized_var(flags);
+
+	got_printf_lock = kdb_printf_lock_get(&flags);
+	if (got_printf_lock) {
+		kdb_filter_end();
+		kdb_obuf_drain(kdb_obuf_len);
+	}
+	kdb_printf_lock_put(got_printf_lock, flags);
+}
+
+/*
+ * kdb_output_end
+ *
+ *	Finish a command started with kdb_output_begin, at the outermost
+ *	level write out its remaining output and go back to writing through.
+ */
+
+void kdb_output_end(void)
+{
+	if (kdb_obuf_depth > 0 && --kdb_obuf_depth == 0) {
+		kdb_output_finish();
+		kdb_capture_ring.quiet = 0;
+	}
+}
+
+/*
+ * kdb_output_reset
+ *
+ *	A command was aborted by longjmp, write out what it left in the
+ *	buffer and go back to writing through.
+ */
+
+void kdb_output_reset(void)
+{
+	kdb_obuf_depth = 0;
+	kdb_output_finish();
+	kdb_capture_ring.quiet = 0;
+}
+
+/*
+ * kdb_output_filter
+ *
+ *	Set up the output filters for the command that is about to run.
+ *
+ * Parameters:
+ *	argc	Number of words after the first '|'
+ *	argv	The words, filters separated by "|"
+ * Returns:
+ *	0 or a kdb diagnostic, no filter is set up on error.
+ * Locking:
+ *	None.
+ * Remarks:
+ *	A command that runs other commands keeps its own filters, the
+ *	pipelines of the inner commands are ignored.
+ */
+
+int kdb_output_filter(int argc, const char **argv)
+{
+	struct kdb_filter filter[KDB_FILTER_MAX], *f;
+	unsigned long val;
+	const char *name;
+	int i = 0, nf = 0, diag, len;
+
+	if (kdb_obuf_depth)
+		return 0;
+	while (i < argc) {
+		if (nf == KDB_FILTER_MAX)
+			return KDB_BADFILTER;
+		f = &filter[nf++];
+		memset(f, 0, sizeof(*f));
+		name = argv[i++];
+		if (strcmp(name, "grep") == 0) {
+			f->type = KDB_FILTER_GREP;
+			if (i < argc && strcmp(argv[i], "-v") == 0) {
+				f->invert = 1;
+				i++;
+			}
+			if (i == argc || strcmp(argv[i], "|") == 0)
+				return KDB_ARGCOUNT;
+			/* The quotes are still on a quoted pattern */
+			name = argv[i++];
+			len = strlen(name);
+			if (len >= 2 && (name[0] == '\'' || name[0] == '"') &&
+			    name[len - 1] == name[0]) {
+				name++;
+				len -= 2;
+			}
+			if (len >= KDB_FILTER_PATLEN)
+				return KDB_BADFILTER;
+			memcpy(f->pat, name, len);
+		} else if (strcmp(name, "count") == 0) {
+			f->type = KDB_FILTER_COUNT;
+		} else {
+			if (strcmp(name, "head") == 0)
+				f->type = KDB_FILTER_HEAD;
+			else if (strcmp(name, "tail") == 0)
+				f->type = KDB_FILTER_TAIL;
+			else if (strcmp(name, "field") == 0)
+				f->type = KDB_FILTER_FIELD;
+			else
+				return KDB_BADFILTER;
+			if (i == argc)
+				return KDB_ARGCOUNT;
+			if ((diag = kdbgetularg(argv[i++], &val)))
+				return diag;
+			if (!val || (f->type == KDB_FILTER_TAIL && val > KDB_TAIL_LINES))
+				return KDB_BADINT;
+			f->n = val;
+		}
+		if (i < argc && (strcmp(argv[i++], "|") || i == argc))
+			return KDB_BADFILTER;
+	}
+	if (!nf)
+		return KDB_BADFILTER;
+	for (i = 0; i < nf - 1; i++) {
+		if (filter[i].type == KDB_FILTER_TAIL ||
+		    filter[i].type == KDB_FILTER_COUNT)
+			return KDB_BADFILTER;
+	}
+
+	memcpy(kdb_filter, filter, sizeof(filter[0]) * nf);
+	kdb_nfilter = nf;
+	kdb_filter_done = 0;
+	kdb_tail.next = 0;
+	return 0;
+}
+
+/*
+ * kdb_capture
+ *
+ *	This function implements the 'capture' command.
+ *
+ *	capture [on|only|off|clear]
+ *
+ * Parameters:
+ *	argc	argument count
+ *	argv	argument vector
+ * Returns:
+ *	zero for success, a kdb diagnostic if error
+ * Locking:
+ *	none.
+ * Remarks:
+ *	on copies all kdb output to the capture ring, only does the same
+ *	but keeps the output of commands off the console, the prompt and
+ *	the input are still shown.  There is no more> prompt while
+ *	capturing.  When the ring is full the oldest output is lost.
+ *	Without an argument the state of the ring is shown, that output
+ *	is never hidden.
+ */
+
+int kdb_capture(int argc, const char **argv)
+{
+	u64 head = kdb_capture_ring.head;
+
+	kdb_capture_ring.quiet = 0;
+	if (!kdb_capture_ring.data) {
+		lkmd_printf("capture: no capture ring, see the capture_size module parameter\n");
+		return 0;
+	}
+	if (argc > 1)
+		return KDB_ARGCOUNT;
+	if (argc == 0) {
+		lkmd_printf("capture %s, %llu of %lu bytes used in /proc/lkmd_capture",
+			    kdb_capture_ring.mode == KDB_CAPTURE_ONLY ? "only" :
+			    kdb_capture_ring.mode ? "on" : "off",
+			    min_t(u64, head, kdb_capture_ring.size),
+			    kdb_capture_ring.size);
+		if (head > kdb_capture_ring.size)
+			lkmd_printf(", %llu older bytes overwritten",
+				    head - kdb_capture_ring.size);
+		lkmd_printf("\n");
+		return 0;
+	}
+	if (strcmp(argv[1], "on") == 0)
+		kdb_capture_ring.mode = KDB_CAPTURE_ON;
+	else if (strcmp(argv[1], "only") == 0)
+		kdb_capture_ring.mode = KDB_CAPTURE_ONLY;
+	else if (strcmp(argv[1], "off") == 0)
+		kdb_capture_ring.mode = KDB_CAPTURE_OFF;
+	else if (strcmp(argv[1], "clear") == 0)
+		kdb_capture_ring.head = 0;
+	else
+		return KDB_ARGCOUNT;
+	return 0;
+}
+
+/*
+ * /proc/lkmd_capture reads the ring from the oldest byte that is still
+ * there.  The file offset is the count of bytes captured since the last
+ * clear, so a reader that falls behind skips to the oldest byte.  kdb
+ * can stop the reader at any point and add to the ring, the copy is
+ * only consistent when read while kdb is not in use.
+ */
+
+static ssize_t kdb_capture_read(struct file *file, char __user *buf,
+				size_t count, loff_t *ppos)
+{
+	u64 head = kdb_capture_ring.head;
+	u64 start = head > kdb_capture_ring.size ? head - kdb_capture_ring.size : 0;
+	unsigned long off, n;
+	size_t done = 0;
+
+	if (*ppos < start)
+		*ppos = start;
+	while (count && *ppos < head) {
+		off = *ppos & (kdb_capture_ring.size - 1);
+		n = min_t(u64, count, head - *ppos);
+		n = min(n, kdb_capture_ring.size - off);
+		if (copy_to_user(buf + done, kdb_capture_ring.data + off, n))
+			return done ? done : -EFAULT;
+		*ppos += n;
+		done += n;
+		count -= n;
+	}
+	return done;
+}
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5,6,0)
+static const struct proc_ops kdb_capture_fops = {
+	.proc_read	= kdb_capture_read,
+	.proc_lseek	= default_llseek,
+};
+#else
+static const struct file_operations kdb_capture_fops = {
+	.owner		= THIS_MODULE,
+	.read		= kdb_capture_read,
+	.llseek		= default_llseek,
+};
+#endif
+
+/*
+ * kdb_capture_init
+ *
+ *	Allocate the capture ring and create /proc/lkmd_capture.  Capture
+ *	is off until the capture command turns it on.
+ */
+
+void kdb_capture_init(void)
+{
+	unsigned long size;
+
+	if (!capture_size)
+		return;
+	size = roundup_pow_of_two(max(capture_size, PAGE_SIZE));
+	kdb_capture_ring.data = vmalloc(size);
+	if (!kdb_capture_ring.data) {
+		lkmd_printf("Cannot allocate the capture ring, capture is disabled\n");
+		return;
+	}
+	kdb_capture_ring.size = size;
+	if (!proc_create("lkmd_capture", 0400, NULL, &kdb_capture_fops))
+		lkmd_printf("Cannot create /proc/lkmd_capture\n");
+}
+
+void kdb_capture_exit(void)
+{
+	if (!kdb_capture_ring.data)
+		return;
+	remove_proc_entry("lkmd_capture", NULL);
+	kdb_capture_ring.mode = KDB_CAPTURE_OFF;
+	vfree(kdb_capture_ring.data);
+	kdb_capture_ring.data = NULL;
 }
 
 /*
@@ -27,6 +27,9 @@
 #include <linux/nmi.h>
 #include <linux/ptrace.h>
 #include <linux/cpu.h>
+#include <linux/topology.h>
+#include <linux/bitmap.h>
+#include <linux/crc32.h>
 #include <linux/kdebug.h>
 
 #include "lkmd.h"
@@ -111,6 +114,7 @@ static kdbmsg_t kdbmsgs[] = {
 	KDBMSG(BADLENGTH, "Invalid length field"),
 	KDBMSG(NOBP, "No Breakpoint exists"),
 	KDBMSG(BADADDR, "Invalid address"),
+	KDBMSG(BADFILTER, "Invalid output filter, use grep [-v] <re>, head <n>, tail <n>, count or field <n>, tail and count last"),
 };
 #undef KDBMSG
 
@@ -143,6 +147,9 @@ static char *__env[] = {
  KDB_PLATFORM_ENV,
  "DTABCOUNT=30",
  "NOSECT=1",
+ "WORKERS=1",			/* use held cpus for heavy commands */
+ "MSCOUNT=32",			/* matches shown by each ms */
+ "LOGGING=0",			/* copy kdb output to the printk log */
  (char *)0,
  (char *)0,
  (char *)0,
@@ -683,6 +690,7 @@ int kdb_parse(const char *cmdstr)
 	char *cpp, quoted;
 	kdbtab_t *tp;
 	int i, escaped, ignore_errors = 0;
+	int nargs;		/* words before the first '|' */
 
 	/*
 	 * First tokenize the command string.
@@ -729,6 +737,12 @@ int kdb_parse(const char *cmdstr)
 					++cp;
 					continue;
 				}
+				/* An unquoted '|' is a word of its own */
+				if (*cp == '|' && !quoted) {
+					if (cpp == argv[argc-1])
+						*cpp++ = *cp++;
+					break;
+				}
 				if (*cp == quoted) {
 					quoted = '\0';
 				} else if (*cp == '\'' || *cp == '"') {
@@ -743,6 +757,8 @@ int kdb_parse(const char *cmdstr)
 	}
 	if (!argc)
 		return 0;
+	for (nargs = 0; nargs < argc && strcmp(argv[nargs], "|"); nargs++)
+		;
 	if (argv[0][0] == '-' && argv[0][1] && (argv[0][1] < '0' || argv[0][1] > '9')) {
 		ignore_errors = 1;
 		++argv[0];
@@ -781,9 +797,17 @@ int kdb_parse(const char *cmdstr)
 
 	if (i < kdb_max_commands) {
 		int result;
+		if (nargs < argc) {
+			result = kdb_output_filter(argc - nargs - 1,
+					(const char **)argv + nargs + 1);
+			if (result)
+				return result;
+		}
 		KDB_STATE_SET(CMD);
-		result = (*tp->cmd_func)(argc-1,
+		kdb_output_begin();
+		result = (*tp->cmd_func)(nargs-1,
 				       (const char**)argv);
+		kdb_output_end();
 		if (result && ignore_errors && result > KDB_CMD_GO)
 			result = 0;
 		KDB_STATE_CLEAR(CMD);
@@ -899,6 +923,12 @@ static int kdb_local(kdb_reason_t reason, int error, struct pt_regs *regs, kdb_d
 
 	KDB_DEBUG_STATE("kdb_local 1", reason);
 
+	/*
+	 * The kernel ran since the last command, if only for one ss
+	 * instruction, so nothing read before is known to be current.
+	 */
+	kdb_getarea_invalidate(0, 0);
+
 	if (kdb_quiet(reason)) {
 		/* no message */
 	} else if (reason == KDB_REASON_DEBUG) {
@@ -1009,6 +1039,8 @@ static int kdb_local(kdb_reason_t reason, int error, struct pt_regs *regs, kdb_d
 		if (kdbjmpbuf) {
 			if (kdba_setjmp(&kdbjmpbuf[smp_processor_id()])) {
 				/* Command aborted (usually in pager) */
+				kdb_write_end();
+				kdb_output_reset();
 				continue;
 			}
 			else
@@ -1066,6 +1098,200 @@ void kdb_print_state(const char *text, int value)
 		text, smp_processor_id(), value, kdb_initial_cpu, kdb_state[smp_processor_id()]);
 }
 
+/*
+ * Roundup and release are grouped by NUMA node.  Each cpu only updates the
+ * counters of its own node, the controlling cpu reads one cache line per
+ * node instead of one per cpu.  On release the controlling cpu only wakes
+ * the node leaders, each leader then releases the other cpus of its node,
+ * so the cross node traffic is per node, not per cpu.
+ */
+
+struct kdb_node_barrier {
+	atomic_t arrived;	/* cpus of this node in kdb_main_loop */
+	atomic_t leaving;	/* cpus of this node still leaving kdb */
+	int release;		/* leader has to release the rest of the node */
+} ____cacheline_aligned_in_smp;
+
+static struct kdb_node_barrier kdb_node_barrier[MAX_NUMNODES];
+static int kdb_arrived_seqno[NR_CPUS];
+
+/*
+ * kdb_node_arrive
+ *
+ *	Count the current cpu as being in kdb for this event.
+ *
+ * Inputs:
+ *	None.
+ * Returns:
+ *	None.
+ * Locking:
+ *	none
+ * Remarks:
+ *	Called each time a cpu enters kdb_main_loop, only the first call
+ *	for each kdb event is counted.
+ */
+
+static void kdb_node_arrive(void)
+{
+	int cpu = smp_processor_id();
+
+	if (kdb_arrived_seqno[cpu] == kdb_seqno)
+		return;
+	kdb_arrived_seqno[cpu] = kdb_seqno;
+	atomic_inc(&kdb_node_barrier[cpu_to_node(cpu)].arrived);
+}
+
+/*
+ * kdb_node_reset
+ *
+ *	Clear the arrival counts at the start of a new kdb event, before
+ *	the other cpus are stopped.
+ *
+ * Inputs:
+ *	None.
+ * Returns:
+ *	None.
+ * Locking:
+ *	kdb_lock must be held.
+ * Remarks:
+ *	Must run before kdb_seqno is bumped.  A cpu that sees the new
+ *	event counts itself in kdb_node_arrive and is not counted again,
+ *	clearing after that would lose it.
+ */
+
+static void kdb_node_reset(void)
+{
+	int node;
+
+	for_each_online_node(node)
+		atomic_set(&kdb_node_barrier[node].arrived, 0);
+}
+
+/*
+ * kdb_cpus_arrived
+ *
+ *	Return the number of cpus that are in kdb_main_loop for the
+ *	current event.
+ *
+ * Inputs:
+ *	None.
+ * Returns:
+ *	Count of cpus in kdb.
+ * Locking:
+ *	none
+ * Remarks:
+ *	none
+ */
+
+static int kdb_cpus_arrived(void)
+{
+	int node, arrived = 0;
+
+	for_each_online_node(node)
+		arrived += atomic_read(&kdb_node_barrier[node].arrived);
+	return arrived;
+}
+
+/*
+ * kdb_release_cpu
+ *
+ *	Release one cpu from kdb, it will see KDB_STATE(LEAVING) if it
+ *	was in kdb.
+ *
+ * Inputs:
+ *	cpu	The cpu to release.
+ * Returns:
+ *	None.
+ * Locking:
+ *	none
+ * Remarks:
+ *	The leaving count is raised before HOLD_CPU is cleared, so it can
+ *	not drop below zero when the released cpu leaves.
+ */
+
+static void kdb_release_cpu(int cpu)
+{
+	if (KDB_STATE_CPU(KDB, cpu)) {
+		KDB_STATE_SET_CPU(LEAVING, cpu);
+		atomic_inc(&kdb_node_barrier[cpu_to_node(cpu)].leaving);
+		smp_wmb();
+	}
+	KDB_STATE_CLEAR_CPU(WAIT_IPI, cpu);
+	KDB_STATE_CLEAR_CPU(HOLD_CPU, cpu);
+}
+
+/*
+ * kdb_release_node
+ *
+ *	Release all the cpus of a node except the current one.
+ *
+ * Inputs:
+ *	node	The node to release.
+ * Returns:
+ *	None.
+ * Locking:
+ *	none
+ * Remarks:
+ *	Run by the node leader, or by the controlling cpu when the leader
+ *	is not in kdb.
+ */
+
+static void kdb_release_node(int node)
+{
+	int cpu;
+
+	for_each_cpu(cpu, cpumask_of_node(node)) {
+		if (cpu != smp_processor_id())
+			kdb_release_cpu(cpu);
+	}
+	smp_wmb();
+	kdb_node_barrier[node].release = 0;
+}
+
+/*
+ * kdb_release_cpus
+ *
+ *	Release all cpus from kdb on go.
+ *
+ * Inputs:
+ *	None.
+ * Returns:
+ *	None.
+ * Locking:
+ *	none
+ * Remarks:
+ *	Called by the controlling cpu.  The leader of each node is the
+ *	first cpu of the node, if it is held in kdb then it is released
+ *	with its release flag set and does the rest of the node from
+ *	kdb_main_loop.  The controlling cpu marks itself as leaving too,
+ *	so kdb_previous_event() drops to 1 when everybody else has gone.
+ */
+
+static void kdb_release_cpus(void)
+{
+	int node, leader, me = smp_processor_id();
+
+	if (KDB_STATE(KDB)) {
+		KDB_STATE_SET(LEAVING);
+		atomic_inc(&kdb_node_barrier[cpu_to_node(me)].leaving);
+	}
+	KDB_STATE_CLEAR(WAIT_IPI);
+	KDB_STATE_CLEAR(HOLD_CPU);
+
+	for_each_online_node(node) {
+		leader = cpumask_first(cpumask_of_node(node));
+		if (leader >= nr_cpu_ids || leader == me ||
+		    kdb_arrived_seqno[leader] != kdb_seqno ||
+		    cpu_to_node(me) == node) {
+			kdb_release_node(node);
+			continue;
+		}
+		kdb_node_barrier[node].release = 1;
+		smp_wmb();
+		kdb_release_cpu(leader);
+	}
+}
+
 /*
  * kdb_previous_event
  *
@@ -1079,15 +1305,19 @@ void kdb_print_state(const char *text, int value)
  * Locking:
  *	none
  * Remarks:
- *	none
+ *	A node whose leader has not yet released the rest of the node
+ *	counts as one more cpu, so the count does not reach 1 until the
+ *	whole node has been released and left.
  */
 
 static int kdb_previous_event(void)
 {
-	int i, leaving = 0;
-	for (i = 0; i < NR_CPUS; ++i) {
-		if (KDB_STATE_CPU(LEAVING, i))
-			++leaving;
+	int node, leaving = 0;
+	struct kdb_node_barrier *b;
+
+	for_each_online_node(node) {
+		b = &kdb_node_barrier[node];
+		leaving += atomic_read(&b->leaving) + ACCESS_ONCE(b->release);
 	}
 	return leaving;
 }
@@ -1105,7 +1335,8 @@ static int kdb_previous_event(void)
  * Locking:
  *	none
  * Remarks:
- *	none
+ *	The first 100ms are polled in small steps, most of the time all
+ *	cpus have arrived well before that.
  */
 
 int kdb_wait_for_cpus_secs;
@@ -1113,19 +1344,19 @@ int kdb_wait_for_cpus_secs;
 static void kdb_wait_for_cpus(void)
 {
 #ifdef	CONFIG_SMP
-	int online = 0, kdb_data = 0, prev_kdb_data = 0, c, time;
-	
-	mdelay(100);
-	
+	int online = 0, kdb_data = 0, prev_kdb_data = 0, time;
+
+	online = num_online_cpus();
+	for (time = 0; time < 1000; ++time) {
+		if (kdb_cpus_arrived() >= online)
+			break;
+		udelay(100);
+	}
+
 	for (time = 0; time < kdb_wait_for_cpus_secs; ++time) {
-		online = 0;
-		kdb_data = 0;
-		for_each_online_cpu(c) {
-			++online;
-			if (kdb_running_process[c].seqno >= kdb_seqno - 1)
-				++kdb_data;
-		}
-		if (online == kdb_data)
+		online = num_online_cpus();
+		kdb_data = kdb_cpus_arrived();
+		if (kdb_data >= online)
 			break;
 		if (prev_kdb_data != kdb_data) {
 			kdb_nextline = 0;	/* no prompt yet */
@@ -1145,7 +1376,7 @@ static void kdb_wait_for_cpus(void)
 	}
 	if (time) {
 		int wait = online - kdb_data;
-		if (wait == 0)
+		if (wait <= 0)
 			lkmd_printf("All cpus are now in kdb\n");
 		else
 			lkmd_printf("%d cpu%s not in kdb, %s state is unknown\n",
@@ -1194,6 +1425,8 @@ int kdb_main_loop(kdb_reason_t reason, kdb_reason_t reason2, int error,
 {
 	int result = 1;
 
+	kdb_node_arrive();
+
 	/* Stay in kdb() until 'go', 'ss[b]' or an error */
 	while (1) {
 		/* All processors except the one that is in control will spin here. */
@@ -1205,12 +1438,21 @@ int kdb_main_loop(kdb_reason_t reason, kdb_reason_t reason2, int error,
 			 */
 			if (!KDB_STATE(KDB))
 				KDB_STATE_SET(KDB);
+			/* help with any job from the controlling cpu */
+			kdb_work_poll();
 		}
 
 		KDB_STATE_CLEAR(SUPPRESS);
 		KDB_DEBUG_STATE("kdb_main_loop 2", reason);
-		if (KDB_STATE(LEAVING))
+		if (KDB_STATE(LEAVING)) {
+			/* Node leaders pass the release on to their node */
+			int node = cpu_to_node(smp_processor_id());
+			smp_rmb();
+			if (ACCESS_ONCE(kdb_node_barrier[node].release) &&
+			    cpumask_first(cpumask_of_node(node)) == smp_processor_id())
+				kdb_release_node(node);
 			break;	/* Another cpu said 'go' */
+		}
 
 		if (!kdb_quiet(reason))
 		 	kdb_wait_for_cpus();
@@ -1569,6 +1811,7 @@ int kdb(kdb_reason_t reason, int error, struct pt_regs *regs)
 		}
 		KDB_DEBUG_STATE("kdb 5", reason);
 
+		kdb_node_reset();
 		kdb_initial_cpu = smp_processor_id();
 		++kdb_seqno;
 		spin_unlock(&kdb_lock);
@@ -1645,13 +1888,7 @@ int kdb(kdb_reason_t reason, int error, struct pt_regs *regs)
 			/*
 			 * Release all other cpus which will see KDB_STATE(LEAVING) is set.
 			 */
-			int i;
-			for (i = 0; i < NR_CPUS; ++i) {
-				if (KDB_STATE_CPU(KDB, i))
-					KDB_STATE_SET_CPU(LEAVING, i);
-				KDB_STATE_CLEAR_CPU(WAIT_IPI, i);
-				KDB_STATE_CLEAR_CPU(HOLD_CPU, i);
-			}
+			kdb_release_cpus();
 			/* Wait until all the other processors leave kdb */
 			while (kdb_previous_event() != 1)
 				;
@@ -1679,13 +1916,210 @@ int kdb(kdb_reason_t reason, int error, struct pt_regs *regs)
 	KDB_STATE_CLEAR(KEYBOARD);
 	KDB_STATE_CLEAR(KDB);		/* Main kdb state has been cleared */
 	KDB_STATE_CLEAR(RECURSE);
-	KDB_STATE_CLEAR(LEAVING);	/* No more kdb work after this */
+	if (KDB_STATE(LEAVING)) {
+		KDB_STATE_CLEAR(LEAVING);	/* No more kdb work after this */
+		smp_mb();
+		atomic_dec(&kdb_node_barrier[cpu_to_node(smp_processor_id())].leaving);
+	}
 	KDB_DEBUG_STATE("kdb 17", reason);
 out:
 	preempt_enable();
 	return result != 0;
 }
 
+/*
+ * The md family reads memory in bulk into kdb_md_buf and renders from there,
+ * instead of fetching every word (twice, with zero suppression) through
+ * kdb_getword.
+ */
+
+#define KDB_MD_BUFSIZE	PAGE_SIZE
+
+static struct {
+	unsigned long addr;	/* address of data[0] */
+	size_t valid;		/* bytes of data that were read */
+	int phys;		/* addr is a physical address */
+	int fault;		/* the byte after the valid data faulted */
+	unsigned char data[KDB_MD_BUFSIZE];
+} kdb_md_buf;
+
+static size_t kdb_md_avail(unsigned long addr)
+{
+	if (addr < kdb_md_buf.addr || addr >= kdb_md_buf.addr + kdb_md_buf.valid)
+		return 0;
+	return kdb_md_buf.addr + kdb_md_buf.valid - addr;
+}
+
+/*
+ * kdb_md_fetch
+ *
+ *	Make sure that the data at addr is in kdb_md_buf.  If the first
+ *	need bytes are not already there then read up to want bytes
+ *	starting at addr.
+ *
+ * Inputs:
+ *	addr	Start address
+ *	need	Number of bytes needed now
+ *	want	Number of bytes to read ahead, limited to KDB_MD_BUFSIZE
+ *	phys	addr is a physical address
+ * Outputs:
+ *	None.
+ * Returns:
+ *	Pointer to the data for addr, NULL if addr can not be read.  The
+ *	number of valid bytes is returned by kdb_md_avail().
+ * Locking:
+ *	none.
+ * Remarks:
+ *	A buffer that ended on a fault is not read again for the same
+ *	range, the caller gets the partial data.
+ */
+
+static const unsigned char *kdb_md_fetch(unsigned long addr, size_t need,
+					 size_t want, int phys)
+{
+	unsigned long end = kdb_md_buf.addr + kdb_md_buf.valid;
+	size_t done;
+
+	if (want < need)
+		want = need;
+	if (want > KDB_MD_BUFSIZE)
+		want = KDB_MD_BUFSIZE;
+	if (phys != kdb_md_buf.phys || addr < kdb_md_buf.addr || addr >= end ||
+	    (addr + need > end && !kdb_md_buf.fault)) {
+		kdb_md_buf.addr = addr;
+		kdb_md_buf.phys = phys;
+		if (phys)
+			kdb_md_buf.fault = kdb_getphys_bulk(kdb_md_buf.data,
+					addr, want, &done) != 0;
+		else
+			kdb_md_buf.fault = kdb_getarea_bulk(kdb_md_buf.data,
+					addr, want, &done) != 0;
+		kdb_md_buf.valid = done;
+	}
+	if (!kdb_md_avail(addr))
+		return NULL;
+	return kdb_md_buf.data + (addr - kdb_md_buf.addr);
+}
+
+/* Report the first address that kdb_md_fetch could not read */
+static void kdb_md_badaddr(void)
+{
+	lkmd_printf("%sBad address " kdb_machreg_fmt0 "\n",
+		kdb_md_buf.phys ? "phys " : "",
+		kdb_md_buf.addr + kdb_md_buf.valid);
+}
+
+static unsigned long kdb_md_word(const unsigned char *p, int bytesperword)
+{
+	switch (bytesperword) {
+	case 8:
+		return *(const u64 *)p;
+	case 4:
+		return *(const u32 *)p;
+	case 2:
+		return *(const u16 *)p;
+	}
+	return *p;
+}
+
+/*
+ * Hex rows are rendered with lookup tables straight into a line that is
+ * handed to kdb_output_write, one call per row instead of one formatted
+ * lkmd_printf per word.  The tables are built on first use.
+ */
+
+#define KDB_MD_LINELEN	128
+
+static char kdb_md_hex[256][2];		/* byte -> two hex digits */
+static char kdb_md_ascii[256];		/* byte -> itself or '.' */
+
+static void kdb_md_tables(void)
+{
+	static const char digits[] = "0123456789abcdef";
+	int i;
+
+	if (kdb_md_ascii[0])
+		return;
+	for (i = 0; i < 256; i++) {
+		kdb_md_hex[i][0] = digits[i >> 4];
+		kdb_md_hex[i][1] = digits[i & 15];
+		kdb_md_ascii[i] = isascii(i) && isprint(i) ? i : '.';
+	}
+}
+
+static char *kdb_md_hexbytes(char *o, const unsigned char *p, int n)
+{
+	while (n--) {
+		memcpy(o, kdb_md_hex[*p++], 2);
+		o += 2;
+	}
+	return o;
+}
+
+/*
+ * kdb_md_row
+ *
+ *	Render one hex line of md output, the same text kdb_md_line prints
+ *	for radix 16 without symbols.
+ *
+ * Inputs:
+ *	addr		Address of the first word
+ *	data		The words from kdb_md_buf
+ *	n		Number of words to show, n <= num
+ *	bytesperword	Word size
+ *	num		Words per full line, for the padding before the ASCII
+ *	phys		addr is a physical address
+ * Outputs:
+ *	None.
+ * Returns:
+ *	None.
+ * Locking:
+ *	none.
+ * Remarks:
+ *	Words are shown most significant byte first, the ASCII column is
+ *	in memory order.
+ */
+
+static void kdb_md_row(kdb_machreg_t addr, const unsigned char *data, int n,
+		       int bytesperword, int num, int phys)
+{
+	char line[KDB_MD_LINELEN];
+	char *o = line;
+	int i, j;
+
+	if (phys) {
+		memcpy(o, "phys ", 5);
+		o += 5;
+	}
+	*o++ = '0';
+	*o++ = 'x';
+	for (i = sizeof(addr) - 1; i >= 0; i--) {
+		memcpy(o, kdb_md_hex[(addr >> (8 * i)) & 0xff], 2);
+		o += 2;
+	}
+	*o++ = ' ';
+
+	for (i = 0; i < n; i++) {
+		const unsigned char *w = data + i * bytesperword;
+#ifdef	__BIG_ENDIAN
+		o = kdb_md_hexbytes(o, w, bytesperword);
+#else
+		for (j = bytesperword - 1; j >= 0; j--) {
+			memcpy(o, kdb_md_hex[w[j]], 2);
+			o += 2;
+		}
+#endif
+		*o++ = ' ';
+	}
+	j = (num - n) * (2 * bytesperword + 1) + 2;
+	memset(o, ' ', j);
+	o += j;
+	for (i = 0; i < n * bytesperword; i++)
+		*o++ = kdb_md_ascii[data[i]];
+	*o++ = '\n';
+	kdb_output_write(line, o - line);
+}
+
 /*
  * kdb_mdr
  *
@@ -1699,7 +2133,7 @@ out:
  * Outputs:
  *	None.
  * Returns:
- *	Always 0.  Any errors are detected and printed by kdb_getarea.
+ *	Always 0.  Any errors are detected and printed here.
  * Locking:
  *	none.
  * Remarks:
@@ -1707,12 +2141,27 @@ out:
 
 static int kdb_mdr(kdb_machreg_t addr, unsigned int count)
 {
-	unsigned char c;
-	while (count--) {
-		if (kdb_getarea(c, addr))
+	const unsigned char *p;
+	char line[KDB_MD_LINELEN];
+	size_t n, i;
+
+	kdb_md_tables();
+	kdb_md_buf.valid = 0;
+	while (count) {
+		p = kdb_md_fetch(addr, 1, count, 0);
+		if (!p) {
+			lkmd_printf("\n");
+			kdb_md_badaddr();
 			return 0;
-		lkmd_printf("%02x", c);
-		addr++;
+		}
+		n = min_t(size_t, count, kdb_md_avail(addr));
+		for (i = 0; i < n; i += KDB_MD_LINELEN / 2) {
+			char *o = kdb_md_hexbytes(line, p + i,
+					min_t(size_t, n - i, KDB_MD_LINELEN / 2));
+			kdb_output_write(line, o - line);
+		}
+		addr += n;
+		count -= n;
 	}
 	lkmd_printf("\n");
 	return 0;
@@ -1740,9 +2189,12 @@ static int kdb_mdr(kdb_machreg_t addr, unsigned int count)
  * Locking:
  *	none.
  * Remarks:
+ *	Each line is rendered from kdb_md_buf, data holds the words
+ *	that were read for this line, avail of them are valid.
  */
 
 static void kdb_md_line(const char *fmtstr, kdb_machreg_t addr,
+	    const unsigned char *data, int avail,
 	    int symbolic, int nosect, int bytesperword,
 	    int num, int repeat, int phys)
 {
@@ -1760,11 +2212,10 @@ static void kdb_md_line(const char *fmtstr, kdb_machreg_t addr,
 		lkmd_printf(kdb_machreg_fmt0 " ", addr);
 
 	for (i = 0; i < num && repeat--; i++) {
-		if (phys) {
-			if (kdb_getphysword(&word, addr, bytesperword))
-				break;
-		} else if (kdb_getword(&word, addr, bytesperword))
+		if (i >= avail)
 			break;
+		word = kdb_md_word(data, bytesperword);
+		data += bytesperword;
 		lkmd_printf(fmtstr, word);
 		if (symbolic)
 			kdbnearsym(word, &symtab);
@@ -1818,189 +2269,1199 @@ static void kdb_md_line(const char *fmtstr, kdb_machreg_t addr,
 #undef printable_char
 		}
 	}
-	lkmd_printf("%*s %s\n", (int)((num-i)*(2*bytesperword + 1)+1), " ", cbuf);
+	lkmd_printf("%*s %s\n", (int)((num-i)*(2*bytesperword + 1)+1), " ", cbuf);
+}
+
+static int kdb_md(int argc, const char **argv)
+{
+	static kdb_machreg_t last_addr;
+	static int last_radix, last_bytesperword, last_repeat;
+	int radix = 16, mdcount = 8, bytesperword = KDB_WORD_SIZE, repeat;
+	int nosect = 0;
+	char fmtchar, fmtstr[64];
+	kdb_machreg_t addr;
+	long offset = 0;
+	int symbolic = 0;
+	int valid = 0;
+	int phys = 0;
+
+	kdbgetintenv("MDCOUNT", &mdcount);
+	kdbgetintenv("RADIX", &radix);
+	kdbgetintenv("BYTESPERWORD", &bytesperword);
+
+	/* Assume 'md <addr>' and start with environment values */
+	repeat = mdcount * 16 / bytesperword;
+
+	if (strcmp(argv[0], "mdr") == 0) {
+		if (argc != 2)
+			return KDB_ARGCOUNT;
+		valid = 1;
+	} else if (isdigit(argv[0][2])) {
+		bytesperword = (int)(argv[0][2] - '0');
+		if (bytesperword == 0) {
+			bytesperword = last_bytesperword;
+			if (bytesperword == 0) {
+				bytesperword = 4;
+			}
+		}
+		last_bytesperword = bytesperword;
+		repeat = mdcount * 16 / bytesperword;
+		if (!argv[0][3])
+			valid = 1;
+		else if (argv[0][3] == 'c' && argv[0][4]) {
+			char *p;
+			repeat = simple_strtoul(argv[0]+4, &p, 10);
+			mdcount = ((repeat * bytesperword) + 15) / 16;
+			valid = !*p;
+		}
+		last_repeat = repeat;
+	} else if (strcmp(argv[0], "md") == 0)
+		valid = 1;
+	else if (strcmp(argv[0], "mds") == 0)
+		valid = 1;
+	else if (strcmp(argv[0], "mdp") == 0) {
+		phys = valid = 1;
+	}
+	if (!valid)
+		return KDB_NOTFOUND;
+
+	if (argc == 0) {
+		if (last_addr == 0)
+			return KDB_ARGCOUNT;
+		addr = last_addr;
+		radix = last_radix;
+		bytesperword = last_bytesperword;
+		repeat = last_repeat;
+		mdcount = ((repeat * bytesperword) + 15) / 16;
+	}
+
+	if (argc) {
+		kdb_machreg_t val;
+		int diag, nextarg = 1;
+		diag = kdbgetaddrarg(argc, argv, &nextarg, &addr, &offset, NULL);
+		if (diag)
+			return diag;
+		if (argc > nextarg+2)
+			return KDB_ARGCOUNT;
+
+		if (argc >= nextarg) {
+			diag = kdbgetularg(argv[nextarg], &val);
+			if (!diag) {
+				mdcount = (int) val;
+				repeat = mdcount * 16 / bytesperword;
+			}
+		}
+		if (argc >= nextarg+1) {
+			diag = kdbgetularg(argv[nextarg+1], &val);
+			if (!diag)
+				radix = (int) val;
+		}
+	}
+
+	if (strcmp(argv[0], "mdr") == 0) {
+		return kdb_mdr(addr, mdcount);
+	}
+
+	switch (radix) {
+	case 10:
+		fmtchar = 'd';
+		break;
+	case 16:
+		fmtchar = 'x';
+		break;
+	case 8:
+		fmtchar = 'o';
+		break;
+	default:
+		return KDB_BADRADIX;
+	}
+
+	last_radix = radix;
+
+	if (bytesperword > KDB_WORD_SIZE)
+		return KDB_BADWIDTH;
+
+	switch (bytesperword) {
+	case 8:
+		sprintf(fmtstr, "%%16.16l%c ", fmtchar);
+		break;
+	case 4:
+		sprintf(fmtstr, "%%8.8l%c ", fmtchar);
+		break;
+	case 2:
+		sprintf(fmtstr, "%%4.4l%c ", fmtchar);
+		break;
+	case 1:
+		sprintf(fmtstr, "%%2.2l%c ", fmtchar);
+		break;
+	default:
+		return KDB_BADWIDTH;
+	}
+
+	last_repeat = repeat;
+	last_bytesperword = bytesperword;
+
+	if (strcmp(argv[0], "mds") == 0) {
+		symbolic = 1;
+		/* Do not save these changes as last_*, they are temporary mds
+		 * overrides.
+		 */
+		bytesperword = KDB_WORD_SIZE;
+		repeat = mdcount;
+		kdbgetintenv("NOSECT", &nosect);
+	}
+
+	/* Round address down modulo BYTESPERWORD */
+
+	addr &= ~(bytesperword-1);
+
+	kdb_md_tables();
+	kdb_md_buf.valid = 0;
+	while (repeat > 0) {
+		const unsigned char *p;
+		unsigned long a;
+		int n, z, avail, num = (symbolic ? 1 : (16 / bytesperword));
+
+		n = min(num, repeat);
+		p = kdb_md_fetch(addr, n * bytesperword, (size_t)repeat * bytesperword, phys);
+		if (!p) {
+			kdb_md_badaddr();
+			break;
+		}
+		avail = kdb_md_avail(addr) / bytesperword;
+		if (fmtchar == 'x' && !symbolic)
+			kdb_md_row(addr, p, min(n, avail), bytesperword, num, phys);
+		else
+			kdb_md_line(fmtstr, addr, p, avail, symbolic, nosect, bytesperword, num, repeat, phys);
+		if (avail < n) {
+			addr += bytesperword * avail;
+			kdb_md_badaddr();
+			break;
+		}
+
+		/* Count the zero words from addr, a whole buffer at a time,
+		 * the buffer is refilled as needed, the line above has
+		 * already been printed.
+		 */
+		for (a = addr, z = 0; z < repeat; ) {
+			const unsigned char *nz;
+			int k;
+			p = kdb_md_fetch(a, bytesperword, (size_t)(repeat - z) * bytesperword, phys);
+			if (!p)
+				break;
+			avail = kdb_md_avail(a) / bytesperword;
+			if (!avail)
+				break;
+			k = min(avail, repeat - z);
+			nz = memchr_inv(p, 0, k * bytesperword);
+			if (nz) {
+				z += (nz - p) / bytesperword;
+				break;
+			}
+			z += k;
+			a += k * bytesperword;
+		}
+		addr += bytesperword * n;
+		repeat -= n;
+		z = (z + num - 1) / num;
+		if (z > 2) {
+			int s = num * (z-2);
+			lkmd_printf(kdb_machreg_fmt0 "-" kdb_machreg_fmt0 " zero suppressed\n",
+				addr, addr + bytesperword * s - 1);
+			addr += bytesperword * s;
+			repeat -= s;
+		}
+	}
+	last_addr = addr;
+
+	return 0;
+}
+
+/*
+ * kdb_mm
+ *
+ *	This function implements the 'mm' command.
+ *
+ *	mm address-expression new-value
+ *
+ * Inputs:
+ *	argc	argument count
+ *	argv	argument vector
+ * Outputs:
+ *	None.
+ * Returns:
+ *	zero for success, a kdb diagnostic if error
+ * Locking:
+ *	none.
+ * Remarks:
+ *	mm works on machine words, mmW works on bytes.
+ */
+
+static int kdb_mm(int argc, const char **argv)
+{
+	int diag;
+	kdb_machreg_t addr;
+	long offset = 0;
+	unsigned long contents;
+	int nextarg;
+	int width;
+
+	if (argv[0][2] && !isdigit(argv[0][2]))
+		return KDB_NOTFOUND;
+
+	if (argc < 2) {
+		return KDB_ARGCOUNT;
+	}
+
+	nextarg = 1;
+	if ((diag = kdbgetaddrarg(argc, argv, &nextarg, &addr, &offset, NULL)))
+		return diag;
+
+	if (nextarg > argc)
+		return KDB_ARGCOUNT;
+
+	if ((diag = kdbgetaddrarg(argc, argv, &nextarg, &contents, NULL, NULL)))
+		return diag;
+
+	if (nextarg != argc + 1)
+		return KDB_ARGCOUNT;
+
+	width = argv[0][2] ? (argv[0][2] - '0') : (KDB_WORD_SIZE);
+	if ((diag = kdb_putword(addr, contents, width)))
+		return diag;
+
+	lkmd_printf(kdb_machreg_fmt " = " kdb_machreg_fmt "\n", addr, contents);
+
+	return 0;
+}
+
+/*
+ * Memory search.  The range is cut into chunks which are scanned on the
+ * controlling cpu and the held cpus, a round of KDB_MS_SLOTS chunks at a
+ * time.  Each chunk has its own slot for the read buffer and the matches,
+ * after each round the matches are printed in address order.
+ */
+
+#define KDB_MS_MAXPAT	64			/* longest pattern */
+#define KDB_MS_MAXHITS	64			/* most matches per ms command */
+#define KDB_MS_SLOTS	32			/* chunks per round */
+#define KDB_MS_CHUNK	(1024*1024)		/* bytes per chunk */
+#define KDB_MS_BUFSIZE	PAGE_SIZE
+
+struct kdb_ms_slot {
+	unsigned char buf[KDB_MS_BUFSIZE + KDB_MS_MAXPAT];
+	unsigned long bitmap[BITS_TO_LONGS(KDB_MS_BUFSIZE + KDB_MS_MAXPAT)];
+	unsigned long hit[KDB_MS_MAXHITS];
+	int nhits;
+};
+
+static struct kdb_ms_slot kdb_ms_slot[KDB_MS_SLOTS];
+
+static struct {
+	unsigned char pat[KDB_MS_MAXPAT];
+	unsigned char mask[KDB_MS_MAXPAT];
+	int len;
+	int anchor;		/* offset of a byte with a full mask, -1 if none */
+	int masked;		/* some mask bytes are not 0xff */
+	int align;		/* matches must be aligned to this */
+	unsigned long next;	/* where the search continues */
+	unsigned long end;	/* end of the search range */
+	unsigned long round;	/* start of the current round */
+	int maxhits;		/* matches wanted from each chunk */
+	int phys;		/* searching physical addresses (msp) */
+} kdb_search;
+
+/*
+ * kdb_ms_candidates
+ *
+ *	Mark the possible match positions in a buffer.
+ *
+ * Inputs:
+ *	buf	The data.
+ *	n	Number of positions to check.
+ * Outputs:
+ *	bitmap	Bit i is set if a match may start at buf[i].
+ * Returns:
+ *	None.
+ * Locking:
+ *	none.
+ * Remarks:
+ *	Only the anchor byte is checked here, using the word at a time scanner
+ *	when the architecture has one.
+ */
+
+static void kdb_ms_candidates(const unsigned char *buf, size_t n, unsigned long *bitmap)
+{
+	const unsigned char *p, *e;
+	unsigned char c;
+
+	if (kdb_search.anchor < 0) {
+		bitmap_fill(bitmap, n);
+		return;
+	}
+	bitmap_zero(bitmap, n);
+	buf += kdb_search.anchor;
+	c = kdb_search.pat[kdb_search.anchor];
+#ifdef kdba_memscan
+	if (kdba_memscan(buf, n, c, bitmap))
+		return;
+#endif	/* kdba_memscan */
+	for (p = buf, e = buf + n; (p = memchr(p, c, e - p)); ++p)
+		__set_bit(p - buf, bitmap);
+}
+
+/*
+ * kdb_ms_scan
+ *
+ *	Record the matches in a buffer.
+ *
+ * Inputs:
+ *	slot	The slot, its buffer holds the data.
+ *	valid	Number of valid bytes in the buffer.
+ *	base	Address of the first byte in the buffer.
+ *	limit	Only matches that start before limit are recorded.
+ * Outputs:
+ *	Matches are added to slot->hit.
+ * Returns:
+ *	None.
+ * Locking:
+ *	none.
+ * Remarks:
+ *	Pointer searches only look at aligned words, no bitmap needed.
+ */
+
+static void kdb_ms_scan(struct kdb_ms_slot *slot, size_t valid,
+			unsigned long base, unsigned long limit)
+{
+	const unsigned char *buf = slot->buf;
+	size_t n, pos;
+	int k;
+
+	if (valid < kdb_search.len)
+		return;
+	n = valid - kdb_search.len + 1;
+	if (limit - base < n)
+		n = limit - base;
+
+	if (kdb_search.align == sizeof(unsigned long) && kdb_search.len == sizeof(unsigned long)) {
+		unsigned long value = *(unsigned long *)kdb_search.pat;
+		for (pos = -base & (kdb_search.align - 1); pos < n; pos += kdb_search.align) {
+			if (*(unsigned long *)(buf + pos) != value)
+				continue;
+			slot->hit[slot->nhits++] = base + pos;
+			if (slot->nhits >= kdb_search.maxhits)
+				return;
+		}
+		return;
+	}
+
+	kdb_ms_candidates(buf, n, slot->bitmap);
+	for_each_set_bit(pos, slot->bitmap, n) {
+		if ((base + pos) & (kdb_search.align - 1))
+			continue;
+		if (kdb_search.masked) {
+			for (k = 0; k < kdb_search.len; ++k) {
+				if ((buf[pos + k] ^ kdb_search.pat[k]) & kdb_search.mask[k])
+					break;
+			}
+			if (k < kdb_search.len)
+				continue;
+		} else if (memcmp(buf + pos, kdb_search.pat, kdb_search.len)) {
+			continue;
+		}
+		slot->hit[slot->nhits++] = base + pos;
+		if (slot->nhits >= kdb_search.maxhits)
+			return;
+	}
+}
+
+static unsigned long kdb_ms_next_mapped(unsigned long addr)
+{
+	if (kdb_search.phys)
+		return (addr | ~PAGE_MASK) + 1;
+#ifdef kdba_next_mapped
+	return kdba_next_mapped(addr);
+#else
+	return (addr | ~PAGE_MASK) + 1;
+#endif	/* kdba_next_mapped */
+}
+
+/* Read part of the search range without messages */
+static int kdb_ms_read(void *buf, unsigned long addr, size_t size, size_t *done)
+{
+	if (kdb_search.phys)
+		return kdb_getphys_bulk(buf, addr, size, done);
+	return kdb_getarea_bulk(buf, addr, size, done);
+}
+
+/*
+ * kdb_ms_chunk
+ *
+ *	Worker function, search one chunk of the range.
+ *
+ * Inputs:
+ *	start	Start of the chunk.
+ *	end	End of the chunk, matches must start before end but may
+ *		extend past it.
+ *	data	Unused.
+ * Outputs:
+ *	The matches are left in the slot for this chunk.
+ * Returns:
+ *	The number of matches.
+ * Locking:
+ *	none.
+ * Remarks:
+ *	Runs on any cpu in kdb, must not print.  A fault skips to the
+ *	next address that may be mapped.
+ */
+
+static long kdb_ms_chunk(unsigned long start, unsigned long end, void *data)
+{
+	struct kdb_ms_slot *slot = &kdb_ms_slot[(start - kdb_search.round) / KDB_MS_CHUNK];
+	unsigned long a = start, fault;
+	size_t want, done;
+
+	slot->nhits = 0;
+	while (a < end && slot->nhits < kdb_search.maxhits) {
+		want = min(end - a, KDB_MS_BUFSIZE) + kdb_search.len - 1;
+		if (want > kdb_search.end - a)
+			want = kdb_search.end - a;
+		if (want < kdb_search.len)
+			break;
+		kdb_ms_read(slot->buf, a, want, &done);
+		kdb_ms_scan(slot, done, a, end);
+		if (done < want) {
+			fault = a + done;
+			a = kdb_ms_next_mapped(fault);
+			if (a <= fault)
+				break;
+		} else {
+			a += want - kdb_search.len + 1;
+		}
+	}
+	return slot->nhits;
+}
+
+/*
+ * kdb_ms_hex
+ *
+ *	Convert a string of hex digit pairs to bytes.
+ *
+ * Inputs:
+ *	s	The string, an optional 0x prefix is ignored.
+ *	out	Where to store the bytes.
+ *	max	Size of out.
+ * Outputs:
+ *	None.
+ * Returns:
+ *	Number of bytes stored, a kdb diagnostic if error.
+ * Locking:
+ *	none.
+ */
+
+static int kdb_ms_hex(const char *s, unsigned char *out, int max)
+{
+	int n = 0, hi, lo;
+
+	if (s[0] == '0' && (s[1] == 'x' || s[1] == 'X'))
+		s += 2;
+	while (*s) {
+		if (n >= max)
+			return KDB_BADLENGTH;
+		hi = hex_to_bin(s[0]);
+		lo = s[1] ? hex_to_bin(s[1]) : -1;
+		if (hi < 0 || lo < 0)
+			return KDB_BADINT;
+		out[n++] = (hi << 4) | lo;
+		s += 2;
+	}
+	return n;
+}
+
+/*
+ * kdb_ms_pattern
+ *
+ *	Parse the pattern arguments of the ms command.
+ *
+ * Inputs:
+ *	argc	argument count
+ *	argv	argument vector
+ *	nextarg	index of the pattern type
+ * Outputs:
+ *	The pattern is stored in kdb_search.
+ * Returns:
+ *	zero for success, a kdb diagnostic if error
+ * Locking:
+ *	none.
+ */
+
+static int kdb_ms_pattern(int argc, const char **argv, int nextarg)
+{
+	const char *type = argv[nextarg++];
+	unsigned long val;
+	int i, n, diag;
+
+	if (nextarg > argc)
+		return KDB_ARGCOUNT;
+	kdb_search.len = 0;
+	kdb_search.masked = 0;
+	kdb_search.align = 1;
+	memset(kdb_search.mask, 0xff, sizeof(kdb_search.mask));
+
+	if (strcmp(type, "-b") == 0) {
+		for (; nextarg <= argc; ++nextarg) {
+			n = kdb_ms_hex(argv[nextarg], kdb_search.pat + kdb_search.len,
+				       KDB_MS_MAXPAT - kdb_search.len);
+			if (n < 0)
+				return n;
+			kdb_search.len += n;
+		}
+	} else if (strcmp(type, "-m") == 0) {
+		if (nextarg + 1 != argc)
+			return KDB_ARGCOUNT;
+		n = kdb_ms_hex(argv[nextarg], kdb_search.pat, KDB_MS_MAXPAT);
+		if (n < 0)
+			return n;
+		if (kdb_ms_hex(argv[nextarg+1], kdb_search.mask, KDB_MS_MAXPAT) != n)
+			return KDB_BADLENGTH;
+		kdb_search.len = n;
+		kdb_search.masked = 1;
+	} else if (strcmp(type, "-p") == 0) {
+		long offset = 0;
+		diag = kdbgetaddrarg(argc, argv, &nextarg, &val, &offset, NULL);
+		if (diag)
+			return diag;
+		memcpy(kdb_search.pat, &val, sizeof(val));
+		kdb_search.len = kdb_search.align = sizeof(val);
+	} else if (strcmp(type, "-s") == 0) {
+		const char *s = argv[nextarg];
+		n = strlen(s);
+		if (n >= 2 && (s[0] == '"' || s[0] == '\'') && s[n-1] == s[0]) {
+			++s;
+			n -= 2;
+		}
+		if (n > KDB_MS_MAXPAT)
+			return KDB_BADLENGTH;
+		memcpy(kdb_search.pat, s, n);
+		kdb_search.len = n;
+	} else {
+		return KDB_ARGCOUNT;
+	}
+	if (kdb_search.len == 0)
+		return KDB_BADLENGTH;
+
+	kdb_search.anchor = -1;
+	for (i = 0; i < kdb_search.len; ++i) {
+		if (kdb_search.mask[i] == 0xff) {
+			kdb_search.anchor = i;
+			break;
+		}
+	}
+	return 0;
+}
+
+/*
+ * kdb_ms
+ *
+ *	This function implements the 'ms' command.
+ *
+ *	ms <vaddr> <bytes> -b <hex>...		byte pattern
+ *	ms <vaddr> <bytes> -m <hex> <mask>	only the bits set in mask
+ *						have to match
+ *	ms <vaddr> <bytes> -p <value>		aligned pointer sized value
+ *	ms <vaddr> <bytes> -s <string>
+ *	msp <paddr> <bytes> <pattern>		search physical memory
+ *	ms					continue the last search
+ *
+ * Inputs:
+ *	argc	argument count
+ *	argv	argument vector
+ * Outputs:
+ *	None.
+ * Returns:
+ *	zero for success, a kdb diagnostic if error
+ * Locking:
+ *	none.
+ * Remarks:
+ *	At most MSCOUNT matches are printed, 'ms' or 'msp' with no
+ *	arguments continues after the last match of either kind of
+ *	search.  Any key stops the search.
+ */
+
+static int kdb_ms(int argc, const char **argv)
+{
+	unsigned long addr, len, round_end;
+	long offset = 0, ret;
+	int nextarg = 1, diag, i, j, printed = 0, maxhits = KDB_MS_MAXHITS;
+
+	kdbgetintenv("MSCOUNT", &maxhits);
+	if (maxhits <= 0 || maxhits > KDB_MS_MAXHITS)
+		maxhits = KDB_MS_MAXHITS;
+
+	if (argc == 0) {
+		if (!kdb_search.len)
+			return KDB_ARGCOUNT;
+		if (kdb_search.next >= kdb_search.end) {
+			lkmd_printf("ms: search finished\n");
+			return 0;
+		}
+	} else {
+		diag = kdbgetaddrarg(argc, argv, &nextarg, &addr, &offset, NULL);
+		if (diag)
+			return diag;
+		if (nextarg + 1 > argc)
+			return KDB_ARGCOUNT;
+		diag = kdbgetularg(argv[nextarg++], &len);
+		if (diag)
+			return diag;
+		diag = kdb_ms_pattern(argc, argv, nextarg);
+		if (diag) {
+			kdb_search.len = 0;
+			return diag;
+		}
+		kdb_search.next = addr;
+		kdb_search.end = addr + len < addr ? ~0UL : addr + len;
+		kdb_search.phys = strcmp(argv[0], "msp") == 0;
+	}
+
+	while (kdb_search.next < kdb_search.end && printed < maxhits) {
+		unsigned char c;
+
+		/* Skip large holes without dispatching a whole round */
+		if (kdb_ms_read(&c, kdb_search.next, 1, NULL)) {
+			addr = kdb_ms_next_mapped(kdb_search.next);
+			kdb_search.next = addr > kdb_search.next ? addr : kdb_search.end;
+			continue;
+		}
+
+		kdb_search.round = kdb_search.next;
+		round_end = kdb_search.round + min(kdb_search.end - kdb_search.round,
+					       (unsigned long)KDB_MS_SLOTS * KDB_MS_CHUNK);
+		kdb_search.maxhits = maxhits - printed;
+		ret = kdb_work_run(kdb_ms_chunk, NULL, kdb_search.round, round_end, KDB_MS_CHUNK);
+		if (ret < 0)
+			return ret;
+		kdb_search.next = round_end;
+
+		for (i = 0; i < KDB_MS_SLOTS && printed < maxhits; ++i) {
+			if (kdb_search.round + (unsigned long)i * KDB_MS_CHUNK >= round_end)
+				break;
+			for (j = 0; j < kdb_ms_slot[i].nhits && printed < maxhits; ++j) {
+				addr = kdb_ms_slot[i].hit[j];
+				if (kdb_search.phys)
+					lkmd_printf("phys " kdb_machreg_fmt0 "\n", addr);
+				else
+					kdb_symbol_print(addr, NULL, KDB_SP_DEFAULT|KDB_SP_NEWLINE);
+				++printed;
+				if (printed == maxhits)
+					kdb_search.next = addr + 1;
+			}
+		}
+
+		if (kdb_poll_interrupt()) {
+			lkmd_printf("ms: interrupted at " kdb_machreg_fmt0 "\n", kdb_search.next);
+			return 0;
+		}
+	}
+	if (printed == maxhits && kdb_search.next < kdb_search.end)
+		lkmd_printf("ms: %d matches shown, 'ms' continues from " kdb_machreg_fmt0 "\n",
+			printed, kdb_search.next);
+	else if (!printed)
+		lkmd_printf("ms: no match\n");
+	return 0;
+}
+
+static unsigned char kdb_mh_buf[PAGE_SIZE];
+
+/*
+ * kdb_mh
+ *
+ *	This function implements the 'mh' and 'mhp' commands, the crc32
+ *	of a range of memory.
+ *
+ *	mh <vaddr> <bytes> [<chunk>]
+ *	mhp <paddr> <bytes> [<chunk>]
+ *
+ * Inputs:
+ *	argc	argument count
+ *	argv	argument vector
+ * Outputs:
+ *	None.
+ * Returns:
+ *	zero for success, a kdb diagnostic if error
+ * Locking:
+ *	none.
+ * Remarks:
+ *	With a chunk size one crc is printed for each chunk, which finds
+ *	the part of a large range that differs from a known good copy.
+ *	The range must be readable, a fault stops the command.
+ */
+
+static int kdb_mh(int argc, const char **argv)
+{
+	unsigned long addr, len, chunk = 0, a, end, cstart;
+	long offset = 0;
+	size_t n, done;
+	u32 crc = ~0;
+	int nextarg = 1, diag, phys = strcmp(argv[0], "mhp") == 0;
+
+	if (argc < 2)
+		return KDB_ARGCOUNT;
+	diag = kdbgetaddrarg(argc, argv, &nextarg, &addr, &offset, NULL);
+	if (diag)
+		return diag;
+	if (nextarg > argc)
+		return KDB_ARGCOUNT;
+	diag = kdbgetularg(argv[nextarg++], &len);
+	if (diag)
+		return diag;
+	if (nextarg <= argc && (diag = kdbgetularg(argv[nextarg++], &chunk)))
+		return diag;
+	if (nextarg <= argc)
+		return KDB_ARGCOUNT;
+	end = addr + len < addr ? ~0UL : addr + len;
+	if (!chunk || chunk > end - addr)
+		chunk = end - addr;
+
+	for (a = cstart = addr; a < end; a += n) {
+		n = min(end - a, PAGE_SIZE - (a & ~PAGE_MASK));
+		if (n > cstart + chunk - a)
+			n = cstart + chunk - a;
+		if (phys)
+			diag = kdb_getphys_bulk(kdb_mh_buf, a, n, &done);
+		else
+			diag = kdb_getarea_bulk(kdb_mh_buf, a, n, &done);
+		if (diag) {
+			lkmd_printf("%sBad address " kdb_machreg_fmt0 "\n",
+				phys ? "phys " : "", a + done);
+			return 0;
+		}
+		crc = crc32_le(crc, kdb_mh_buf, n);
+		if (a + n == cstart + chunk || a + n == end) {
+			lkmd_printf(kdb_machreg_fmt0 " %8lu bytes crc32 0x%08x\n",
+				cstart, a + n - cstart, ~crc);
+			crc = ~0;
+			cstart = a + n;
+		}
+		touch_nmi_watchdog();
+		if (!((a + n) & ((1UL << 20) - 1)) && kdb_poll_interrupt()) {
+			lkmd_printf("mh: interrupted at " kdb_machreg_fmt0 "\n", a + n);
+			return 0;
+		}
+	}
+	return 0;
+}
+
+/*
+ * Bulk memory writes.  mmb, mf and mcp write through kdb_putarea_bulk with
+ * one write window open for the whole command, so text and rodata can be
+ * patched, and every chunk is read back to verify it.  Nothing is printed
+ * until the window is closed again.
+ */
+
+#define KDB_MMB_MAX	256			/* most bytes for one mmb */
+
+static unsigned char kdb_mw_buf[PAGE_SIZE];
+
+static void kdb_mw_report(const char *cmd, unsigned long addr, size_t size,
+			  size_t done)
+{
+	if (done < size)
+		lkmd_printf("%s: write failed or did not verify at " kdb_machreg_fmt0
+			", %lu of %lu bytes done\n", cmd, addr + done,
+			(unsigned long)done, (unsigned long)size);
+	else
+		lkmd_printf("%s: %lu bytes written at " kdb_machreg_fmt0 "\n",
+			cmd, (unsigned long)size, addr);
+}
+
+/*
+ * kdb_mmb
+ *
+ *	This function implements the 'mmb' command.
+ *
+ *	mmb <vaddr> <hexbytes>...
+ *
+ * Inputs:
+ *	argc	argument count
+ *	argv	argument vector
+ * Outputs:
+ *	None.
+ * Returns:
+ *	zero for success, a kdb diagnostic if error
+ * Locking:
+ *	none.
+ * Remarks:
+ *	The bytes are written in the order given, e.g.
+ *	'mmb func 0f 1f 44 00 00' writes a five byte nop.
+ */
+
+static int kdb_mmb(int argc, const char **argv)
+{
+	unsigned long addr;
+	long offset = 0;
+	size_t done;
+	int nextarg = 1, diag, n, len = 0;
+
+	if (argc < 2)
+		return KDB_ARGCOUNT;
+	diag = kdbgetaddrarg(argc, argv, &nextarg, &addr, &offset, NULL);
+	if (diag)
+		return diag;
+	if (nextarg > argc)
+		return KDB_ARGCOUNT;
+	for (; nextarg <= argc; ++nextarg) {
+		n = kdb_ms_hex(argv[nextarg], kdb_mw_buf + len, KDB_MMB_MAX - len);
+		if (n < 0)
+			return n;
+		len += n;
+	}
+	if (!len)
+		return KDB_BADLENGTH;
+
+	kdb_write_begin();
+	kdb_putarea_bulk(addr, kdb_mw_buf, len, &done);
+	kdb_write_end();
+	kdb_mw_report(argv[0], addr, len, done);
+	return 0;
+}
+
+/*
+ * kdb_mf
+ *
+ *	This function implements the 'mf' command.
+ *
+ *	mf <vaddr> <bytes> <hexpattern>
+ *
+ * Inputs:
+ *	argc	argument count
+ *	argv	argument vector
+ * Outputs:
+ *	None.
+ * Returns:
+ *	zero for success, a kdb diagnostic if error
+ * Locking:
+ *	none.
+ * Remarks:
+ *	The pattern is repeated from vaddr on, the last copy may be cut
+ *	short.
+ */
+
+static int kdb_mf(int argc, const char **argv)
+{
+	unsigned char pat[KDB_MS_MAXPAT];
+	unsigned long addr, len, a, end;
+	long offset = 0;
+	size_t n, i, done = 0;
+	int nextarg = 1, diag, plen, phase;
+
+	if (argc < 3)
+		return KDB_ARGCOUNT;
+	diag = kdbgetaddrarg(argc, argv, &nextarg, &addr, &offset, NULL);
+	if (diag)
+		return diag;
+	if (nextarg + 1 != argc)
+		return KDB_ARGCOUNT;
+	diag = kdbgetularg(argv[nextarg++], &len);
+	if (diag)
+		return diag;
+	plen = kdb_ms_hex(argv[nextarg], pat, sizeof(pat));
+	if (plen < 0)
+		return plen;
+	if (!plen || addr + len < addr)
+		return KDB_BADLENGTH;
+
+	end = addr + len;
+	phase = 0;
+	kdb_write_begin();
+	for (a = addr; a < end; a += n) {
+		n = min(end - a, PAGE_SIZE - (a & ~PAGE_MASK));
+		for (i = 0; i < n; ++i) {
+			kdb_mw_buf[i] = pat[phase];
+			if (++phase == plen)
+				phase = 0;
+		}
+		touch_nmi_watchdog();
+		if (kdb_putarea_bulk(a, kdb_mw_buf, n, &done)) {
+			done += a - addr;
+			break;
+		}
+		done = a + n - addr;
+	}
+	kdb_write_end();
+	kdb_mw_report(argv[0], addr, len, done);
+	return 0;
+}
+
+/*
+ * kdb_mcp
+ *
+ *	This function implements the 'mcp' command.
+ *
+ *	mcp <dst> <src> <bytes>
+ *
+ * Inputs:
+ *	argc	argument count
+ *	argv	argument vector
+ * Outputs:
+ *	None.
+ * Returns:
+ *	zero for success, a kdb diagnostic if error
+ * Locking:
+ *	none.
+ * Remarks:
+ *	Overlapping ranges are copied like memmove.
+ */
+
+static int kdb_mcp(int argc, const char **argv)
+{
+	unsigned long dst, src, len, off, o = 0;
+	long offset = 0;
+	size_t n, done = 0;
+	int nextarg = 1, diag, backward, rfault = 0;
+
+	if (argc < 3)
+		return KDB_ARGCOUNT;
+	diag = kdbgetaddrarg(argc, argv, &nextarg, &dst, &offset, NULL);
+	if (diag)
+		return diag;
+	diag = kdbgetaddrarg(argc, argv, &nextarg, &src, &offset, NULL);
+	if (diag)
+		return diag;
+	if (nextarg != argc)
+		return KDB_ARGCOUNT;
+	diag = kdbgetularg(argv[nextarg], &len);
+	if (diag)
+		return diag;
+	if (dst + len < dst || src + len < src)
+		return KDB_BADLENGTH;
+
+	backward = dst > src && dst - src < len;
+	kdb_write_begin();
+	for (off = 0; off < len; off += n) {
+		n = min(len - off, PAGE_SIZE);
+		o = backward ? len - off - n : off;
+		touch_nmi_watchdog();
+		if (kdb_getarea_bulk(kdb_mw_buf, src + o, n, &done)) {
+			rfault = 1;
+			break;
+		}
+		if (kdb_putarea_bulk(dst + o, kdb_mw_buf, n, &done))
+			break;
+	}
+	kdb_write_end();
+	if (rfault)
+		lkmd_printf("%s: Bad address " kdb_machreg_fmt0 "\n", argv[0], src + o + done);
+	else if (off < len)
+		kdb_mw_report(argv[0], dst, len, o + done);
+	else
+		kdb_mw_report(argv[0], dst, len, len);
+	return 0;
 }
 
-static int kdb_md(int argc, const char **argv)
+/*
+ * Memory snapshots.  snap copies a region into an arena that is allocated
+ * once at init, sdiff compares the region with its copy a word at a time
+ * and shows the words that changed.  Snapshots are packed at the start of
+ * the arena in the order they were taken, deleting one moves the later
+ * ones down.
+ */
+
+#define KDB_SNAP_ARENA	(1024*1024)		/* bytes for all snapshots */
+#define KDB_MAXSNAP	8
+#define KDB_SNAP_NAMELEN 16
+
+static struct kdb_snap {
+	char name[KDB_SNAP_NAMELEN];		/* "" if the entry is free */
+	unsigned long addr;
+	unsigned long len;
+	unsigned long *data;			/* in kdb_snap_arena */
+} kdb_snap[KDB_MAXSNAP];
+
+static unsigned char *kdb_snap_arena;
+static unsigned long kdb_snap_used;		/* bytes of the arena in use */
+static unsigned long kdb_snap_buf[PAGE_SIZE / sizeof(unsigned long)];
+
+#define KDB_SNAP_WORDS(len) (((len) + sizeof(unsigned long) - 1) / sizeof(unsigned long))
+
+static struct kdb_snap *kdb_snap_find(const char *name)
 {
-	static kdb_machreg_t last_addr;
-	static int last_radix, last_bytesperword, last_repeat;
-	int radix = 16, mdcount = 8, bytesperword = KDB_WORD_SIZE, repeat;
-	int nosect = 0;
-	char fmtchar, fmtstr[64];
-	kdb_machreg_t addr;
-	unsigned long word;
-	long offset = 0;
-	int symbolic = 0;
-	int valid = 0;
-	int phys = 0;
+	int i;
 
-	kdbgetintenv("MDCOUNT", &mdcount);
-	kdbgetintenv("RADIX", &radix);
-	kdbgetintenv("BYTESPERWORD", &bytesperword);
+	for (i = 0; i < KDB_MAXSNAP; ++i) {
+		if (kdb_snap[i].name[0] && strcmp(kdb_snap[i].name, name) == 0)
+			return kdb_snap + i;
+	}
+	return NULL;
+}
 
-	/* Assume 'md <addr>' and start with environment values */
-	repeat = mdcount * 16 / bytesperword;
+/* Free a snapshot and close the gap it leaves in the arena */
+static void kdb_snap_free(struct kdb_snap *sp)
+{
+	unsigned char *start = (unsigned char *)sp->data;
+	unsigned long size = KDB_SNAP_WORDS(sp->len) * sizeof(unsigned long);
+	int i;
 
-	if (strcmp(argv[0], "mdr") == 0) {
-		if (argc != 2)
-			return KDB_ARGCOUNT;
-		valid = 1;
-	} else if (isdigit(argv[0][2])) {
-		bytesperword = (int)(argv[0][2] - '0');
-		if (bytesperword == 0) {
-			bytesperword = last_bytesperword;
-			if (bytesperword == 0) {
-				bytesperword = 4;
-			}
-		}
-		last_bytesperword = bytesperword;
-		repeat = mdcount * 16 / bytesperword;
-		if (!argv[0][3])
-			valid = 1;
-		else if (argv[0][3] == 'c' && argv[0][4]) {
-			char *p;
-			repeat = simple_strtoul(argv[0]+4, &p, 10);
-			mdcount = ((repeat * bytesperword) + 15) / 16;
-			valid = !*p;
-		}
-		last_repeat = repeat;
-	} else if (strcmp(argv[0], "md") == 0)
-		valid = 1;
-	else if (strcmp(argv[0], "mds") == 0)
-		valid = 1;
-	else if (strcmp(argv[0], "mdp") == 0) {
-		phys = valid = 1;
+	memmove(start, start + size, kdb_snap_arena + kdb_snap_used - (start + size));
+	kdb_snap_used -= size;
+	for (i = 0; i < KDB_MAXSNAP; ++i) {
+		if (kdb_snap[i].name[0] && (unsigned char *)kdb_snap[i].data > start)
+			kdb_snap[i].data = (unsigned long *)((unsigned char *)kdb_snap[i].data - size);
 	}
-	if (!valid)
-		return KDB_NOTFOUND;
+	sp->name[0] = '\0';
+}
+
+/*
+ * kdb_snap_cmd
+ *
+ *	This function implements the 'snap' command.
+ *
+ *	snap				list the snapshots
+ *	snap <name> <vaddr> <bytes>	take a snapshot
+ *	snap <name>			take the snapshot again, same range
+ *	snap -d <name>			delete a snapshot
+ *
+ * Inputs:
+ *	argc	argument count
+ *	argv	argument vector
+ * Outputs:
+ *	None.
+ * Returns:
+ *	zero for success, a kdb diagnostic if error
+ * Locking:
+ *	none.
+ * Remarks:
+ *	An existing snapshot with the same name is replaced, it is kept
+ *	when the new copy can not be read.
+ */
+
+static int kdb_snap_cmd(int argc, const char **argv)
+{
+	struct kdb_snap *sp, *slot;
+	unsigned long addr, len, size, off, n;
+	unsigned char *tail;
+	long offset = 0;
+	size_t done;
+	int i, nextarg, diag;
 
+	if (!kdb_snap_arena) {
+		lkmd_printf("snap: no snapshot buffer\n");
+		return 0;
+	}
 	if (argc == 0) {
-		if (last_addr == 0)
+		for (i = 0; i < KDB_MAXSNAP; ++i) {
+			sp = kdb_snap + i;
+			if (sp->name[0])
+				lkmd_printf("%-*s " kdb_machreg_fmt0 " %lu bytes\n",
+					KDB_SNAP_NAMELEN, sp->name, sp->addr, sp->len);
+		}
+		lkmd_printf("%lu of %lu bytes used\n", kdb_snap_used,
+			(unsigned long)KDB_SNAP_ARENA);
+		return 0;
+	}
+	if (strcmp(argv[1], "-d") == 0) {
+		if (argc != 2)
 			return KDB_ARGCOUNT;
-		addr = last_addr;
-		radix = last_radix;
-		bytesperword = last_bytesperword;
-		repeat = last_repeat;
-		mdcount = ((repeat * bytesperword) + 15) / 16;
+		if (!(sp = kdb_snap_find(argv[2]))) {
+			lkmd_printf("snap: no snapshot '%s'\n", argv[2]);
+			return 0;
+		}
+		kdb_snap_free(sp);
+		return 0;
 	}
+	if (strlen(argv[1]) >= KDB_SNAP_NAMELEN)
+		return KDB_BADLENGTH;
 
-	if (argc) {
-		kdb_machreg_t val;
-		int diag, nextarg = 1;
+	sp = kdb_snap_find(argv[1]);
+	if (argc == 1) {
+		if (!sp) {
+			lkmd_printf("snap: no snapshot '%s'\n", argv[1]);
+			return 0;
+		}
+		addr = sp->addr;
+		len = sp->len;
+	} else {
+		nextarg = 2;
 		diag = kdbgetaddrarg(argc, argv, &nextarg, &addr, &offset, NULL);
 		if (diag)
 			return diag;
-		if (argc > nextarg+2)
+		if (nextarg != argc)
 			return KDB_ARGCOUNT;
-
-		if (argc >= nextarg) {
-			diag = kdbgetularg(argv[nextarg], &val);
-			if (!diag) {
-				mdcount = (int) val;
-				repeat = mdcount * 16 / bytesperword;
-			}
-		}
-		if (argc >= nextarg+1) {
-			diag = kdbgetularg(argv[nextarg+1], &val);
-			if (!diag)
-				radix = (int) val;
-		}
-	}
-
-	if (strcmp(argv[0], "mdr") == 0) {
-		return kdb_mdr(addr, mdcount);
+		diag = kdbgetularg(argv[nextarg], &len);
+		if (diag)
+			return diag;
+		if (!len || addr + len < addr)
+			return KDB_BADLENGTH;
 	}
 
-	switch (radix) {
-	case 10:
-		fmtchar = 'd';
-		break;
-	case 16:
-		fmtchar = 'x';
-		break;
-	case 8:
-		fmtchar = 'o';
-		break;
-	default:
-		return KDB_BADRADIX;
+	size = KDB_SNAP_WORDS(len) * sizeof(unsigned long);
+	if (size > KDB_SNAP_ARENA - kdb_snap_used +
+	    (sp ? KDB_SNAP_WORDS(sp->len) * sizeof(unsigned long) : 0)) {
+		lkmd_printf("snap: not enough space, %lu of %lu bytes used\n",
+			kdb_snap_used, (unsigned long)KDB_SNAP_ARENA);
+		return 0;
 	}
-
-	last_radix = radix;
-
-	if (bytesperword > KDB_WORD_SIZE)
-		return KDB_BADWIDTH;
-
-	switch (bytesperword) {
-	case 8:
-		sprintf(fmtstr, "%%16.16l%c ", fmtchar);
-		break;
-	case 4:
-		sprintf(fmtstr, "%%8.8l%c ", fmtchar);
-		break;
-	case 2:
-		sprintf(fmtstr, "%%4.4l%c ", fmtchar);
-		break;
-	case 1:
-		sprintf(fmtstr, "%%2.2l%c ", fmtchar);
-		break;
-	default:
-		return KDB_BADWIDTH;
+	if (!sp) {
+		for (i = 0; i < KDB_MAXSNAP && kdb_snap[i].name[0]; ++i)
+			;
+		if (i == KDB_MAXSNAP) {
+			lkmd_printf("snap: all %d snapshots in use\n", KDB_MAXSNAP);
+			return 0;
+		}
+		slot = kdb_snap + i;
+	} else {
+		slot = sp;
 	}
 
-	last_repeat = repeat;
-	last_bytesperword = bytesperword;
-
-	if (strcmp(argv[0], "mds") == 0) {
-		symbolic = 1;
-		/* Do not save these changes as last_*, they are temporary mds
-		 * overrides.
+	if (size <= KDB_SNAP_ARENA - kdb_snap_used) {
+		/* Read behind the arena, an old copy is only dropped once
+		 * the new one is complete.
 		 */
-		bytesperword = KDB_WORD_SIZE;
-		repeat = mdcount;
-		kdbgetintenv("NOSECT", &nosect);
-	}
-
-	/* Round address down modulo BYTESPERWORD */
-
-	addr &= ~(bytesperword-1);
-
-	while (repeat > 0) {
-		unsigned long a;
-		int n, z, num = (symbolic ? 1 : (16 / bytesperword));
-
-		for (a = addr, z = 0; z < repeat; a += bytesperword, ++z) {
-			if (phys) {
-				if (kdb_getphysword(&word, a, bytesperword)
-						|| word)
-					break;
-			} else if (kdb_getword(&word, a, bytesperword) || word)
-				break;
+		tail = kdb_snap_arena + kdb_snap_used;
+		((unsigned long *)tail)[KDB_SNAP_WORDS(len) - 1] = 0;
+		if (kdb_getarea_bulk(tail, addr, len, &done)) {
+			lkmd_printf("snap: Bad address " kdb_machreg_fmt0 "\n", addr + done);
+			return 0;
 		}
-		n = min(num, repeat);
-		kdb_md_line(fmtstr, addr, symbolic, nosect, bytesperword, num, repeat, phys);
-		addr += bytesperword * n;
-		repeat -= n;
-		z = (z + num - 1) / num;
-		if (z > 2) {
-			int s = num * (z-2);
-			lkmd_printf(kdb_machreg_fmt0 "-" kdb_machreg_fmt0 " zero suppressed\n",
-				addr, addr + bytesperword * s - 1);
-			addr += bytesperword * s;
-			repeat -= s;
+		if (sp) {
+			kdb_snap_free(sp);
+			memmove(kdb_snap_arena + kdb_snap_used, tail, size);
+		}
+	} else {
+		/* Only fits in the space of the copy it replaces, check that
+		 * the whole range reads before giving that up.
+		 */
+		for (off = 0; off < len; off += n) {
+			n = min(len - off, (unsigned long)sizeof(kdb_snap_buf));
+			if (kdb_getarea_bulk(kdb_snap_buf, addr + off, n, &done)) {
+				lkmd_printf("snap: Bad address " kdb_machreg_fmt0 "\n",
+					addr + off + done);
+				return 0;
+			}
+		}
+		kdb_snap_free(sp);
+		tail = kdb_snap_arena + kdb_snap_used;
+		((unsigned long *)tail)[KDB_SNAP_WORDS(len) - 1] = 0;
+		if (kdb_getarea_bulk(tail, addr, len, &done)) {
+			lkmd_printf("snap: Bad address " kdb_machreg_fmt0 "\n", addr + done);
+			return 0;
 		}
 	}
-	last_addr = addr;
-
+	sp = slot;
+	sp->data = (unsigned long *)(kdb_snap_arena + kdb_snap_used);
+	strcpy(sp->name, argv[1]);
+	sp->addr = addr;
+	sp->len = len;
+	kdb_snap_used += size;
 	return 0;
 }
 
 /*
- * kdb_mm
+ * kdb_sdiff
  *
- *	This function implements the 'mm' command.
+ *	This function implements the 'sdiff' command.
  *
- *	mm address-expression new-value
+ *	sdiff <name>
  *
  * Inputs:
  *	argc	argument count
@@ -2012,44 +3473,59 @@ static int kdb_md(int argc, const char **argv)
  * Locking:
  *	none.
  * Remarks:
- *	mm works on machine words, mmW works on bytes.
+ *	Each changed word is printed with its address, its old value and
+ *	its new value, addresses and values are symbolized.  The words are
+ *	counted from the start of the snapshot, a short last word is
+ *	padded with zero.  Unchanged memory is skipped eight words at a
+ *	time.
  */
 
-static int kdb_mm(int argc, const char **argv)
+static int kdb_sdiff(int argc, const char **argv)
 {
-	int diag;
-	kdb_machreg_t addr;
-	long offset = 0;
-	unsigned long contents;
-	int nextarg;
-	int width;
-
-	if (argv[0][2] && !isdigit(argv[0][2]))
-		return KDB_NOTFOUND;
+	const int bpw = sizeof(unsigned long);
+	const unsigned long *old, *new;
+	struct kdb_snap *sp;
+	unsigned long off, n, i, words, changed = 0;
+	size_t done;
 
-	if (argc < 2) {
+	if (argc != 1)
 		return KDB_ARGCOUNT;
+	if (!(sp = kdb_snap_find(argv[1]))) {
+		lkmd_printf("sdiff: no snapshot '%s'\n", argv[1]);
+		return 0;
 	}
 
-	nextarg = 1;
-	if ((diag = kdbgetaddrarg(argc, argv, &nextarg, &addr, &offset, NULL)))
-		return diag;
-
-	if (nextarg > argc)
-		return KDB_ARGCOUNT;
-
-	if ((diag = kdbgetaddrarg(argc, argv, &nextarg, &contents, NULL, NULL)))
-		return diag;
-
-	if (nextarg != argc + 1)
-		return KDB_ARGCOUNT;
-
-	width = argv[0][2] ? (argv[0][2] - '0') : (KDB_WORD_SIZE);
-	if ((diag = kdb_putword(addr, contents, width)))
-		return diag;
-
-	lkmd_printf(kdb_machreg_fmt " = " kdb_machreg_fmt "\n", addr, contents);
-
+	for (off = 0; off < sp->len; off += n) {
+		n = min(sp->len - off, (unsigned long)sizeof(kdb_snap_buf));
+		words = KDB_SNAP_WORDS(n);
+		kdb_snap_buf[words - 1] = 0;
+		if (kdb_getarea_bulk(kdb_snap_buf, sp->addr + off, n, &done)) {
+			lkmd_printf("sdiff: Bad address " kdb_machreg_fmt0 "\n",
+				sp->addr + off + done);
+			return 0;
+		}
+		old = sp->data + off / bpw;
+		new = kdb_snap_buf;
+		for (i = 0; i < words; ++i) {
+			if (i + 8 <= words &&
+			    !((old[i] ^ new[i]) | (old[i+1] ^ new[i+1]) |
+			      (old[i+2] ^ new[i+2]) | (old[i+3] ^ new[i+3]) |
+			      (old[i+4] ^ new[i+4]) | (old[i+5] ^ new[i+5]) |
+			      (old[i+6] ^ new[i+6]) | (old[i+7] ^ new[i+7]))) {
+				i += 7;
+				continue;
+			}
+			if (old[i] == new[i])
+				continue;
+			kdb_symbol_print(sp->addr + off + i * bpw, NULL, KDB_SP_DEFAULT);
+			lkmd_printf(" ");
+			kdb_symbol_print(old[i], NULL, KDB_SP_DEFAULT);
+			lkmd_printf(" -> ");
+			kdb_symbol_print(new[i], NULL, KDB_SP_DEFAULT|KDB_SP_NEWLINE);
+			++changed;
+		}
+	}
+	lkmd_printf("sdiff: %lu of %lu words changed\n", changed, KDB_SNAP_WORDS(sp->len));
 	return 0;
 }
 
@@ -2193,6 +3669,8 @@ static int kdb_rm(int argc, const char **argv)
 	if ((diag = kdb_check_regs()))
 		return diag;
 	diag = kdba_setregcontents(&argv[1][ind], kdb_current_regs, contents);
+	/* pt_regs is in memory, do not show stale copies of it */
+	kdb_getarea_invalidate(0, 0);
 	if (diag)
 		return diag;
 
@@ -2715,6 +4193,10 @@ static int kdb_help(int argc, const char **argv)
 			lkmd_printf("%-15.15s %-20.20s %s\n", kt->cmd_name,
 				   kt->cmd_usage, kt->cmd_help);
 	}
+	lkmd_printf("\nOutput of any command can be filtered, e.g. "
+		    "ps | grep -v sleep | field 7 | head 10\n"
+		    "Filters: grep [-v] <re>, head <n>, tail <n>, count, "
+		    "field <n>\n");
 	return 0;
 }
 
@@ -3166,7 +4648,19 @@ static void __init kdb_inittab(void)
 	lkmd_register_repeat("mdp", kdb_md, "<paddr> <bytes>", 	"Display Physical Memory", 0, KDB_REPEAT_NO_ARGS);
 	lkmd_register_repeat("mds", kdb_md, "<vaddr>", 	"Display Memory Symbolically", 0, KDB_REPEAT_NO_ARGS);
 	lkmd_register_repeat("mm", kdb_mm, "<vaddr> <contents>",   "Modify Memory Contents", 0, KDB_REPEAT_NO_ARGS);
+	lkmd_register_repeat("ms", kdb_ms, "<vaddr> <bytes> -b|-m|-p|-s <pattern>", "Search Memory", 0, KDB_REPEAT_NO_ARGS);
+	lkmd_register_repeat("msp", kdb_ms, "<paddr> <bytes> -b|-m|-p|-s <pattern>", "Search Physical Memory", 0, KDB_REPEAT_NO_ARGS);
+	lkmd_register_repeat("mh", kdb_mh, "<vaddr> <bytes> [<chunk>]", "Memory crc32", 0, KDB_REPEAT_NONE);
+	lkmd_register_repeat("mhp", kdb_mh, "<paddr> <bytes> [<chunk>]", "Physical Memory crc32", 0, KDB_REPEAT_NONE);
+	lkmd_register_repeat("mmb", kdb_mmb, "<vaddr> <hexbytes>...", "Modify Memory Bytes", 0, KDB_REPEAT_NONE);
+	lkmd_register_repeat("mf", kdb_mf, "<vaddr> <bytes> <hexpattern>", "Fill Memory", 0, KDB_REPEAT_NONE);
+	lkmd_register_repeat("mcp", kdb_mcp, "<dst> <src> <bytes>", "Copy Memory", 0, KDB_REPEAT_NONE);
+	lkmd_register_repeat("snap", kdb_snap_cmd, "[<name> [<vaddr> <bytes>]]", "Snapshot Memory", 0, KDB_REPEAT_NONE);
+	lkmd_register_repeat("sdiff", kdb_sdiff, "<name>", "Diff Memory against a Snapshot", 0, KDB_REPEAT_NONE);
+	lkmd_register_repeat("sym", kdb_sym, "<pattern>", "List Symbols matching a pattern", 0, KDB_REPEAT_NONE);
 	lkmd_register_repeat("id", kdb_id, "<vaddr>",   "Display Instructions", 1, KDB_REPEAT_NO_ARGS);
+	lkmd_register_repeat("idf", kdb_idf, "<func>",  "Display a whole function", 0, KDB_REPEAT_NONE);
+	lkmd_register_repeat("xref", kdb_xref, "<vaddr>", "Find direct branches to an address", 0, KDB_REPEAT_NONE);
 	lkmd_register_repeat("go", kdb_go, "[<vaddr>]", "Continue Execution", 1, KDB_REPEAT_NONE);
 	lkmd_register_repeat("rd", kdb_rd, "",		"Display Registers", 1, KDB_REPEAT_NONE);
 	lkmd_register_repeat("rm", kdb_rm, "<reg> <contents>", "Modify Registers", 0, KDB_REPEAT_NONE);
@@ -3191,6 +4685,7 @@ static void __init kdb_inittab(void)
 	// lkmd_register_repeat("kill", kdb_kill, "<-signal> <pid>", "Send a signal to a process", 0, KDB_REPEAT_NONE);
 	// lkmd_register_repeat("summary", kdb_summary, "", "Summarize the system", 4, KDB_REPEAT_NONE);
 	lkmd_register_repeat("per_cpu", kdb_per_cpu, "", "Display per_cpu variables", 3, KDB_REPEAT_NONE);
+	lkmd_register_repeat("capture", kdb_capture, "[on|only|off|clear]", "Capture output for /proc/lkmd_capture", 0, KDB_REPEAT_NONE);
 	// lkmd_register_repeat("print", kdb_debuginfo_print, "<expression>",
 	// 	"Type casting, as in lcrash",  0, KDB_REPEAT_NONE);
 	// lkmd_register_repeat("px", kdb_debuginfo_print, "<expression>",
@@ -3271,8 +4766,10 @@ int __init lkmd_init(void)
 {
 	kdb_initial_cpu = smp_processor_id();
 
+	kdb_sym_init();		/* Symbol index, used by lkmd_kernsym_init */
 	if (lkmd_kernsym_init()) {
 		printk(KERN_ERR "Get kernel symbol error\n");
+		kdb_sym_exit();
  		return -EFAULT;
     }
 
@@ -3281,6 +4778,7 @@ int __init lkmd_init(void)
 	 */
 	if (kdb_io_init()) {
 		printk(KERN_ERR "Init io error\n");
+		kdb_sym_exit();
 		return -EFAULT;
     }
 	
@@ -3290,6 +4788,7 @@ int __init lkmd_init(void)
 	kdb_inittab();		/* Initialize Command Table */
 	kdb_initbptab();	/* Initialize Breakpoint Table */
 	kdb_id_init();		/* Initialize Disassembler */
+	kdb_blob_init();	/* Optional symbol and line table blob */
 	lkmda_init();		/* Architecture Dependent Initialization */
 
 	kdb_initial_cpu = -1;	/* Avoid recursion problems */
@@ -3298,10 +4797,21 @@ int __init lkmd_init(void)
 	//atomic_notifier_chain_register(&panic_notifier_list, &kdb_block);
 	//register_cpu_notifier(&kdb_cpu_nfb);
 
+	kdb_snap_arena = vmalloc(KDB_SNAP_ARENA);
+	if (!kdb_snap_arena)
+		lkmd_printf("Cannot allocate the snapshot buffer, snap is disabled\n");
+	kdb_capture_init();
+
 #ifdef kdba_setjmp
 	kdbjmpbuf = vmalloc(NR_CPUS * sizeof(*kdbjmpbuf));
 	if (!kdbjmpbuf) {
 		lkmd_printf("Cannot allocate kdbjmpbuf, no kdb recovery will be possible\n");
+		if (kdb_snap_arena)
+			vfree(kdb_snap_arena);
+		kdb_snap_arena = NULL;
+		kdb_capture_exit();
+		kdb_blob_exit();
+		kdb_sym_exit();
         return -ENOMEM;
     }
 #endif	/* kdba_setjmp */
@@ -3323,11 +4833,16 @@ void __exit lkmd_exit(void)
 	lkmd_printf("LKMD Exited!\n");
 	
 	kdb_initial_cpu = -1;
+	kdb_blob_exit();
+	kdb_sym_exit();
 
 #ifdef kdba_setjmp
     if (kdbjmpbuf)
 	    vfree(kdbjmpbuf);
 #endif
+	if (kdb_snap_arena)
+		vfree(kdb_snap_arena);
+	kdb_capture_exit();
 }
 
 module_init(lkmd_init);
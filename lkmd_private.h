@@ -40,6 +40,7 @@
 #define KDB_BADLENGTH	(-19)
 #define KDB_NOBP	(-20)
 #define KDB_BADADDR	(-21)
+#define KDB_BADFILTER	(-22)
 
 	/*
 	 * Kernel Debugger Command codes.  Must not overlap with error codes.
@@ -90,8 +91,6 @@ typedef struct __ksymtab {
 		unsigned long sym_start;
 		unsigned long sym_end;
 		} kdb_symtab_t;
-//extern int kallsyms_symbol_next(char *prefix_name, int flag);
-//extern int kallsyms_symbol_complete(char *prefix_name, int max_len);
 
 	/*
 	 * Exported Symbols for kernel loadable modules to use.
@@ -102,6 +101,14 @@ extern int lkmd_unregister(char *);
 
 extern int kdb_getarea_size(void *, unsigned long, size_t);
 extern int kdb_putarea_size(unsigned long, void *, size_t);
+extern int kdb_getarea_bulk(void *, unsigned long, size_t, size_t *);
+extern void kdb_getarea_invalidate(unsigned long, size_t);
+extern int kdb_getarea_cacheable(unsigned long);
+extern unsigned long kdb_getarea_generation;
+extern void kdb_getuserarea_invalidate(void);
+extern int kdb_putarea_bulk(unsigned long, const void *, size_t, size_t *);
+extern void kdb_write_begin(void);
+extern void kdb_write_end(void);
 
 /* Like get_user and put_user, kdb_getarea and kdb_putarea take variable
  * names, not pointers.  The underlying *_size functions take pointers.
@@ -111,6 +118,7 @@ extern int kdb_putarea_size(unsigned long, void *, size_t);
 
 extern int kdb_getphysword(unsigned long *word,
 			unsigned long addr, size_t size);
+extern int kdb_getphys_bulk(void *, unsigned long, size_t, size_t *);
 extern int kdb_getword(unsigned long *, unsigned long, size_t);
 extern int kdb_putword(unsigned long, unsigned long, size_t);
 
@@ -122,6 +130,20 @@ extern int kdbgetaddrarg(int, const char**, int*, unsigned long *,
 extern int lkmd_get_sym_val(const char *, kdb_symtab_t *);
 extern int kdbnearsym(unsigned long, kdb_symtab_t *);
 extern void kdbnearsym_cleanup(void);
+extern int kdb_sym_lookup(unsigned long, kdb_symtab_t *);
+extern unsigned long kdb_sym_name_lookup(const char *);
+extern unsigned int kdb_sym_generation(void);
+extern int kdb_sym_text(unsigned long, unsigned long *, unsigned long *);
+extern unsigned long kdb_sym_span(unsigned long, unsigned long *);
+extern int kdb_sym_complete(char *, int);
+extern const char *kdb_sym_complete_next(const char *, int);
+extern int kdb_sym(int, const char **);
+extern void kdb_sym_init(void);
+extern void kdb_sym_exit(void);
+extern int kdb_blob_lookup(unsigned long, kdb_symtab_t *);
+extern int kdb_blob_line(unsigned long, const char **, unsigned int *);
+extern void kdb_blob_init(void);
+extern void kdb_blob_exit(void);
 extern char *kdb_strdup(const char *str, gfp_t type);
 extern void kdb_symbol_print(kdb_machreg_t, const kdb_symtab_t *, unsigned int);
 
@@ -303,12 +325,24 @@ typedef struct _kdbtab {
 	 */
 
 extern int kdb_id(int, const char **);
+extern int kdb_idf(int, const char **);
+extern int kdb_xref(int, const char **);
 extern int kdb_bt(int, const char **);
 
 	/*
 	 * External utility function declarations
 	 */
 extern char* kdb_getstr(char *, size_t, char *);
+extern void kdb_output_begin(void);
+extern void kdb_output_end(void);
+extern void kdb_output_flush(void);
+extern void kdb_output_write(const char *, size_t);
+extern void kdb_output_reset(void);
+extern int kdb_output_filter(int, const char **);
+extern int kdb_capture(int, const char **);
+extern void kdb_capture_init(void);
+extern void kdb_capture_exit(void);
+extern int kdb_poll_interrupt(void);
 
 	/*
 	 * Register contents manipulation
@@ -367,6 +401,15 @@ extern int kdba_ipi(struct pt_regs *, void (*)(void));
 extern int kdba_main_loop(kdb_reason_t, kdb_reason_t, int, kdb_dbtrap_t, struct pt_regs *);
 extern int kdb_main_loop(kdb_reason_t, kdb_reason_t, int, kdb_dbtrap_t, struct pt_regs *);
 
+	/*
+	 * Worker pool, runs chunks of a job on the held cpus.
+	 */
+typedef long (*kdb_work_func_t)(unsigned long start, unsigned long end, void *data);
+
+extern long kdb_work_run(kdb_work_func_t, void *, unsigned long, unsigned long, unsigned long);
+extern void kdb_work_poll(void);
+extern int kdb_work_workers(void);
+
 	/*
 	 * General Disassembler interfaces
 	 */
@@ -374,12 +417,31 @@ extern int kdb_dis_fprintf(PTR, const char *, ...) __attribute__ ((format (print
 extern int kdb_dis_fprintf_dummy(PTR, const char *, ...) __attribute__ ((format (printf, 2, 3)));
 extern disassemble_info	kdb_di;
 
+/* One instruction of a function in the decoded function cache */
+typedef struct {
+	unsigned short offset;		/* from the start of the function */
+	unsigned char length;
+	unsigned char flags;		/* KDB_INSN_* */
+	unsigned long target;		/* direct branch or call target */
+} kdb_insn_t;
+
+#define KDB_INSN_BRANCH	0x01		/* jump, return, int or syscall */
+#define KDB_INSN_CALL	0x02
+#define KDB_INSN_TARGET	0x04		/* target is valid */
+#define KDB_INSN_BAD	0x08		/* not a valid instruction */
+#define KDB_INSN_BLOCK	0x10		/* first instruction of a basic block */
+#define KDB_INSN_JOIN	0x20		/* branched to from inside the function */
+
+extern const kdb_insn_t *kdb_id_lookup(unsigned long);
+
 	/*
 	 * Architecture Dependent Disassembler interfaces
 	 */
 extern int  kdba_id_printinsn(kdb_machreg_t, disassemble_info *);
 extern int  kdba_id_parsemode(const char *, disassemble_info*);
 extern void kdba_id_init(disassemble_info *);
+extern int  kdba_id_classify(kdb_machreg_t, kdb_insn_t *);
+extern int  kdba_insn_len(const unsigned char *, int, kdb_machreg_t, kdb_insn_t *);
 extern void kdba_check_pc(kdb_machreg_t *);
 
 	/*
@@ -402,7 +464,6 @@ extern void kdb_si_swapinfo(struct sysinfo *);
 #ifdef	CONFIG_HUGETLB_PAGE
 extern void kdb_hugetlb_report_meminfo(void);
 #endif	/* CONFIG_HUGETLB_PAGE */
-// extern const char *lkmd_walk_kallsyms(loff_t *pos);
 
 	/*
 	 * Defines for kdb_symbol_print.
@@ -21,6 +21,7 @@
 #include <linux/ptrace.h>
 #include <linux/module.h>
 #include <linux/highmem.h>
+#include <linux/hugetlb.h>
 #include <linux/hardirq.h>
 #include <linux/delay.h>
 #include <linux/version.h>
@@ -74,19 +75,19 @@ static struct lkmd_kernel_sym kernelsym;
 
 int __init lkmd_kernsym_init(void)
 {
-	if ((kernelsym.curr_task = kallsyms_lookup_name("curr_task")) == 0 ||
+	if ((kernelsym.curr_task = kdb_sym_name_lookup("curr_task")) == 0 ||
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(3,9,0)
-			(kernelsym.follow_page_mask = kallsyms_lookup_name("follow_page_mask")) == 0 ||
+			(kernelsym.follow_page_mask = kdb_sym_name_lookup("follow_page_mask")) == 0 ||
 #endif
-			(kernelsym.irq_enter = kallsyms_lookup_name("irq_enter")) == 0 ||
-			(kernelsym.irq_exit = kallsyms_lookup_name("irq_exit")) == 0 ||
-			(kernelsym.kallsyms_lookup = kallsyms_lookup_name("kallsyms_lookup")) == 0 ||
-			(kernelsym.find_extend_vma = kallsyms_lookup_name("find_extend_vma")) == 0)
+			(kernelsym.irq_enter = kdb_sym_name_lookup("irq_enter")) == 0 ||
+			(kernelsym.irq_exit = kdb_sym_name_lookup("irq_exit")) == 0 ||
+			(kernelsym.kallsyms_lookup = kdb_sym_name_lookup("kallsyms_lookup")) == 0 ||
+			(kernelsym.find_extend_vma = kdb_sym_name_lookup("find_extend_vma")) == 0)
 		return -EFAULT;
 
-	if ((orig_smp_error_interrupt = (void *)kallsyms_lookup_name("smp_error_interrupt")) == 0 ||
-			(orig_do_debug = (void *)kallsyms_lookup_name("do_debug")) == 0 ||
-			(orig_do_int3 = (void *)kallsyms_lookup_name("do_int3")) == 0)
+	if ((orig_smp_error_interrupt = (void *)kdb_sym_name_lookup("smp_error_interrupt")) == 0 ||
+			(orig_do_debug = (void *)kdb_sym_name_lookup("do_debug")) == 0 ||
+			(orig_do_int3 = (void *)kdb_sym_name_lookup("do_int3")) == 0)
 		return -EFAULT;
 
     return 0;
@@ -130,16 +131,18 @@ struct vm_area_struct *lkmd_find_extend_vma(struct mm_struct *mm, unsigned long
 
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(3,9,0)
 struct page *lkmd_follow_page(struct vm_area_struct *vma,
-                              unsigned long address, unsigned int flags)
+                              unsigned long address, unsigned int flags,
+                              unsigned int *page_mask)
 {
-	unsigned int unused_page_mask;
 	struct page *(*fn)(struct vm_area_struct *,unsigned long, unsigned int,
     	unsigned int *) = (void *)kernelsym.follow_page_mask;
 
-	return fn(vma, address, flags, &unused_page_mask);
+	*page_mask = 0;
+	return fn(vma, address, flags, page_mask);
 }
 #else
-#define lkmd_follow_page(vma, address, flags) follow_page(vma, address, flags)
+#define lkmd_follow_page(vma, address, flags, page_mask) \
+	(*(page_mask) = 0, follow_page(vma, address, flags))
 #endif
 
 int kdb_task_has_cpu(const struct task_struct *p)
@@ -152,31 +155,6 @@ struct task_struct *lkmd_find_task_by_pid_ns(pid_t nr, struct pid_namespace *ns)
 	return pid_task(find_pid_ns(nr, ns), PIDTYPE_PID);
 }
 
-// @TODO
-// struct kallsym_iter {
-// 	loff_t pos;
-// 	unsigned long value;
-// 	unsigned int nameoff; /* If iterating in core kernel symbols. */
-// 	char name[KSYM_NAME_LEN];
-// };
-
-// const char *lkmd_walk_kallsyms(loff_t *pos)
-// {
-// 	static struct kallsym_iter kdb_walk_kallsyms_iter;
-// 	if (*pos == 0) {
-// 		memset(&kdb_walk_kallsyms_iter, 0, sizeof(kdb_walk_kallsyms_iter));
-// 		reset_iter(&kdb_walk_kallsyms_iter, 0);
-// 	}
-// 	while (1) {
-// 		if (!update_iter(&kdb_walk_kallsyms_iter, *pos))
-// 			return NULL;
-// 		++*pos;
-// 		/* Some debugging symbols have no name.  Ignore them. */
-// 		if (kdb_walk_kallsyms_iter.name[0])
-// 			return kdb_walk_kallsyms_iter.name;
-// 	}
-// }
-
 /*
  * Symbol table functions.
  */
@@ -204,7 +182,7 @@ int lkmd_get_sym_val(const char *symname, kdb_symtab_t *symtab)
 		lkmd_printf("lkmd_get_sym_val: symname=%s, symtab=%p\n", symname, symtab);
 	memset(symtab, 0, sizeof(*symtab));
 
-	if ((symtab->sym_start = kallsyms_lookup_name(symname))) {
+	if ((symtab->sym_start = kdb_sym_name_lookup(symname))) {
 		if (KDB_DEBUG(AR))
 			lkmd_printf("lkmd_get_sym_val: returns 1, symtab->sym_start=0x%lx\n", symtab->sym_start);
 		return 1;
@@ -237,9 +215,22 @@ int lkmd_get_sym_val(const char *symname, kdb_symtab_t *symtab)
  *	maintains an LRU list of the last few unique strings.  The list is sized
  *	large enough to hold active strings, no kdb caller of kdbnearsym makes
  *	more than ~20 later calls before using a saved value.
+ *
+ *	Most lookups are answered by the symbol blob (lkmd_blob.c), if one
+ *	was loaded, or by the symbol index (lkmd_sym.c), whose names stay
+ *	valid for the whole kdb session, kallsyms and the LRU list are only
+ *	used when neither can tell.
+ *
+ *	Disassembly, md and backtraces look up one address after another in
+ *	the same function, so the last symbol found is kept and an address
+ *	inside [sym_start, sym_end) of that symbol is answered without any
+ *	lookup.  The cached symbol is dropped when modules change, when its
+ *	name could leave the LRU list and when kdb resumes the kernel.
  */
 
 static char *kdb_name_table[100];	/* arbitrary size */
+static kdb_symtab_t kdb_nearsym_last;	/* sym_name is NULL when empty */
+static unsigned int kdb_nearsym_gen;
 
 int kdbnearsym(unsigned long addr, kdb_symtab_t *symtab)
 {
@@ -248,13 +239,27 @@ int kdbnearsym(unsigned long addr, kdb_symtab_t *symtab)
 	unsigned long offset;
 #define knt1_size 128		/* must be >= kallsyms table size */
 	char *knt1 = NULL;
+	unsigned int gen = kdb_sym_generation();
 
 	if (KDB_DEBUG(AR))
 		lkmd_printf("kdbnearsym: addr=0x%lx, symtab=%p\n", addr, symtab);
+	if (kdb_nearsym_last.sym_name && kdb_nearsym_gen == gen &&
+	    addr >= kdb_nearsym_last.sym_start && addr < kdb_nearsym_last.sym_end) {
+		*symtab = kdb_nearsym_last;
+		return 1;
+	}
 	memset(symtab, 0, sizeof(*symtab));
 
 	if (addr < 4096)
 		goto out;
+	ret = kdb_blob_lookup(addr, symtab);
+	if (ret < 0)
+		ret = kdb_sym_lookup(addr, symtab);
+	if (ret >= 0)
+		goto modname;
+	ret = 0;
+	/* The cached name may be the one that drops off the LRU list */
+	kdb_nearsym_last.sym_name = NULL;
 	knt1 = debug_kmalloc(knt1_size, GFP_ATOMIC);
 	if (!knt1) {
 		lkmd_printf("kdbnearsym: addr=0x%lx cannot kmalloc knt1\n", addr);
@@ -302,8 +307,13 @@ int kdbnearsym(unsigned long addr, kdb_symtab_t *symtab)
 		knt1 = NULL;
 	}
 
+modname:
 	if (symtab->mod_name == NULL)
 		symtab->mod_name = "kernel";
+	if (ret && symtab->sym_end > symtab->sym_start) {
+		kdb_nearsym_last = *symtab;
+		kdb_nearsym_gen = gen;
+	}
 	if (KDB_DEBUG(AR))
 		lkmd_printf("kdbnearsym: returns %d symtab->sym_start=0x%lx, symtab->mod_name=%p, symtab->sym_name=%p (%s)\n", ret, symtab->sym_start, symtab->mod_name, symtab->sym_name, symtab->sym_name);
 
@@ -316,6 +326,7 @@ void
 kdbnearsym_cleanup(void)
 {
 	int i;
+	kdb_nearsym_last.sym_name = NULL;
 	for (i = 0; i < ARRAY_SIZE(kdb_name_table); ++i) {
 		if (kdb_name_table[i]) {
 			debug_kfree(kdb_name_table[i]);
@@ -324,80 +335,6 @@ kdbnearsym_cleanup(void)
 	}
 }
 
-/*
- * kallsyms_symbol_complete
- *
- * Parameters:
- *	prefix_name	prefix of a symbol name to lookup
- *	max_len		maximum length that can be returned
- * Returns:
- *	Number of symbols which match the given prefix.
- * Notes:
- *	prefix_name is changed to contain the longest unique prefix that
- *	starts with this prefix (tab completion).
- */
-
-// @TODO
-// static char ks_namebuf[KSYM_NAME_LEN+1], ks_namebuf_prev[KSYM_NAME_LEN+1];
-//
-// int kallsyms_symbol_complete(char *prefix_name, int max_len)
-// {
-// 	loff_t pos = 0;
-// 	int prefix_len = strlen(prefix_name), prev_len = 0;
-// 	int i, number = 0;
-// 	const char *name;
-
-// 	while ((name = lkmd_walk_kallsyms(&pos))) {
-// 		if (strncmp(name, prefix_name, prefix_len) == 0) {
-// 			strcpy(ks_namebuf, name);
-// 			/* Work out the longest name that matches the prefix */
-// 			if (++number == 1) {
-// 				prev_len = min_t(int, max_len-1, strlen(ks_namebuf));
-// 				memcpy(ks_namebuf_prev, ks_namebuf, prev_len);
-// 				ks_namebuf_prev[prev_len] = '\0';
-// 			} else for (i = 0; i < prev_len; ++i) {
-// 				if (ks_namebuf[i] != ks_namebuf_prev[i]) {
-// 					prev_len = i;
-// 					ks_namebuf_prev[i] = '\0';
-// 					break;
-// 				}
-// 			}
-// 		}
-// 	}
-//  	if (prev_len > prefix_len)
-// 		memcpy(prefix_name, ks_namebuf_prev, prev_len+1);
-// 	return number;
-// }
-
-/*
- * kallsyms_symbol_next
- *
- * Parameters:
- *	prefix_name	prefix of a symbol name to lookup
- *	flag	0 means search from the head, 1 means continue search.
- * Returns:
- *	1 if a symbol matches the given prefix.
- *	0 if no string found
- */
-// @TODO
-// int kallsyms_symbol_next(char *prefix_name, int flag)
-// {
-// 	int prefix_len = strlen(prefix_name);
-// 	static loff_t pos;
-// 	const char *name;
-
-// 	if (!flag)
-// 		pos = 0;
-
-// 	while ((name = lkmd_walk_kallsyms(&pos))) {
-// 		if (strncmp(name, prefix_name, prefix_len) == 0) {
-// 			strncpy(prefix_name, name, strlen(name)+1);
-// 			return 1;
-// 		}
-// 	}
-// 	return 0;
-// }
-
 #if defined(CONFIG_SMP)
 /*
  * kdb_ipi
@@ -545,6 +482,200 @@ char *kdb_strdup(const char *str, gfp_t type)
 	return strcpy(s, str);
 }
 
+/*
+ * Session page cache.  While a command runs on the controlling cpu, reads of
+ * kernel memory are served from whole pages that were copied once.  Only
+ * RAM backed kernel and module addresses are cached,
+ * reading a full page around a device register is not safe.  Writes through
+ * kdb_putarea_size update the cached copy, anything that changes memory
+ * behind kdb's back must call kdb_getarea_invalidate.  The cache is flushed
+ * every time the controlling cpu enters kdb, including after ss.
+ *
+ * kdb_getarea_generation changes on every write and invalidate, so that
+ * smaller copies kept elsewhere, such as the disassembler's read ahead
+ * window, can tell that they are stale.
+ */
+
+#define KDB_PCACHE_PAGES	16
+
+static struct kdb_pcache {
+	unsigned long vpage;		/* page address, 0 if the slot is empty */
+} kdb_pcache[KDB_PCACHE_PAGES];
+static unsigned char kdb_pcache_data[KDB_PCACHE_PAGES][PAGE_SIZE];
+static int kdb_pcache_next;		/* next slot to replace */
+
+unsigned long kdb_getarea_generation;
+
+/*
+ * kdb_getarea_cacheable
+ *
+ *	Check whether memory at an address may be copied ahead of use.
+ * Inputs:
+ *	addr	Address to check.
+ * Outputs:
+ *	none.
+ * Returns:
+ *	1 if addr is RAM backed kernel or module memory and a command is
+ *	running, 0 otherwise.
+ * Locking:
+ *	none.
+ */
+
+int kdb_getarea_cacheable(unsigned long addr)
+{
+	if (!KDB_STATE(CMD) || addr < PAGE_OFFSET)
+		return 0;
+	return virt_addr_valid(addr) || is_module_address(addr);
+}
+
+/*
+ * kdb_pcache_page
+ *
+ *	Return the cached copy of the page containing addr, reading the
+ *	page into the cache if necessary.
+ * Inputs:
+ *	addr	Address within the page.
+ * Outputs:
+ *	none.
+ * Returns:
+ *	Pointer to the copy of the page, NULL if the page is not cached
+ *	and could not be read.
+ * Locking:
+ *	none.
+ */
+
+static unsigned char *kdb_pcache_lookup(unsigned long addr)
+{
+	unsigned long vpage = addr & PAGE_MASK;
+	int i;
+
+	for (i = 0; i < KDB_PCACHE_PAGES; ++i) {
+		if (kdb_pcache[i].vpage == vpage)
+			return kdb_pcache_data[i];
+	}
+	return NULL;
+}
+
+static unsigned char *kdb_pcache_page(unsigned long addr)
+{
+	unsigned long vpage = addr & PAGE_MASK;
+	unsigned char *page;
+	int i;
+
+	if ((page = kdb_pcache_lookup(addr)))
+		return page;
+	i = kdb_pcache_next;
+	kdb_pcache[i].vpage = 0;
+	if (kdba_getarea_size(kdb_pcache_data[i], vpage, PAGE_SIZE))
+		return NULL;
+	kdb_pcache[i].vpage = vpage;
+	kdb_pcache_next = (i + 1) % KDB_PCACHE_PAGES;
+	return kdb_pcache_data[i];
+}
+
+/*
+ * kdb_pcache_get
+ *
+ *	Read an area through the session page cache.
+ * Inputs:
+ *	res	Pointer to the area to receive the result.
+ *	addr	Address of the area to copy.
+ *	size	Size of the area.
+ * Outputs:
+ *	none.
+ * Returns:
+ *	0 for success, non-zero if any page could not be read.
+ * Locking:
+ *	none.
+ */
+
+static int kdb_pcache_get(void *res, unsigned long addr, size_t size)
+{
+	unsigned char *page;
+	size_t n;
+
+	while (size) {
+		n = min_t(size_t, size, PAGE_SIZE - (addr & ~PAGE_MASK));
+		if (!(page = kdb_pcache_page(addr)))
+			return 1;
+		memcpy(res, page + (addr & ~PAGE_MASK), n);
+		res = (char *)res + n;
+		addr += n;
+		size -= n;
+	}
+	return 0;
+}
+
+/*
+ * kdb_pcache_put
+ *
+ *	Copy data that has just been written to memory into any cached
+ *	pages that cover it.
+ * Inputs:
+ *	addr	Address of the area that was written.
+ *	res	Pointer to the data that was written.
+ *	size	Size of the area.
+ * Outputs:
+ *	none.
+ * Returns:
+ *	none.
+ * Locking:
+ *	none.
+ */
+
+static void kdb_pcache_put(unsigned long addr, const void *res, size_t size)
+{
+	size_t n;
+	int i;
+
+	while (size) {
+		n = min_t(size_t, size, PAGE_SIZE - (addr & ~PAGE_MASK));
+		for (i = 0; i < KDB_PCACHE_PAGES; ++i) {
+			if (kdb_pcache[i].vpage == (addr & PAGE_MASK))
+				memcpy(kdb_pcache_data[i] + (addr & ~PAGE_MASK), res, n);
+		}
+		res = (const char *)res + n;
+		addr += n;
+		size -= n;
+	}
+}
+
+/*
+ * kdb_getarea_invalidate
+ *
+ *	Drop any cached pages that overlap an area.
+ * Inputs:
+ *	addr	Start of the area, 0 with a size of 0 drops all pages
+ *		and the user address tlb.
+ *	size	Size of the area.
+ * Outputs:
+ *	none.
+ * Returns:
+ *	none.
+ * Locking:
+ *	none.
+ * Remarks:
+ *	Called on each entry to kdb_local, by rm (pt_regs live in memory)
+ *	and by any code that writes memory without going through
+ *	kdb_putarea_size.
+ */
+
+void kdb_getarea_invalidate(unsigned long addr, size_t size)
+{
+	unsigned long first = addr & PAGE_MASK;
+	unsigned long last = (addr + size - 1) & PAGE_MASK;
+	int i;
+
+	++kdb_getarea_generation;
+	for (i = 0; i < KDB_PCACHE_PAGES; ++i) {
+		if (!size || (kdb_pcache[i].vpage >= first &&
+			      kdb_pcache[i].vpage <= last))
+			kdb_pcache[i].vpage = 0;
+	}
+	if (!size)
+		kdb_getuserarea_invalidate();
+}
+
 /*
  * kdb_getarea_size
  *
@@ -560,11 +691,19 @@ char *kdb_strdup(const char *str, gfp_t type)
  *	0 for success, < 0 for error.
  * Locking:
  *	none.
+ * Remarks:
+ *	Inside a command, kernel memory is read through the session page
+ *	cache.
  */
 
 int kdb_getarea_size(void *res, unsigned long addr, size_t size)
 {
-	int ret = kdba_getarea_size(res, addr, size);
+	int ret;
+
+	if (kdb_getarea_cacheable(addr) && kdb_getarea_cacheable(addr + size - 1))
+		ret = kdb_pcache_get(res, addr, size);
+	else
+		ret = kdba_getarea_size(res, addr, size);
 	if (ret) {
 		if (!KDB_STATE(SUPPRESS)) {
 			lkmd_printf("kdb_getarea: Bad address 0x%lx\n", addr);
@@ -578,6 +717,52 @@ int kdb_getarea_size(void *res, unsigned long addr, size_t size)
 	return(ret);
 }
 
+/*
+ * kdb_getarea_bulk
+ *
+ *	Read a large area of data, one page sized chunk at a time.
+ *	Unlike kdb_getarea_size, no message is printed for an invalid
+ *	address and the data before the first invalid byte is returned.
+ * Inputs:
+ *	res	Pointer to the area to receive the result.
+ *	addr	Address of the area to copy.
+ *	size	Size of the area.
+ * Outputs:
+ *	done	Number of bytes copied, i.e. the offset of the first byte
+ *		that could not be read.  May be NULL.
+ * Returns:
+ *	0 if the whole area was copied, KDB_BADADDR otherwise.
+ * Locking:
+ *	none.
+ * Remarks:
+ *	The chunks never cross a page boundary and a page is either
+ *	mapped or not, so a failed chunk faults on its first byte and
+ *	the reported offset is exact.  Pages that are in the session
+ *	cache are copied from there, so all views agree, but a bulk read
+ *	does not fill the cache.
+ */
+
+int kdb_getarea_bulk(void *res, unsigned long addr, size_t size, size_t *done)
+{
+	size_t off = 0, n;
+
+	while (off < size) {
+		unsigned char *page = NULL;
+		n = min_t(size_t, size - off, PAGE_SIZE - ((addr + off) & ~PAGE_MASK));
+		/* Use pages that are already cached, do not fill the cache */
+		if (kdb_getarea_cacheable(addr + off))
+			page = kdb_pcache_lookup(addr + off);
+		if (page)
+			memcpy((char *)res + off, page + ((addr + off) & ~PAGE_MASK), n);
+		else if (kdba_getarea_size((char *)res + off, addr + off, n))
+			break;
+		off += n;
+	}
+	if (done)
+		*done = off;
+	return off == size ? 0 : KDB_BADADDR;
+}
+
 /*
  * kdb_putarea_size
  *
@@ -598,6 +783,11 @@ int kdb_getarea_size(void *res, unsigned long addr, size_t size)
 int kdb_putarea_size(unsigned long addr, void *res, size_t size)
 {
 	int ret = kdba_putarea_size(addr, res, size);
+	++kdb_getarea_generation;
+	if (ret)
+		kdb_getarea_invalidate(addr, size);
+	else
+		kdb_pcache_put(addr, res, size);
 	if (ret) {
 		if (!KDB_STATE(SUPPRESS)) {
 			lkmd_printf("kdb_putarea: Bad address 0x%lx\n", addr);
@@ -611,6 +801,88 @@ int kdb_putarea_size(unsigned long addr, void *res, size_t size)
 	return(ret);
 }
 
+/*
+ * kdb_write_begin
+ *
+ *	Open a window in which kdb_putarea_bulk can also write to read
+ *	only kernel memory, if the architecture supports it.
+ * Inputs:
+ *	none.
+ * Outputs:
+ *	none.
+ * Returns:
+ *	none.
+ * Locking:
+ *	none.
+ * Remarks:
+ *	Nothing may be printed while the window is open.  kdb_write_end
+ *	is also called when a command is aborted, it does nothing if the
+ *	window is closed.
+ */
+
+void kdb_write_begin(void)
+{
+#ifdef kdba_write_begin
+	kdba_write_begin();
+#endif	/* kdba_write_begin */
+}
+
+void kdb_write_end(void)
+{
+#ifdef kdba_write_begin
+	kdba_write_end();
+#endif	/* kdba_write_begin */
+}
+
+static unsigned char kdb_verify_buf[PAGE_SIZE];
+
+/*
+ * kdb_putarea_bulk
+ *
+ *	Write a large area of data one page sized chunk at a time and
+ *	read every chunk back to verify it.  No message is printed.
+ * Inputs:
+ *	addr	Address of the area to write to.
+ *	res	Pointer to the area holding the data.
+ *	size	Size of the area.
+ * Outputs:
+ *	done	Offset of the first byte that could not be written or did
+ *		not read back correctly, size if the whole area was
+ *		written.  May be NULL.
+ * Returns:
+ *	0 for success, KDB_BADADDR otherwise.
+ * Locking:
+ *	none.
+ * Remarks:
+ *	Call between kdb_write_begin and kdb_write_end to write text or
+ *	rodata.  Cached copies of the area are dropped.
+ */
+
+int kdb_putarea_bulk(unsigned long addr, const void *res, size_t size, size_t *done)
+{
+	const unsigned char *from = res;
+	size_t off = 0, n, i;
+
+	while (off < size) {
+		n = min_t(size_t, size - off, PAGE_SIZE - ((addr + off) & ~PAGE_MASK));
+		if (kdba_putarea_size(addr + off, (void *)(from + off), n) ||
+		    kdba_getarea_size(kdb_verify_buf, addr + off, n))
+			break;
+		if (memcmp(kdb_verify_buf, from + off, n)) {
+			for (i = 0; kdb_verify_buf[i] == from[off + i]; ++i)
+				;
+			off += i;
+			break;
+		}
+		off += n;
+	}
+	if (size)
+		kdb_getarea_invalidate(addr, size);
+	if (done)
+		*done = off;
+	return off == size ? 0 : KDB_BADADDR;
+}
+
 /*
  * kdb_getphys
  *
@@ -659,6 +931,43 @@ static int kdb_getphys(void *res, unsigned long addr, size_t size)
 	return 0;
 }
 
+/*
+ * kdb_getphys_bulk
+ *
+ *	Read a range of physical memory.  Each page is mapped once and the
+ *	requested part of it copied, instead of mapping the page again for
+ *	every word.
+ * Inputs:
+ *	res	Pointer to the area to receive the result.
+ *	addr	Physical address of the area to copy.
+ *	size	Size of the area.
+ * Outputs:
+ *	done	Number of bytes copied, i.e. the offset of the first byte
+ *		in a page without a valid pfn.  May be NULL.
+ * Returns:
+ *	0 if the whole area was copied, KDB_BADADDR otherwise.
+ * Locking:
+ *	none.
+ * Remarks:
+ *	No message is printed for an invalid address, the same as
+ *	kdb_getarea_bulk.
+ */
+
+int kdb_getphys_bulk(void *res, unsigned long addr, size_t size, size_t *done)
+{
+	size_t off = 0, n;
+
+	while (off < size) {
+		n = min_t(size_t, size - off, PAGE_SIZE - ((addr + off) & ~PAGE_MASK));
+		if (addr + off < addr || kdb_getphys((char *)res + off, addr + off, n))
+			break;
+		off += n;
+	}
+	if (done)
+		*done = off;
+	return off == size ? 0 : KDB_BADADDR;
+}
+
 /*
  * kdb_getphysword
  *
@@ -1004,80 +1313,205 @@ kdb_print_nameval(const char *name, unsigned long val)
 		lkmd_printf("0x%lx\n", val);
 }
 
-static struct page * kdb_get_one_user_page(const struct task_struct *tsk, unsigned long start,
-		int len, int write)
-{
-	struct mm_struct *mm = tsk->mm;
-	unsigned int flags;
-	struct vm_area_struct *	vma;
+/*
+ * User space addresses are translated through a small software tlb keyed
+ * by (mm, virtual page), so reading a user buffer a word at a time does
+ * not walk the vma tree and the page tables for every word.  An entry
+ * covers a whole huge page when the address is mapped by a hugetlb or a
+ * transparent huge page.  The target process is stopped while kdb runs,
+ * the tlb is flushed every time the controlling cpu enters kdb.
+ */
 
-	/* shouldn't cross a page boundary. */
-	if ((start & PAGE_MASK) != ((start+len) & PAGE_MASK))
-		return NULL;
+#define KDB_UTLB_SIZE	16
 
-	/* we need to align start address to the current page boundy, PAGE_ALIGN
-	 * aligns to next page boundry.
-	 * FIXME: What about hugetlb?
-	 */
-	start = start & PAGE_MASK;
-	flags = write ? (VM_WRITE | VM_MAYWRITE) : (VM_READ | VM_MAYREAD);
+static struct kdb_utlb {
+	const struct mm_struct *mm;	/* NULL if the entry is empty */
+	unsigned long vaddr;		/* start of the mapping, size aligned */
+	unsigned long size;		/* PAGE_SIZE or the huge page size */
+	unsigned long pfn;		/* pfn that maps vaddr */
+	int write;			/* translated for writing */
+} kdb_utlb[KDB_UTLB_SIZE];
+static int kdb_utlb_next;		/* next entry to replace */
+
+/*
+ * kdb_utlb_fill
+ *
+ *	Translate a user address the slow way.
+ * Inputs:
+ *	mm	The address space.
+ *	addr	User address.
+ *	write	The translation is for a write.
+ *	e	Entry to fill, a tlb slot or a caller's local entry.
+ * Outputs:
+ *	*e is filled in on success, left alone otherwise.
+ * Returns:
+ *	1 on success, 0 if addr is not mapped with the required access.
+ * Locking:
+ *	none.
+ * Remarks:
+ *	follow_page only reports the size of transparent huge pages,
+ *	hugetlb mappings take their size from the vma.
+ */
 
-	vma = lkmd_find_extend_vma(mm, start);
+static int kdb_utlb_fill(const struct mm_struct *mm, unsigned long addr,
+			 int write, struct kdb_utlb *e)
+{
+	struct vm_area_struct *vma;
+	struct page *page;
+	unsigned int flags, page_mask;
+	unsigned long size;
+
+	flags = write ? (VM_WRITE | VM_MAYWRITE) : (VM_READ | VM_MAYREAD);
+	vma = lkmd_find_extend_vma((struct mm_struct *)mm, addr);
 
 	/* may be we can allow access to VM_IO pages inside KDB? */
 	if (!vma || (vma->vm_flags & VM_IO) || !(flags & vma->vm_flags))
-		return NULL;
+		return 0;
 
-	return lkmd_follow_page(vma, start, write ? FOLL_WRITE : 0);
+	page = lkmd_follow_page(vma, addr & PAGE_MASK, write ? FOLL_WRITE : 0,
+				&page_mask);
+	if (!page || IS_ERR(page))
+		return 0;
+
+	if (is_vm_hugetlb_page(vma))
+		size = vma_kernel_pagesize(vma);
+	else
+		size = (unsigned long)(page_mask + 1) << PAGE_SHIFT;
+	/* The huge page must lie entirely inside the vma */
+	if (size > PAGE_SIZE && ((addr & ~(size - 1)) < vma->vm_start ||
+				 (addr & ~(size - 1)) + size > vma->vm_end))
+		size = PAGE_SIZE;
+
+	e->mm = mm;
+	e->vaddr = addr & ~(size - 1);
+	e->size = size;
+	e->pfn = page_to_pfn(page) - ((addr & PAGE_MASK) - e->vaddr) / PAGE_SIZE;
+	e->write = write;
+	return 1;
 }
 
-int kdb_getuserarea_size(void *to, unsigned long from, size_t size)
-{
-	struct page *page;
-	void *vaddr;
+/*
+ * kdb_user_page
+ *
+ *	Translate a user address of the current kdb process.
+ * Inputs:
+ *	addr	User address.
+ *	write	The translation is for a write.
+ * Outputs:
+ *	none.
+ * Returns:
+ *	The page that holds addr, NULL if it is not mapped with the
+ *	required access.
+ * Locking:
+ *	The tlb is only used on the controlling cpu.  Worker cpus (see
+ *	kdb_work_run) translate without it, they could otherwise match an
+ *	entry that another cpu is still filling in.
+ */
 
-	page = kdb_get_one_user_page(lkmd_current_task, from, size, 0);
-	if (!page)
-		return size;
+static struct page *kdb_user_page(unsigned long addr, int write)
+{
+	const struct mm_struct *mm = lkmd_current_task->mm;
+	struct kdb_utlb *e, local;
+	int i;
 
-#if LINUX_VERSION_CODE >= KERNEL_VERSION(3,4,0)
-	vaddr = kmap_atomic(page);
-#else
-	vaddr = kmap_atomic(page, KM_USER0);
-#endif
+	if (!mm)
+		return NULL;
+	if (smp_processor_id() != kdb_initial_cpu) {
+		e = &local;
+		if (!kdb_utlb_fill(mm, addr, write, e))
+			return NULL;
+		return pfn_to_page(e->pfn + (addr - e->vaddr) / PAGE_SIZE);
+	}
+	for (i = 0, e = kdb_utlb; i < KDB_UTLB_SIZE; ++i, ++e) {
+		if (e->mm == mm && addr - e->vaddr < e->size &&
+		    (e->write || !write))
+			break;
+	}
+	if (i == KDB_UTLB_SIZE) {
+		e = &kdb_utlb[kdb_utlb_next];
+		if (!kdb_utlb_fill(mm, addr, write, e))
+			return NULL;
+		kdb_utlb_next = (kdb_utlb_next + 1) % KDB_UTLB_SIZE;
+	}
+	return pfn_to_page(e->pfn + (addr - e->vaddr) / PAGE_SIZE);
+}
 
-	memcpy(to, vaddr+ (from & (PAGE_SIZE - 1)), size);
+/*
+ * kdb_getuserarea_invalidate
+ *
+ *	Flush the user address tlb.
+ * Inputs:
+ *	none.
+ * Outputs:
+ *	none.
+ * Returns:
+ *	none.
+ * Locking:
+ *	none.
+ */
 
-#if LINUX_VERSION_CODE >= KERNEL_VERSION(3,4,0)
-	kunmap_atomic(vaddr);
-#else
-	kunmap_atomic(vaddr, KM_USER0);
-#endif
-	return 0;
+void kdb_getuserarea_invalidate(void)
+{
+	memset(kdb_utlb, 0, sizeof(kdb_utlb));
+	kdb_utlb_next = 0;
 }
 
-int kdb_putuserarea_size(unsigned long to, void *from, size_t size)
+/*
+ * kdb_copy_user
+ *
+ *	Copy between kdb and the address space of the current kdb
+ *	process, one page at a time.
+ * Inputs:
+ *	buf	kdb buffer.
+ *	uaddr	User address.
+ *	size	Number of bytes.
+ *	write	Copy from buf to uaddr.
+ * Outputs:
+ *	none.
+ * Returns:
+ *	Number of bytes not copied, 0 for success.
+ * Locking:
+ *	none.
+ */
+
+static size_t kdb_copy_user(void *buf, unsigned long uaddr, size_t size, int write)
 {
 	struct page *page;
+	size_t off = 0, n;
 	void *vaddr;
 
-	page = kdb_get_one_user_page(lkmd_current_task, to, size, 1);
-	if (!page)
-		return size;
-
+	while (off < size) {
+		n = min_t(size_t, size - off, PAGE_SIZE - ((uaddr + off) & ~PAGE_MASK));
+		page = kdb_user_page(uaddr + off, write);
+		if (!page)
+			break;
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(3,4,0)
-	vaddr = kmap_atomic(page);
+		vaddr = kmap_atomic(page);
 #else
-	vaddr = kmap_atomic(page, KM_USER0);
+		vaddr = kmap_atomic(page, KM_USER0);
 #endif
-	memcpy(vaddr+ (to & (PAGE_SIZE - 1)), from, size);
-
+		if (write)
+			memcpy(vaddr + ((uaddr + off) & ~PAGE_MASK), (char *)buf + off, n);
+		else
+			memcpy((char *)buf + off, vaddr + ((uaddr + off) & ~PAGE_MASK), n);
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(3,4,0)
-	kunmap_atomic(vaddr);
+		kunmap_atomic(vaddr);
 #else
-	kunmap_atomic(vaddr, KM_USER0);
+		kunmap_atomic(vaddr, KM_USER0);
 #endif
-	return 0;
+		off += n;
+	}
+	return size - off;
+}
+
+int kdb_getuserarea_size(void *to, unsigned long from, size_t size)
+{
+	return kdb_copy_user(to, from, size, 0);
+}
+
+int kdb_putuserarea_size(unsigned long to, void *from, size_t size)
+{
+	return kdb_copy_user(from, to, size, 1);
 }
 
 /* Last ditch allocator for debugging, so we can still debug even when the
@@ -0,0 +1,991 @@
+/*
+ * Kernel Debugger Architecture Independent Symbol Index
+ *
+ * This file is subject to the terms and conditions of the GNU General Public
+ * License.  See the file "COPYING" in the main directory of this archive
+ * for more details.
+ *
+ * kallsyms_lookup() decompresses names and scans the kallsyms tables for
+ * every address, which is far too slow for symbolizing every word of an
+ * mds or every instruction of an id.  The symbol index is a copy of the
+ * kernel and module symbols sorted by address, looked up with a binary
+ * search over an array that holds nothing but the start addresses.  The
+ * same walk of kallsyms fills a name hash, which replaces the linear scan
+ * of kallsyms_lookup_name, and a list of the names in sorted order, which
+ * serves Tab completion and the sym command with a binary search on the
+ * prefix.
+ *
+ * The index is built in process context, kdb itself can not allocate or
+ * take module_mutex.  It is built once at load time, before the kernel
+ * symbols that lkmd needs are resolved, and again from a work item
+ * whenever a module comes or goes.  While a rebuild is pending the core
+ * kernel part of the old index is still used, anything else falls back to
+ * kallsyms.  The index is only replaced and freed while
+ * kdb is not running, so the names it hands out stay valid for the whole
+ * kdb session.
+ */
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/kallsyms.h>
+#include <linux/vmalloc.h>
+#include <linux/slab.h>
+#include <linux/workqueue.h>
+#include <linux/notifier.h>
+#include <linux/mutex.h>
+#include <linux/delay.h>
+#include <linux/sort.h>
+#include <linux/version.h>
+#include "lkmd.h"
+#include "lkmd_private.h"
+
+/* kdbnearsym does not report a symbol that is further away than this */
+#define KDB_SYM_MAXSIZE	(8*1024*1024)
+
+#define KDB_SYM_NONE	(~0U)		/* end of a hash chain */
+
+struct kdb_sym_info {
+	unsigned int size;		/* 0 if the end is not known */
+	unsigned int name;		/* offset in names */
+	unsigned short mod;		/* index in mods, 0 for the kernel */
+};
+
+/* Name hash entry, one for every symbol including aliases */
+struct kdb_sym_hent {
+	unsigned long addr;
+	unsigned int name;		/* offset in names */
+	unsigned int next;		/* next entry in the chain */
+};
+
+struct kdb_symidx {
+	unsigned long nsyms;
+	unsigned long *addr;		/* sorted start addresses */
+	struct kdb_sym_info *info;	/* parallel to addr */
+	char *names;
+	char (*mods)[MODULE_NAME_LEN];	/* mods[0] is "kernel" */
+	struct kdb_sym_hent *hent;	/* in kallsyms order */
+	unsigned long nhent;
+	unsigned long ncore;		/* hent[0..ncore) are kernel symbols */
+	unsigned int *bucket;		/* first hent of each chain */
+	unsigned long nbuckets;		/* a power of 2 */
+	unsigned int *byname;		/* hent indices sorted by name */
+	unsigned long nbyname;		/* duplicate names are left out */
+	struct kdb_sym_text *text;	/* text[0] is the kernel */
+	unsigned long ntext;
+};
+
+/* A range of kernel or module text */
+struct kdb_sym_text {
+	unsigned long start;
+	unsigned long end;
+};
+
+/* Entry used while the index is built and sorted */
+struct kdb_sym_ent {
+	unsigned long start;
+	unsigned int name;
+	unsigned short mod;
+};
+
+struct kdb_sym_build {
+	struct kdb_sym_ent *ent;	/* in kallsyms order */
+	unsigned long nsyms, maxsyms;
+	char *names;
+	unsigned long names_size, maxnames;
+	char (*mods)[MODULE_NAME_LEN];
+	unsigned long nmods, maxmods;
+	struct module *last_mod;
+	struct kdb_sym_text *text;
+	unsigned long ntext, maxtext;
+	unsigned long stext, etext, end;
+	int nomem;
+};
+
+static struct kdb_symidx *kdb_symidx;
+static unsigned long kdb_sym_stext, kdb_sym_end;	/* core kernel range */
+static int kdb_sym_stale = 1;	/* modules changed since the index was built */
+static atomic_t kdb_sym_modgen = ATOMIC_INIT(0);
+static atomic_t kdb_sym_idxgen = ATOMIC_INIT(0);	/* index replacements */
+
+static void kdb_symidx_free(struct kdb_symidx *idx)
+{
+	if (!idx)
+		return;
+	vfree(idx->addr);
+	vfree(idx->info);
+	vfree(idx->names);
+	vfree(idx->mods);
+	vfree(idx->hent);
+	vfree(idx->bucket);
+	vfree(idx->byname);
+	vfree(idx->text);
+	kfree(idx);
+}
+
+static unsigned int kdb_sym_hash(const char *s)
+{
+	unsigned int h = 2166136261U;		/* FNV-1a */
+
+	while (*s)
+		h = (h ^ (unsigned char)*s++) * 16777619U;
+	return h;
+}
+
+/* Make room for need elements in a vmalloc'd array */
+static int kdb_sym_grow(void *array, unsigned long *max, unsigned long need, size_t elem)
+{
+	void **p = array;
+	unsigned long n = *max ? *max : 1024;
+	void *q;
+
+	if (need <= *max)
+		return 0;
+	while (n < need)
+		n *= 2;
+	q = vmalloc(n * elem);
+	if (!q)
+		return -ENOMEM;
+	if (*p) {
+		memcpy(q, *p, *max * elem);
+		vfree(*p);
+	}
+	*p = q;
+	*max = n;
+	return 0;
+}
+
+/*
+ * kdb_sym_modtext
+ *
+ *	Find the core text of a module.
+ *
+ * Inputs:
+ *	mod	The module.
+ * Outputs:
+ *	text	start and end are filled in.
+ * Returns:
+ *	None.
+ * Locking:
+ *	Called with module_mutex held.
+ */
+
+static void kdb_sym_modtext(struct module *mod, struct kdb_sym_text *text)
+{
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6,4,0)
+	text->start = (unsigned long)mod->mem[MOD_TEXT].base;
+	text->end = text->start + mod->mem[MOD_TEXT].size;
+#elif LINUX_VERSION_CODE >= KERNEL_VERSION(4,5,0)
+	text->start = (unsigned long)mod->core_layout.base;
+	text->end = text->start + mod->core_layout.text_size;
+#else
+	text->start = (unsigned long)mod->module_core;
+	text->end = text->start + mod->core_text_size;
+#endif
+}
+
+/*
+ * kdb_sym_add
+ *
+ *	kallsyms_on_each_symbol callback, add a symbol to the index being
+ *	built.
+ *
+ * Inputs:
+ *	data	The build state.
+ *	name	Symbol name.
+ *	mod	Module that holds the symbol, NULL for the kernel.
+ *	addr	Symbol address.
+ * Returns:
+ *	Always 0, to continue the walk.
+ * Locking:
+ *	Called with module_mutex held.
+ * Remarks:
+ *	The symbols of a module are walked together, so a new module index
+ *	is allocated whenever the module changes.  The arrays grow as
+ *	needed, the symbols are only walked once.
+ */
+
+static int kdb_sym_add(void *data, const char *name, struct module *mod,
+		       unsigned long addr)
+{
+	struct kdb_sym_build *b = data;
+	size_t len;
+
+	if (!name[0] || b->nomem)
+		return 0;
+	if (mod != b->last_mod) {
+		b->last_mod = mod;
+		if (mod) {
+			if (kdb_sym_grow(&b->mods, &b->maxmods, b->nmods + 1, sizeof(*b->mods)))
+				goto nomem;
+			strlcpy(b->mods[b->nmods++], mod->name, MODULE_NAME_LEN);
+			if (kdb_sym_grow(&b->text, &b->maxtext, b->ntext + 1, sizeof(*b->text)))
+				goto nomem;
+			kdb_sym_modtext(mod, &b->text[b->ntext++]);
+		}
+	}
+	len = strlen(name) + 1;
+	if (kdb_sym_grow(&b->ent, &b->maxsyms, b->nsyms + 1, sizeof(*b->ent)) ||
+	    kdb_sym_grow(&b->names, &b->maxnames, b->names_size + len, 1))
+		goto nomem;
+	if (!mod && strcmp(name, "_stext") == 0)
+		b->stext = addr;
+	if (!mod && strcmp(name, "_etext") == 0)
+		b->etext = addr;
+	if (!mod && strcmp(name, "_end") == 0)
+		b->end = addr;
+	b->ent[b->nsyms].start = addr;
+	b->ent[b->nsyms].name = b->names_size;
+	b->ent[b->nsyms].mod = mod ? b->nmods - 1 : 0;
+	memcpy(b->names + b->names_size, name, len);
+	++b->nsyms;
+	b->names_size += len;
+	return 0;
+
+nomem:
+	b->nomem = 1;
+	return 0;
+}
+
+static int kdb_sym_cmp(const void *a, const void *b)
+{
+	const struct kdb_sym_ent *x = a, *y = b;
+
+	if (x->start != y->start)
+		return x->start < y->start ? -1 : 1;
+	/* Aliases, keep the one that kallsyms lists first */
+	return x->name < y->name ? -1 : x->name > y->name;
+}
+
+/*
+ * kdb_symidx_hash
+ *
+ *	Build the name hash from the symbols in kallsyms order.
+ *
+ * Inputs:
+ *	idx	The index being built.
+ *	b	The build state.
+ * Returns:
+ *	0 for success, -ENOMEM.
+ * Locking:
+ *	none.
+ * Remarks:
+ *	Every symbol is hashed, including aliases and the per cpu and
+ *	absolute symbols that are left out of the address index.  The
+ *	chains are built backwards so a name that is defined more than
+ *	once finds the same symbol that kallsyms_lookup_name would.
+ */
+
+static int kdb_symidx_hash(struct kdb_symidx *idx, const struct kdb_sym_build *b)
+{
+	unsigned long i;
+	unsigned int h;
+
+	idx->nhent = b->nsyms;
+	idx->nbuckets = 1024;
+	while (idx->nbuckets < b->nsyms)
+		idx->nbuckets *= 2;
+	idx->hent = vmalloc(idx->nhent * sizeof(*idx->hent));
+	idx->bucket = vmalloc(idx->nbuckets * sizeof(*idx->bucket));
+	if (!idx->hent || !idx->bucket)
+		return -ENOMEM;
+	memset(idx->bucket, 0xff, idx->nbuckets * sizeof(*idx->bucket));
+	for (i = 0; i < b->nsyms && b->ent[i].mod == 0; ++i)
+		;
+	idx->ncore = i;
+	for (i = b->nsyms; i-- > 0; ) {
+		h = kdb_sym_hash(idx->names + b->ent[i].name) & (idx->nbuckets - 1);
+		idx->hent[i].addr = b->ent[i].start;
+		idx->hent[i].name = b->ent[i].name;
+		idx->hent[i].next = idx->bucket[h];
+		idx->bucket[h] = i;
+	}
+	return 0;
+}
+
+/* Entry used while the names are sorted */
+struct kdb_sym_nent {
+	const char *name;
+	unsigned int hent;
+};
+
+static int kdb_sym_name_cmp(const void *a, const void *b)
+{
+	const struct kdb_sym_nent *x = a, *y = b;
+	int c = strcmp(x->name, y->name);
+
+	if (c)
+		return c;
+	return x->hent < y->hent ? -1 : x->hent > y->hent;
+}
+
+/*
+ * kdb_symidx_byname
+ *
+ *	Build the list of symbol names in sorted order.
+ *
+ * Inputs:
+ *	idx	The index being built, the name hash must already be there.
+ * Returns:
+ *	0 for success, -ENOMEM.
+ * Locking:
+ *	none.
+ * Remarks:
+ *	A name that is defined more than once is listed once, pointing at
+ *	the definition that kallsyms lists first.
+ */
+
+static int kdb_symidx_byname(struct kdb_symidx *idx)
+{
+	struct kdb_sym_nent *nent;
+	unsigned long i, j;
+
+	nent = vmalloc(idx->nhent * sizeof(*nent));
+	idx->byname = vmalloc(idx->nhent * sizeof(*idx->byname));
+	if (!nent || !idx->byname) {
+		vfree(nent);
+		return -ENOMEM;
+	}
+	for (i = 0; i < idx->nhent; ++i) {
+		nent[i].name = idx->names + idx->hent[i].name;
+		nent[i].hent = i;
+	}
+	sort(nent, idx->nhent, sizeof(*nent), kdb_sym_name_cmp, NULL);
+	for (i = j = 0; i < idx->nhent; ++i) {
+		if (j && strcmp(nent[i].name, nent[i-1].name) == 0)
+			continue;
+		idx->byname[j++] = nent[i].hent;
+	}
+	idx->nbyname = j;
+	vfree(nent);
+	return 0;
+}
+
+/*
+ * kdb_symidx_build
+ *
+ *	Build a new symbol index from kallsyms.
+ *
+ * Inputs:
+ *	None.
+ * Returns:
+ *	The new index, NULL if there was not enough memory.
+ * Locking:
+ *	Takes module_mutex.
+ * Remarks:
+ *	One walk of kallsyms feeds the name hash, the sorted names and
+ *	the address index.  Kernel symbols outside the kernel image (per cpu offsets,
+ *	absolute symbols) are left out of the address index, kallsyms_lookup
+ *	does not report them either.  The size of a symbol is the distance
+ *	to the next symbol of the same owner, the last symbol of a module
+ *	has no known end.
+ */
+
+static struct kdb_symidx *kdb_symidx_build(void)
+{
+	struct kdb_sym_build b;
+	struct kdb_symidx *idx;
+	struct kdb_sym_ent *ent;
+	unsigned long i, j, size;
+
+	idx = kzalloc(sizeof(*idx), GFP_KERNEL);
+	if (!idx)
+		return NULL;
+	memset(&b, 0, sizeof(b));
+	if (kdb_sym_grow(&b.mods, &b.maxmods, 1, sizeof(*b.mods)) ||
+	    kdb_sym_grow(&b.text, &b.maxtext, 1, sizeof(*b.text)))
+		goto fail;
+	strcpy(b.mods[0], "kernel");
+	b.nmods = 1;
+	b.ntext = 1;
+
+	mutex_lock(&module_mutex);
+	kallsyms_on_each_symbol(kdb_sym_add, &b);
+	mutex_unlock(&module_mutex);
+	if (b.nomem || !b.nsyms || !b.stext || b.end <= b.stext)
+		goto fail;
+	kdb_sym_stext = b.stext;
+	kdb_sym_end = b.end;
+	b.text[0].start = b.stext;
+	b.text[0].end = b.etext > b.stext ? b.etext : b.end;
+	idx->names = b.names;
+	idx->mods = b.mods;
+	idx->text = b.text;
+	idx->ntext = b.ntext;
+	b.names = NULL;
+	b.mods = NULL;
+	b.text = NULL;
+
+	if (kdb_symidx_hash(idx, &b) || kdb_symidx_byname(idx))
+		goto fail;
+
+	ent = b.ent;
+	for (i = j = 0; i < b.nsyms; ++i) {
+		if (ent[i].start < 4096 || (ent[i].mod == 0 &&
+		    (ent[i].start < b.stext || ent[i].start >= b.end)))
+			continue;
+		ent[j++] = ent[i];
+	}
+	sort(ent, j, sizeof(*ent), kdb_sym_cmp, NULL);
+	b.nsyms = j;
+	for (i = j = 0; i < b.nsyms; ++i) {
+		if (j && ent[j-1].start == ent[i].start)
+			continue;
+		ent[j++] = ent[i];
+	}
+	idx->nsyms = j;
+
+	idx->addr = vmalloc(idx->nsyms * sizeof(*idx->addr));
+	idx->info = vmalloc(idx->nsyms * sizeof(*idx->info));
+	if (!idx->addr || !idx->info)
+		goto fail;
+	for (i = 0; i < idx->nsyms; ++i) {
+		if (i + 1 < idx->nsyms && ent[i+1].mod == ent[i].mod)
+			size = ent[i+1].start - ent[i].start;
+		else if (ent[i].mod == 0)
+			size = b.end - ent[i].start;
+		else
+			size = 0;
+		idx->addr[i] = ent[i].start;
+		idx->info[i].size = size < KDB_SYM_MAXSIZE ? size : 0;
+		idx->info[i].name = ent[i].name;
+		idx->info[i].mod = ent[i].mod;
+	}
+	vfree(ent);
+	return idx;
+
+fail:
+	vfree(b.ent);
+	vfree(b.names);
+	vfree(b.mods);
+	vfree(b.text);
+	kdb_symidx_free(idx);
+	return NULL;
+}
+
+/*
+ * kdb_sym_rebuild
+ *
+ *	Work function, replace the symbol index with a new one.
+ *
+ * Inputs:
+ *	work	Unused.
+ * Returns:
+ *	None.
+ * Locking:
+ *	none.
+ * Remarks:
+ *	The index is not replaced while kdb is running.  A module event
+ *	that arrives during the build queues the work again and leaves
+ *	the index marked stale.
+ */
+
+static void kdb_sym_rebuild(struct work_struct *work)
+{
+	struct kdb_symidx *idx, *old;
+	int gen = atomic_read(&kdb_sym_modgen);
+
+	idx = kdb_symidx_build();
+	if (!idx) {
+		printk(KERN_WARNING "lkmd: cannot build the symbol index, using kallsyms\n");
+		return;
+	}
+	while (KDB_IS_RUNNING())
+		msleep(10);
+	old = kdb_symidx;
+	kdb_symidx = idx;
+	smp_wmb();
+	kdb_sym_stale = gen != atomic_read(&kdb_sym_modgen);
+	atomic_inc(&kdb_sym_idxgen);
+	while (KDB_IS_RUNNING())
+		msleep(10);
+	kdb_symidx_free(old);
+}
+
+static DECLARE_WORK(kdb_sym_work, kdb_sym_rebuild);
+
+static int kdb_sym_module_notify(struct notifier_block *self,
+				 unsigned long val, void *data)
+{
+	atomic_inc(&kdb_sym_modgen);
+	kdb_sym_stale = 1;
+	schedule_work(&kdb_sym_work);
+	return NOTIFY_DONE;
+}
+
+static struct notifier_block kdb_sym_module_nb = {
+	.notifier_call = kdb_sym_module_notify,
+};
+
+/*
+ * kdb_sym_lookup
+ *
+ *	Find the symbol that contains an address in the symbol index.
+ *
+ * Inputs:
+ *	addr	Address to look up.
+ * Outputs:
+ *	symtab	sym_name, sym_start, sym_end and mod_name are filled in
+ *		when a symbol is found.
+ * Returns:
+ *	1 if a symbol was found, 0 if the address is not in any symbol,
+ *	-1 if the index can not tell and the caller must ask kallsyms.
+ * Locking:
+ *	none.
+ */
+
+int kdb_sym_lookup(unsigned long addr, kdb_symtab_t *symtab)
+{
+	struct kdb_symidx *idx = kdb_symidx;
+	const struct kdb_sym_info *info;
+	unsigned long lo, hi, mid;
+	int core = addr >= kdb_sym_stext && addr < kdb_sym_end;
+
+	if (!idx || (kdb_sym_stale && !core))
+		return -1;
+	smp_rmb();
+
+	/* Find the last symbol that starts at or below addr */
+	lo = 0;
+	hi = idx->nsyms;
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (idx->addr[mid] <= addr)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (!lo)
+		return 0;
+	info = idx->info + lo - 1;
+	if (!info->size)
+		return -1;
+	if (addr - idx->addr[lo-1] >= info->size)
+		return core ? -1 : 0;
+
+	symtab->sym_name = idx->names + info->name;
+	symtab->sym_start = idx->addr[lo-1];
+	symtab->sym_end = symtab->sym_start + info->size;
+	symtab->mod_name = idx->mods[info->mod];
+	return 1;
+}
+
+/*
+ * kdb_sym_name_lookup
+ *
+ *	Find the address of a symbol by name, the replacement for
+ *	kallsyms_lookup_name.
+ *
+ * Inputs:
+ *	name	Symbol name, "module:symbol" is passed on to kallsyms.
+ * Returns:
+ *	The address of the symbol, 0 if there is no such symbol.
+ * Locking:
+ *	none.
+ * Remarks:
+ *	While a rebuild is pending only kernel symbols are taken from the
+ *	hash, module symbols may be gone or new.
+ */
+
+unsigned long kdb_sym_name_lookup(const char *name)
+{
+	struct kdb_symidx *idx = kdb_symidx;
+	unsigned int i;
+
+	if (!idx || strchr(name, ':'))
+		return kallsyms_lookup_name(name);
+	smp_rmb();
+	i = idx->bucket[kdb_sym_hash(name) & (idx->nbuckets - 1)];
+	for (; i != KDB_SYM_NONE; i = idx->hent[i].next) {
+		if (strcmp(idx->names + idx->hent[i].name, name) == 0) {
+			if (i < idx->ncore || !kdb_sym_stale)
+				return idx->hent[i].addr;
+			break;
+		}
+	}
+	return kdb_sym_stale ? kallsyms_lookup_name(name) : 0;
+}
+
+static const char *kdb_sym_byname(const struct kdb_symidx *idx, unsigned long i)
+{
+	return idx->names + idx->hent[idx->byname[i]].name;
+}
+
+/*
+ * kdb_sym_prefix
+ *
+ *	Find the range of sorted names that start with a prefix.
+ *
+ * Inputs:
+ *	idx	The index.
+ *	prefix	Prefix to look for.
+ *	len	Length of the prefix.
+ * Outputs:
+ *	first	First name in the range.
+ * Returns:
+ *	End of the range, exclusive.  The range is empty if it equals first.
+ * Locking:
+ *	none.
+ */
+
+static unsigned long kdb_sym_prefix(const struct kdb_symidx *idx, const char *prefix,
+				    size_t len, unsigned long *first)
+{
+	unsigned long lo, hi, mid;
+
+	lo = 0;
+	hi = idx->nbyname;
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (strncmp(kdb_sym_byname(idx, mid), prefix, len) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	*first = lo;
+	hi = idx->nbyname;
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (strncmp(kdb_sym_byname(idx, mid), prefix, len) == 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+/*
+ * kdb_sym_complete
+ *
+ *	Tab completion of a symbol name.
+ *
+ * Inputs:
+ *	prefix	Prefix of a symbol name.
+ *	max_len	Size of the prefix buffer.
+ * Outputs:
+ *	prefix	Extended to the longest prefix that all matching names share.
+ * Returns:
+ *	Number of symbols that start with the prefix.
+ * Locking:
+ *	none.
+ * Remarks:
+ *	The sorted names are in lexical order, so the longest shared prefix
+ *	of the whole range is the one shared by its first and last names.
+ */
+
+int kdb_sym_complete(char *prefix, int max_len)
+{
+	struct kdb_symidx *idx = kdb_symidx;
+	unsigned long first, end;
+	const char *a, *z;
+	size_t len = strlen(prefix), n;
+
+	if (!idx)
+		return 0;
+	smp_rmb();
+	end = kdb_sym_prefix(idx, prefix, len, &first);
+	if (end == first)
+		return 0;
+	a = kdb_sym_byname(idx, first);
+	z = kdb_sym_byname(idx, end - 1);
+	for (n = len; a[n] && a[n] == z[n]; ++n)
+		;
+	if (n > max_len - 1)
+		n = max_len - 1;
+	if (n > len) {
+		memcpy(prefix, a, n);
+		prefix[n] = '\0';
+	}
+	return end - first;
+}
+
+/*
+ * kdb_sym_complete_next
+ *
+ *	Return one of the symbols that start with a prefix.
+ *
+ * Inputs:
+ *	prefix	Prefix of a symbol name.
+ *	n	Which of the matching names, counting from 0 in sorted order.
+ * Returns:
+ *	The name, NULL if fewer than n+1 names match.
+ * Locking:
+ *	none.
+ */
+
+const char *kdb_sym_complete_next(const char *prefix, int n)
+{
+	struct kdb_symidx *idx = kdb_symidx;
+	unsigned long first, end;
+
+	if (!idx)
+		return NULL;
+	smp_rmb();
+	end = kdb_sym_prefix(idx, prefix, strlen(prefix), &first);
+	if (n < 0 || n >= end - first)
+		return NULL;
+	return kdb_sym_byname(idx, first + n);
+}
+
+/* Match a name against a shell style pattern with '*', '?' and '[...]' */
+static int kdb_sym_glob(const char *pat, const char *s)
+{
+	const char *star = NULL, *retry = NULL, *p;
+	int match, neg;
+
+	while (*s) {
+		switch (*pat) {
+		case '*':
+			star = ++pat;
+			retry = s;
+			continue;
+		case '?':
+			++pat;
+			++s;
+			continue;
+		case '[':
+			p = pat + 1;
+			neg = *p == '!' || *p == '^';
+			if (neg)
+				++p;
+			match = 0;
+			do {
+				if (!*p)
+					return 0;	/* unterminated class */
+				if (p[1] == '-' && p[2] && p[2] != ']') {
+					if (*s >= p[0] && *s <= p[2])
+						match = 1;
+					p += 3;
+				} else {
+					if (*s == *p)
+						match = 1;
+					++p;
+				}
+			} while (*p != ']');
+			if (match != neg) {
+				pat = p + 1;
+				++s;
+				continue;
+			}
+			break;
+		default:
+			if (*pat == *s) {
+				++pat;
+				++s;
+				continue;
+			}
+			break;
+		}
+		/* Mismatch, let the last '*' swallow one more character */
+		if (!star)
+			return 0;
+		pat = star;
+		s = ++retry;
+	}
+	while (*pat == '*')
+		++pat;
+	return !*pat;
+}
+
+/*
+ * kdb_sym
+ *
+ *	This function implements the 'sym' command.
+ *
+ *	sym <pattern>
+ *
+ *	List the symbols whose names match a shell style pattern, with
+ *	their address, size and module.
+ *
+ * Inputs:
+ *	argc	argument count
+ *	argv	argument vector
+ * Outputs:
+ *	None.
+ * Returns:
+ *	zero for success, a kdb diagnostic if error
+ * Locking:
+ *	none.
+ * Remarks:
+ *	Only the names that start with the literal part of the pattern,
+ *	up to the first wildcard, are tried, so "sym vfs_*" looks at the
+ *	vfs_ names only.  A pattern that starts with a wildcard tries
+ *	every name.
+ */
+
+int kdb_sym(int argc, const char **argv)
+{
+	struct kdb_symidx *idx = kdb_symidx;
+	unsigned long first, end, i, addr;
+	kdb_symtab_t symtab;
+	const char *pat, *name;
+	char prefix[KSYM_NAME_LEN];
+	size_t len;
+	int count = 0;
+
+	if (argc != 1)
+		return KDB_ARGCOUNT;
+	if (!idx) {
+		lkmd_printf("sym: there is no symbol index\n");
+		return 0;
+	}
+	smp_rmb();
+	pat = argv[1];
+	len = strcspn(pat, "*?[");
+	if (len >= sizeof(prefix))
+		len = sizeof(prefix) - 1;
+	memcpy(prefix, pat, len);
+	prefix[len] = '\0';
+
+	end = kdb_sym_prefix(idx, prefix, len, &first);
+	for (i = first; i < end; ++i) {
+		name = kdb_sym_byname(idx, i);
+		if (!kdb_sym_glob(pat, name))
+			continue;
+		addr = idx->hent[idx->byname[i]].addr;
+		memset(&symtab, 0, sizeof(symtab));
+		if (kdb_sym_lookup(addr, &symtab) == 1 && symtab.sym_start == addr)
+			lkmd_printf(kdb_machreg_fmt0 " %8lx  %s [%s]\n", addr,
+				    symtab.sym_end - symtab.sym_start, name,
+				    symtab.mod_name);
+		else
+			lkmd_printf(kdb_machreg_fmt0 " %8s  %s\n", addr, "?", name);
+		++count;
+	}
+	lkmd_printf("%d symbol%s\n", count, count == 1 ? "" : "s");
+	if (kdb_sym_stale)
+		lkmd_printf("sym: modules changed since the index was built, module symbols may be out of date\n");
+	return 0;
+}
+
+/*
+ * kdb_sym_text
+ *
+ *	Return one of the ranges of kernel and module text.
+ *
+ * Inputs:
+ *	i	Range number, 0 is the kernel.
+ * Outputs:
+ *	start	First byte of the text.
+ *	end	First byte after the text.
+ * Returns:
+ *	1 if there is such a range, 0 if there is not, -1 for a module
+ *	range while the index is stale.
+ * Locking:
+ *	none.
+ * Remarks:
+ *	The module ranges are those of the last index build.  While
+ *	a rebuild is pending only the kernel text is returned.
+ */
+
+int kdb_sym_text(unsigned long i, unsigned long *start, unsigned long *end)
+{
+	struct kdb_symidx *idx = kdb_symidx;
+
+	if (i && kdb_sym_stale)
+		return -1;
+	if (!idx || i >= idx->ntext)
+		return 0;
+	smp_rmb();
+	*start = idx->text[i].start;
+	*end = idx->text[i].end;
+	return 1;
+}
+
+/*
+ * kdb_sym_span
+ *
+ *	Find the symbol starts around an address.
+ *
+ * Inputs:
+ *	addr	Address.
+ * Outputs:
+ *	next	Start of the first symbol after addr, ~0UL if there is
+ *		none.
+ * Returns:
+ *	Start of the last symbol at or below addr, 0 if there is none.
+ * Locking:
+ *	none.
+ * Remarks:
+ *	Only reads the index, so it is safe on the held cpus.  Without
+ *	an index the answer is 0 and ~0UL.
+ */
+
+unsigned long kdb_sym_span(unsigned long addr, unsigned long *next)
+{
+	struct kdb_symidx *idx = kdb_symidx;
+	unsigned long lo, hi, mid;
+
+	*next = ~0UL;
+	if (!idx)
+		return 0;
+	smp_rmb();
+	lo = 0;
+	hi = idx->nsyms;
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (idx->addr[mid] <= addr)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo < idx->nsyms)
+		*next = idx->addr[lo];
+	return lo ? idx->addr[lo-1] : 0;
+}
+
+/*
+ * kdb_sym_generation
+ *
+ *	Return a number that changes whenever a module comes or goes and
+ *	whenever the symbol index is replaced.
+ *
+ * Inputs:
+ *	None.
+ * Returns:
+ *	The symbol generation.
+ * Locking:
+ *	none.
+ * Remarks:
+ *	Callers that keep a symbol across kdb sessions compare the
+ *	generation before they use it, a module event may have freed the
+ *	name or replaced the symbol index.
+ */
+
+unsigned int kdb_sym_generation(void)
+{
+	return atomic_read(&kdb_sym_modgen) + atomic_read(&kdb_sym_idxgen);
+}
+
+/*
+ * kdb_sym_init
+ *
+ *	Build the symbol index and follow module changes.
+ *
+ * Inputs:
+ *	None.
+ * Returns:
+ *	None.
+ * Locking:
+ *	none.
+ * Remarks:
+ *	Called before lkmd_kernsym_init, which resolves its symbols through
+ *	the hash.  Without an index everything falls back to kallsyms.
+ */
+
+void __init kdb_sym_init(void)
+{
+	kdb_symidx = kdb_symidx_build();
+	if (kdb_symidx)
+		kdb_sym_stale = 0;
+	else
+		printk(KERN_WARNING "lkmd: cannot build the symbol index, using kallsyms\n");
+	register_module_notifier(&kdb_sym_module_nb);
+}
+
+void kdb_sym_exit(void)
+{
+	unregister_module_notifier(&kdb_sym_module_nb);
+	cancel_work_sync(&kdb_sym_work);
+	kdb_symidx_free(kdb_symidx);
+	kdb_symidx = NULL;
+}
@@ -0,0 +1,223 @@
+/*
+ * Kernel Debugger Architecture Independent Worker Pool
+ *
+ * This file is subject to the terms and conditions of the GNU General Public
+ * License.  See the file "COPYING" in the main directory of this archive
+ * for more details.
+ *
+ * While the controlling cpu runs commands, every other cpu sits in
+ * kdb_main_loop() spinning on KDB_STATE(HOLD_CPU).  Heavy commands (memory
+ * scans, text hashing, cross reference searches) can hand a job to those
+ * cpus instead of leaving them idle.  A job is a range split into fixed
+ * size chunks, the chunks are claimed with an atomic counter so there is no
+ * lock and no per-cpu assignment.  The controlling cpu publishes the job,
+ * works on chunks itself and then waits for the held cpus to finish the
+ * chunks they claimed.
+ *
+ * Work functions run on held cpus in NMI context.  They must not print, must
+ * not take locks and must only touch memory through the silent accessors
+ * (kdba_getarea_size and friends), results are handed back through the
+ * return value or through per-cpu slots in the caller's data.
+ */
+
+#include <linux/kernel.h>
+#include <linux/smp.h>
+#include <linux/sched.h>
+#include <linux/nmi.h>
+#include <linux/atomic.h>
+#include "lkmd.h"
+#include "lkmd_private.h"
+
+struct kdb_work {
+	kdb_work_func_t func;
+	void *data;
+	unsigned long start;
+	unsigned long end;
+	unsigned long chunk;
+	unsigned long nchunks;
+	atomic_long_t next;		/* next chunk to be claimed */
+	atomic_long_t result;		/* sum of the positive results */
+	atomic_t error;			/* first negative result, 0 if none */
+};
+
+/* The job being run, NULL when there is none.  Only written by the
+ * controlling cpu.
+ */
+static struct kdb_work *kdb_work_current;
+
+/* Number of held cpus that are looking at kdb_work_current. */
+static atomic_t kdb_work_users = ATOMIC_INIT(0);
+
+/*
+ * kdb_work_chunks
+ *
+ *	Claim and run chunks of a job until there are none left or the
+ *	job has failed.
+ *
+ * Inputs:
+ *	w	The job.
+ * Returns:
+ *	Number of chunks run by this cpu.
+ * Locking:
+ *	none.
+ * Remarks:
+ *	Called on the controlling cpu and on the held cpus.
+ *	touch_nmi_watchdog() only covers the cpu that calls it, so each
+ *	cpu touches its own watchdog before every chunk.
+ */
+
+static unsigned long kdb_work_chunks(struct kdb_work *w)
+{
+	unsigned long i, start, end, count = 0;
+	long ret;
+
+	while (!atomic_read(&w->error)) {
+		i = atomic_long_inc_return(&w->next) - 1;
+		if (i >= w->nchunks)
+			break;
+		start = w->start + i * w->chunk;
+		end = start + w->chunk;
+		if (end > w->end || end < start)
+			end = w->end;
+		touch_nmi_watchdog();
+		ret = w->func(start, end, w->data);
+		if (ret < 0)
+			atomic_cmpxchg(&w->error, 0, (int)ret);
+		else
+			atomic_long_add(ret, &w->result);
+		++count;
+	}
+	return count;
+}
+
+/*
+ * kdb_work_poll
+ *
+ *	Called by the held cpus from their spin loop in kdb_main_loop.
+ *	If the controlling cpu has published a job then help with it.
+ *
+ * Inputs:
+ *	none.
+ * Returns:
+ *	none.
+ * Locking:
+ *	none.
+ * Remarks:
+ *	The user count is raised before the job pointer is checked
+ *	again, kdb_work_run() clears the pointer before it waits for the
+ *	user count to drop, so a job is never referenced after the
+ *	controlling cpu has returned from kdb_work_run().
+ */
+
+void kdb_work_poll(void)
+{
+	struct kdb_work *w;
+
+	if (!ACCESS_ONCE(kdb_work_current))
+		return;
+	atomic_inc(&kdb_work_users);
+	smp_mb();
+	w = ACCESS_ONCE(kdb_work_current);
+	if (w)
+		kdb_work_chunks(w);
+	atomic_dec(&kdb_work_users);
+}
+
+/*
+ * kdb_work_workers
+ *
+ *	Count the cpus that can take part in a job.
+ *
+ * Inputs:
+ *	none.
+ * Returns:
+ *	Number of held cpus plus the controlling cpu, 1 if the worker
+ *	pool is disabled with WORKERS=0.
+ * Locking:
+ *	none.
+ * Remarks:
+ *	A cpu that did not respond to the kdb IPI is not counted, it
+ *	would never pick up any chunks anyway.
+ */
+
+int kdb_work_workers(void)
+{
+	int c, workers = 1, diag, enabled;
+
+	diag = kdbgetintenv("WORKERS", &enabled);
+	if (!diag && !enabled)
+		return 1;
+	for_each_online_cpu(c) {
+		if (c == smp_processor_id())
+			continue;
+		if (KDB_STATE_CPU(KDB, c) && KDB_STATE_CPU(HOLD_CPU, c))
+			++workers;
+	}
+	return workers;
+}
+
+/*
+ * kdb_work_run
+ *
+ *	Run a job over the range [start, end) on the controlling cpu and
+ *	on all held cpus.
+ *
+ * Inputs:
+ *	func	Function to call for each chunk.  It returns a negative
+ *		KDB_* code to abort the job, otherwise a count which is
+ *		added to the job result.
+ *	data	Passed to func unchanged.
+ *	start	Start of the range.
+ *	end	End of the range, exclusive.
+ *	chunk	Size of each chunk, the last one may be shorter.
+ * Returns:
+ *	The first error returned by func or the sum of the results.
+ * Locking:
+ *	none.
+ * Remarks:
+ *	Must only be called by the controlling cpu while kdb is active.
+ *	Every cpu touches its NMI watchdog before each chunk it runs, so
+ *	work functions do not need to as long as a chunk is short.
+ */
+
+long kdb_work_run(kdb_work_func_t func, void *data, unsigned long start,
+		  unsigned long end, unsigned long chunk)
+{
+	struct kdb_work w;
+	int pool;
+
+	if (end <= start)
+		return 0;
+	if (!chunk)
+		chunk = end - start;
+	w.func = func;
+	w.data = data;
+	w.start = start;
+	w.end = end;
+	w.chunk = chunk;
+	w.nchunks = (end - start - 1) / chunk + 1;
+	atomic_long_set(&w.next, 0);
+	atomic_long_set(&w.result, 0);
+	atomic_set(&w.error, 0);
+
+	pool = w.nchunks > 1 && kdb_work_workers() > 1;
+	if (pool) {
+		smp_wmb();
+		kdb_work_current = &w;
+	}
+
+	kdb_work_chunks(&w);
+
+	if (pool) {
+		kdb_work_current = NULL;
+		smp_mb();
+		while (atomic_read(&kdb_work_users)) {
+			touch_nmi_watchdog();
+			cpu_relax();
+		}
+	}
+
+	if (atomic_read(&w.error))
+		return atomic_read(&w.error);
+	return atomic_long_read(&w.result);
+}
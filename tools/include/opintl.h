@@ -0,0 +1,2 @@
+/* Host build of x86-dis.c, no message translation.  */
+#define _(String) (String)
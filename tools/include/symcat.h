@@ -0,0 +1 @@
+/* Host build of x86-dis.c, bfd.h only needs this to exist.  */
@@ -0,0 +1,3 @@
+/* Host build of x86-dis.c, stands in for the binutils sysdep.h.  */
+#include <stdlib.h>
+#include <string.h>
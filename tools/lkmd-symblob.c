@@ -0,0 +1,957 @@
+/*
+ * lkmd-symblob - build the LKMD symbol and line table blob from a vmlinux
+ *
+ * This file is subject to the terms and conditions of the GNU General Public
+ * License.  See the file "COPYING" in the main directory of this archive
+ * for more details.
+ *
+ *	lkmd-symblob <vmlinux> <blob>
+ *
+ * The symbols come from .symtab, so static functions and data are there
+ * even on kernels built without CONFIG_KALLSYMS_ALL, and they have their
+ * real sizes.  The line table comes from the DWARF .debug_line section
+ * (versions 2 to 5).  The blob format is described in lkmd_blob.h.
+ *
+ * Only linked kernel images are handled.  Module objects would need their
+ * relocations applied and their section addresses known at load time.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <elf.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "../lkmd_blob.h"
+
+/* The few DWARF constants that the line table reader needs */
+#define DW_LNS_copy			1
+#define DW_LNS_advance_pc		2
+#define DW_LNS_advance_line		3
+#define DW_LNS_set_file			4
+#define DW_LNS_const_add_pc		8
+#define DW_LNS_fixed_advance_pc		9
+#define DW_LNE_end_sequence		1
+#define DW_LNE_set_address		2
+#define DW_LNCT_path			1
+#define DW_LNCT_directory_index		2
+#define DW_FORM_data2			0x05
+#define DW_FORM_data4			0x06
+#define DW_FORM_data8			0x07
+#define DW_FORM_string			0x08
+#define DW_FORM_block			0x09
+#define DW_FORM_data1			0x0b
+#define DW_FORM_strp			0x0e
+#define DW_FORM_udata			0x0f
+#define DW_FORM_data16			0x1e
+#define DW_FORM_line_strp		0x1f
+
+static const char *prog = "lkmd-symblob";
+
+static void die(const char *fmt, const char *arg)
+{
+	fprintf(stderr, "%s: ", prog);
+	fprintf(stderr, fmt, arg);
+	fputc('\n', stderr);
+	exit(1);
+}
+
+static void *xrealloc(void *p, size_t n)
+{
+	p = realloc(p, n ? n : 1);
+	if (!p)
+		die("%s", strerror(ENOMEM));
+	return p;
+}
+
+/* Grow an array so that it holds need elements */
+#define GROW(a, max, need)						\
+	do {								\
+		if ((need) > (max)) {					\
+			(max) = (max) ? (max) * 2 : 1024;		\
+			if ((max) < (need))				\
+				(max) = (need);				\
+			(a) = xrealloc((a), (max) * sizeof(*(a)));	\
+		}							\
+	} while (0)
+
+/*
+ * String pool, every string is stored once.
+ */
+
+static char *pool;
+static size_t pool_size, pool_max;
+static uint32_t *pool_hash;		/* offset + 1, 0 for a free slot */
+static size_t pool_nhash, pool_count;
+
+static void pool_init(void)
+{
+	GROW(pool, pool_max, 1);
+	pool[0] = '\0';		/* offset 0 is the empty string */
+	pool_size = 1;
+}
+
+static uint32_t hash_str(const char *s)
+{
+	uint32_t h = 2166136261U;		/* FNV-1a */
+
+	while (*s)
+		h = (h ^ (unsigned char)*s++) * 16777619U;
+	return h;
+}
+
+static void pool_rehash(void)
+{
+	uint32_t *old = pool_hash;
+	size_t i, j, n = pool_nhash;
+
+	pool_nhash = n ? n * 2 : 4096;
+	pool_hash = calloc(pool_nhash, sizeof(*pool_hash));
+	if (!pool_hash)
+		die("%s", strerror(ENOMEM));
+	for (i = 0; i < n; ++i) {
+		if (!old[i])
+			continue;
+		j = hash_str(pool + old[i] - 1) & (pool_nhash - 1);
+		while (pool_hash[j])
+			j = (j + 1) & (pool_nhash - 1);
+		pool_hash[j] = old[i];
+	}
+	free(old);
+}
+
+static uint32_t intern(const char *s)
+{
+	size_t j, len;
+
+	if (!*s)
+		return 0;
+	if ((pool_count + 1) * 2 > pool_nhash)
+		pool_rehash();
+	j = hash_str(s) & (pool_nhash - 1);
+	while (pool_hash[j]) {
+		if (strcmp(pool + pool_hash[j] - 1, s) == 0)
+			return pool_hash[j] - 1;
+		j = (j + 1) & (pool_nhash - 1);
+	}
+	len = strlen(s) + 1;
+	GROW(pool, pool_max, pool_size + len);
+	memcpy(pool + pool_size, s, len);
+	pool_hash[j] = pool_size + 1;
+	++pool_count;
+	pool_size += len;
+	if (pool_size > UINT32_MAX)
+		die("%s", "string pool too large");
+	return pool_hash[j] - 1;
+}
+
+/*
+ * ELF access, 32 and 64 bit little endian images.
+ */
+
+static const unsigned char *image;
+static size_t image_len;
+static int elf64;
+
+struct section {
+	const char *name;
+	uint32_t type;
+	uint64_t flags, addr, offset, size, link, entsize;
+};
+
+static struct section *sec;
+static unsigned int nsec;
+
+static const void *at(uint64_t off, uint64_t len)
+{
+	if (off > image_len || len > image_len - off)
+		die("%s", "truncated or corrupt ELF file");
+	return image + off;
+}
+
+static void read_sections(void)
+{
+	const Elf64_Ehdr *e64 = at(0, sizeof(Elf32_Ehdr));
+	const Elf32_Ehdr *e32 = (const Elf32_Ehdr *)e64;
+	uint64_t shoff;
+	unsigned int i, shstrndx, shentsize;
+	const struct section *strs;
+
+	if (memcmp(e64->e_ident, ELFMAG, SELFMAG) ||
+	    e64->e_ident[EI_DATA] != ELFDATA2LSB)
+		die("%s", "not a little endian ELF file");
+	elf64 = e64->e_ident[EI_CLASS] == ELFCLASS64;
+	if (elf64) {
+		e64 = at(0, sizeof(*e64));
+		if (e64->e_type != ET_EXEC && e64->e_type != ET_DYN)
+			die("%s", "not a linked image, modules are not supported");
+		shoff = e64->e_shoff;
+		nsec = e64->e_shnum;
+		shstrndx = e64->e_shstrndx;
+		shentsize = sizeof(Elf64_Shdr);
+	} else {
+		if (e32->e_type != ET_EXEC && e32->e_type != ET_DYN)
+			die("%s", "not a linked image, modules are not supported");
+		shoff = e32->e_shoff;
+		nsec = e32->e_shnum;
+		shstrndx = e32->e_shstrndx;
+		shentsize = sizeof(Elf32_Shdr);
+	}
+	sec = xrealloc(NULL, nsec * sizeof(*sec));
+	for (i = 0; i < nsec; ++i) {
+		if (elf64) {
+			const Elf64_Shdr *s = at(shoff + i * shentsize, shentsize);
+			sec[i].name = (const char *)(uintptr_t)s->sh_name;
+			sec[i].type = s->sh_type;
+			sec[i].flags = s->sh_flags;
+			sec[i].addr = s->sh_addr;
+			sec[i].offset = s->sh_offset;
+			sec[i].size = s->sh_size;
+			sec[i].link = s->sh_link;
+			sec[i].entsize = s->sh_entsize;
+		} else {
+			const Elf32_Shdr *s = at(shoff + i * shentsize, shentsize);
+			sec[i].name = (const char *)(uintptr_t)s->sh_name;
+			sec[i].type = s->sh_type;
+			sec[i].flags = s->sh_flags;
+			sec[i].addr = s->sh_addr;
+			sec[i].offset = s->sh_offset;
+			sec[i].size = s->sh_size;
+			sec[i].link = s->sh_link;
+			sec[i].entsize = s->sh_entsize;
+		}
+	}
+	if (shstrndx >= nsec)
+		die("%s", "no section name table");
+	strs = &sec[shstrndx];
+	at(strs->offset, strs->size);
+	for (i = 0; i < nsec; ++i) {
+		uintptr_t n = (uintptr_t)sec[i].name;
+		if (n >= strs->size)
+			die("%s", "corrupt section name");
+		sec[i].name = (const char *)image + strs->offset + n;
+	}
+}
+
+static const struct section *find_section(const char *name)
+{
+	unsigned int i;
+
+	for (i = 0; i < nsec; ++i)
+		if (strcmp(sec[i].name, name) == 0 && sec[i].type != SHT_NOBITS)
+			return &sec[i];
+	return NULL;
+}
+
+/*
+ * Symbols.
+ */
+
+struct sym {
+	uint64_t addr;
+	uint64_t size;
+	uint32_t name;
+	uint32_t flags;
+	int rank;		/* which of several symbols at one address wins */
+};
+
+static struct sym *syms;
+static size_t nsyms, maxsyms;
+static uint64_t text_addr, end_addr, banner_addr;
+static uint32_t banner;
+
+static void read_symbols(void)
+{
+	const struct section *symtab = find_section(".symtab"), *strtab;
+	size_t i, n, entsize = elf64 ? sizeof(Elf64_Sym) : sizeof(Elf32_Sym);
+	const char *strs, *name;
+	uint64_t value, size;
+	unsigned int shndx, type, bind;
+
+	if (!symtab || symtab->link >= nsec)
+		die("%s", "no symbol table, is the image stripped?");
+	strtab = &sec[symtab->link];
+	strs = at(strtab->offset, strtab->size);
+	n = symtab->size / entsize;
+	for (i = 1; i < n; ++i) {
+		if (elf64) {
+			const Elf64_Sym *s = at(symtab->offset + i * entsize, entsize);
+			value = s->st_value;
+			size = s->st_size;
+			shndx = s->st_shndx;
+			type = ELF64_ST_TYPE(s->st_info);
+			bind = ELF64_ST_BIND(s->st_info);
+			name = s->st_name < strtab->size ? strs + s->st_name : "";
+		} else {
+			const Elf32_Sym *s = at(symtab->offset + i * entsize, entsize);
+			value = s->st_value;
+			size = s->st_size;
+			shndx = s->st_shndx;
+			type = ELF32_ST_TYPE(s->st_info);
+			bind = ELF32_ST_BIND(s->st_info);
+			name = s->st_name < strtab->size ? strs + s->st_name : "";
+		}
+		if (strcmp(name, "_text") == 0)
+			text_addr = value;
+		else if (strcmp(name, "_end") == 0)
+			end_addr = value;
+		else if (strcmp(name, "linux_banner") == 0)
+			banner_addr = value;
+		if (!name[0] || name[0] == '$' || strncmp(name, ".L", 2) == 0)
+			continue;
+		if (shndx == SHN_UNDEF || shndx >= SHN_LORESERVE || shndx >= nsec ||
+		    !(sec[shndx].flags & SHF_ALLOC))
+			continue;
+		if (type != STT_FUNC && type != STT_OBJECT && type != STT_NOTYPE)
+			continue;
+		GROW(syms, maxsyms, nsyms + 1);
+		syms[nsyms].addr = value;
+		syms[nsyms].size = size;
+		syms[nsyms].name = intern(name);
+		syms[nsyms].flags = (bind != STB_LOCAL ? LKMD_BLOB_GLOBAL : 0) |
+				    (type == STT_FUNC ? LKMD_BLOB_FUNC : 0);
+		syms[nsyms].rank = (type == STT_FUNC ? 4 : type == STT_OBJECT ? 2 : 0) +
+				   (bind != STB_LOCAL) + (size ? 8 : 0);
+		++nsyms;
+	}
+	if (!text_addr || end_addr <= text_addr || end_addr - text_addr > UINT32_MAX)
+		die("%s", "no _text and _end, is this a kernel image?");
+}
+
+static int sym_cmp(const void *a, const void *b)
+{
+	const struct sym *x = a, *y = b;
+
+	if (x->addr != y->addr)
+		return x->addr < y->addr ? -1 : 1;
+	if (x->rank != y->rank)
+		return y->rank - x->rank;
+	return x->name < y->name ? -1 : x->name > y->name;
+}
+
+/* Keep the symbols inside the image, one per address, and fill in sizes */
+static void sort_symbols(void)
+{
+	size_t i, j;
+
+	for (i = j = 0; i < nsyms; ++i)
+		if (syms[i].addr >= text_addr && syms[i].addr < end_addr)
+			syms[j++] = syms[i];
+	nsyms = j;
+	qsort(syms, nsyms, sizeof(*syms), sym_cmp);
+	for (i = j = 0; i < nsyms; ++i) {
+		if (j && syms[j-1].addr == syms[i].addr)
+			continue;
+		syms[j++] = syms[i];
+	}
+	nsyms = j;
+	for (i = 0; i < nsyms; ++i) {
+		uint64_t next = i + 1 < nsyms ? syms[i+1].addr : end_addr;
+		if (!syms[i].size || syms[i].addr + syms[i].size > end_addr)
+			syms[i].size = next - syms[i].addr;
+		if (syms[i].size > UINT32_MAX)
+			syms[i].size = UINT32_MAX;
+	}
+}
+
+/*
+ * DWARF line tables.
+ */
+
+struct row {
+	uint32_t off;
+	uint32_t file;		/* index in files */
+	uint32_t line;		/* 0 at the end of a sequence */
+	uint32_t seq;		/* order of appearance, keeps the sort stable */
+};
+
+static struct row *rows;
+static size_t nrows, maxrows;
+static uint32_t *files;		/* string offsets */
+static size_t nfiles, maxfiles;
+static uint32_t *file_ids;	/* file string offset to index in files */
+static size_t nfile_ids;
+
+static uint32_t file_index(uint32_t name)
+{
+	size_t i;
+
+	if (name >= nfile_ids) {
+		size_t n = nfile_ids ? nfile_ids : 1024;
+		while (n <= name)
+			n *= 2;
+		file_ids = xrealloc(file_ids, n * sizeof(*file_ids));
+		memset(file_ids + nfile_ids, 0, (n - nfile_ids) * sizeof(*file_ids));
+		nfile_ids = n;
+	}
+	if (!file_ids[name]) {
+		GROW(files, maxfiles, nfiles + 1);
+		files[nfiles++] = name;
+		file_ids[name] = nfiles;
+	}
+	i = file_ids[name] - 1;
+	return i;
+}
+
+struct cursor {
+	const unsigned char *p, *end;
+};
+
+static void need(struct cursor *c, size_t n)
+{
+	if ((size_t)(c->end - c->p) < n)
+		die("%s", "corrupt .debug_line");
+}
+
+static uint64_t get_n(struct cursor *c, unsigned int n)
+{
+	uint64_t v = 0;
+	unsigned int i;
+
+	need(c, n);
+	for (i = 0; i < n; ++i)
+		v |= (uint64_t)c->p[i] << (8 * i);
+	c->p += n;
+	return v;
+}
+
+static uint64_t get_uleb(struct cursor *c)
+{
+	uint64_t v = 0;
+	unsigned int shift = 0;
+	unsigned char b;
+
+	do {
+		need(c, 1);
+		b = *c->p++;
+		if (shift < 64)
+			v |= (uint64_t)(b & 0x7f) << shift;
+		shift += 7;
+	} while (b & 0x80);
+	return v;
+}
+
+static int64_t get_sleb(struct cursor *c)
+{
+	int64_t v = 0;
+	unsigned int shift = 0;
+	unsigned char b;
+
+	do {
+		need(c, 1);
+		b = *c->p++;
+		if (shift < 64)
+			v |= (int64_t)(b & 0x7f) << shift;
+		shift += 7;
+	} while (b & 0x80);
+	if (shift < 64 && (b & 0x40))
+		v |= -((int64_t)1 << shift);
+	return v;
+}
+
+static const char *get_str(struct cursor *c)
+{
+	const char *s = (const char *)c->p;
+	const unsigned char *z = memchr(c->p, 0, c->end - c->p);
+
+	if (!z)
+		die("%s", "corrupt .debug_line");
+	c->p = z + 1;
+	return s;
+}
+
+static const struct section *debug_str, *debug_line_str;
+
+static const char *str_at(const struct section *s, uint64_t off)
+{
+	const char *base;
+
+	if (!s || off >= s->size)
+		return "";
+	base = at(s->offset, s->size);
+	if (!memchr(base + off, 0, s->size - off))
+		return "";
+	return base + off;
+}
+
+/* Read one attribute of a DWARF 5 directory or file entry */
+static int get_form(struct cursor *c, uint64_t form, int dwarf64,
+		    const char **str, uint64_t *val)
+{
+	*str = NULL;
+	*val = 0;
+	switch (form) {
+	case DW_FORM_string:
+		*str = get_str(c);
+		break;
+	case DW_FORM_line_strp:
+		*str = str_at(debug_line_str, get_n(c, dwarf64 ? 8 : 4));
+		break;
+	case DW_FORM_strp:
+		*str = str_at(debug_str, get_n(c, dwarf64 ? 8 : 4));
+		break;
+	case DW_FORM_udata:
+		*val = get_uleb(c);
+		break;
+	case DW_FORM_data1:
+		*val = get_n(c, 1);
+		break;
+	case DW_FORM_data2:
+		*val = get_n(c, 2);
+		break;
+	case DW_FORM_data4:
+		*val = get_n(c, 4);
+		break;
+	case DW_FORM_data8:
+		*val = get_n(c, 8);
+		break;
+	case DW_FORM_data16:
+		get_n(c, 8);
+		get_n(c, 8);
+		break;
+	case DW_FORM_block:
+		*val = get_uleb(c);
+		need(c, *val);
+		c->p += *val;
+		break;
+	default:
+		return -1;
+	}
+	return 0;
+}
+
+static uint32_t join_path(const char *dir, const char *name)
+{
+	static char *buf;
+	static size_t max;
+	size_t n;
+
+	if (!dir || !*dir || name[0] == '/')
+		return intern(name);
+	n = strlen(dir) + strlen(name) + 2;
+	GROW(buf, max, n);
+	snprintf(buf, n, "%s/%s", dir, name);
+	return intern(buf);
+}
+
+static uint32_t strip_dot(uint32_t name)
+{
+	while (strncmp(pool + name, "./", 2) == 0)
+		name += 2;
+	return name;
+}
+
+/* Read a DWARF 5 directory or file name table */
+static void read_entries(struct cursor *c, int dwarf64, const char ***names,
+			 uint64_t **dirs, uint64_t *count)
+{
+	uint64_t fmt[32][2], i, n, k, val;
+	unsigned int nfmt = get_n(c, 1);
+	const char *str;
+
+	if (nfmt > 32)
+		die("%s", "corrupt .debug_line");
+	for (k = 0; k < nfmt; ++k) {
+		fmt[k][0] = get_uleb(c);
+		fmt[k][1] = get_uleb(c);
+	}
+	n = get_uleb(c);
+	if (n > (uint64_t)(c->end - c->p))
+		die("%s", "corrupt .debug_line");
+	*names = xrealloc(NULL, n * sizeof(**names));
+	if (dirs)
+		*dirs = xrealloc(NULL, n * sizeof(**dirs));
+	for (i = 0; i < n; ++i) {
+		(*names)[i] = "";
+		if (dirs)
+			(*dirs)[i] = 0;
+		for (k = 0; k < nfmt; ++k) {
+			if (get_form(c, fmt[k][1], dwarf64, &str, &val))
+				die("%s", "unsupported form in .debug_line");
+			if (fmt[k][0] == DW_LNCT_path && str)
+				(*names)[i] = str;
+			else if (fmt[k][0] == DW_LNCT_directory_index && dirs)
+				(*dirs)[i] = val;
+		}
+	}
+	*count = n;
+}
+
+static void add_row(uint64_t addr, uint32_t file, uint32_t line)
+{
+	if (addr < text_addr || addr >= end_addr)
+		return;
+	GROW(rows, maxrows, nrows + 1);
+	rows[nrows].off = addr - text_addr;
+	rows[nrows].file = file;
+	rows[nrows].line = line;
+	rows[nrows].seq = nrows;
+	++nrows;
+}
+
+/*
+ * read_unit
+ *
+ *	Run the line number program of one unit and collect its rows.
+ */
+
+static void read_unit(struct cursor *c, uint64_t len, int dwarf64)
+{
+	struct cursor u = { c->p, c->p + len }, h;
+	unsigned int version, min_len, line_range, opcode_base, op, i;
+	int line_base;
+	unsigned char std_len[256];
+	const char **dir_names = NULL, **file_names = NULL;
+	uint64_t *file_dirs = NULL, ndirs = 0, nfile_names = 0, hlen, k;
+	uint32_t *map = NULL;
+	uint64_t addr = 0, file = 1, line = 1, n;
+	int v5;
+
+	c->p += len;
+	version = get_n(&u, 2);
+	if (version < 2 || version > 5)
+		return;
+	v5 = version >= 5;
+	if (v5)
+		get_n(&u, 2);		/* address_size, segment_selector_size */
+	hlen = get_n(&u, dwarf64 ? 8 : 4);
+	need(&u, hlen);
+	h.p = u.p;
+	h.end = u.p + hlen;
+	u.p += hlen;
+
+	min_len = get_n(&h, 1);
+	if (version >= 4)
+		get_n(&h, 1);		/* maximum_operations_per_instruction */
+	get_n(&h, 1);			/* default_is_stmt */
+	line_base = (signed char)get_n(&h, 1);
+	line_range = get_n(&h, 1);
+	opcode_base = get_n(&h, 1);
+	if (!line_range || !opcode_base)
+		return;
+	memset(std_len, 0, sizeof(std_len));
+	for (i = 1; i < opcode_base; ++i)
+		std_len[i] = get_n(&h, 1);
+
+	if (v5) {
+		read_entries(&h, dwarf64, &dir_names, NULL, &ndirs);
+		read_entries(&h, dwarf64, &file_names, &file_dirs, &nfile_names);
+	} else {
+		const char *s;
+		while (*(s = get_str(&h))) {
+			dir_names = xrealloc(dir_names, (ndirs + 2) * sizeof(*dir_names));
+			if (!ndirs)
+				dir_names[ndirs++] = "";	/* 0 is the compile dir */
+			dir_names[ndirs++] = s;
+		}
+		while (*(s = get_str(&h))) {
+			file_names = xrealloc(file_names, (nfile_names + 1) * sizeof(*file_names));
+			file_dirs = xrealloc(file_dirs, (nfile_names + 1) * sizeof(*file_dirs));
+			file_names[nfile_names] = s;
+			file_dirs[nfile_names++] = get_uleb(&h);
+			get_uleb(&h);		/* mtime */
+			get_uleb(&h);		/* length */
+		}
+	}
+
+	/* Index in the unit's file table to index in files */
+	map = xrealloc(NULL, (nfile_names + 1) * sizeof(*map));
+	for (k = 0; k < nfile_names; ++k) {
+		/* Directory 0 is the compile directory, names are relative to it */
+		const char *d = file_dirs[k] && file_dirs[k] < ndirs ? dir_names[file_dirs[k]] : NULL;
+		map[k] = file_index(strip_dot(join_path(d, file_names[k])));
+	}
+#define FILE_OF(f)	(v5 ? ((f) < nfile_names ? map[f] : 0) :		\
+			 ((f) >= 1 && (f) <= nfile_names ? map[(f) - 1] : 0))
+
+	while (u.p < u.end) {
+		op = get_n(&u, 1);
+		if (op >= opcode_base) {
+			op -= opcode_base;
+			addr += (op / line_range) * min_len;
+			line += line_base + (int)(op % line_range);
+			add_row(addr, FILE_OF(file), line);
+			continue;
+		}
+		switch (op) {
+		case 0:
+			n = get_uleb(&u);
+			need(&u, n);
+			if (!n)
+				break;
+			op = *u.p;
+			if (op == DW_LNE_end_sequence) {
+				add_row(addr, 0, 0);
+				addr = 0;
+				file = line = 1;
+			} else if (op == DW_LNE_set_address) {
+				struct cursor a = { u.p + 1, u.p + n };
+				addr = get_n(&a, n - 1 > 8 ? 8 : n - 1);
+			}
+			u.p += n;
+			break;
+		case DW_LNS_copy:
+			add_row(addr, FILE_OF(file), line);
+			break;
+		case DW_LNS_advance_pc:
+			addr += get_uleb(&u) * min_len;
+			break;
+		case DW_LNS_advance_line:
+			line += get_sleb(&u);
+			break;
+		case DW_LNS_set_file:
+			file = get_uleb(&u);
+			break;
+		case DW_LNS_const_add_pc:
+			addr += ((255 - opcode_base) / line_range) * min_len;
+			break;
+		case DW_LNS_fixed_advance_pc:
+			addr += get_n(&u, 2);
+			break;
+		default:
+			for (i = 0; i < std_len[op]; ++i)
+				get_uleb(&u);
+			break;
+		}
+	}
+#undef FILE_OF
+	free(dir_names);
+	free(file_names);
+	free(file_dirs);
+	free(map);
+}
+
+static void read_lines(void)
+{
+	const struct section *s = find_section(".debug_line");
+	struct cursor c;
+	uint64_t len;
+	int dwarf64;
+
+	if (!s) {
+		fprintf(stderr, "%s: no .debug_line, the blob has no line numbers\n", prog);
+		return;
+	}
+	debug_str = find_section(".debug_str");
+	debug_line_str = find_section(".debug_line_str");
+	c.p = at(s->offset, s->size);
+	c.end = c.p + s->size;
+	while (c.p < c.end) {
+		len = get_n(&c, 4);
+		dwarf64 = len == 0xffffffff;
+		if (dwarf64)
+			len = get_n(&c, 8);
+		need(&c, len);
+		read_unit(&c, len, dwarf64);
+	}
+}
+
+static int row_cmp(const void *a, const void *b)
+{
+	const struct row *x = a, *y = b;
+
+	if (x->off != y->off)
+		return x->off < y->off ? -1 : 1;
+	return x->seq < y->seq ? -1 : 1;
+}
+
+/*
+ * Sort the rows and drop the ones that add nothing: of several rows at one
+ * address the last one with a line wins, a row that repeats the file and
+ * line of the previous row is not needed.
+ */
+static void sort_rows(void)
+{
+	size_t i, j, k;
+
+	qsort(rows, nrows, sizeof(*rows), row_cmp);
+	for (i = j = 0; i < nrows; i = k) {
+		struct row r = rows[i];
+		for (k = i + 1; k < nrows && rows[k].off == r.off; ++k)
+			if (rows[k].line || !r.line)
+				r = rows[k];
+		if (j && rows[j-1].file == r.file && rows[j-1].line == r.line)
+			continue;
+		if (!j && !r.line)
+			continue;
+		rows[j++] = r;
+	}
+	nrows = j;
+}
+
+/*
+ * Output.
+ */
+
+static unsigned char *out;
+static size_t out_size, out_max;
+
+static void put(const void *p, size_t n)
+{
+	GROW(out, out_max, out_size + n);
+	memcpy(out + out_size, p, n);
+	out_size += n;
+}
+
+static void put_uleb(uint64_t v)
+{
+	unsigned char b;
+
+	do {
+		b = v & 0x7f;
+		v >>= 7;
+		put(&b, 1);
+		out[out_size-1] |= v ? 0x80 : 0;
+	} while (v);
+}
+
+static void put_sleb(int64_t v)
+{
+	unsigned char b;
+	int more;
+
+	do {
+		b = v & 0x7f;
+		v >>= 7;
+		more = !((v == 0 && !(b & 0x40)) || (v == -1 && (b & 0x40)));
+		if (more)
+			b |= 0x80;
+		put(&b, 1);
+	} while (more);
+}
+
+static void align4(void)
+{
+	static const char zero[4];
+
+	put(zero, (4 - out_size % 4) % 4);
+}
+
+static void write_blob(const char *path)
+{
+	struct lkmd_blob_hdr hdr;
+	struct lkmd_blob_sym bs;
+	struct lkmd_blob_lblock *blk;
+	size_t i, j, nblocks = (nrows + LKMD_BLOB_LBLOCK - 1) / LKMD_BLOB_LBLOCK;
+	unsigned char *lines = NULL;
+	size_t lines_size;
+	FILE *f;
+
+	/* Encode the rows first, the blocks need their positions */
+	blk = xrealloc(NULL, nblocks * sizeof(*blk));
+	for (i = 0; i < nrows; ++i) {
+		if (i % LKMD_BLOB_LBLOCK == 0) {
+			blk[i / LKMD_BLOB_LBLOCK].off = rows[i].off;
+			blk[i / LKMD_BLOB_LBLOCK].file = rows[i].file;
+			blk[i / LKMD_BLOB_LBLOCK].line = rows[i].line;
+			blk[i / LKMD_BLOB_LBLOCK].pos = out_size;
+			continue;
+		}
+		put_uleb((uint64_t)(rows[i].off - rows[i-1].off) << 1 |
+			 (rows[i].file != rows[i-1].file));
+		put_sleb((int64_t)rows[i].line - rows[i-1].line);
+		if (rows[i].file != rows[i-1].file)
+			put_uleb(rows[i].file);
+	}
+	lines = out;
+	lines_size = out_size;
+	out = NULL;
+	out_size = out_max = 0;
+
+	memset(&hdr, 0, sizeof(hdr));
+	put(&hdr, sizeof(hdr));
+	memcpy(hdr.magic, LKMD_BLOB_MAGIC, sizeof(hdr.magic));
+	hdr.version = LKMD_BLOB_VERSION;
+	hdr.text = text_addr;
+	hdr.image_size = end_addr - text_addr;
+	hdr.banner = banner;
+
+	hdr.nsyms = nsyms;
+	hdr.syms = out_size;
+	for (i = 0; i < nsyms; ++i) {
+		bs.off = syms[i].addr - text_addr;
+		bs.size = syms[i].size;
+		bs.name = syms[i].name;
+		bs.flags = syms[i].flags;
+		put(&bs, sizeof(bs));
+	}
+	hdr.nfiles = nfiles;
+	hdr.files = out_size;
+	put(files, nfiles * sizeof(*files));
+	hdr.nrows = nrows;
+	hdr.nblocks = nblocks;
+	hdr.blocks = out_size;
+	put(blk, nblocks * sizeof(*blk));
+	hdr.strings = out_size;
+	hdr.strings_size = pool_size;
+	put(pool, pool_size);
+	align4();
+	hdr.lines = out_size;
+	hdr.lines_size = lines_size;
+	put(lines, lines_size);
+	align4();
+	if (out_size > UINT32_MAX)
+		die("%s", "blob too large");
+	hdr.size = out_size;
+	memcpy(out, &hdr, sizeof(hdr));
+
+	f = fopen(path, "wb");
+	if (!f || fwrite(out, 1, out_size, f) != out_size || fclose(f))
+		die("cannot write %s", path);
+	j = nrows ? nrows : 1;
+	printf("%s: %zu symbols, %zu files, %zu line rows (%.1f bytes/row), %zu bytes\n",
+	       path, nsyms, nfiles, nrows, (double)lines_size / j, out_size);
+	free(blk);
+	free(lines);
+}
+
+/* linux_banner identifies the kernel build, lkmd checks it at load time */
+static void read_banner(void)
+{
+	unsigned int i;
+	const char *p;
+	uint64_t off;
+
+	for (i = 0; banner_addr && i < nsec; ++i) {
+		if (!(sec[i].flags & SHF_ALLOC) || sec[i].type == SHT_NOBITS ||
+		    banner_addr < sec[i].addr || banner_addr >= sec[i].addr + sec[i].size)
+			continue;
+		off = banner_addr - sec[i].addr;
+		p = at(sec[i].offset + off, sec[i].size - off);
+		if (memchr(p, 0, sec[i].size - off))
+			banner = intern(p);
+		return;
+	}
+}
+
+int main(int argc, char **argv)
+{
+	struct stat st;
+	int fd;
+
+	if (argc != 3) {
+		fprintf(stderr, "usage: %s <vmlinux> <blob>\n", prog);
+		return 1;
+	}
+	fd = open(argv[1], O_RDONLY);
+	if (fd < 0 || fstat(fd, &st))
+		die("cannot open %s", argv[1]);
+	image_len = st.st_size;
+	image = mmap(NULL, image_len, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (image == MAP_FAILED)
+		die("cannot map %s", argv[1]);
+
+	pool_init();
+	read_sections();
+	read_symbols();
+	read_banner();
+	sort_symbols();
+	read_lines();
+	sort_rows();
+	write_blob(argv[2]);
+	return 0;
+}
@@ -0,0 +1,320 @@
+/*
+ * x86-disbench - throughput baseline for the x86 disassembler
+ *
+ * This file is subject to the terms and conditions of the GNU General Public
+ * License.  See the file "COPYING" in the main directory of this archive
+ * for more details.
+ *
+ *	x86-disbench [-m 16|32|64] [-l loops] [-d] [-n shown] [-r] [file]...
+ *
+ * Disassembles each file, raw code such as the output of
+ * "objcopy -O binary --only-section=.text vmlinux vmlinux.text", with
+ * print_insn_i386_att_ctx, the call kdb's id command makes, and reports
+ * instructions and bytes per second.  -r adds 4MB of pseudo random bytes
+ * to the corpus, which is all there is when no file is given.
+ *
+ * -d also runs "objdump -D -b binary" over each corpus and disassembles
+ * every instruction objdump found at the same address, then counts the
+ * instructions where the two disagree on the length or, after blanks
+ * and comments are squeezed out, on the text.  The first -n of each
+ * kind are shown.  objdump knows many instructions that the disassembler
+ * does not, so the text count is a baseline to compare against, not a
+ * test that has to reach zero.
+ */
+
+#include <ctype.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "dis-asm.h"
+#include "x86-dis.h"
+
+#define RANDOM_SIZE	(4 << 20)
+#define PAD		64
+#define MAXCORPUS	16
+
+struct corpus {
+	const char *name;
+	unsigned char *text;
+	size_t size;
+};
+
+static struct corpus corpus[MAXCORPUS];
+static int ncorpus;
+static struct corpus *cur;		/* being disassembled */
+static bfd_vma base = 0x1000000;
+
+static char line[512];			/* output of the instruction */
+static size_t line_len;
+
+static const char *prog = "x86-disbench";
+
+static void die(const char *fmt, const char *arg)
+{
+	fprintf(stderr, "%s: ", prog);
+	fprintf(stderr, fmt, arg);
+	fputc('\n', stderr);
+	exit(1);
+}
+
+static void add_file(const char *name)
+{
+	struct corpus *c = &corpus[ncorpus++];
+	FILE *f = fopen(name, "rb");
+	long n;
+
+	if (!f || fseek(f, 0, SEEK_END) || (n = ftell(f)) < 0)
+		die("cannot read %s", name);
+	rewind(f);
+	c->name = name;
+	c->size = n;
+	c->text = calloc(1, c->size + PAD);
+	if (!c->text || fread(c->text, 1, c->size, f) != c->size)
+		die("cannot read %s", name);
+	fclose(f);
+}
+
+/* Random code with enough prefixes and escapes to reach every path */
+static void add_random(void)
+{
+	static const unsigned char special[] = {
+		0x66, 0x67, 0xf2, 0xf3, 0xf0, 0x2e, 0x3e, 0x26,
+		0x64, 0x65, 0x36, 0x0f, 0x48, 0x41, 0x4c, 0x0f,
+	};
+	struct corpus *c = &corpus[ncorpus++];
+	size_t i;
+
+	c->name = "random";
+	c->size = RANDOM_SIZE;
+	c->text = calloc(1, c->size + PAD);
+	if (!c->text)
+		die("%s", "out of memory");
+	srand(1);
+	for (i = 0; i < c->size; i++)
+		c->text[i] = rand() % 16 < 4 ? special[rand() % 16] : rand();
+}
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int read_text(bfd_vma addr, bfd_byte *buf, unsigned int len,
+		     disassemble_info *info)
+{
+	if (addr < base || addr + len > base + cur->size + PAD)
+		return -1;
+	memcpy(buf, cur->text + (addr - base), len);
+	return 0;
+}
+
+static int print_line(void *stream, const char *fmt, ...)
+{
+	va_list ap;
+	int n;
+
+	va_start(ap, fmt);
+	n = vsnprintf(line + line_len, sizeof(line) - line_len, fmt, ap);
+	va_end(ap);
+	if (n > 0)
+		line_len += n;
+	if (line_len >= sizeof(line))
+		line_len = sizeof(line) - 1;
+	return n;
+}
+
+static void print_address(bfd_vma addr, disassemble_info *info)
+{
+	print_line(NULL, "0x%lx", (unsigned long)addr);
+}
+
+static void memory_error(int status, bfd_vma addr, disassemble_info *info)
+{
+}
+
+static struct x86_dis_ctx ctx;
+static disassemble_info info;
+
+static void init_info(int mode)
+{
+	memset(&info, 0, sizeof(info));
+	info.fprintf_func = print_line;
+	info.read_memory_func = read_text;
+	info.print_address_func = print_address;
+	info.memory_error_func = memory_error;
+	info.mach = mode == 16 ? bfd_mach_i386_i8086
+		  : mode == 64 ? bfd_mach_x86_64 : bfd_mach_i386_i386;
+}
+
+/* Disassemble one instruction into line, return its length */
+static int disassemble(bfd_vma pc)
+{
+	int len;
+
+	line_len = 0;
+	line[0] = '\0';
+	len = print_insn_i386_att_ctx(&ctx, pc, &info);
+	return len > 0 ? len : 1;
+}
+
+static void bench(struct corpus *c, int loops)
+{
+	unsigned long insns = 0;
+	double t;
+	size_t pos;
+	int i;
+
+	cur = c;
+	t = now();
+	for (i = 0; i < loops; i++) {
+		for (pos = 0; pos < c->size; insns++)
+			pos += disassemble(base + pos);
+	}
+	t = now() - t;
+	printf("%-24s %9lu bytes %8lu insns  %7.2f MB/s  %6.2f Minsns/s\n",
+	       c->name, (unsigned long)c->size, insns / loops,
+	       c->size * loops / t / 1e6, insns / t / 1e6);
+}
+
+/* Squeeze blanks to one space and drop comments */
+static void squeeze(char *s)
+{
+	char *d = s, *p;
+	int blank = 0;
+
+	if ((p = strstr(s, " #")) || (p = strstr(s, "\t#")))
+		*p = '\0';
+	for (p = s; *p; p++) {
+		if (isspace((unsigned char)*p)) {
+			blank = d != s;
+			continue;
+		}
+		if (blank)
+			*d++ = ' ';
+		blank = 0;
+		*d++ = *p;
+	}
+	*d = '\0';
+}
+
+static void diff(struct corpus *c, int mode, int shown)
+{
+	static const char *arch[] = { "i8086", "i386", "i386:x86-64" };
+	char cmd[1024], od[512], tmp[] = "/tmp/x86-disbenchXXXXXX";
+	const char *file = c->name;
+	unsigned long compared = 0, badlen = 0, badtext = 0;
+	unsigned long addr;
+	int fd = -1, len, odlen;
+	char *p, *text;
+	FILE *f;
+
+	if (strcmp(c->name, "random") == 0) {
+		fd = mkstemp(tmp);
+		if (fd < 0 || write(fd, c->text, c->size) != (ssize_t)c->size)
+			die("cannot write %s", tmp);
+		close(fd);
+		file = tmp;
+	}
+	snprintf(cmd, sizeof(cmd),
+		 "objdump -D -z -w -b binary -m %s --adjust-vma=0x%lx '%s'",
+		 arch[mode == 16 ? 0 : mode == 32 ? 1 : 2],
+		 (unsigned long)base, file);
+	f = popen(cmd, "r");
+	if (!f)
+		die("cannot run %s", cmd);
+
+	cur = c;
+	while (fgets(od, sizeof(od), f)) {
+		/* "  1000:\t48 89 e5             \tmov    %rsp,%rbp" */
+		addr = strtoul(od, &p, 16);
+		if (*p != ':' || p[1] != '\t' || addr < base ||
+		    addr >= base + c->size)
+			continue;
+		p += 2;
+		text = strchr(p, '\t');
+		if (!text)
+			continue;
+		*text++ = '\0';
+		for (odlen = 0; isxdigit((unsigned char)p[0]) &&
+			       isxdigit((unsigned char)p[1]); p += 3)
+			odlen++;
+		squeeze(text);
+		if (strstr(text, "(bad)") || strncmp(text, ".byte", 5) == 0)
+			continue;
+
+		len = disassemble(addr);
+		squeeze(line);
+		compared++;
+		if (len != odlen) {
+			if (badlen++ < shown)
+				printf("  0x%lx length %d, objdump %d: %s | %s\n",
+				       addr, len, odlen, line, text);
+		} else if (strcmp(line, text)) {
+			if (badtext++ < shown)
+				printf("  0x%lx: %s | objdump: %s\n",
+				       addr, line, text);
+		}
+	}
+	pclose(f);
+	if (fd >= 0)
+		unlink(tmp);
+	if (!compared)
+		die("no objdump output for %s", c->name);
+	printf("%-24s %8lu insns compared, %lu length and %lu text "
+	       "differences, %.2f%% identical\n", c->name, compared, badlen,
+	       badtext, 100.0 * (compared - badlen - badtext) / compared);
+}
+
+int main(int argc, char **argv)
+{
+	int mode = 64, loops = 5, diffing = 0, shown = 10, random = 0;
+	int c, i;
+
+	while ((c = getopt(argc, argv, "m:l:dn:r")) != -1) {
+		switch (c) {
+		case 'm':
+			mode = atoi(optarg);
+			break;
+		case 'l':
+			loops = atoi(optarg);
+			break;
+		case 'd':
+			diffing = 1;
+			break;
+		case 'n':
+			shown = atoi(optarg);
+			break;
+		case 'r':
+			random = 1;
+			break;
+		default:
+			die("%s", "usage: x86-disbench [-m 16|32|64] [-l loops] "
+			    "[-d] [-n shown] [-r] [file]...");
+		}
+	}
+	if (mode != 16 && mode != 32 && mode != 64)
+		die("bad mode %s", "(16, 32 or 64)");
+	if (loops <= 0)
+		loops = 1;
+	if (argc - optind > MAXCORPUS - 1)
+		die("more than %s files", "15");
+	for (i = optind; i < argc; i++)
+		add_file(argv[i]);
+	if (random || optind == argc)
+		add_random();
+
+	init_info(mode);
+	for (i = 0; i < ncorpus; i++)
+		bench(&corpus[i], loops);
+	if (diffing) {
+		for (i = 0; i < ncorpus; i++)
+			diff(&corpus[i], mode, shown);
+	}
+	return 0;
+}
@@ -0,0 +1,244 @@
+/*
+ * x86-lenbench - throughput and cross check of the x86 length decoder
+ *
+ * This file is subject to the terms and conditions of the GNU General Public
+ * License.  See the file "COPYING" in the main directory of this archive
+ * for more details.
+ *
+ *	x86-lenbench [-m 16|32|64] [-l loops] [-c] [file]
+ *
+ * Walks the instructions in file, raw code such as the output of
+ * "objcopy -O binary --only-section=.text vmlinux text.bin", or in 16MB
+ * of pseudo random bytes when no file is given, with x86_insn_len and
+ * reports bytes and instructions per second.
+ *
+ * -c decodes every byte offset with x86_decode_insn as well and reports
+ * each instruction where the two disagree on the length, the branch flag
+ * or the branch target.  Offsets that x86_decode_insn finds invalid, VEX
+ * and EVEX encodings, which it does not know, and fwait, which it joins
+ * to the next float instruction, are skipped.
+ *
+ * On a 2 GHz x86-64 guest libc .text scans at 140-215 MB/s, mostly
+ * around 160, or 35-50M instructions/s.  Random bytes are slower.  The
+ * time goes on the dependent table loads of each instruction and on
+ * mispredicted prefix and escape branches, about half the instructions
+ * in libc have a prefix and a fifth are 0x0f escapes.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "dis-asm.h"
+#include "x86-dis.h"
+#include "x86-len.h"
+
+#define RANDOM_SIZE	(16 << 20)
+#define PAD		64
+
+static unsigned char *text;
+static size_t size;
+static bfd_vma base = 0x1000000;
+
+static const char *prog = "x86-lenbench";
+
+static void die(const char *fmt, const char *arg)
+{
+	fprintf(stderr, "%s: ", prog);
+	fprintf(stderr, fmt, arg);
+	fputc('\n', stderr);
+	exit(1);
+}
+
+static void read_file(const char *name)
+{
+	FILE *f = fopen(name, "rb");
+	long n;
+
+	if (!f || fseek(f, 0, SEEK_END) || (n = ftell(f)) < 0)
+		die("cannot read %s", name);
+	rewind(f);
+	size = n;
+	text = calloc(1, size + PAD);
+	if (!text || fread(text, 1, size, f) != size)
+		die("cannot read %s", name);
+	fclose(f);
+}
+
+/* Random code with enough prefixes and escapes to reach every path */
+static void make_random(void)
+{
+	static const unsigned char special[] = {
+		0x66, 0x67, 0xf2, 0xf3, 0xf0, 0x2e, 0x3e, 0x26,
+		0x64, 0x65, 0x36, 0x0f, 0x48, 0x41, 0x4c, 0x0f,
+	};
+	size_t i;
+
+	size = RANDOM_SIZE;
+	text = calloc(1, size + PAD);
+	if (!text)
+		die("%s", "out of memory");
+	srand(1);
+	for (i = 0; i < size; i++)
+		text[i] = rand() % 16 < 4 ? special[rand() % 16] : rand();
+}
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void bench(int mode, int loops)
+{
+	unsigned long insns = 0, branches = 0;
+	double t;
+	size_t pos;
+	int i, len, flags;
+
+	t = now();
+	for (i = 0; i < loops; i++) {
+		for (pos = 0; pos < size; pos += len) {
+			len = x86_insn_len(text + pos, size - pos, mode, &flags);
+			if (len < 0)
+				break;
+			insns++;
+			branches += flags & X86_LEN_BRANCH;
+		}
+	}
+	t = now() - t;
+	printf("%d bit: %lu bytes, %lu insns, %lu branches in %.3fs\n",
+	       mode, (unsigned long)size * loops, insns, branches, t);
+	printf("%.1f MB/s, %.1f Minsns/s\n",
+	       size * loops / t / 1e6, insns / t / 1e6);
+}
+
+static int read_text(bfd_vma addr, bfd_byte *buf, unsigned int len,
+		     disassemble_info *info)
+{
+	if (addr < base || addr + len > base + size + PAD)
+		return -1;
+	memcpy(buf, text + (addr - base), len);
+	return 0;
+}
+
+static int print_nothing(void *stream, const char *fmt, ...)
+{
+	return 0;
+}
+
+static void no_address(bfd_vma addr, disassemble_info *info)
+{
+}
+
+static void no_error(int status, bfd_vma addr, disassemble_info *info)
+{
+}
+
+/* Skip legacy and REX prefixes, to see whether an fwait follows */
+static size_t skip_prefixes(size_t pos, int mode)
+{
+	for (;; pos++) {
+		switch (text[pos]) {
+		case 0x26: case 0x2e: case 0x36: case 0x3e: case 0x64:
+		case 0x65: case 0x66: case 0x67: case 0xf0: case 0xf2:
+		case 0xf3:
+			continue;
+		}
+		if (mode == 64 && (text[pos] & 0xf0) == 0x40)
+			continue;
+		return pos;
+	}
+}
+
+static int check(int mode)
+{
+	static struct x86_dis_ctx ctx;
+	disassemble_info info;
+	struct x86_insn insn;
+	unsigned long compared = 0, bad = 0;
+	size_t pos;
+	int len, dlen, flags, ok;
+	bfd_vma target;
+
+	memset(&info, 0, sizeof(info));
+	info.fprintf_func = print_nothing;
+	info.read_memory_func = read_text;
+	info.print_address_func = no_address;
+	info.memory_error_func = no_error;
+	info.mach = mode == 16 ? bfd_mach_i386_i8086
+		  : mode == 64 ? bfd_mach_x86_64 : bfd_mach_i386_i386;
+
+	for (pos = 0; pos < size; pos++) {
+		len = x86_insn_len(text + pos, size + PAD - pos, mode, &flags);
+		if (len < 0 || flags & X86_LEN_VEX ||
+		    text[skip_prefixes(pos, mode)] == 0x9b)
+			continue;
+		dlen = x86_decode_insn(&ctx, base + pos, &info, &insn);
+		if (dlen < 0 || dlen > X86_LEN_MAX ||
+		    insn.class == X86_INSN_BAD)
+			continue;
+		compared++;
+		ok = len == dlen && !(flags & X86_LEN_BAD) &&
+		     !(flags & X86_LEN_BRANCH) == (insn.class == X86_INSN_OTHER);
+		if ((insn.flags & X86_INSN_TARGET) &&
+		    !(insn.flags & X86_INSN_FAR)) {
+			target = x86_len_target(text + pos, len, flags,
+						base + pos);
+			if (mode != 64)
+				target &= 0xffffffff;
+			if (!(flags & X86_LEN_REL) || target != insn.target)
+				ok = 0;
+		} else if (flags & X86_LEN_REL)
+			ok = 0;
+		if (!ok && bad++ < 20) {
+			printf("%d bit offset 0x%lx: length %d flags 0x%x, "
+			       "decoder length %d class %d:", mode,
+			       (unsigned long)pos, len, flags, dlen,
+			       insn.class);
+			for (len = 0; len < dlen; len++)
+				printf(" %02x", text[pos + len]);
+			printf("\n");
+		}
+	}
+	printf("%d bit: %lu offsets compared, %lu mismatches\n",
+	       mode, compared, bad);
+	return bad != 0;
+}
+
+int main(int argc, char **argv)
+{
+	int mode = 64, loops = 10, checking = 0;
+	int c;
+
+	while ((c = getopt(argc, argv, "m:l:c")) != -1) {
+		switch (c) {
+		case 'm':
+			mode = atoi(optarg);
+			break;
+		case 'l':
+			loops = atoi(optarg);
+			break;
+		case 'c':
+			checking = 1;
+			break;
+		default:
+			die("%s", "usage: x86-lenbench [-m 16|32|64] "
+			    "[-l loops] [-c] [file]");
+		}
+	}
+	if (mode != 16 && mode != 32 && mode != 64)
+		die("bad mode %s", "(16, 32 or 64)");
+	if (optind < argc)
+		read_file(argv[optind]);
+	else
+		make_random();
+
+	if (checking)
+		return check(mode);
+	bench(mode, loops);
+	return 0;
+}
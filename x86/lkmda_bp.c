@@ -15,6 +15,7 @@
 #include <linux/ptrace.h>
 #include "../lkmd.h"
 #include "../lkmd_private.h"
+#include "x86-dis.h"
 
 static char *kdba_rwtypes[] = { "Instruction(Register)", "Data Write",
 			"I/O", "Data Access"};
@@ -139,18 +140,24 @@ kdb_dbtrap_t kdba_db_trap(struct pt_regs *regs, int error_unused)
 		/* single step */
 		rv = KDB_DB_SS;		/* Indicate single step */
 		if (KDB_STATE(DOING_SSB)) {
-			unsigned char instruction[2];
+			const kdb_insn_t *fi;
+			struct x86_insn insn;
+			int stop;
 
 			kdb_id1(regs->ip);
-			if (kdb_getarea(instruction, regs->ip) ||
-			    (instruction[0]&0xf0) == 0xe0 ||	/* short disp jumps */
-			    (instruction[0]&0xf0) == 0x70 ||	/* Misc. jumps */
-			    instruction[0]        == 0xc2 ||	/* ret */
-			    instruction[0]        == 0x9a ||	/* call */
-			    (instruction[0]&0xf8) == 0xc8 ||	/* enter, leave, iret, int, */
-			    ((instruction[0]      == 0x0f) &&
-			     ((instruction[1]&0xf0)== 0x80))
-			   ) {
+			/*
+			 * Stop in front of anything that leaves the straight
+			 * line: jumps, calls, returns, interrupts and system
+			 * calls, and at bad or unreadable instructions.  Inside
+			 * a known function the decoded function cache answers,
+			 * so each stop does not decode again.
+			 */
+			if ((fi = kdb_id_lookup(regs->ip)))
+				stop = fi->flags & (KDB_INSN_BRANCH | KDB_INSN_CALL | KDB_INSN_BAD);
+			else
+				stop = kdba_id_decode(regs->ip, &insn) < 0 ||
+				       insn.class != X86_INSN_OTHER;
+			if (stop) {
 				/* End the ssb command here. */
 				KDB_STATE_CLEAR(DOING_SSB);
 				KDB_STATE_CLEAR(DOING_SS);
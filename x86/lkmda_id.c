@@ -15,6 +15,15 @@
 #include <linux/string.h>
 #include "../lkmd.h"
 #include "../lkmd_private.h"
+#include "x86-dis.h"
+#include "x86-len.h"
+
+/*
+ * Decoder state for kdb's own disassembly.  Only the cpu that controls
+ * kdb disassembles, so one is enough; other users of x86-dis.c bring
+ * their own.
+ */
+static struct x86_dis_ctx kdba_dis_ctx;
 
 /*
  * kdba_dis_getsym
@@ -116,6 +125,54 @@ static void kdba_dis_printaddr(bfd_vma addr, disassemble_info *dip)
 	kdba_printaddress(addr, dip, 0);
 }
 
+/*
+ * Read ahead window for the disassembler.  The decoder asks for a few
+ * bytes at a time, each fetch used to be a separate checked copy.  The
+ * window holds up to the next KDBA_DIS_WINDOW bytes, never past the end
+ * of the page, read in one go.  It is only filled where the session
+ * page cache would be allowed to copy memory ahead of use, and is
+ * dropped whenever kdb writes or invalidates memory.
+ */
+
+#define KDBA_DIS_WINDOW	64
+
+static struct {
+	unsigned long addr;		/* address of data[0] */
+	size_t len;			/* valid bytes, 0 if empty */
+	unsigned long generation;	/* kdb_getarea_generation when filled */
+	unsigned char data[KDBA_DIS_WINDOW];
+} kdba_dis_window;
+
+/*
+ * kdba_dis_fill
+ *
+ *	Refill the disassembler window starting at addr.
+ *
+ * Parameters:
+ *	addr	First address to read.
+ * Returns:
+ *	None.
+ * Locking:
+ *	None.
+ * Remarks:
+ *	Leaves the window empty, or shorter than asked, if the memory
+ *	cannot be read ahead.  No message is printed here, the caller
+ *	reports the error when it falls back to kdb_getarea_size.
+ */
+
+static void kdba_dis_fill(unsigned long addr)
+{
+	size_t n = min_t(size_t, KDBA_DIS_WINDOW,
+			 PAGE_SIZE - (addr & ~PAGE_MASK));
+
+	kdba_dis_window.len = 0;
+	kdba_dis_window.addr = addr;
+	kdba_dis_window.generation = kdb_getarea_generation;
+	if (kdb_getarea_cacheable(addr))
+		kdb_getarea_bulk(kdba_dis_window.data, addr, n,
+				 &kdba_dis_window.len);
+}
+
 /*
  * kdba_dis_getmem
  *
@@ -130,13 +187,26 @@ static void kdba_dis_printaddr(bfd_vma addr, disassemble_info *dip)
  *	0 if data is available, otherwise error.
  * Locking:
  * Remarks:
- *
+ *	Served from the read ahead window when possible.  A request the
+ *	window cannot cover, at a page end or on memory that is not read
+ *	ahead, goes to kdb_getarea_size as before.
  */
 
 /* ARGSUSED */
 static int kdba_dis_getmem(bfd_vma addr, bfd_byte *buf, unsigned int length, disassemble_info *dip)
 {
-	return kdb_getarea_size(buf, addr, length);
+	unsigned long off = addr - kdba_dis_window.addr;
+
+	if (kdba_dis_window.generation != kdb_getarea_generation ||
+	    addr < kdba_dis_window.addr ||
+	    off + length > kdba_dis_window.len) {
+		kdba_dis_fill(addr);
+		off = 0;
+		if (length > kdba_dis_window.len)
+			return kdb_getarea_size(buf, addr, length);
+	}
+	memcpy(buf, kdba_dis_window.data + off, length);
+	return 0;
 }
 
 /*
@@ -212,7 +282,134 @@ void kdba_check_pc(kdb_machreg_t *pc)
 int kdba_id_printinsn(kdb_machreg_t pc, disassemble_info *dip)
 {
 	kdba_printaddress(pc, dip, 1);
-	return print_insn_i386_att(pc, dip);
+	return print_insn_i386_att_ctx(&kdba_dis_ctx, pc, dip);
+}
+
+/*
+ * kdba_id_decode
+ *
+ * 	Decode a single instruction at 'pc' without printing it.
+ *
+ * Parameters:
+ *	pc	Program Counter Value.
+ *	insn	Filled in with the decoded instruction.
+ * Returns:
+ *	Length of instruction, -1 for error.
+ * Locking:
+ *	None.
+ * Remarks:
+ *	Always decodes in the native mode of the kernel, IDMODE is not
+ *	used.  Shares the decoder state with kdba_id_printinsn.
+ */
+
+int kdba_id_decode(kdb_machreg_t pc, struct x86_insn *insn)
+{
+	disassemble_info di;
+
+	memset(&di, 0, sizeof(di));
+	kdba_id_init(&di);
+	return x86_decode_insn(&kdba_dis_ctx, pc, &di, insn);
+}
+
+/*
+ * kdba_id_classify
+ *
+ * 	Decode the instruction at 'pc' into the generic form kept by
+ *	the function cache.
+ *
+ * Parameters:
+ *	pc	Program Counter Value.
+ *	insn	length, flags and target are filled in.
+ * Returns:
+ *	Length of instruction, -1 if it could not be read.
+ * Locking:
+ *	None.
+ * Remarks:
+ *	insn->offset is left to the caller.
+ */
+
+int kdba_id_classify(kdb_machreg_t pc, kdb_insn_t *insn)
+{
+	struct x86_insn xi;
+	int len;
+
+	len = kdba_id_decode(pc, &xi);
+	if (len <= 0)
+		return -1;
+	insn->length = len;
+	insn->flags = 0;
+	insn->target = 0;
+	switch (xi.class) {
+	case X86_INSN_OTHER:
+		break;
+	case X86_INSN_BAD:
+		insn->flags |= KDB_INSN_BAD;
+		break;
+	case X86_INSN_CALL:
+		insn->flags |= KDB_INSN_CALL;
+		break;
+	default:
+		insn->flags |= KDB_INSN_BRANCH;
+		break;
+	}
+	if ((xi.flags & X86_INSN_TARGET) && !(xi.flags & X86_INSN_FAR)) {
+		insn->flags |= KDB_INSN_TARGET;
+		insn->target = xi.target;
+	}
+	return len;
+}
+
+/*
+ * kdba_insn_len
+ *
+ * 	Size up the instruction in 'buf' with the length decoder, for
+ *	scans over a lot of text.
+ *
+ * Parameters:
+ *	buf	Instruction bytes.
+ *	size	Number of valid bytes in buf.
+ *	pc	Address of buf[0].
+ *	insn	length, flags and target are filled in, as for
+ *		kdba_id_classify.
+ * Returns:
+ *	Length of instruction, -1 if it does not fit in size bytes.
+ * Locking:
+ *	None.
+ * Remarks:
+ *	Does not read memory, so it is safe on the held cpus.  Only the
+ *	call, branch and bad flags are set, there is no distinction
+ *	between a jump and a return.
+ */
+
+int kdba_insn_len(const unsigned char *buf, int size, kdb_machreg_t pc, kdb_insn_t *insn)
+{
+	const unsigned char *p;
+	int len, flags;
+
+#ifdef CONFIG_X86_64
+	len = x86_insn_len(buf, size, 64, &flags);
+#else
+	len = x86_insn_len(buf, size, 32, &flags);
+#endif
+	if (len < 0)
+		return -1;
+	insn->length = len;
+	insn->flags = 0;
+	insn->target = 0;
+	if (flags & X86_LEN_BAD)
+		insn->flags |= KDB_INSN_BAD;
+	if (flags & X86_LEN_BRANCH) {
+		/* Operand size, address size, segment and bnd prefixes */
+		for (p = buf; p < buf + len - 1 && (*p == 0x66 || *p == 0x67 ||
+		     *p == 0x2e || *p == 0x3e || *p == 0xf2); ++p)
+			;
+		insn->flags |= *p == 0xe8 ? KDB_INSN_CALL : KDB_INSN_BRANCH;
+	}
+	if (flags & X86_LEN_REL) {
+		insn->flags |= KDB_INSN_TARGET;
+		insn->target = x86_len_target(buf, len, flags, pc);
+	}
+	return len;
 }
 
 /*
@@ -286,4 +286,19 @@ void kernel_write_ul(unsigned long *, unsigned long);
 void set_cr0_rw(void);
 void set_cr0_ro(void);
 
+/* Memory search helpers, see kdb_ms */
+extern int kdba_memscan(const void *, size_t, unsigned char, unsigned long *);
+#define kdba_memscan kdba_memscan
+extern unsigned long kdba_next_mapped(unsigned long);
+#define kdba_next_mapped kdba_next_mapped
+
+/* Decode without printing, see x86-dis.h */
+struct x86_insn;
+extern int kdba_id_decode(kdb_machreg_t, struct x86_insn *);
+
+/* Write window for read only kernel memory, see kdb_write_begin */
+extern void kdba_write_begin(void);
+#define kdba_write_begin kdba_write_begin
+extern void kdba_write_end(void);
+
 #endif	/* !_ARCH_LKMD_PRIVATE_H */
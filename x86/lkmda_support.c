@@ -27,6 +27,8 @@
 #include <asm/msr.h>
 #include <asm/uaccess.h>
 #include <asm/desc.h>
+#include <asm/pgtable.h>
+#include <asm/unaligned.h>
 #include "../lkmd.h"
 #include "../lkmd_private.h"
 
@@ -1598,6 +1600,168 @@ void kdba_set_current_task(const struct task_struct *p)
 	kdb_current_regs = NULL;
 }
 
+/*
+ * kdba_memscan
+ *
+ *	Set a bit in a bitmap for every byte of a buffer that is equal to
+ *	c, a word at a time.
+ *
+ * Inputs:
+ *	buf	The buffer to scan.
+ *	len	Length of the buffer.
+ *	c	The byte to look for.
+ * Outputs:
+ *	bitmap	Bit n is set if buf[n] == c, it must hold len bits and be
+ *		cleared by the caller.
+ * Returns:
+ *	Always 1, the buffer was scanned.
+ * Locking:
+ *	none.
+ * Remarks:
+ *	No SSE/AVX, kdb can stop the kernel inside kernel_fpu_begin() and
+ *	a nested kernel_fpu_begin/end would clobber the live vector
+ *	registers.  Each word is xored with c in every byte, a zero byte
+ *	is found without carries between the bytes so every match is
+ *	exact.
+ */
+
+int kdba_memscan(const void *buf, size_t len, unsigned char c, unsigned long *bitmap)
+{
+	const unsigned long ones = ~0UL / 0xff;		/* 0x0101... */
+	const unsigned long low7 = ones * 0x7f;
+	const unsigned long pat = ones * c;
+	const unsigned char *p = buf;
+	unsigned long x, t;
+	size_t i = 0;
+
+	for (; i + sizeof(long) <= len; i += sizeof(long)) {
+		x = get_unaligned((const unsigned long *)(p + i)) ^ pat;
+		/* bit 7 of each byte of t is set if that byte of x is 0 */
+		t = ~(((x & low7) + low7) | x | low7);
+		while (t) {
+			__set_bit(i + __ffs(t) / 8, bitmap);
+			t &= t - 1;
+		}
+	}
+	for (; i < len; ++i) {
+		if (p[i] == c)
+			__set_bit(i, bitmap);
+	}
+	return 1;
+}
+
+/*
+ * kdba_next_mapped
+ *
+ *	Find the next kernel address after an unreadable address that is
+ *	worth trying, skipping whole unmapped page table levels.
+ *
+ * Inputs:
+ *	addr	An address that could not be read.
+ * Outputs:
+ *	None.
+ * Returns:
+ *	The next address to try, 0 if the end of the address space was
+ *	reached.
+ * Locking:
+ *	none.
+ * Remarks:
+ *	lookup_address() stops at the first level that is not present,
+ *	the level it reports is the last one that was present.  An empty
+ *	pgd is reported the same as an empty pud, so only skip to the
+ *	next pud in that case.
+ */
+
+unsigned long kdba_next_mapped(unsigned long addr)
+{
+	unsigned long size = PAGE_SIZE;
+	unsigned int level;
+	pte_t *pte;
+
+	if (addr >= PAGE_OFFSET) {
+		pte = lookup_address(addr, &level);
+		if (!pte)
+			size = level == PG_LEVEL_NONE ? PUD_SIZE : PMD_SIZE;
+		else if (level == PG_LEVEL_1G)
+			size = PUD_SIZE;
+		else if (level == PG_LEVEL_2M)
+			size = PMD_SIZE;
+	}
+	return (addr | (size - 1)) + 1;
+}
+
+/*
+ * Write window for the bulk write commands.  Clearing CR0.WP lets the
+ * kernel write through read only mappings (text, rodata, module text),
+ * the copy itself still goes through the exception table so unmapped
+ * addresses fail instead of faulting.  CR0 is written directly, newer
+ * kernels pin WP in native_write_cr0().  The other cpus are held in kdb
+ * and serialize on the way out, so patched text needs no extra sync.
+ */
+
+static unsigned long kdba_write_cr0;
+static unsigned long kdba_write_flags;
+static int kdba_write_open;
+
+static inline void kdba_cr0_write(unsigned long cr0)
+{
+	asm volatile("mov %0,%%cr0" : : "r" (cr0) : "memory");
+}
+
+/*
+ * kdba_write_begin
+ *
+ *	Open the write window.
+ *
+ * Inputs:
+ *	None.
+ * Outputs:
+ *	None.
+ * Returns:
+ *	None.
+ * Locking:
+ *	none.
+ * Remarks:
+ *	The window must be closed with kdba_write_end() before anything
+ *	is printed, the pager can longjmp out of a command.
+ */
+
+void kdba_write_begin(void)
+{
+	if (kdba_write_open)
+		return;
+	local_irq_save(kdba_write_flags);
+	kdba_write_cr0 = read_cr0();
+	if (kdba_write_cr0 & X86_CR0_WP)
+		kdba_cr0_write(kdba_write_cr0 & ~X86_CR0_WP);
+	kdba_write_open = 1;
+}
+
+/*
+ * kdba_write_end
+ *
+ *	Close the write window, if it is open.
+ *
+ * Inputs:
+ *	None.
+ * Outputs:
+ *	None.
+ * Returns:
+ *	None.
+ * Locking:
+ *	none.
+ */
+
+void kdba_write_end(void)
+{
+	if (!kdba_write_open)
+		return;
+	kdba_write_open = 0;
+	if (kdba_write_cr0 & X86_CR0_WP)
+		kdba_cr0_write(kdba_write_cr0);
+	local_irq_restore(kdba_write_flags);
+}
+
 #ifdef CONFIG_X86_32
 /*
  * asm-i386 uaccess.h supplies __copy_to_user which relies on MMU to
@@ -42,17 +42,13 @@
 #include <linux/string.h>
 #include "../dis-asm.h"
 #include "../lkmd.h"
+#include "x86-dis.h"
 #define abort() BUG()
 #else	/* __KERNEL__ */
 #include "dis-asm.h"
 #include "sysdep.h"
 #include "opintl.h"
-#endif	/* __KERNEL__ */
-
-#define MAXLEN 20
-
-#ifndef __KERNEL__
-#include <setjmp.h>
+#include "x86-dis.h"
 #endif	/* __KERNEL__ */
 
 #ifndef UNIXWARE_COMPAT
@@ -61,88 +57,68 @@
 #define UNIXWARE_COMPAT 1
 #endif
 
-static int fetch_data (struct disassemble_info *, bfd_byte *);
-static void ckprefix (void);
-static const char *prefix_name (int, int);
-static int print_insn (bfd_vma, disassemble_info *);
-static void dofloat (int);
-static void OP_ST (int, int);
-static void OP_STi (int, int);
-static int putop (const char *, int);
-static void oappend (const char *);
-static void append_seg (void);
-static void OP_indirE (int, int);
-static void print_operand_value (char *, int, bfd_vma);
-static void OP_E (int, int);
-static void OP_G (int, int);
-static bfd_vma get64 (void);
-static bfd_signed_vma get32 (void);
-static bfd_signed_vma get32s (void);
-static int get16 (void);
-static void set_op (bfd_vma, int);
-static void OP_REG (int, int);
-static void OP_IMREG (int, int);
-static void OP_I (int, int);
-static void OP_I64 (int, int);
-static void OP_sI (int, int);
-static void OP_J (int, int);
-static void OP_SEG (int, int);
-static void OP_DIR (int, int);
-static void OP_OFF (int, int);
-static void OP_OFF64 (int, int);
-static void ptr_reg (int, int);
-static void OP_ESreg (int, int);
-static void OP_DSreg (int, int);
-static void OP_C (int, int);
-static void OP_D (int, int);
-static void OP_T (int, int);
-static void OP_Rd (int, int);
-static void OP_MMX (int, int);
-static void OP_XMM (int, int);
-static void OP_EM (int, int);
-static void OP_EX (int, int);
-static void OP_MS (int, int);
-static void OP_XS (int, int);
-static void OP_M (int, int);
-static void OP_VMX (int, int);
-static void OP_0fae (int, int);
-static void OP_0f07 (int, int);
-static void NOP_Fixup (int, int);
-static void OP_3DNowSuffix (int, int);
-static void OP_SIMD_Suffix (int, int);
-static void SIMD_Fixup (int, int);
-static void PNI_Fixup (int, int);
-static void SVME_Fixup (int, int);
-static void INVLPG_Fixup (int, int);
-static void BadOp (void);
-static void SEG_Fixup (int, int);
-static void VMX_Fixup (int, int);
-
-struct dis_private {
-  /* Points to first byte not fetched.	*/
-  bfd_byte *max_fetched;
-  bfd_byte the_buffer[MAXLEN];
-  bfd_vma insn_start;
-  int orig_sizeflag;
-#ifndef __KERNEL__
-  jmp_buf bailout;
-#endif	/* __KERNEL__ */
-};
+static int fetch_data (struct x86_dis_ctx *, bfd_byte *);
+static void ckprefix (struct x86_dis_ctx *);
+static const char *prefix_name (struct x86_dis_ctx *, int, int);
+static void set_mode (struct x86_dis_ctx *, disassemble_info *);
+static int print_insn (struct x86_dis_ctx *, bfd_vma, disassemble_info *);
+static void dofloat (struct x86_dis_ctx *, int);
+static void OP_ST (struct x86_dis_ctx *, int, int);
+static void OP_STi (struct x86_dis_ctx *, int, int);
+static int putop (struct x86_dis_ctx *, const char *, int);
+static void oappend (struct x86_dis_ctx *, const char *);
+static void append_seg (struct x86_dis_ctx *);
+static void OP_indirE (struct x86_dis_ctx *, int, int);
+static void print_operand_value (struct x86_dis_ctx *, char *, int, bfd_vma);
+static void OP_E (struct x86_dis_ctx *, int, int);
+static void OP_G (struct x86_dis_ctx *, int, int);
+static bfd_vma get64 (struct x86_dis_ctx *);
+static bfd_signed_vma get32 (struct x86_dis_ctx *);
+static bfd_signed_vma get32s (struct x86_dis_ctx *);
+static int get16 (struct x86_dis_ctx *);
+static void set_op (struct x86_dis_ctx *, bfd_vma, int);
+static void OP_REG (struct x86_dis_ctx *, int, int);
+static void OP_IMREG (struct x86_dis_ctx *, int, int);
+static void OP_I (struct x86_dis_ctx *, int, int);
+static void OP_I64 (struct x86_dis_ctx *, int, int);
+static void OP_sI (struct x86_dis_ctx *, int, int);
+static void OP_J (struct x86_dis_ctx *, int, int);
+static void OP_SEG (struct x86_dis_ctx *, int, int);
+static void OP_DIR (struct x86_dis_ctx *, int, int);
+static void OP_OFF (struct x86_dis_ctx *, int, int);
+static void OP_OFF64 (struct x86_dis_ctx *, int, int);
+static void ptr_reg (struct x86_dis_ctx *, int, int);
+static void OP_ESreg (struct x86_dis_ctx *, int, int);
+static void OP_DSreg (struct x86_dis_ctx *, int, int);
+static void OP_C (struct x86_dis_ctx *, int, int);
+static void OP_D (struct x86_dis_ctx *, int, int);
+static void OP_T (struct x86_dis_ctx *, int, int);
+static void OP_Rd (struct x86_dis_ctx *, int, int);
+static void OP_MMX (struct x86_dis_ctx *, int, int);
+static void OP_XMM (struct x86_dis_ctx *, int, int);
+static void OP_EM (struct x86_dis_ctx *, int, int);
+static void OP_EX (struct x86_dis_ctx *, int, int);
+static void OP_MS (struct x86_dis_ctx *, int, int);
+static void OP_XS (struct x86_dis_ctx *, int, int);
+static void OP_M (struct x86_dis_ctx *, int, int);
+static void OP_VMX (struct x86_dis_ctx *, int, int);
+static void OP_0fae (struct x86_dis_ctx *, int, int);
+static void OP_0f07 (struct x86_dis_ctx *, int, int);
+static void NOP_Fixup (struct x86_dis_ctx *, int, int);
+static void OP_3DNowSuffix (struct x86_dis_ctx *, int, int);
+static void OP_SIMD_Suffix (struct x86_dis_ctx *, int, int);
+static void SIMD_Fixup (struct x86_dis_ctx *, int, int);
+static void PNI_Fixup (struct x86_dis_ctx *, int, int);
+static void SVME_Fixup (struct x86_dis_ctx *, int, int);
+static void INVLPG_Fixup (struct x86_dis_ctx *, int, int);
+static void BadOp (struct x86_dis_ctx *);
+static void SEG_Fixup (struct x86_dis_ctx *, int, int);
+static void VMX_Fixup (struct x86_dis_ctx *, int, int);
 
 /* The opcode for the fwait instruction, which we treat as a prefix
    when we can.	 */
 #define FWAIT_OPCODE (0x9b)
 
-/* Set to 1 for 64bit mode disassembly.	 */
-static int mode_64bit;
-
-/* Flags for the prefixes for the current instruction.	See below.  */
-static int prefixes;
-
-/* REX prefix the current instruction.	See below.  */
-static int rex;
-/* Bits of REX we've already used.  */
-static int rex_used;
 #define REX_MODE64	8
 #define REX_EXTX	4
 #define REX_EXTY	2
@@ -154,46 +130,40 @@ static int rex_used;
 #define USED_REX(value)					\
   {							\
     if (value)						\
-      rex_used |= (rex & value) ? (value) | 0x40 : 0;	\
+      ctx->rex_used |= (ctx->rex & value) ? (value) | 0x40 : 0;	\
     else						\
-      rex_used |= 0x40;					\
+      ctx->rex_used |= 0x40;					\
   }
 
-/* Flags for prefixes which we somehow handled when printing the
-   current instruction.	 */
-static int used_prefixes;
-
-/* Flags stored in PREFIXES.  */
-#define PREFIX_REPZ 1
-#define PREFIX_REPNZ 2
-#define PREFIX_LOCK 4
-#define PREFIX_CS 8
-#define PREFIX_SS 0x10
-#define PREFIX_DS 0x20
-#define PREFIX_ES 0x40
-#define PREFIX_FS 0x80
-#define PREFIX_GS 0x100
-#define PREFIX_DATA 0x200
-#define PREFIX_ADDR 0x400
-#define PREFIX_FWAIT 0x800
-
-/* Make sure that bytes from INFO->PRIVATE_DATA->BUFFER (inclusive)
-   to ADDR (exclusive) are valid.  Returns 1 for success, longjmps
-   on error.  */
-#define FETCH_DATA(info, addr) \
-  ((addr) <= ((struct dis_private *) (info->private_data))->max_fetched \
-   ? 1 : fetch_data ((info), (addr)))
+/* Flags stored in PREFIXES, see x86-dis.h.  */
+#define PREFIX_REPZ X86_PREFIX_REPZ
+#define PREFIX_REPNZ X86_PREFIX_REPNZ
+#define PREFIX_LOCK X86_PREFIX_LOCK
+#define PREFIX_CS X86_PREFIX_CS
+#define PREFIX_SS X86_PREFIX_SS
+#define PREFIX_DS X86_PREFIX_DS
+#define PREFIX_ES X86_PREFIX_ES
+#define PREFIX_FS X86_PREFIX_FS
+#define PREFIX_GS X86_PREFIX_GS
+#define PREFIX_DATA X86_PREFIX_DATA
+#define PREFIX_ADDR X86_PREFIX_ADDR
+#define PREFIX_FWAIT X86_PREFIX_FWAIT
+
+/* Make sure that bytes from CTX->THE_BUFFER (inclusive) to ADDR
+   (exclusive) are valid.  Returns 1 for success, longjmps on error.  */
+#define FETCH_DATA(ctx, addr) \
+  ((addr) <= (ctx)->max_fetched ? 1 : fetch_data ((ctx), (addr)))
 
 static int
-fetch_data (struct disassemble_info *info, bfd_byte *addr)
+fetch_data (struct x86_dis_ctx *ctx, bfd_byte *addr)
 {
+  struct disassemble_info *info = ctx->info;
   int status;
-  struct dis_private *priv = (struct dis_private *) info->private_data;
-  bfd_vma start = priv->insn_start + (priv->max_fetched - priv->the_buffer);
+  bfd_vma start = ctx->insn_start + (ctx->max_fetched - ctx->the_buffer);
 
   status = (*info->read_memory_func) (start,
-				      priv->max_fetched,
-				      addr - priv->max_fetched,
+				      ctx->max_fetched,
+				      addr - ctx->max_fetched,
 				      info);
   if (status != 0)
     {
@@ -201,17 +171,19 @@ fetch_data (struct disassemble_info *info, bfd_byte *addr)
 	 print_insn_i386 will do something sensible.  Otherwise, print
 	 an error.  We do that here because this is where we know
 	 STATUS.  */
-      if (priv->max_fetched == priv->the_buffer)
+      ctx->fetch_error = status;
+      if (ctx->max_fetched == ctx->the_buffer && !ctx->decode_only)
 	(*info->memory_error_func) (status, start, info);
 #ifndef __KERNEL__
-      longjmp (priv->bailout, 1);
+      longjmp (ctx->bailout, 1);
 #else	/* __KERNEL__ */
 	/* XXX - what to do? */
-	lkmd_printf("Hmm. longjmp.\n");
+	if (!ctx->decode_only)
+	  lkmd_printf("Hmm. longjmp.\n");
 #endif	/* __KERNEL__ */
     }
   else
-    priv->max_fetched = addr;
+    ctx->max_fetched = addr;
   return 1;
 }
 
@@ -468,7 +440,8 @@ fetch_data (struct disassemble_info *info, bfd_byte *addr)
 
 #define X86_64_0  NULL, NULL, X86_64_SPECIAL, NULL,  0, NULL, 0
 
-typedef void (*op_rtn) (int bytemode, int sizeflag);
+struct x86_dis_ctx;
+typedef void (*op_rtn) (struct x86_dis_ctx *ctx, int bytemode, int sizeflag);
 
 struct dis386 {
   const char *name;
@@ -836,13 +809,13 @@ static const struct dis386 dis386_twobyte[] = {
   { "movhpX",		EX, XM, SIMD_Fixup, 'l' },
   /* 18 */
   { GRP14 },
-  { "(bad)",		XX, XX, XX },
-  { "(bad)",		XX, XX, XX },
-  { "(bad)",		XX, XX, XX },
-  { "(bad)",		XX, XX, XX },
-  { "(bad)",		XX, XX, XX },
-  { "(bad)",		XX, XX, XX },
-  { "(bad)",		XX, XX, XX },
+  { "nopQ",		Ev, XX, XX },
+  { "nopQ",		Ev, XX, XX },
+  { "nopQ",		Ev, XX, XX },
+  { "nopQ",		Ev, XX, XX },
+  { "nopQ",		Ev, XX, XX },
+  { "nopQ",		Ev, XX, XX },
+  { "nopQ",		Ev, XX, XX },
   /* 20 */
   { "movL",		Rm, Cm, XX },
   { "movL",		Rm, Dm, XX },
@@ -1124,7 +1097,7 @@ static const unsigned char twobyte_has_modrm[256] = {
   /*	   0 1 2 3 4 5 6 7 8 9 a b c d e f	  */
   /*	   -------------------------------	  */
   /* 00 */ 1,1,1,1,0,0,0,0,0,0,0,0,0,1,0,1, /* 0f */
-  /* 10 */ 1,1,1,1,1,1,1,1,1,0,0,0,0,0,0,0, /* 1f */
+  /* 10 */ 1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1, /* 1f */
   /* 20 */ 1,1,1,1,1,0,1,0,1,1,1,1,1,1,1,1, /* 2f */
   /* 30 */ 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, /* 3f */
   /* 40 */ 1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1, /* 4f */
@@ -1166,80 +1139,60 @@ static const unsigned char twobyte_uses_SSE_prefix[256] = {
   /*	   0 1 2 3 4 5 6 7 8 9 a b c d e f	  */
 };
 
-static char obuf[100];
-static char *obufp;
-static char scratchbuf[100];
-static unsigned char *start_codep;
-static unsigned char *insn_codep;
-static unsigned char *codep;
-static disassemble_info *the_info;
-static int mod;
-static int rm;
-static int reg;
-static unsigned char need_modrm;
-
 /* If we are accessing mod/rm/reg without need_modrm set, then the
    values are stale.  Hitting this abort likely indicates that you
    need to update onebyte_has_modrm or twobyte_has_modrm.  */
-#define MODRM_CHECK  if (!need_modrm) abort ()
-
-static const char **names64;
-static const char **names32;
-static const char **names16;
-static const char **names8;
-static const char **names8rex;
-static const char **names_seg;
-static const char **index16;
+#define MODRM_CHECK  if (!ctx->need_modrm) abort ()
 
-static const char *intel_names64[] = {
+static const char *const intel_names64[] = {
   "rax", "rcx", "rdx", "rbx", "rsp", "rbp", "rsi", "rdi",
   "r8", "r9", "r10", "r11", "r12", "r13", "r14", "r15"
 };
-static const char *intel_names32[] = {
+static const char *const intel_names32[] = {
   "eax", "ecx", "edx", "ebx", "esp", "ebp", "esi", "edi",
   "r8d", "r9d", "r10d", "r11d", "r12d", "r13d", "r14d", "r15d"
 };
-static const char *intel_names16[] = {
+static const char *const intel_names16[] = {
   "ax", "cx", "dx", "bx", "sp", "bp", "si", "di",
   "r8w", "r9w", "r10w", "r11w", "r12w", "r13w", "r14w", "r15w"
 };
-static const char *intel_names8[] = {
+static const char *const intel_names8[] = {
   "al", "cl", "dl", "bl", "ah", "ch", "dh", "bh",
 };
-static const char *intel_names8rex[] = {
+static const char *const intel_names8rex[] = {
   "al", "cl", "dl", "bl", "spl", "bpl", "sil", "dil",
   "r8b", "r9b", "r10b", "r11b", "r12b", "r13b", "r14b", "r15b"
 };
-static const char *intel_names_seg[] = {
+static const char *const intel_names_seg[] = {
   "es", "cs", "ss", "ds", "fs", "gs", "?", "?",
 };
-static const char *intel_index16[] = {
+static const char *const intel_index16[] = {
   "bx+si", "bx+di", "bp+si", "bp+di", "si", "di", "bp", "bx"
 };
 
-static const char *att_names64[] = {
+static const char *const att_names64[] = {
   "%rax", "%rcx", "%rdx", "%rbx", "%rsp", "%rbp", "%rsi", "%rdi",
   "%r8", "%r9", "%r10", "%r11", "%r12", "%r13", "%r14", "%r15"
 };
-static const char *att_names32[] = {
+static const char *const att_names32[] = {
   "%eax", "%ecx", "%edx", "%ebx", "%esp", "%ebp", "%esi", "%edi",
   "%r8d", "%r9d", "%r10d", "%r11d", "%r12d", "%r13d", "%r14d", "%r15d"
 };
-static const char *att_names16[] = {
+static const char *const att_names16[] = {
   "%ax", "%cx", "%dx", "%bx", "%sp", "%bp", "%si", "%di",
   "%r8w", "%r9w", "%r10w", "%r11w", "%r12w", "%r13w", "%r14w", "%r15w"
 };
-static const char *att_names8[] = {
+static const char *const att_names8[] = {
   "%al", "%cl", "%dl", "%bl", "%ah", "%ch", "%dh", "%bh",
 };
-static const char *att_names8rex[] = {
+static const char *const att_names8rex[] = {
   "%al", "%cl", "%dl", "%bl", "%spl", "%bpl", "%sil", "%dil",
   "%r8b", "%r9b", "%r10b", "%r11b", "%r12b", "%r13b", "%r14b", "%r15b"
 };
-static const char *att_names_seg[] = {
+static const char *const att_names_seg[] = {
   "%es", "%cs", "%ss", "%ds", "%fs", "%gs", "%?", "%?",
 };
-static const char *att_index16[] = {
+static const char *const att_index16[] = {
   "%bx,%si", "%bx,%di", "%bp,%si", "%bp,%di", "%si", "%di", "%bp", "%bx"
 };
 
@@ -1769,18 +1722,18 @@ static const struct dis386 x86_64_table[][2] = {
 #endif	/* __KERNEL__ */
 
 static void
-ckprefix (void)
+ckprefix (struct x86_dis_ctx *ctx)
 {
   int newrex;
-  rex = 0;
-  prefixes = 0;
-  used_prefixes = 0;
-  rex_used = 0;
+  ctx->rex = 0;
+  ctx->prefixes = 0;
+  ctx->used_prefixes = 0;
+  ctx->rex_used = 0;
   while (1)
     {
-      FETCH_DATA (the_info, codep + 1);
+      FETCH_DATA (ctx, ctx->codep + 1);
       newrex = 0;
-      switch (*codep)
+      switch (*ctx->codep)
 	{
 	/* REX prefixes family.	 */
 	case 0x40:
@@ -1799,67 +1752,67 @@ ckprefix (void)
 	case 0x4d:
 	case 0x4e:
 	case 0x4f:
-	    if (mode_64bit)
-	      newrex = *codep;
+	    if (ctx->mode_64bit)
+	      newrex = *ctx->codep;
 	    else
 	      return;
 	  break;
 	case 0xf3:
-	  prefixes |= PREFIX_REPZ;
+	  ctx->prefixes |= PREFIX_REPZ;
 	  break;
 	case 0xf2:
-	  prefixes |= PREFIX_REPNZ;
+	  ctx->prefixes |= PREFIX_REPNZ;
 	  break;
 	case 0xf0:
-	  prefixes |= PREFIX_LOCK;
+	  ctx->prefixes |= PREFIX_LOCK;
 	  break;
 	case 0x2e:
-	  prefixes |= PREFIX_CS;
+	  ctx->prefixes |= PREFIX_CS;
 	  break;
 	case 0x36:
-	  prefixes |= PREFIX_SS;
+	  ctx->prefixes |= PREFIX_SS;
 	  break;
 	case 0x3e:
-	  prefixes |= PREFIX_DS;
+	  ctx->prefixes |= PREFIX_DS;
 	  break;
 	case 0x26:
-	  prefixes |= PREFIX_ES;
+	  ctx->prefixes |= PREFIX_ES;
 	  break;
 	case 0x64:
-	  prefixes |= PREFIX_FS;
+	  ctx->prefixes |= PREFIX_FS;
 	  break;
 	case 0x65:
-	  prefixes |= PREFIX_GS;
+	  ctx->prefixes |= PREFIX_GS;
 	  break;
 	case 0x66:
-	  prefixes |= PREFIX_DATA;
+	  ctx->prefixes |= PREFIX_DATA;
 	  break;
 	case 0x67:
-	  prefixes |= PREFIX_ADDR;
+	  ctx->prefixes |= PREFIX_ADDR;
 	  break;
 	case FWAIT_OPCODE:
 	  /* fwait is really an instruction.  If there are prefixes
 	     before the fwait, they belong to the fwait, *not* to the
 	     following instruction.  */
-	  if (prefixes)
+	  if (ctx->prefixes)
 	    {
-	      prefixes |= PREFIX_FWAIT;
-	      codep++;
+	      ctx->prefixes |= PREFIX_FWAIT;
+	      ctx->codep++;
 	      return;
 	    }
-	  prefixes = PREFIX_FWAIT;
+	  ctx->prefixes = PREFIX_FWAIT;
 	  break;
 	default:
 	  return;
 	}
       /* Rex is ignored when followed by another prefix.  */
-      if (rex)
+      if (ctx->rex && !ctx->decode_only)
 	{
-	  oappend (prefix_name (rex, 0));
-	  oappend (" ");
+	  oappend (ctx, prefix_name (ctx, ctx->rex, 0));
+	  oappend (ctx, " ");
 	}
-      rex = newrex;
-      codep++;
+      ctx->rex = newrex;
+      ctx->codep++;
     }
 }
 
@@ -1867,7 +1820,7 @@ ckprefix (void)
    prefix byte.	 */
 
 static const char *
-prefix_name (int pref, int sizeflag)
+prefix_name (struct x86_dis_ctx *ctx, int pref, int sizeflag)
 {
   switch (pref)
     {
@@ -1925,7 +1878,7 @@ prefix_name (int pref, int sizeflag)
     case 0x66:
       return (sizeflag & DFLAG) ? "data16" : "data32";
     case 0x67:
-      if (mode_64bit)
+      if (ctx->mode_64bit)
 	return (sizeflag & AFLAG) ? "addr32" : "addr64";
       else
 	return (sizeflag & AFLAG) ? "addr16" : "addr32";
@@ -1936,13 +1889,6 @@ prefix_name (int pref, int sizeflag)
     }
 }
 
-static char op1out[100], op2out[100], op3out[100];
-static int op_ad, op_index[3];
-static int two_source_ops;
-static bfd_vma op_address[3];
-static bfd_vma op_riprel[3];
-static bfd_vma start_pc;
-
 /*
  *   On the 386's of 1988, the maximum length of an instruction is 15 bytes.
  *   (see topic "Redundant prefixes" in the "Differences from 8086"
@@ -1952,65 +1898,85 @@ static bfd_vma start_pc;
  * The function returns the length of this instruction in bytes.
  */
 
-static char intel_syntax;
-static char open_char;
-static char close_char;
-static char separator_char;
-static char scale_char;
-
 /* Here for backwards compatibility.  When gdb stops using
    print_insn_i386_att and print_insn_i386_intel these functions can
    disappear, and print_insn_i386 be merged into print_insn.  */
 int
 print_insn_i386_att (bfd_vma pc, disassemble_info *info)
 {
-  intel_syntax = 0;
+  struct x86_dis_ctx ctx;
 
-  return print_insn (pc, info);
+  return print_insn_i386_att_ctx (&ctx, pc, info);
 }
 
 int
 print_insn_i386_intel (bfd_vma pc, disassemble_info *info)
 {
-  intel_syntax = 1;
+  struct x86_dis_ctx ctx;
 
-  return print_insn (pc, info);
+  return print_insn_i386_intel_ctx (&ctx, pc, info);
 }
 
 int
 print_insn_i386 (bfd_vma pc, disassemble_info *info)
 {
-  intel_syntax = -1;
+  struct x86_dis_ctx ctx;
 
-  return print_insn (pc, info);
+  return print_insn_i386_ctx (&ctx, pc, info);
 }
 
-static int
-print_insn (bfd_vma pc, disassemble_info *info)
+/* The same with the decoder state in CTX, which is owned by the caller
+   and must not be shared with another decode running at the same time.
+   Nothing in CTX needs to be set up beforehand.  */
+int
+print_insn_i386_att_ctx (struct x86_dis_ctx *ctx, bfd_vma pc,
+			 disassemble_info *info)
+{
+  ctx->intel_syntax = 0;
+
+  return print_insn (ctx, pc, info);
+}
+
+int
+print_insn_i386_intel_ctx (struct x86_dis_ctx *ctx, bfd_vma pc,
+			   disassemble_info *info)
+{
+  ctx->intel_syntax = 1;
+
+  return print_insn (ctx, pc, info);
+}
+
+int
+print_insn_i386_ctx (struct x86_dis_ctx *ctx, bfd_vma pc,
+		     disassemble_info *info)
+{
+  ctx->intel_syntax = -1;
+
+  return print_insn (ctx, pc, info);
+}
+
+/* Set the mode, syntax and default operand and address size for
+   INFO->mach and INFO->disassembler_options.  */
+
+static void
+set_mode (struct x86_dis_ctx *ctx, disassemble_info *info)
 {
-  const struct dis386 *dp;
-  int i;
-  char *first, *second, *third;
-  int needcomma;
-  unsigned char uses_SSE_prefix, uses_LOCK_prefix;
-  int sizeflag;
   const char *p;
-  struct dis_private priv;
 
-  mode_64bit = (info->mach == bfd_mach_x86_64_intel_syntax
+  ctx->mode_64bit = (info->mach == bfd_mach_x86_64_intel_syntax
 		|| info->mach == bfd_mach_x86_64);
 
-  if (intel_syntax == (char) -1)
-    intel_syntax = (info->mach == bfd_mach_i386_i386_intel_syntax
+  if (ctx->intel_syntax == (char) -1)
+    ctx->intel_syntax = (info->mach == bfd_mach_i386_i386_intel_syntax
 		    || info->mach == bfd_mach_x86_64_intel_syntax);
 
   if (info->mach == bfd_mach_i386_i386
       || info->mach == bfd_mach_x86_64
       || info->mach == bfd_mach_i386_i386_intel_syntax
       || info->mach == bfd_mach_x86_64_intel_syntax)
-    priv.orig_sizeflag = AFLAG | DFLAG;
+    ctx->orig_sizeflag = AFLAG | DFLAG;
   else if (info->mach == bfd_mach_i386_i8086)
-    priv.orig_sizeflag = 0;
+    ctx->orig_sizeflag = 0;
   else
     abort ();
 
@@ -2018,116 +1984,129 @@ print_insn (bfd_vma pc, disassemble_info *info)
     {
       if (strncmp (p, "x86-64", 6) == 0)
 	{
-	  mode_64bit = 1;
-	  priv.orig_sizeflag = AFLAG | DFLAG;
+	  ctx->mode_64bit = 1;
+	  ctx->orig_sizeflag = AFLAG | DFLAG;
 	}
       else if (strncmp (p, "i386", 4) == 0)
 	{
-	  mode_64bit = 0;
-	  priv.orig_sizeflag = AFLAG | DFLAG;
+	  ctx->mode_64bit = 0;
+	  ctx->orig_sizeflag = AFLAG | DFLAG;
 	}
       else if (strncmp (p, "i8086", 5) == 0)
 	{
-	  mode_64bit = 0;
-	  priv.orig_sizeflag = 0;
+	  ctx->mode_64bit = 0;
+	  ctx->orig_sizeflag = 0;
 	}
       else if (strncmp (p, "intel", 5) == 0)
 	{
-	  intel_syntax = 1;
+	  ctx->intel_syntax = 1;
 	}
       else if (strncmp (p, "att", 3) == 0)
 	{
-	  intel_syntax = 0;
+	  ctx->intel_syntax = 0;
 	}
       else if (strncmp (p, "addr", 4) == 0)
 	{
 	  if (p[4] == '1' && p[5] == '6')
-	    priv.orig_sizeflag &= ~AFLAG;
+	    ctx->orig_sizeflag &= ~AFLAG;
 	  else if (p[4] == '3' && p[5] == '2')
-	    priv.orig_sizeflag |= AFLAG;
+	    ctx->orig_sizeflag |= AFLAG;
 	}
       else if (strncmp (p, "data", 4) == 0)
 	{
 	  if (p[4] == '1' && p[5] == '6')
-	    priv.orig_sizeflag &= ~DFLAG;
+	    ctx->orig_sizeflag &= ~DFLAG;
 	  else if (p[4] == '3' && p[5] == '2')
-	    priv.orig_sizeflag |= DFLAG;
+	    ctx->orig_sizeflag |= DFLAG;
 	}
       else if (strncmp (p, "suffix", 6) == 0)
-	priv.orig_sizeflag |= SUFFIX_ALWAYS;
+	ctx->orig_sizeflag |= SUFFIX_ALWAYS;
 
       p = strchr (p, ',');
       if (p != NULL)
 	p++;
     }
+}
+
+static int
+print_insn (struct x86_dis_ctx *ctx, bfd_vma pc, disassemble_info *info)
+{
+  const struct dis386 *dp;
+  int i;
+  char *first, *second, *third;
+  int needcomma;
+  unsigned char uses_SSE_prefix, uses_LOCK_prefix;
+  int sizeflag;
+
+  ctx->decode_only = 0;
+  set_mode (ctx, info);
 
-  if (intel_syntax)
+  if (ctx->intel_syntax)
     {
-      names64 = intel_names64;
-      names32 = intel_names32;
-      names16 = intel_names16;
-      names8 = intel_names8;
-      names8rex = intel_names8rex;
-      names_seg = intel_names_seg;
-      index16 = intel_index16;
-      open_char = '[';
-      close_char = ']';
-      separator_char = '+';
-      scale_char = '*';
+      ctx->names64 = intel_names64;
+      ctx->names32 = intel_names32;
+      ctx->names16 = intel_names16;
+      ctx->names8 = intel_names8;
+      ctx->names8rex = intel_names8rex;
+      ctx->names_seg = intel_names_seg;
+      ctx->index16 = intel_index16;
+      ctx->open_char = '[';
+      ctx->close_char = ']';
+      ctx->separator_char = '+';
+      ctx->scale_char = '*';
     }
   else
     {
-      names64 = att_names64;
-      names32 = att_names32;
-      names16 = att_names16;
-      names8 = att_names8;
-      names8rex = att_names8rex;
-      names_seg = att_names_seg;
-      index16 = att_index16;
-      open_char = '(';
-      close_char =  ')';
-      separator_char = ',';
-      scale_char = ',';
+      ctx->names64 = att_names64;
+      ctx->names32 = att_names32;
+      ctx->names16 = att_names16;
+      ctx->names8 = att_names8;
+      ctx->names8rex = att_names8rex;
+      ctx->names_seg = att_names_seg;
+      ctx->index16 = att_index16;
+      ctx->open_char = '(';
+      ctx->close_char =  ')';
+      ctx->separator_char = ',';
+      ctx->scale_char = ',';
     }
 
   /* The output looks better if we put 7 bytes on a line, since that
      puts most long word instructions on a single line.	 */
   info->bytes_per_line = 7;
 
-  info->private_data = &priv;
-  priv.max_fetched = priv.the_buffer;
-  priv.insn_start = pc;
+  ctx->max_fetched = ctx->the_buffer;
+  ctx->insn_start = pc;
 
-  obuf[0] = 0;
-  op1out[0] = 0;
-  op2out[0] = 0;
-  op3out[0] = 0;
+  ctx->obuf[0] = 0;
+  ctx->op1out[0] = 0;
+  ctx->op2out[0] = 0;
+  ctx->op3out[0] = 0;
 
-  op_index[0] = op_index[1] = op_index[2] = -1;
+  ctx->op_index[0] = ctx->op_index[1] = ctx->op_index[2] = -1;
 
-  the_info = info;
-  start_pc = pc;
-  start_codep = priv.the_buffer;
-  codep = priv.the_buffer;
+  ctx->info = info;
+  ctx->start_pc = pc;
+  ctx->start_codep = ctx->the_buffer;
+  ctx->codep = ctx->the_buffer;
 
 #ifndef __KERNEL__
-  if (setjmp (priv.bailout) != 0)
+  if (setjmp (ctx->bailout) != 0)
     {
       const char *name;
 
       /* Getting here means we tried for data but didn't get it.  That
 	 means we have an incomplete instruction of some sort.	Just
 	 print the first byte as a prefix or a .byte pseudo-op.	 */
-      if (codep > priv.the_buffer)
+      if (ctx->codep > ctx->the_buffer)
 	{
-	  name = prefix_name (priv.the_buffer[0], priv.orig_sizeflag);
+	  name = prefix_name (ctx, ctx->the_buffer[0], ctx->orig_sizeflag);
 	  if (name != NULL)
 	    (*info->fprintf_func) (info->stream, "%s", name);
 	  else
 	    {
 	      /* Just print the first byte as a .byte instruction.  */
 	      (*info->fprintf_func) (info->stream, ".byte 0x%x",
-				     (unsigned int) priv.the_buffer[0]);
+				     (unsigned int) ctx->the_buffer[0]);
 	    }
 
 	  return 1;
@@ -2137,101 +2116,101 @@ print_insn (bfd_vma pc, disassemble_info *info)
     }
 #endif	/* __KERNEL__ */
 
-  obufp = obuf;
-  ckprefix ();
+  ctx->obufp = ctx->obuf;
+  ckprefix (ctx);
 
-  insn_codep = codep;
-  sizeflag = priv.orig_sizeflag;
+  ctx->insn_codep = ctx->codep;
+  sizeflag = ctx->orig_sizeflag;
 
-  FETCH_DATA (info, codep + 1);
-  two_source_ops = (*codep == 0x62) || (*codep == 0xc8);
+  FETCH_DATA (ctx, ctx->codep + 1);
+  ctx->two_source_ops = (*ctx->codep == 0x62) || (*ctx->codep == 0xc8);
 
-  if ((prefixes & PREFIX_FWAIT)
-      && ((*codep < 0xd8) || (*codep > 0xdf)))
+  if ((ctx->prefixes & PREFIX_FWAIT)
+      && ((*ctx->codep < 0xd8) || (*ctx->codep > 0xdf)))
     {
       const char *name;
 
       /* fwait not followed by floating point instruction.  Print the
 	 first prefix, which is probably fwait itself.	*/
-      name = prefix_name (priv.the_buffer[0], priv.orig_sizeflag);
+      name = prefix_name (ctx, ctx->the_buffer[0], ctx->orig_sizeflag);
       if (name == NULL)
 	name = INTERNAL_DISASSEMBLER_ERROR;
       (*info->fprintf_func) (info->stream, "%s", name);
       return 1;
     }
 
-  if (*codep == 0x0f)
+  if (*ctx->codep == 0x0f)
     {
-      FETCH_DATA (info, codep + 2);
-      dp = &dis386_twobyte[*++codep];
-      need_modrm = twobyte_has_modrm[*codep];
-      uses_SSE_prefix = twobyte_uses_SSE_prefix[*codep];
-      uses_LOCK_prefix = (*codep & ~0x02) == 0x20;
+      FETCH_DATA (ctx, ctx->codep + 2);
+      dp = &dis386_twobyte[*++ctx->codep];
+      ctx->need_modrm = twobyte_has_modrm[*ctx->codep];
+      uses_SSE_prefix = twobyte_uses_SSE_prefix[*ctx->codep];
+      uses_LOCK_prefix = (*ctx->codep & ~0x02) == 0x20;
     }
   else
     {
-      dp = &dis386[*codep];
-      need_modrm = onebyte_has_modrm[*codep];
+      dp = &dis386[*ctx->codep];
+      ctx->need_modrm = onebyte_has_modrm[*ctx->codep];
       uses_SSE_prefix = 0;
       uses_LOCK_prefix = 0;
     }
-  codep++;
+  ctx->codep++;
 
-  if (!uses_SSE_prefix && (prefixes & PREFIX_REPZ))
+  if (!uses_SSE_prefix && (ctx->prefixes & PREFIX_REPZ))
     {
-      oappend ("repz ");
-      used_prefixes |= PREFIX_REPZ;
+      oappend (ctx, "repz ");
+      ctx->used_prefixes |= PREFIX_REPZ;
     }
-  if (!uses_SSE_prefix && (prefixes & PREFIX_REPNZ))
+  if (!uses_SSE_prefix && (ctx->prefixes & PREFIX_REPNZ))
     {
-      oappend ("repnz ");
-      used_prefixes |= PREFIX_REPNZ;
+      oappend (ctx, "repnz ");
+      ctx->used_prefixes |= PREFIX_REPNZ;
     }
-  if (!uses_LOCK_prefix && (prefixes & PREFIX_LOCK))
+  if (!uses_LOCK_prefix && (ctx->prefixes & PREFIX_LOCK))
     {
-      oappend ("lock ");
-      used_prefixes |= PREFIX_LOCK;
+      oappend (ctx, "lock ");
+      ctx->used_prefixes |= PREFIX_LOCK;
     }
 
-  if (prefixes & PREFIX_ADDR)
+  if (ctx->prefixes & PREFIX_ADDR)
     {
       sizeflag ^= AFLAG;
-      if (dp->bytemode3 != loop_jcxz_mode || intel_syntax)
+      if (dp->bytemode3 != loop_jcxz_mode || ctx->intel_syntax)
 	{
-	  if ((sizeflag & AFLAG) || mode_64bit)
-	    oappend ("addr32 ");
+	  if ((sizeflag & AFLAG) || ctx->mode_64bit)
+	    oappend (ctx, "addr32 ");
 	  else
-	    oappend ("addr16 ");
-	  used_prefixes |= PREFIX_ADDR;
+	    oappend (ctx, "addr16 ");
+	  ctx->used_prefixes |= PREFIX_ADDR;
 	}
     }
 
-  if (!uses_SSE_prefix && (prefixes & PREFIX_DATA))
+  if (!uses_SSE_prefix && (ctx->prefixes & PREFIX_DATA))
     {
       sizeflag ^= DFLAG;
       if (dp->bytemode3 == cond_jump_mode
 	  && dp->bytemode1 == v_mode
-	  && !intel_syntax)
+	  && !ctx->intel_syntax)
 	{
 	  if (sizeflag & DFLAG)
-	    oappend ("data32 ");
+	    oappend (ctx, "data32 ");
 	  else
-	    oappend ("data16 ");
-	  used_prefixes |= PREFIX_DATA;
+	    oappend (ctx, "data16 ");
+	  ctx->used_prefixes |= PREFIX_DATA;
 	}
     }
 
-  if (need_modrm)
+  if (ctx->need_modrm)
     {
-      FETCH_DATA (info, codep + 1);
-      mod = (*codep >> 6) & 3;
-      reg = (*codep >> 3) & 7;
-      rm = *codep & 7;
+      FETCH_DATA (ctx, ctx->codep + 1);
+      ctx->mod = (*ctx->codep >> 6) & 3;
+      ctx->reg = (*ctx->codep >> 3) & 7;
+      ctx->rm = *ctx->codep & 7;
     }
 
   if (dp->name == NULL && dp->bytemode1 == FLOATCODE)
     {
-      dofloat (sizeflag);
+      dofloat (ctx, sizeflag);
     }
   else
     {
@@ -2241,23 +2220,23 @@ print_insn (bfd_vma pc, disassemble_info *info)
 	  switch (dp->bytemode1)
 	    {
 	    case USE_GROUPS:
-	      dp = &grps[dp->bytemode2][reg];
+	      dp = &grps[dp->bytemode2][ctx->reg];
 	      break;
 
 	    case USE_PREFIX_USER_TABLE:
 	      index = 0;
-	      used_prefixes |= (prefixes & PREFIX_REPZ);
-	      if (prefixes & PREFIX_REPZ)
+	      ctx->used_prefixes |= (ctx->prefixes & PREFIX_REPZ);
+	      if (ctx->prefixes & PREFIX_REPZ)
 		index = 1;
 	      else
 		{
-		  used_prefixes |= (prefixes & PREFIX_DATA);
-		  if (prefixes & PREFIX_DATA)
+		  ctx->used_prefixes |= (ctx->prefixes & PREFIX_DATA);
+		  if (ctx->prefixes & PREFIX_DATA)
 		    index = 2;
 		  else
 		    {
-		      used_prefixes |= (prefixes & PREFIX_REPNZ);
-		      if (prefixes & PREFIX_REPNZ)
+		      ctx->used_prefixes |= (ctx->prefixes & PREFIX_REPNZ);
+		      if (ctx->prefixes & PREFIX_REPNZ)
 			index = 3;
 		    }
 		}
@@ -2265,31 +2244,31 @@ print_insn (bfd_vma pc, disassemble_info *info)
 	      break;
 
 	    case X86_64_SPECIAL:
-	      dp = &x86_64_table[dp->bytemode2][mode_64bit];
+	      dp = &x86_64_table[dp->bytemode2][ctx->mode_64bit];
 	      break;
 
 	    default:
-	      oappend (INTERNAL_DISASSEMBLER_ERROR);
+	      oappend (ctx, INTERNAL_DISASSEMBLER_ERROR);
 	      break;
 	    }
 	}
 
-      if (putop (dp->name, sizeflag) == 0)
+      if (putop (ctx, dp->name, sizeflag) == 0)
 	{
-	  obufp = op1out;
-	  op_ad = 2;
+	  ctx->obufp = ctx->op1out;
+	  ctx->op_ad = 2;
 	  if (dp->op1)
-	    (*dp->op1) (dp->bytemode1, sizeflag);
+	    (*dp->op1) (ctx, dp->bytemode1, sizeflag);
 
-	  obufp = op2out;
-	  op_ad = 1;
+	  ctx->obufp = ctx->op2out;
+	  ctx->op_ad = 1;
 	  if (dp->op2)
-	    (*dp->op2) (dp->bytemode2, sizeflag);
+	    (*dp->op2) (ctx, dp->bytemode2, sizeflag);
 
-	  obufp = op3out;
-	  op_ad = 0;
+	  ctx->obufp = ctx->op3out;
+	  ctx->op_ad = 0;
 	  if (dp->op3)
-	    (*dp->op3) (dp->bytemode3, sizeflag);
+	    (*dp->op3) (ctx, dp->bytemode3, sizeflag);
 	}
     }
 
@@ -2297,53 +2276,54 @@ print_insn (bfd_vma pc, disassemble_info *info)
      separately.  If we don't do this, we'll wind up printing an
      instruction stream which does not precisely correspond to the
      bytes we are disassembling.  */
-  if ((prefixes & ~used_prefixes) != 0)
+  if ((ctx->prefixes & ~ctx->used_prefixes) != 0)
     {
       const char *name;
 
-      name = prefix_name (priv.the_buffer[0], priv.orig_sizeflag);
+      name = prefix_name (ctx, ctx->the_buffer[0], ctx->orig_sizeflag);
       if (name == NULL)
 	name = INTERNAL_DISASSEMBLER_ERROR;
       (*info->fprintf_func) (info->stream, "%s", name);
       return 1;
     }
-  if (rex & ~rex_used)
+  if (ctx->rex & ~ctx->rex_used)
     {
       const char *name;
-      name = prefix_name (rex | 0x40, priv.orig_sizeflag);
+      name = prefix_name (ctx, ctx->rex | 0x40, ctx->orig_sizeflag);
       if (name == NULL)
 	name = INTERNAL_DISASSEMBLER_ERROR;
       (*info->fprintf_func) (info->stream, "%s ", name);
     }
 
-  obufp = obuf + strlen (obuf);
-  for (i = strlen (obuf); i < 6; i++)
-    oappend (" ");
-  oappend (" ");
-  (*info->fprintf_func) (info->stream, "%s", obuf);
+  ctx->obufp = ctx->obuf + strlen (ctx->obuf);
+  for (i = strlen (ctx->obuf); i < 6; i++)
+    oappend (ctx, " ");
+  oappend (ctx, " ");
+  (*info->fprintf_func) (info->stream, "%s", ctx->obuf);
 
   /* The enter and bound instructions are printed with operands in the same
      order as the intel book; everything else is printed in reverse order.  */
-  if (intel_syntax || two_source_ops)
+  if (ctx->intel_syntax || ctx->two_source_ops)
     {
-      first = op1out;
-      second = op2out;
-      third = op3out;
-      op_ad = op_index[0];
-      op_index[0] = op_index[2];
-      op_index[2] = op_ad;
+      first = ctx->op1out;
+      second = ctx->op2out;
+      third = ctx->op3out;
+      ctx->op_ad = ctx->op_index[0];
+      ctx->op_index[0] = ctx->op_index[2];
+      ctx->op_index[2] = ctx->op_ad;
     }
   else
     {
-      first = op3out;
-      second = op2out;
-      third = op1out;
+      first = ctx->op3out;
+      second = ctx->op2out;
+      third = ctx->op1out;
     }
   needcomma = 0;
   if (*first)
     {
-      if (op_index[0] != -1 && !op_riprel[0])
-	(*info->print_address_func) ((bfd_vma) op_address[op_index[0]], info);
+      if (ctx->op_index[0] != -1 && !ctx->op_riprel[0])
+	(*info->print_address_func)
+	  ((bfd_vma) ctx->op_address[ctx->op_index[0]], info);
       else
 	(*info->fprintf_func) (info->stream, "%s", first);
       needcomma = 1;
@@ -2352,8 +2332,9 @@ print_insn (bfd_vma pc, disassemble_info *info)
     {
       if (needcomma)
 	(*info->fprintf_func) (info->stream, ",");
-      if (op_index[1] != -1 && !op_riprel[1])
-	(*info->print_address_func) ((bfd_vma) op_address[op_index[1]], info);
+      if (ctx->op_index[1] != -1 && !ctx->op_riprel[1])
+	(*info->print_address_func)
+	  ((bfd_vma) ctx->op_address[ctx->op_index[1]], info);
       else
 	(*info->fprintf_func) (info->stream, "%s", second);
       needcomma = 1;
@@ -2362,22 +2343,24 @@ print_insn (bfd_vma pc, disassemble_info *info)
     {
       if (needcomma)
 	(*info->fprintf_func) (info->stream, ",");
-      if (op_index[2] != -1 && !op_riprel[2])
-	(*info->print_address_func) ((bfd_vma) op_address[op_index[2]], info);
+      if (ctx->op_index[2] != -1 && !ctx->op_riprel[2])
+	(*info->print_address_func)
+	  ((bfd_vma) ctx->op_address[ctx->op_index[2]], info);
       else
 	(*info->fprintf_func) (info->stream, "%s", third);
     }
   for (i = 0; i < 3; i++)
-    if (op_index[i] != -1 && op_riprel[i])
+    if (ctx->op_index[i] != -1 && ctx->op_riprel[i])
       {
 	(*info->fprintf_func) (info->stream, "	      # ");
-	(*info->print_address_func) ((bfd_vma) (start_pc + codep - start_codep
-						+ op_address[op_index[i]]), info);
+	(*info->print_address_func)
+	  ((bfd_vma) (ctx->start_pc + ctx->codep - ctx->start_codep
+		      + ctx->op_address[ctx->op_index[i]]), info);
       }
-  return codep - priv.the_buffer;
+  return ctx->codep - ctx->the_buffer;
 }
 
-static const char *float_mem[] = {
+static const char *const float_mem[] = {
   /* d8 */
   "fadd{s||s|}",
   "fmul{s||s|}",
@@ -2645,7 +2628,7 @@ static const struct dis386 float_reg[][8] = {
   },
 };
 
-static char *fgrps[][8] = {
+static const char *const fgrps[][8] = {
   /* d9_2  0 */
   {
     "fnop","(bad)","(bad)","(bad)","(bad)","(bad)","(bad)","(bad)",
@@ -2694,64 +2677,69 @@ static char *fgrps[][8] = {
 };
 
 static void
-dofloat (int sizeflag)
+dofloat (struct x86_dis_ctx *ctx, int sizeflag)
 {
   const struct dis386 *dp;
   unsigned char floatop;
 
-  floatop = codep[-1];
+  floatop = ctx->codep[-1];
 
-  if (mod != 3)
+  if (ctx->mod != 3)
     {
-      int fp_indx = (floatop - 0xd8) * 8 + reg;
+      int fp_indx = (floatop - 0xd8) * 8 + ctx->reg;
 
-      putop (float_mem[fp_indx], sizeflag);
-      obufp = op1out;
-      OP_E (float_mem_mode[fp_indx], sizeflag);
+      putop (ctx, float_mem[fp_indx], sizeflag);
+      ctx->obufp = ctx->op1out;
+      ctx->op_ad = 2;
+      OP_E (ctx, float_mem_mode[fp_indx], sizeflag);
       return;
     }
   /* Skip mod/rm byte.	*/
   MODRM_CHECK;
-  codep++;
+  ctx->codep++;
 
-  dp = &float_reg[floatop - 0xd8][reg];
+  dp = &float_reg[floatop - 0xd8][ctx->reg];
   if (dp->name == NULL)
     {
-      putop (fgrps[dp->bytemode1][rm], sizeflag);
+      putop (ctx, fgrps[dp->bytemode1][ctx->rm], sizeflag);
 
       /* Instruction fnstsw is only one with strange arg.  */
-      if (floatop == 0xdf && codep[-1] == 0xe0)
-	strcpy (op1out, names16[0]);
+      if (floatop == 0xdf && ctx->codep[-1] == 0xe0)
+	strcpy (ctx->op1out, ctx->names16[0]);
     }
   else
     {
-      putop (dp->name, sizeflag);
+      putop (ctx, dp->name, sizeflag);
 
-      obufp = op1out;
+      ctx->obufp = ctx->op1out;
+      ctx->op_ad = 2;
       if (dp->op1)
-	(*dp->op1) (dp->bytemode1, sizeflag);
-      obufp = op2out;
+	(*dp->op1) (ctx, dp->bytemode1, sizeflag);
+      ctx->obufp = ctx->op2out;
+      ctx->op_ad = 1;
       if (dp->op2)
-	(*dp->op2) (dp->bytemode2, sizeflag);
+	(*dp->op2) (ctx, dp->bytemode2, sizeflag);
     }
 }
 
 static void
-OP_ST (int bytemode ATTRIBUTE_UNUSED, int sizeflag ATTRIBUTE_UNUSED)
+OP_ST (struct x86_dis_ctx *ctx,
+       int bytemode ATTRIBUTE_UNUSED, int sizeflag ATTRIBUTE_UNUSED)
 {
-  oappend ("%st");
+  oappend (ctx, "%st");
 }
 
 static void
-OP_STi (int bytemode ATTRIBUTE_UNUSED, int sizeflag ATTRIBUTE_UNUSED)
+OP_STi (struct x86_dis_ctx *ctx,
+	int bytemode ATTRIBUTE_UNUSED, int sizeflag ATTRIBUTE_UNUSED)
 {
-  sprintf (scratchbuf, "%%st(%d)", rm);
-  oappend (scratchbuf + intel_syntax);
+  sprintf (ctx->scratchbuf, "%%st(%d)", ctx->rm);
+  oappend (ctx, ctx->scratchbuf + ctx->intel_syntax);
 }
 
 /* Capital letters in template are macros.  */
 static int
-putop (const char *template, int sizeflag)
+putop (struct x86_dis_ctx *ctx, const char *template, int sizeflag)
 {
   const char *p;
   int alt = 0;
@@ -2761,13 +2749,13 @@ putop (const char *template, int sizeflag)
       switch (*p)
 	{
 	default:
-	  *obufp++ = *p;
+	  *ctx->obufp++ = *p;
 	  break;
 	case '{':
 	  alt = 0;
-	  if (intel_syntax)
+	  if (ctx->intel_syntax)
 	    alt += 1;
-	  if (mode_64bit)
+	  if (ctx->mode_64bit)
 	    alt += 2;
 	  while (alt != 0)
 	    {
@@ -2776,8 +2764,8 @@ putop (const char *template, int sizeflag)
 		  if (*p == '}')
 		    {
 		      /* Alternative not valid.	 */
-		      strcpy (obuf, "(bad)");
-		      obufp = obuf + 5;
+		      strcpy (ctx->obuf, "(bad)");
+		      ctx->obufp = ctx->obuf + 5;
 		      return 1;
 		    }
 		  else if (*p == '\0')
@@ -2799,305 +2787,305 @@ putop (const char *template, int sizeflag)
 	case '}':
 	  break;
 	case 'A':
-	  if (intel_syntax)
+	  if (ctx->intel_syntax)
 	    break;
-	  if (mod != 3 || (sizeflag & SUFFIX_ALWAYS))
-	    *obufp++ = 'b';
+	  if (ctx->mod != 3 || (sizeflag & SUFFIX_ALWAYS))
+	    *ctx->obufp++ = 'b';
 	  break;
 	case 'B':
-	  if (intel_syntax)
+	  if (ctx->intel_syntax)
 	    break;
 	  if (sizeflag & SUFFIX_ALWAYS)
-	    *obufp++ = 'b';
+	    *ctx->obufp++ = 'b';
 	  break;
 	case 'C':
-	  if (intel_syntax && !alt)
+	  if (ctx->intel_syntax && !alt)
 	    break;
-	  if ((prefixes & PREFIX_DATA) || (sizeflag & SUFFIX_ALWAYS))
+	  if ((ctx->prefixes & PREFIX_DATA) || (sizeflag & SUFFIX_ALWAYS))
 	    {
 	      if (sizeflag & DFLAG)
-		*obufp++ = intel_syntax ? 'd' : 'l';
+		*ctx->obufp++ = ctx->intel_syntax ? 'd' : 'l';
 	      else
-		*obufp++ = intel_syntax ? 'w' : 's';
-	      used_prefixes |= (prefixes & PREFIX_DATA);
+		*ctx->obufp++ = ctx->intel_syntax ? 'w' : 's';
+	      ctx->used_prefixes |= (ctx->prefixes & PREFIX_DATA);
 	    }
 	  break;
 	case 'E':		/* For jcxz/jecxz */
-	  if (mode_64bit)
+	  if (ctx->mode_64bit)
 	    {
 	      if (sizeflag & AFLAG)
-		*obufp++ = 'r';
+		*ctx->obufp++ = 'r';
 	      else
-		*obufp++ = 'e';
+		*ctx->obufp++ = 'e';
 	    }
 	  else
 	    if (sizeflag & AFLAG)
-	      *obufp++ = 'e';
-	  used_prefixes |= (prefixes & PREFIX_ADDR);
+	      *ctx->obufp++ = 'e';
+	  ctx->used_prefixes |= (ctx->prefixes & PREFIX_ADDR);
 	  break;
 	case 'F':
-	  if (intel_syntax)
+	  if (ctx->intel_syntax)
 	    break;
-	  if ((prefixes & PREFIX_ADDR) || (sizeflag & SUFFIX_ALWAYS))
+	  if ((ctx->prefixes & PREFIX_ADDR) || (sizeflag & SUFFIX_ALWAYS))
 	    {
 	      if (sizeflag & AFLAG)
-		*obufp++ = mode_64bit ? 'q' : 'l';
+		*ctx->obufp++ = ctx->mode_64bit ? 'q' : 'l';
 	      else
-		*obufp++ = mode_64bit ? 'l' : 'w';
-	      used_prefixes |= (prefixes & PREFIX_ADDR);
+		*ctx->obufp++ = ctx->mode_64bit ? 'l' : 'w';
+	      ctx->used_prefixes |= (ctx->prefixes & PREFIX_ADDR);
 	    }
 	  break;
 	case 'H':
-	  if (intel_syntax)
+	  if (ctx->intel_syntax)
 	    break;
-	  if ((prefixes & (PREFIX_CS | PREFIX_DS)) == PREFIX_CS
-	      || (prefixes & (PREFIX_CS | PREFIX_DS)) == PREFIX_DS)
+	  if ((ctx->prefixes & (PREFIX_CS | PREFIX_DS)) == PREFIX_CS
+	      || (ctx->prefixes & (PREFIX_CS | PREFIX_DS)) == PREFIX_DS)
 	    {
-	      used_prefixes |= prefixes & (PREFIX_CS | PREFIX_DS);
-	      *obufp++ = ',';
-	      *obufp++ = 'p';
-	      if (prefixes & PREFIX_DS)
-		*obufp++ = 't';
+	      ctx->used_prefixes |= ctx->prefixes & (PREFIX_CS | PREFIX_DS);
+	      *ctx->obufp++ = ',';
+	      *ctx->obufp++ = 'p';
+	      if (ctx->prefixes & PREFIX_DS)
+		*ctx->obufp++ = 't';
 	      else
-		*obufp++ = 'n';
+		*ctx->obufp++ = 'n';
 	    }
 	  break;
 	case 'J':
-	  if (intel_syntax)
+	  if (ctx->intel_syntax)
 	    break;
-	  *obufp++ = 'l';
+	  *ctx->obufp++ = 'l';
 	  break;
 	case 'L':
-	  if (intel_syntax)
+	  if (ctx->intel_syntax)
 	    break;
 	  if (sizeflag & SUFFIX_ALWAYS)
-	    *obufp++ = 'l';
+	    *ctx->obufp++ = 'l';
 	  break;
 	case 'N':
-	  if ((prefixes & PREFIX_FWAIT) == 0)
-	    *obufp++ = 'n';
+	  if ((ctx->prefixes & PREFIX_FWAIT) == 0)
+	    *ctx->obufp++ = 'n';
 	  else
-	    used_prefixes |= PREFIX_FWAIT;
+	    ctx->used_prefixes |= PREFIX_FWAIT;
 	  break;
 	case 'O':
 	  USED_REX (REX_MODE64);
-	  if (rex & REX_MODE64)
-	    *obufp++ = 'o';
+	  if (ctx->rex & REX_MODE64)
+	    *ctx->obufp++ = 'o';
 	  else
-	    *obufp++ = 'd';
+	    *ctx->obufp++ = 'd';
 	  break;
 	case 'T':
-	  if (intel_syntax)
+	  if (ctx->intel_syntax)
 	    break;
-	  if (mode_64bit)
+	  if (ctx->mode_64bit)
 	    {
-	      *obufp++ = 'q';
+	      *ctx->obufp++ = 'q';
 	      break;
 	    }
 	  /* Fall through.  */
 	case 'P':
-	  if (intel_syntax)
+	  if (ctx->intel_syntax)
 	    break;
-	  if ((prefixes & PREFIX_DATA)
-	      || (rex & REX_MODE64)
+	  if ((ctx->prefixes & PREFIX_DATA)
+	      || (ctx->rex & REX_MODE64)
 	      || (sizeflag & SUFFIX_ALWAYS))
 	    {
 	      USED_REX (REX_MODE64);
-	      if (rex & REX_MODE64)
-		*obufp++ = 'q';
+	      if (ctx->rex & REX_MODE64)
+		*ctx->obufp++ = 'q';
 	      else
 		{
 		   if (sizeflag & DFLAG)
-		      *obufp++ = 'l';
+		      *ctx->obufp++ = 'l';
 		   else
-		     *obufp++ = 'w';
-		   used_prefixes |= (prefixes & PREFIX_DATA);
+		     *ctx->obufp++ = 'w';
+		   ctx->used_prefixes |= (ctx->prefixes & PREFIX_DATA);
 		}
 	    }
 	  break;
 	case 'U':
-	  if (intel_syntax)
+	  if (ctx->intel_syntax)
 	    break;
-	  if (mode_64bit)
+	  if (ctx->mode_64bit)
 	    {
-	      *obufp++ = 'q';
+	      *ctx->obufp++ = 'q';
 	      break;
 	    }
 	  /* Fall through.  */
 	case 'Q':
-	  if (intel_syntax && !alt)
+	  if (ctx->intel_syntax && !alt)
 	    break;
 	  USED_REX (REX_MODE64);
-	  if (mod != 3 || (sizeflag & SUFFIX_ALWAYS))
+	  if (ctx->mod != 3 || (sizeflag & SUFFIX_ALWAYS))
 	    {
-	      if (rex & REX_MODE64)
-		*obufp++ = 'q';
+	      if (ctx->rex & REX_MODE64)
+		*ctx->obufp++ = 'q';
 	      else
 		{
 		  if (sizeflag & DFLAG)
-		    *obufp++ = intel_syntax ? 'd' : 'l';
+		    *ctx->obufp++ = ctx->intel_syntax ? 'd' : 'l';
 		  else
-		    *obufp++ = 'w';
-		  used_prefixes |= (prefixes & PREFIX_DATA);
+		    *ctx->obufp++ = 'w';
+		  ctx->used_prefixes |= (ctx->prefixes & PREFIX_DATA);
 		}
 	    }
 	  break;
 	case 'R':
 	  USED_REX (REX_MODE64);
-	  if (intel_syntax)
+	  if (ctx->intel_syntax)
 	    {
-	      if (rex & REX_MODE64)
+	      if (ctx->rex & REX_MODE64)
 		{
-		  *obufp++ = 'q';
-		  *obufp++ = 't';
+		  *ctx->obufp++ = 'q';
+		  *ctx->obufp++ = 't';
 		}
 	      else if (sizeflag & DFLAG)
 		{
-		  *obufp++ = 'd';
-		  *obufp++ = 'q';
+		  *ctx->obufp++ = 'd';
+		  *ctx->obufp++ = 'q';
 		}
 	      else
 		{
-		  *obufp++ = 'w';
-		  *obufp++ = 'd';
+		  *ctx->obufp++ = 'w';
+		  *ctx->obufp++ = 'd';
 		}
 	    }
 	  else
 	    {
-	      if (rex & REX_MODE64)
-		*obufp++ = 'q';
+	      if (ctx->rex & REX_MODE64)
+		*ctx->obufp++ = 'q';
 	      else if (sizeflag & DFLAG)
-		*obufp++ = 'l';
+		*ctx->obufp++ = 'l';
 	      else
-		*obufp++ = 'w';
+		*ctx->obufp++ = 'w';
 	    }
-	  if (!(rex & REX_MODE64))
-	    used_prefixes |= (prefixes & PREFIX_DATA);
+	  if (!(ctx->rex & REX_MODE64))
+	    ctx->used_prefixes |= (ctx->prefixes & PREFIX_DATA);
 	  break;
 	case 'S':
-	  if (intel_syntax)
+	  if (ctx->intel_syntax)
 	    break;
 	  if (sizeflag & SUFFIX_ALWAYS)
 	    {
-	      if (rex & REX_MODE64)
-		*obufp++ = 'q';
+	      if (ctx->rex & REX_MODE64)
+		*ctx->obufp++ = 'q';
 	      else
 		{
 		  if (sizeflag & DFLAG)
-		    *obufp++ = 'l';
+		    *ctx->obufp++ = 'l';
 		  else
-		    *obufp++ = 'w';
-		  used_prefixes |= (prefixes & PREFIX_DATA);
+		    *ctx->obufp++ = 'w';
+		  ctx->used_prefixes |= (ctx->prefixes & PREFIX_DATA);
 		}
 	    }
 	  break;
 	case 'X':
-	  if (prefixes & PREFIX_DATA)
-	    *obufp++ = 'd';
+	  if (ctx->prefixes & PREFIX_DATA)
+	    *ctx->obufp++ = 'd';
 	  else
-	    *obufp++ = 's';
-	  used_prefixes |= (prefixes & PREFIX_DATA);
+	    *ctx->obufp++ = 's';
+	  ctx->used_prefixes |= (ctx->prefixes & PREFIX_DATA);
 	  break;
 	case 'Y':
-	  if (intel_syntax)
+	  if (ctx->intel_syntax)
 	    break;
-	  if (rex & REX_MODE64)
+	  if (ctx->rex & REX_MODE64)
 	    {
 	      USED_REX (REX_MODE64);
-	      *obufp++ = 'q';
+	      *ctx->obufp++ = 'q';
 	    }
 	  break;
 	  /* implicit operand size 'l' for i386 or 'q' for x86-64 */
 	case 'W':
 	  /* operand size flag for cwtl, cbtw */
 	  USED_REX (0);
-	  if (rex)
-	    *obufp++ = 'l';
+	  if (ctx->rex)
+	    *ctx->obufp++ = 'l';
 	  else if (sizeflag & DFLAG)
-	    *obufp++ = 'w';
+	    *ctx->obufp++ = 'w';
 	  else
-	    *obufp++ = 'b';
-	  if (intel_syntax)
+	    *ctx->obufp++ = 'b';
+	  if (ctx->intel_syntax)
 	    {
-	      if (rex)
+	      if (ctx->rex)
 		{
-		  *obufp++ = 'q';
-		  *obufp++ = 'e';
+		  *ctx->obufp++ = 'q';
+		  *ctx->obufp++ = 'e';
 		}
 	      if (sizeflag & DFLAG)
 		{
-		  *obufp++ = 'd';
-		  *obufp++ = 'e';
+		  *ctx->obufp++ = 'd';
+		  *ctx->obufp++ = 'e';
 		}
 	      else
 		{
-		  *obufp++ = 'w';
+		  *ctx->obufp++ = 'w';
 		}
 	    }
-	  if (!rex)
-	    used_prefixes |= (prefixes & PREFIX_DATA);
+	  if (!ctx->rex)
+	    ctx->used_prefixes |= (ctx->prefixes & PREFIX_DATA);
 	  break;
 	}
       alt = 0;
     }
-  *obufp = 0;
+  *ctx->obufp = 0;
   return 0;
 }
 
 static void
-oappend (const char *s)
+oappend (struct x86_dis_ctx *ctx, const char *s)
 {
-  strcpy (obufp, s);
-  obufp += strlen (s);
+  strcpy (ctx->obufp, s);
+  ctx->obufp += strlen (s);
 }
 
 static void
-append_seg (void)
+append_seg (struct x86_dis_ctx *ctx)
 {
-  if (prefixes & PREFIX_CS)
+  if (ctx->prefixes & PREFIX_CS)
     {
-      used_prefixes |= PREFIX_CS;
-      oappend ("%cs:" + intel_syntax);
+      ctx->used_prefixes |= PREFIX_CS;
+      oappend (ctx, "%cs:" + ctx->intel_syntax);
     }
-  if (prefixes & PREFIX_DS)
+  if (ctx->prefixes & PREFIX_DS)
     {
-      used_prefixes |= PREFIX_DS;
-      oappend ("%ds:" + intel_syntax);
+      ctx->used_prefixes |= PREFIX_DS;
+      oappend (ctx, "%ds:" + ctx->intel_syntax);
     }
-  if (prefixes & PREFIX_SS)
+  if (ctx->prefixes & PREFIX_SS)
     {
-      used_prefixes |= PREFIX_SS;
-      oappend ("%ss:" + intel_syntax);
+      ctx->used_prefixes |= PREFIX_SS;
+      oappend (ctx, "%ss:" + ctx->intel_syntax);
     }
-  if (prefixes & PREFIX_ES)
+  if (ctx->prefixes & PREFIX_ES)
     {
-      used_prefixes |= PREFIX_ES;
-      oappend ("%es:" + intel_syntax);
+      ctx->used_prefixes |= PREFIX_ES;
+      oappend (ctx, "%es:" + ctx->intel_syntax);
     }
-  if (prefixes & PREFIX_FS)
+  if (ctx->prefixes & PREFIX_FS)
     {
-      used_prefixes |= PREFIX_FS;
-      oappend ("%fs:" + intel_syntax);
+      ctx->used_prefixes |= PREFIX_FS;
+      oappend (ctx, "%fs:" + ctx->intel_syntax);
     }
-  if (prefixes & PREFIX_GS)
+  if (ctx->prefixes & PREFIX_GS)
     {
-      used_prefixes |= PREFIX_GS;
-      oappend ("%gs:" + intel_syntax);
+      ctx->used_prefixes |= PREFIX_GS;
+      oappend (ctx, "%gs:" + ctx->intel_syntax);
     }
 }
 
 static void
-OP_indirE (int bytemode, int sizeflag)
+OP_indirE (struct x86_dis_ctx *ctx, int bytemode, int sizeflag)
 {
-  if (!intel_syntax)
-    oappend ("*");
-  OP_E (bytemode, sizeflag);
+  if (!ctx->intel_syntax)
+    oappend (ctx, "*");
+  OP_E (ctx, bytemode, sizeflag);
 }
 
 static void
-print_operand_value (char *buf, int hex, bfd_vma disp)
+print_operand_value (struct x86_dis_ctx *ctx, char *buf, int hex, bfd_vma disp)
 {
-  if (mode_64bit)
+  if (ctx->mode_64bit)
     {
       if (hex)
 	{
@@ -3152,82 +3140,82 @@ print_operand_value (char *buf, int hex, bfd_vma disp)
 }
 
 static void
-OP_E (int bytemode, int sizeflag)
+OP_E (struct x86_dis_ctx *ctx, int bytemode, int sizeflag)
 {
   bfd_vma disp;
   int add = 0;
   int riprel = 0;
   USED_REX (REX_EXTZ);
-  if (rex & REX_EXTZ)
+  if (ctx->rex & REX_EXTZ)
     add += 8;
 
   /* Skip mod/rm byte.	*/
   MODRM_CHECK;
-  codep++;
+  ctx->codep++;
 
-  if (mod == 3)
+  if (ctx->mod == 3)
     {
       switch (bytemode)
 	{
 	case b_mode:
 	  USED_REX (0);
-	  if (rex)
-	    oappend (names8rex[rm + add]);
+	  if (ctx->rex)
+	    oappend (ctx, ctx->names8rex[ctx->rm + add]);
 	  else
-	    oappend (names8[rm + add]);
+	    oappend (ctx, ctx->names8[ctx->rm + add]);
 	  break;
 	case w_mode:
-	  oappend (names16[rm + add]);
+	  oappend (ctx, ctx->names16[ctx->rm + add]);
 	  break;
 	case d_mode:
-	  oappend (names32[rm + add]);
+	  oappend (ctx, ctx->names32[ctx->rm + add]);
 	  break;
 	case q_mode:
-	  oappend (names64[rm + add]);
+	  oappend (ctx, ctx->names64[ctx->rm + add]);
 	  break;
 	case m_mode:
-	  if (mode_64bit)
-	    oappend (names64[rm + add]);
+	  if (ctx->mode_64bit)
+	    oappend (ctx, ctx->names64[ctx->rm + add]);
 	  else
-	    oappend (names32[rm + add]);
+	    oappend (ctx, ctx->names32[ctx->rm + add]);
 	  break;
 	case branch_v_mode:
-	  if (mode_64bit)
-	    oappend (names64[rm + add]);
+	  if (ctx->mode_64bit)
+	    oappend (ctx, ctx->names64[ctx->rm + add]);
 	  else
 	    {
 	      if ((sizeflag & DFLAG) || bytemode != branch_v_mode)
-		oappend (names32[rm + add]);
+		oappend (ctx, ctx->names32[ctx->rm + add]);
 	      else
-		oappend (names16[rm + add]);
-	      used_prefixes |= (prefixes & PREFIX_DATA);
+		oappend (ctx, ctx->names16[ctx->rm + add]);
+	      ctx->used_prefixes |= (ctx->prefixes & PREFIX_DATA);
 	    }
 	  break;
 	case v_mode:
 	case dq_mode:
 	case dqw_mode:
 	  USED_REX (REX_MODE64);
-	  if (rex & REX_MODE64)
-	    oappend (names64[rm + add]);
+	  if (ctx->rex & REX_MODE64)
+	    oappend (ctx, ctx->names64[ctx->rm + add]);
 	  else if ((sizeflag & DFLAG) || bytemode != v_mode)
-	    oappend (names32[rm + add]);
+	    oappend (ctx, ctx->names32[ctx->rm + add]);
 	  else
-	    oappend (names16[rm + add]);
-	  used_prefixes |= (prefixes & PREFIX_DATA);
+	    oappend (ctx, ctx->names16[ctx->rm + add]);
+	  ctx->used_prefixes |= (ctx->prefixes & PREFIX_DATA);
 	  break;
 	case 0:
 	  break;
 	default:
-	  oappend (INTERNAL_DISASSEMBLER_ERROR);
+	  oappend (ctx, INTERNAL_DISASSEMBLER_ERROR);
 	  break;
 	}
       return;
     }
 
   disp = 0;
-  append_seg ();
+  append_seg (ctx);
 
-  if ((sizeflag & AFLAG) || mode_64bit) /* 32 bit address mode */
+  if ((sizeflag & AFLAG) || ctx->mode_64bit) /* 32 bit address mode */
     {
       int havesib;
       int havebase;
@@ -3237,319 +3225,319 @@ OP_E (int bytemode, int sizeflag)
 
       havesib = 0;
       havebase = 1;
-      base = rm;
+      base = ctx->rm;
 
       if (base == 4)
 	{
 	  havesib = 1;
-	  FETCH_DATA (the_info, codep + 1);
-	  index = (*codep >> 3) & 7;
-	  if (mode_64bit || index != 0x4)
+	  FETCH_DATA (ctx, ctx->codep + 1);
+	  index = (*ctx->codep >> 3) & 7;
+	  if (ctx->mode_64bit || index != 0x4)
 	    /* When INDEX == 0x4 in 32 bit mode, SCALE is ignored.  */
-	    scale = (*codep >> 6) & 3;
-	  base = *codep & 7;
+	    scale = (*ctx->codep >> 6) & 3;
+	  base = *ctx->codep & 7;
 	  USED_REX (REX_EXTY);
-	  if (rex & REX_EXTY)
+	  if (ctx->rex & REX_EXTY)
 	    index += 8;
-	  codep++;
+	  ctx->codep++;
 	}
       base += add;
 
-      switch (mod)
+      switch (ctx->mod)
 	{
 	case 0:
 	  if ((base & 7) == 5)
 	    {
 	      havebase = 0;
-	      if (mode_64bit && !havesib)
+	      if (ctx->mode_64bit && !havesib)
 		riprel = 1;
-	      disp = get32s ();
+	      disp = get32s (ctx);
 	    }
 	  break;
 	case 1:
-	  FETCH_DATA (the_info, codep + 1);
-	  disp = *codep++;
+	  FETCH_DATA (ctx, ctx->codep + 1);
+	  disp = *ctx->codep++;
 	  if ((disp & 0x80) != 0)
 	    disp -= 0x100;
 	  break;
 	case 2:
-	  disp = get32s ();
+	  disp = get32s (ctx);
 	  break;
 	}
 
-      if (!intel_syntax)
-	if (mod != 0 || (base & 7) == 5)
+      if (!ctx->intel_syntax)
+	if (ctx->mod != 0 || (base & 7) == 5)
 	  {
-	    print_operand_value (scratchbuf, !riprel, disp);
-	    oappend (scratchbuf);
+	    print_operand_value (ctx, ctx->scratchbuf, !riprel, disp);
+	    oappend (ctx, ctx->scratchbuf);
 	    if (riprel)
 	      {
-		set_op (disp, 1);
-		oappend ("(%rip)");
+		set_op (ctx, disp, 1);
+		oappend (ctx, "(%rip)");
 	      }
 	  }
 
       if (havebase || (havesib && (index != 4 || scale != 0)))
 	{
-	  if (intel_syntax)
+	  if (ctx->intel_syntax)
 	    {
 	      switch (bytemode)
 		{
 		case b_mode:
-		  oappend ("BYTE PTR ");
+		  oappend (ctx, "BYTE PTR ");
 		  break;
 		case w_mode:
 		case dqw_mode:
-		  oappend ("WORD PTR ");
+		  oappend (ctx, "WORD PTR ");
 		  break;
 		case branch_v_mode:
 		case v_mode:
 		case dq_mode:
 		  USED_REX (REX_MODE64);
-		  if (rex & REX_MODE64)
-		    oappend ("QWORD PTR ");
+		  if (ctx->rex & REX_MODE64)
+		    oappend (ctx, "QWORD PTR ");
 		  else if ((sizeflag & DFLAG) || bytemode == dq_mode)
-		    oappend ("DWORD PTR ");
+		    oappend (ctx, "DWORD PTR ");
 		  else
-		    oappend ("WORD PTR ");
-		  used_prefixes |= (prefixes & PREFIX_DATA);
+		    oappend (ctx, "WORD PTR ");
+		  ctx->used_prefixes |= (ctx->prefixes & PREFIX_DATA);
 		  break;
 		case d_mode:
-		  oappend ("DWORD PTR ");
+		  oappend (ctx, "DWORD PTR ");
 		  break;
 		case q_mode:
-		  oappend ("QWORD PTR ");
+		  oappend (ctx, "QWORD PTR ");
 		  break;
 		case m_mode:
-		  if (mode_64bit)
-		    oappend ("QWORD PTR ");
+		  if (ctx->mode_64bit)
+		    oappend (ctx, "QWORD PTR ");
 		  else
-		    oappend ("DWORD PTR ");
+		    oappend (ctx, "DWORD PTR ");
 		  break;
 		case f_mode:
 		  if (sizeflag & DFLAG)
 		    {
-		      used_prefixes |= (prefixes & PREFIX_DATA);
-		      oappend ("FWORD PTR ");
+		      ctx->used_prefixes |= (ctx->prefixes & PREFIX_DATA);
+		      oappend (ctx, "FWORD PTR ");
 		    }
 		  else
-		    oappend ("DWORD PTR ");
+		    oappend (ctx, "DWORD PTR ");
 		  break;
 		case t_mode:
-		  oappend ("TBYTE PTR ");
+		  oappend (ctx, "TBYTE PTR ");
 		  break;
 		case x_mode:
-		  oappend ("XMMWORD PTR ");
+		  oappend (ctx, "XMMWORD PTR ");
 		  break;
 		default:
 		  break;
 		}
 	    }
-	  *obufp++ = open_char;
-	  if (intel_syntax && riprel)
-	    oappend ("rip + ");
-	  *obufp = '\0';
+	  *ctx->obufp++ = ctx->open_char;
+	  if (ctx->intel_syntax && riprel)
+	    oappend (ctx, "rip + ");
+	  *ctx->obufp = '\0';
 	  if (havebase)
-	    oappend (mode_64bit && (sizeflag & AFLAG)
-		     ? names64[base] : names32[base]);
+	    oappend (ctx, ctx->mode_64bit && (sizeflag & AFLAG)
+		     ? ctx->names64[base] : ctx->names32[base]);
 	  if (havesib)
 	    {
 	      if (index != 4)
 		{
-		  if (!intel_syntax || havebase)
+		  if (!ctx->intel_syntax || havebase)
 		    {
-		      *obufp++ = separator_char;
-		      *obufp = '\0';
+		      *ctx->obufp++ = ctx->separator_char;
+		      *ctx->obufp = '\0';
 		    }
-		  oappend (mode_64bit && (sizeflag & AFLAG)
-			   ? names64[index] : names32[index]);
+		  oappend (ctx, ctx->mode_64bit && (sizeflag & AFLAG)
+			   ? ctx->names64[index] : ctx->names32[index]);
 		}
-	      if (scale != 0 || (!intel_syntax && index != 4))
+	      if (scale != 0 || (!ctx->intel_syntax && index != 4))
 		{
-		  *obufp++ = scale_char;
-		  *obufp = '\0';
-		  sprintf (scratchbuf, "%d", 1 << scale);
-		  oappend (scratchbuf);
+		  *ctx->obufp++ = ctx->scale_char;
+		  *ctx->obufp = '\0';
+		  sprintf (ctx->scratchbuf, "%d", 1 << scale);
+		  oappend (ctx, ctx->scratchbuf);
 		}
 	    }
-	  if (intel_syntax && disp)
+	  if (ctx->intel_syntax && disp)
 	    {
 	      if ((bfd_signed_vma) disp > 0)
 		{
-		  *obufp++ = '+';
-		  *obufp = '\0';
+		  *ctx->obufp++ = '+';
+		  *ctx->obufp = '\0';
 		}
-	      else if (mod != 1)
+	      else if (ctx->mod != 1)
 		{
-		  *obufp++ = '-';
-		  *obufp = '\0';
+		  *ctx->obufp++ = '-';
+		  *ctx->obufp = '\0';
 		  disp = - (bfd_signed_vma) disp;
 		}
 
-	      print_operand_value (scratchbuf, mod != 1, disp);
-	      oappend (scratchbuf);
+	      print_operand_value (ctx, ctx->scratchbuf, ctx->mod != 1, disp);
+	      oappend (ctx, ctx->scratchbuf);
 	    }
 
-	  *obufp++ = close_char;
-	  *obufp = '\0';
+	  *ctx->obufp++ = ctx->close_char;
+	  *ctx->obufp = '\0';
 	}
-      else if (intel_syntax)
+      else if (ctx->intel_syntax)
 	{
-	  if (mod != 0 || (base & 7) == 5)
+	  if (ctx->mod != 0 || (base & 7) == 5)
 	    {
-	      if (prefixes & (PREFIX_CS | PREFIX_SS | PREFIX_DS
+	      if (ctx->prefixes & (PREFIX_CS | PREFIX_SS | PREFIX_DS
 			      | PREFIX_ES | PREFIX_FS | PREFIX_GS))
 		;
 	      else
 		{
-		  oappend (names_seg[ds_reg - es_reg]);
-		  oappend (":");
+		  oappend (ctx, ctx->names_seg[ds_reg - es_reg]);
+		  oappend (ctx, ":");
 		}
-	      print_operand_value (scratchbuf, 1, disp);
-	      oappend (scratchbuf);
+	      print_operand_value (ctx, ctx->scratchbuf, 1, disp);
+	      oappend (ctx, ctx->scratchbuf);
 	    }
 	}
     }
   else
     { /* 16 bit address mode */
-      switch (mod)
+      switch (ctx->mod)
 	{
 	case 0:
-	  if (rm == 6)
+	  if (ctx->rm == 6)
 	    {
-	      disp = get16 ();
+	      disp = get16 (ctx);
 	      if ((disp & 0x8000) != 0)
 		disp -= 0x10000;
 	    }
 	  break;
 	case 1:
-	  FETCH_DATA (the_info, codep + 1);
-	  disp = *codep++;
+	  FETCH_DATA (ctx, ctx->codep + 1);
+	  disp = *ctx->codep++;
 	  if ((disp & 0x80) != 0)
 	    disp -= 0x100;
 	  break;
 	case 2:
-	  disp = get16 ();
+	  disp = get16 (ctx);
 	  if ((disp & 0x8000) != 0)
 	    disp -= 0x10000;
 	  break;
 	}
 
-      if (!intel_syntax)
-	if (mod != 0 || rm == 6)
+      if (!ctx->intel_syntax)
+	if (ctx->mod != 0 || ctx->rm == 6)
 	  {
-	    print_operand_value (scratchbuf, 0, disp);
-	    oappend (scratchbuf);
+	    print_operand_value (ctx, ctx->scratchbuf, 0, disp);
+	    oappend (ctx, ctx->scratchbuf);
 	  }
 
-      if (mod != 0 || rm != 6)
+      if (ctx->mod != 0 || ctx->rm != 6)
 	{
-	  *obufp++ = open_char;
-	  *obufp = '\0';
-	  oappend (index16[rm]);
-	  if (intel_syntax && disp)
+	  *ctx->obufp++ = ctx->open_char;
+	  *ctx->obufp = '\0';
+	  oappend (ctx, ctx->index16[ctx->rm]);
+	  if (ctx->intel_syntax && disp)
 	    {
 	      if ((bfd_signed_vma) disp > 0)
 		{
-		  *obufp++ = '+';
-		  *obufp = '\0';
+		  *ctx->obufp++ = '+';
+		  *ctx->obufp = '\0';
 		}
-	      else if (mod != 1)
+	      else if (ctx->mod != 1)
 		{
-		  *obufp++ = '-';
-		  *obufp = '\0';
+		  *ctx->obufp++ = '-';
+		  *ctx->obufp = '\0';
 		  disp = - (bfd_signed_vma) disp;
 		}
 
-	      print_operand_value (scratchbuf, mod != 1, disp);
-	      oappend (scratchbuf);
+	      print_operand_value (ctx, ctx->scratchbuf, ctx->mod != 1, disp);
+	      oappend (ctx, ctx->scratchbuf);
 	    }
 
-	  *obufp++ = close_char;
-	  *obufp = '\0';
+	  *ctx->obufp++ = ctx->close_char;
+	  *ctx->obufp = '\0';
 	}
-      else if (intel_syntax)
+      else if (ctx->intel_syntax)
 	{
-	  if (prefixes & (PREFIX_CS | PREFIX_SS | PREFIX_DS
+	  if (ctx->prefixes & (PREFIX_CS | PREFIX_SS | PREFIX_DS
 			  | PREFIX_ES | PREFIX_FS | PREFIX_GS))
 	    ;
 	  else
 	    {
-	      oappend (names_seg[ds_reg - es_reg]);
-	      oappend (":");
+	      oappend (ctx, ctx->names_seg[ds_reg - es_reg]);
+	      oappend (ctx, ":");
 	    }
-	  print_operand_value (scratchbuf, 1, disp & 0xffff);
-	  oappend (scratchbuf);
+	  print_operand_value (ctx, ctx->scratchbuf, 1, disp & 0xffff);
+	  oappend (ctx, ctx->scratchbuf);
 	}
     }
 }
 
 static void
-OP_G (int bytemode, int sizeflag)
+OP_G (struct x86_dis_ctx *ctx, int bytemode, int sizeflag)
 {
   int add = 0;
   USED_REX (REX_EXTX);
-  if (rex & REX_EXTX)
+  if (ctx->rex & REX_EXTX)
     add += 8;
   switch (bytemode)
     {
     case b_mode:
       USED_REX (0);
-      if (rex)
-	oappend (names8rex[reg + add]);
+      if (ctx->rex)
+	oappend (ctx, ctx->names8rex[ctx->reg + add]);
       else
-	oappend (names8[reg + add]);
+	oappend (ctx, ctx->names8[ctx->reg + add]);
       break;
     case w_mode:
-      oappend (names16[reg + add]);
+      oappend (ctx, ctx->names16[ctx->reg + add]);
       break;
     case d_mode:
-      oappend (names32[reg + add]);
+      oappend (ctx, ctx->names32[ctx->reg + add]);
       break;
     case q_mode:
-      oappend (names64[reg + add]);
+      oappend (ctx, ctx->names64[ctx->reg + add]);
       break;
     case v_mode:
     case dq_mode:
     case dqw_mode:
       USED_REX (REX_MODE64);
-      if (rex & REX_MODE64)
-	oappend (names64[reg + add]);
+      if (ctx->rex & REX_MODE64)
+	oappend (ctx, ctx->names64[ctx->reg + add]);
       else if ((sizeflag & DFLAG) || bytemode != v_mode)
-	oappend (names32[reg + add]);
+	oappend (ctx, ctx->names32[ctx->reg + add]);
       else
-	oappend (names16[reg + add]);
-      used_prefixes |= (prefixes & PREFIX_DATA);
+	oappend (ctx, ctx->names16[ctx->reg + add]);
+      ctx->used_prefixes |= (ctx->prefixes & PREFIX_DATA);
       break;
     case m_mode:
-      if (mode_64bit)
-	oappend (names64[reg + add]);
+      if (ctx->mode_64bit)
+	oappend (ctx, ctx->names64[ctx->reg + add]);
       else
-	oappend (names32[reg + add]);
+	oappend (ctx, ctx->names32[ctx->reg + add]);
       break;
     default:
-      oappend (INTERNAL_DISASSEMBLER_ERROR);
+      oappend (ctx, INTERNAL_DISASSEMBLER_ERROR);
       break;
     }
 }
 
 static bfd_vma
-get64 (void)
+get64 (struct x86_dis_ctx *ctx)
 {
   bfd_vma x;
 #ifdef BFD64
   unsigned int a;
   unsigned int b;
 
-  FETCH_DATA (the_info, codep + 8);
-  a = *codep++ & 0xff;
-  a |= (*codep++ & 0xff) << 8;
-  a |= (*codep++ & 0xff) << 16;
-  a |= (*codep++ & 0xff) << 24;
-  b = *codep++ & 0xff;
-  b |= (*codep++ & 0xff) << 8;
-  b |= (*codep++ & 0xff) << 16;
-  b |= (*codep++ & 0xff) << 24;
+  FETCH_DATA (ctx, ctx->codep + 8);
+  a = *ctx->codep++ & 0xff;
+  a |= (*ctx->codep++ & 0xff) << 8;
+  a |= (*ctx->codep++ & 0xff) << 16;
+  a |= (*ctx->codep++ & 0xff) << 24;
+  b = *ctx->codep++ & 0xff;
+  b |= (*ctx->codep++ & 0xff) << 8;
+  b |= (*ctx->codep++ & 0xff) << 16;
+  b |= (*ctx->codep++ & 0xff) << 24;
   x = a + ((bfd_vma) b << 32);
 #else
   abort ();
@@ -3559,28 +3547,28 @@ get64 (void)
 }
 
 static bfd_signed_vma
-get32 (void)
+get32 (struct x86_dis_ctx *ctx)
 {
   bfd_signed_vma x = 0;
 
-  FETCH_DATA (the_info, codep + 4);
-  x = *codep++ & (bfd_signed_vma) 0xff;
-  x |= (*codep++ & (bfd_signed_vma) 0xff) << 8;
-  x |= (*codep++ & (bfd_signed_vma) 0xff) << 16;
-  x |= (*codep++ & (bfd_signed_vma) 0xff) << 24;
+  FETCH_DATA (ctx, ctx->codep + 4);
+  x = *ctx->codep++ & (bfd_signed_vma) 0xff;
+  x |= (*ctx->codep++ & (bfd_signed_vma) 0xff) << 8;
+  x |= (*ctx->codep++ & (bfd_signed_vma) 0xff) << 16;
+  x |= (*ctx->codep++ & (bfd_signed_vma) 0xff) << 24;
   return x;
 }
 
 static bfd_signed_vma
-get32s (void)
+get32s (struct x86_dis_ctx *ctx)
 {
   bfd_signed_vma x = 0;
 
-  FETCH_DATA (the_info, codep + 4);
-  x = *codep++ & (bfd_signed_vma) 0xff;
-  x |= (*codep++ & (bfd_signed_vma) 0xff) << 8;
-  x |= (*codep++ & (bfd_signed_vma) 0xff) << 16;
-  x |= (*codep++ & (bfd_signed_vma) 0xff) << 24;
+  FETCH_DATA (ctx, ctx->codep + 4);
+  x = *ctx->codep++ & (bfd_signed_vma) 0xff;
+  x |= (*ctx->codep++ & (bfd_signed_vma) 0xff) << 8;
+  x |= (*ctx->codep++ & (bfd_signed_vma) 0xff) << 16;
+  x |= (*ctx->codep++ & (bfd_signed_vma) 0xff) << 24;
 
   x = (x ^ ((bfd_signed_vma) 1 << 31)) - ((bfd_signed_vma) 1 << 31);
 
@@ -3588,71 +3576,71 @@ get32s (void)
 }
 
 static int
-get16 (void)
+get16 (struct x86_dis_ctx *ctx)
 {
   int x = 0;
 
-  FETCH_DATA (the_info, codep + 2);
-  x = *codep++ & 0xff;
-  x |= (*codep++ & 0xff) << 8;
+  FETCH_DATA (ctx, ctx->codep + 2);
+  x = *ctx->codep++ & 0xff;
+  x |= (*ctx->codep++ & 0xff) << 8;
   return x;
 }
 
 static void
-set_op (bfd_vma op, int riprel)
+set_op (struct x86_dis_ctx *ctx, bfd_vma op, int riprel)
 {
-  op_index[op_ad] = op_ad;
-  if (mode_64bit)
+  ctx->op_index[ctx->op_ad] = ctx->op_ad;
+  if (ctx->mode_64bit)
     {
-      op_address[op_ad] = op;
-      op_riprel[op_ad] = riprel;
+      ctx->op_address[ctx->op_ad] = op;
+      ctx->op_riprel[ctx->op_ad] = riprel;
     }
   else
     {
       /* Mask to get a 32-bit address.	*/
-      op_address[op_ad] = op & 0xffffffff;
-      op_riprel[op_ad] = riprel & 0xffffffff;
+      ctx->op_address[ctx->op_ad] = op & 0xffffffff;
+      ctx->op_riprel[ctx->op_ad] = riprel & 0xffffffff;
     }
 }
 
 static void
-OP_REG (int code, int sizeflag)
+OP_REG (struct x86_dis_ctx *ctx, int code, int sizeflag)
 {
   const char *s;
   int add = 0;
   USED_REX (REX_EXTZ);
-  if (rex & REX_EXTZ)
+  if (ctx->rex & REX_EXTZ)
     add = 8;
 
   switch (code)
     {
     case indir_dx_reg:
-      if (intel_syntax)
+      if (ctx->intel_syntax)
 	s = "[dx]";
       else
 	s = "(%dx)";
       break;
     case ax_reg: case cx_reg: case dx_reg: case bx_reg:
     case sp_reg: case bp_reg: case si_reg: case di_reg:
-      s = names16[code - ax_reg + add];
+      s = ctx->names16[code - ax_reg + add];
       break;
     case es_reg: case ss_reg: case cs_reg:
     case ds_reg: case fs_reg: case gs_reg:
-      s = names_seg[code - es_reg + add];
+      s = ctx->names_seg[code - es_reg];
       break;
     case al_reg: case ah_reg: case cl_reg: case ch_reg:
     case dl_reg: case dh_reg: case bl_reg: case bh_reg:
       USED_REX (0);
-      if (rex)
-	s = names8rex[code - al_reg + add];
+      if (ctx->rex)
+	s = ctx->names8rex[code - al_reg + add];
       else
-	s = names8[code - al_reg];
+	s = ctx->names8[code - al_reg];
       break;
     case rAX_reg: case rCX_reg: case rDX_reg: case rBX_reg:
     case rSP_reg: case rBP_reg: case rSI_reg: case rDI_reg:
-      if (mode_64bit)
+      if (ctx->mode_64bit)
 	{
-	  s = names64[code - rAX_reg + add];
+	  s = ctx->names64[code - rAX_reg + add];
 	  break;
 	}
       code += eAX_reg - rAX_reg;
@@ -3660,70 +3648,70 @@ OP_REG (int code, int sizeflag)
     case eAX_reg: case eCX_reg: case eDX_reg: case eBX_reg:
     case eSP_reg: case eBP_reg: case eSI_reg: case eDI_reg:
       USED_REX (REX_MODE64);
-      if (rex & REX_MODE64)
-	s = names64[code - eAX_reg + add];
+      if (ctx->rex & REX_MODE64)
+	s = ctx->names64[code - eAX_reg + add];
       else if (sizeflag & DFLAG)
-	s = names32[code - eAX_reg + add];
+	s = ctx->names32[code - eAX_reg + add];
       else
-	s = names16[code - eAX_reg + add];
-      used_prefixes |= (prefixes & PREFIX_DATA);
+	s = ctx->names16[code - eAX_reg + add];
+      ctx->used_prefixes |= (ctx->prefixes & PREFIX_DATA);
       break;
     default:
       s = INTERNAL_DISASSEMBLER_ERROR;
       break;
     }
-  oappend (s);
+  oappend (ctx, s);
 }
 
 static void
-OP_IMREG (int code, int sizeflag)
+OP_IMREG (struct x86_dis_ctx *ctx, int code, int sizeflag)
 {
   const char *s;
 
   switch (code)
     {
     case indir_dx_reg:
-      if (intel_syntax)
+      if (ctx->intel_syntax)
 	s = "[dx]";
       else
 	s = "(%dx)";
       break;
     case ax_reg: case cx_reg: case dx_reg: case bx_reg:
     case sp_reg: case bp_reg: case si_reg: case di_reg:
-      s = names16[code - ax_reg];
+      s = ctx->names16[code - ax_reg];
       break;
     case es_reg: case ss_reg: case cs_reg:
     case ds_reg: case fs_reg: case gs_reg:
-      s = names_seg[code - es_reg];
+      s = ctx->names_seg[code - es_reg];
       break;
     case al_reg: case ah_reg: case cl_reg: case ch_reg:
     case dl_reg: case dh_reg: case bl_reg: case bh_reg:
       USED_REX (0);
-      if (rex)
-	s = names8rex[code - al_reg];
+      if (ctx->rex)
+	s = ctx->names8rex[code - al_reg];
       else
-	s = names8[code - al_reg];
+	s = ctx->names8[code - al_reg];
       break;
     case eAX_reg: case eCX_reg: case eDX_reg: case eBX_reg:
     case eSP_reg: case eBP_reg: case eSI_reg: case eDI_reg:
       USED_REX (REX_MODE64);
-      if (rex & REX_MODE64)
-	s = names64[code - eAX_reg];
+      if (ctx->rex & REX_MODE64)
+	s = ctx->names64[code - eAX_reg];
       else if (sizeflag & DFLAG)
-	s = names32[code - eAX_reg];
+	s = ctx->names32[code - eAX_reg];
       else
-	s = names16[code - eAX_reg];
-      used_prefixes |= (prefixes & PREFIX_DATA);
+	s = ctx->names16[code - eAX_reg];
+      ctx->used_prefixes |= (ctx->prefixes & PREFIX_DATA);
       break;
     default:
       s = INTERNAL_DISASSEMBLER_ERROR;
       break;
     }
-  oappend (s);
+  oappend (ctx, s);
 }
 
 static void
-OP_I (int bytemode, int sizeflag)
+OP_I (struct x86_dis_ctx *ctx, int bytemode, int sizeflag)
 {
   bfd_signed_vma op;
   bfd_signed_vma mask = -1;
@@ -3731,106 +3719,106 @@ OP_I (int bytemode, int sizeflag)
   switch (bytemode)
     {
     case b_mode:
-      FETCH_DATA (the_info, codep + 1);
-      op = *codep++;
+      FETCH_DATA (ctx, ctx->codep + 1);
+      op = *ctx->codep++;
       mask = 0xff;
       break;
     case q_mode:
-      if (mode_64bit)
+      if (ctx->mode_64bit)
 	{
-	  op = get32s ();
+	  op = get32s (ctx);
 	  break;
 	}
       /* Fall through.	*/
     case v_mode:
       USED_REX (REX_MODE64);
-      if (rex & REX_MODE64)
-	op = get32s ();
+      if (ctx->rex & REX_MODE64)
+	op = get32s (ctx);
       else if (sizeflag & DFLAG)
 	{
-	  op = get32 ();
+	  op = get32 (ctx);
 	  mask = 0xffffffff;
 	}
       else
 	{
-	  op = get16 ();
+	  op = get16 (ctx);
 	  mask = 0xfffff;
 	}
-      used_prefixes |= (prefixes & PREFIX_DATA);
+      ctx->used_prefixes |= (ctx->prefixes & PREFIX_DATA);
       break;
     case w_mode:
       mask = 0xfffff;
-      op = get16 ();
+      op = get16 (ctx);
       break;
     case const_1_mode:
-      if (intel_syntax)
-	oappend ("1");
+      if (ctx->intel_syntax)
+	oappend (ctx, "1");
       return;
     default:
-      oappend (INTERNAL_DISASSEMBLER_ERROR);
+      oappend (ctx, INTERNAL_DISASSEMBLER_ERROR);
       return;
     }
 
   op &= mask;
-  scratchbuf[0] = '$';
-  print_operand_value (scratchbuf + 1, 1, op);
-  oappend (scratchbuf + intel_syntax);
-  scratchbuf[0] = '\0';
+  ctx->scratchbuf[0] = '$';
+  print_operand_value (ctx, ctx->scratchbuf + 1, 1, op);
+  oappend (ctx, ctx->scratchbuf + ctx->intel_syntax);
+  ctx->scratchbuf[0] = '\0';
 }
 
 static void
-OP_I64 (int bytemode, int sizeflag)
+OP_I64 (struct x86_dis_ctx *ctx, int bytemode, int sizeflag)
 {
   bfd_signed_vma op;
   bfd_signed_vma mask = -1;
 
-  if (!mode_64bit)
+  if (!ctx->mode_64bit)
     {
-      OP_I (bytemode, sizeflag);
+      OP_I (ctx, bytemode, sizeflag);
       return;
     }
 
   switch (bytemode)
     {
     case b_mode:
-      FETCH_DATA (the_info, codep + 1);
-      op = *codep++;
+      FETCH_DATA (ctx, ctx->codep + 1);
+      op = *ctx->codep++;
       mask = 0xff;
       break;
     case v_mode:
       USED_REX (REX_MODE64);
-      if (rex & REX_MODE64)
-	op = get64 ();
+      if (ctx->rex & REX_MODE64)
+	op = get64 (ctx);
       else if (sizeflag & DFLAG)
 	{
-	  op = get32 ();
+	  op = get32 (ctx);
 	  mask = 0xffffffff;
 	}
       else
 	{
-	  op = get16 ();
+	  op = get16 (ctx);
 	  mask = 0xfffff;
 	}
-      used_prefixes |= (prefixes & PREFIX_DATA);
+      ctx->used_prefixes |= (ctx->prefixes & PREFIX_DATA);
       break;
     case w_mode:
       mask = 0xfffff;
-      op = get16 ();
+      op = get16 (ctx);
       break;
     default:
-      oappend (INTERNAL_DISASSEMBLER_ERROR);
+      oappend (ctx, INTERNAL_DISASSEMBLER_ERROR);
       return;
     }
 
   op &= mask;
-  scratchbuf[0] = '$';
-  print_operand_value (scratchbuf + 1, 1, op);
-  oappend (scratchbuf + intel_syntax);
-  scratchbuf[0] = '\0';
+  ctx->scratchbuf[0] = '$';
+  print_operand_value (ctx, ctx->scratchbuf + 1, 1, op);
+  oappend (ctx, ctx->scratchbuf + ctx->intel_syntax);
+  ctx->scratchbuf[0] = '\0';
 }
 
 static void
-OP_sI (int bytemode, int sizeflag)
+OP_sI (struct x86_dis_ctx *ctx, int bytemode, int sizeflag)
 {
   bfd_signed_vma op;
   bfd_signed_vma mask = -1;
@@ -3838,48 +3826,48 @@ OP_sI (int bytemode, int sizeflag)
   switch (bytemode)
     {
     case b_mode:
-      FETCH_DATA (the_info, codep + 1);
-      op = *codep++;
+      FETCH_DATA (ctx, ctx->codep + 1);
+      op = *ctx->codep++;
       if ((op & 0x80) != 0)
 	op -= 0x100;
       mask = 0xffffffff;
       break;
     case v_mode:
       USED_REX (REX_MODE64);
-      if (rex & REX_MODE64)
-	op = get32s ();
+      if (ctx->rex & REX_MODE64)
+	op = get32s (ctx);
       else if (sizeflag & DFLAG)
 	{
-	  op = get32s ();
+	  op = get32s (ctx);
 	  mask = 0xffffffff;
 	}
       else
 	{
 	  mask = 0xffffffff;
-	  op = get16 ();
+	  op = get16 (ctx);
 	  if ((op & 0x8000) != 0)
 	    op -= 0x10000;
 	}
-      used_prefixes |= (prefixes & PREFIX_DATA);
+      ctx->used_prefixes |= (ctx->prefixes & PREFIX_DATA);
       break;
     case w_mode:
-      op = get16 ();
+      op = get16 (ctx);
       mask = 0xffffffff;
       if ((op & 0x8000) != 0)
 	op -= 0x10000;
       break;
     default:
-      oappend (INTERNAL_DISASSEMBLER_ERROR);
+      oappend (ctx, INTERNAL_DISASSEMBLER_ERROR);
       return;
     }
 
-  scratchbuf[0] = '$';
-  print_operand_value (scratchbuf + 1, 1, op);
-  oappend (scratchbuf + intel_syntax);
+  ctx->scratchbuf[0] = '$';
+  print_operand_value (ctx, ctx->scratchbuf + 1, 1, op);
+  oappend (ctx, ctx->scratchbuf + ctx->intel_syntax);
 }
 
 static void
-OP_J (int bytemode, int sizeflag)
+OP_J (struct x86_dis_ctx *ctx, int bytemode, int sizeflag)
 {
   bfd_vma disp;
   bfd_vma mask = -1;
@@ -3887,17 +3875,17 @@ OP_J (int bytemode, int sizeflag)
   switch (bytemode)
     {
     case b_mode:
-      FETCH_DATA (the_info, codep + 1);
-      disp = *codep++;
+      FETCH_DATA (ctx, ctx->codep + 1);
+      disp = *ctx->codep++;
       if ((disp & 0x80) != 0)
 	disp -= 0x100;
       break;
     case v_mode:
       if (sizeflag & DFLAG)
-	disp = get32s ();
+	disp = get32s (ctx);
       else
 	{
-	  disp = get16 ();
+	  disp = get16 (ctx);
 	  /* For some reason, a data16 prefix on a jump instruction
 	     means that the pc is masked to 16 bits after the
 	     displacement is added!  */
@@ -3905,382 +3893,390 @@ OP_J (int bytemode, int sizeflag)
 	}
       break;
     default:
-      oappend (INTERNAL_DISASSEMBLER_ERROR);
+      oappend (ctx, INTERNAL_DISASSEMBLER_ERROR);
       return;
     }
-  disp = (start_pc + codep - start_codep + disp) & mask;
-  set_op (disp, 0);
-  print_operand_value (scratchbuf, 1, disp);
-  oappend (scratchbuf);
+  disp = (ctx->start_pc + ctx->codep - ctx->start_codep + disp) & mask;
+  set_op (ctx, disp, 0);
+  print_operand_value (ctx, ctx->scratchbuf, 1, disp);
+  oappend (ctx, ctx->scratchbuf);
 }
 
 static void
-OP_SEG (int dummy ATTRIBUTE_UNUSED, int sizeflag ATTRIBUTE_UNUSED)
+OP_SEG (struct x86_dis_ctx *ctx,
+	int dummy ATTRIBUTE_UNUSED, int sizeflag ATTRIBUTE_UNUSED)
 {
-  oappend (names_seg[reg]);
+  oappend (ctx, ctx->names_seg[ctx->reg]);
 }
 
 static void
-OP_DIR (int dummy ATTRIBUTE_UNUSED, int sizeflag)
+OP_DIR (struct x86_dis_ctx *ctx, int dummy ATTRIBUTE_UNUSED, int sizeflag)
 {
   int seg, offset;
 
   if (sizeflag & DFLAG)
     {
-      offset = get32 ();
-      seg = get16 ();
+      offset = get32 (ctx);
+      seg = get16 (ctx);
     }
   else
     {
-      offset = get16 ();
-      seg = get16 ();
+      offset = get16 (ctx);
+      seg = get16 (ctx);
     }
-  used_prefixes |= (prefixes & PREFIX_DATA);
-  if (intel_syntax)
-    sprintf (scratchbuf, "0x%x,0x%x", seg, offset);
+  ctx->used_prefixes |= (ctx->prefixes & PREFIX_DATA);
+  if (ctx->intel_syntax)
+    sprintf (ctx->scratchbuf, "0x%x,0x%x", seg, offset);
   else
-    sprintf (scratchbuf, "$0x%x,$0x%x", seg, offset);
-  oappend (scratchbuf);
+    sprintf (ctx->scratchbuf, "$0x%x,$0x%x", seg, offset);
+  oappend (ctx, ctx->scratchbuf);
 }
 
 static void
-OP_OFF (int bytemode ATTRIBUTE_UNUSED, int sizeflag)
+OP_OFF (struct x86_dis_ctx *ctx, int bytemode ATTRIBUTE_UNUSED, int sizeflag)
 {
   bfd_vma off;
 
-  append_seg ();
+  append_seg (ctx);
 
-  if ((sizeflag & AFLAG) || mode_64bit)
-    off = get32 ();
+  if ((sizeflag & AFLAG) || ctx->mode_64bit)
+    off = get32 (ctx);
   else
-    off = get16 ();
+    off = get16 (ctx);
 
-  if (intel_syntax)
+  if (ctx->intel_syntax)
     {
-      if (!(prefixes & (PREFIX_CS | PREFIX_SS | PREFIX_DS
+      if (!(ctx->prefixes & (PREFIX_CS | PREFIX_SS | PREFIX_DS
 			| PREFIX_ES | PREFIX_FS | PREFIX_GS)))
 	{
-	  oappend (names_seg[ds_reg - es_reg]);
-	  oappend (":");
+	  oappend (ctx, ctx->names_seg[ds_reg - es_reg]);
+	  oappend (ctx, ":");
 	}
     }
-  print_operand_value (scratchbuf, 1, off);
-  oappend (scratchbuf);
+  print_operand_value (ctx, ctx->scratchbuf, 1, off);
+  oappend (ctx, ctx->scratchbuf);
 }
 
 static void
-OP_OFF64 (int bytemode ATTRIBUTE_UNUSED, int sizeflag ATTRIBUTE_UNUSED)
+OP_OFF64 (struct x86_dis_ctx *ctx,
+	  int bytemode ATTRIBUTE_UNUSED, int sizeflag ATTRIBUTE_UNUSED)
 {
   bfd_vma off;
 
-  if (!mode_64bit)
+  if (!ctx->mode_64bit)
     {
-      OP_OFF (bytemode, sizeflag);
+      OP_OFF (ctx, bytemode, sizeflag);
       return;
     }
 
-  append_seg ();
+  append_seg (ctx);
 
-  off = get64 ();
+  off = get64 (ctx);
 
-  if (intel_syntax)
+  if (ctx->intel_syntax)
     {
-      if (!(prefixes & (PREFIX_CS | PREFIX_SS | PREFIX_DS
+      if (!(ctx->prefixes & (PREFIX_CS | PREFIX_SS | PREFIX_DS
 			| PREFIX_ES | PREFIX_FS | PREFIX_GS)))
 	{
-	  oappend (names_seg[ds_reg - es_reg]);
-	  oappend (":");
+	  oappend (ctx, ctx->names_seg[ds_reg - es_reg]);
+	  oappend (ctx, ":");
 	}
     }
-  print_operand_value (scratchbuf, 1, off);
-  oappend (scratchbuf);
+  print_operand_value (ctx, ctx->scratchbuf, 1, off);
+  oappend (ctx, ctx->scratchbuf);
 }
 
 static void
-ptr_reg (int code, int sizeflag)
+ptr_reg (struct x86_dis_ctx *ctx, int code, int sizeflag)
 {
   const char *s;
 
-  *obufp++ = open_char;
-  used_prefixes |= (prefixes & PREFIX_ADDR);
-  if (mode_64bit)
+  *ctx->obufp++ = ctx->open_char;
+  ctx->used_prefixes |= (ctx->prefixes & PREFIX_ADDR);
+  if (ctx->mode_64bit)
     {
       if (!(sizeflag & AFLAG))
-	s = names32[code - eAX_reg];
+	s = ctx->names32[code - eAX_reg];
       else
-	s = names64[code - eAX_reg];
+	s = ctx->names64[code - eAX_reg];
     }
   else if (sizeflag & AFLAG)
-    s = names32[code - eAX_reg];
+    s = ctx->names32[code - eAX_reg];
   else
-    s = names16[code - eAX_reg];
-  oappend (s);
-  *obufp++ = close_char;
-  *obufp = 0;
+    s = ctx->names16[code - eAX_reg];
+  oappend (ctx, s);
+  *ctx->obufp++ = ctx->close_char;
+  *ctx->obufp = 0;
 }
 
 static void
-OP_ESreg (int code, int sizeflag)
+OP_ESreg (struct x86_dis_ctx *ctx, int code, int sizeflag)
 {
-  if (intel_syntax)
+  if (ctx->intel_syntax)
     {
-      if (codep[-1] & 1)
+      if (ctx->codep[-1] & 1)
 	{
 	  USED_REX (REX_MODE64);
-	  used_prefixes |= (prefixes & PREFIX_DATA);
-	  if (rex & REX_MODE64)
-	    oappend ("QWORD PTR ");
+	  ctx->used_prefixes |= (ctx->prefixes & PREFIX_DATA);
+	  if (ctx->rex & REX_MODE64)
+	    oappend (ctx, "QWORD PTR ");
 	  else if ((sizeflag & DFLAG))
-	    oappend ("DWORD PTR ");
+	    oappend (ctx, "DWORD PTR ");
 	  else
-	    oappend ("WORD PTR ");
+	    oappend (ctx, "WORD PTR ");
 	}
       else
-	oappend ("BYTE PTR ");
+	oappend (ctx, "BYTE PTR ");
     }
 
-  oappend ("%es:" + intel_syntax);
-  ptr_reg (code, sizeflag);
+  oappend (ctx, "%es:" + ctx->intel_syntax);
+  ptr_reg (ctx, code, sizeflag);
 }
 
 static void
-OP_DSreg (int code, int sizeflag)
+OP_DSreg (struct x86_dis_ctx *ctx, int code, int sizeflag)
 {
-  if (intel_syntax)
+  if (ctx->intel_syntax)
     {
-      if (codep[-1] != 0xd7 && (codep[-1] & 1))
+      if (ctx->codep[-1] != 0xd7 && (ctx->codep[-1] & 1))
 	{
 	  USED_REX (REX_MODE64);
-	  used_prefixes |= (prefixes & PREFIX_DATA);
-	  if (rex & REX_MODE64)
-	    oappend ("QWORD PTR ");
+	  ctx->used_prefixes |= (ctx->prefixes & PREFIX_DATA);
+	  if (ctx->rex & REX_MODE64)
+	    oappend (ctx, "QWORD PTR ");
 	  else if ((sizeflag & DFLAG))
-	    oappend ("DWORD PTR ");
+	    oappend (ctx, "DWORD PTR ");
 	  else
-	    oappend ("WORD PTR ");
+	    oappend (ctx, "WORD PTR ");
 	}
       else
-	oappend ("BYTE PTR ");
+	oappend (ctx, "BYTE PTR ");
     }
 
-  if ((prefixes
+  if ((ctx->prefixes
        & (PREFIX_CS
 	  | PREFIX_DS
 	  | PREFIX_SS
 	  | PREFIX_ES
 	  | PREFIX_FS
 	  | PREFIX_GS)) == 0)
-    prefixes |= PREFIX_DS;
-  append_seg ();
-  ptr_reg (code, sizeflag);
+    ctx->prefixes |= PREFIX_DS;
+  append_seg (ctx);
+  ptr_reg (ctx, code, sizeflag);
 }
 
 static void
-OP_C (int dummy ATTRIBUTE_UNUSED, int sizeflag ATTRIBUTE_UNUSED)
+OP_C (struct x86_dis_ctx *ctx,
+      int dummy ATTRIBUTE_UNUSED, int sizeflag ATTRIBUTE_UNUSED)
 {
   int add = 0;
-  if (rex & REX_EXTX)
+  if (ctx->rex & REX_EXTX)
     {
       USED_REX (REX_EXTX);
       add = 8;
     }
-  else if (!mode_64bit && (prefixes & PREFIX_LOCK))
+  else if (!ctx->mode_64bit && (ctx->prefixes & PREFIX_LOCK))
     {
-      used_prefixes |= PREFIX_LOCK;
+      ctx->used_prefixes |= PREFIX_LOCK;
       add = 8;
     }
-  sprintf (scratchbuf, "%%cr%d", reg + add);
-  oappend (scratchbuf + intel_syntax);
+  sprintf (ctx->scratchbuf, "%%cr%d", ctx->reg + add);
+  oappend (ctx, ctx->scratchbuf + ctx->intel_syntax);
 }
 
 static void
-OP_D (int dummy ATTRIBUTE_UNUSED, int sizeflag ATTRIBUTE_UNUSED)
+OP_D (struct x86_dis_ctx *ctx,
+      int dummy ATTRIBUTE_UNUSED, int sizeflag ATTRIBUTE_UNUSED)
 {
   int add = 0;
   USED_REX (REX_EXTX);
-  if (rex & REX_EXTX)
+  if (ctx->rex & REX_EXTX)
     add = 8;
-  if (intel_syntax)
-    sprintf (scratchbuf, "db%d", reg + add);
+  if (ctx->intel_syntax)
+    sprintf (ctx->scratchbuf, "db%d", ctx->reg + add);
   else
-    sprintf (scratchbuf, "%%db%d", reg + add);
-  oappend (scratchbuf);
+    sprintf (ctx->scratchbuf, "%%db%d", ctx->reg + add);
+  oappend (ctx, ctx->scratchbuf);
 }
 
 static void
-OP_T (int dummy ATTRIBUTE_UNUSED, int sizeflag ATTRIBUTE_UNUSED)
+OP_T (struct x86_dis_ctx *ctx,
+      int dummy ATTRIBUTE_UNUSED, int sizeflag ATTRIBUTE_UNUSED)
 {
-  sprintf (scratchbuf, "%%tr%d", reg);
-  oappend (scratchbuf + intel_syntax);
+  sprintf (ctx->scratchbuf, "%%tr%d", ctx->reg);
+  oappend (ctx, ctx->scratchbuf + ctx->intel_syntax);
 }
 
 static void
-OP_Rd (int bytemode, int sizeflag)
+OP_Rd (struct x86_dis_ctx *ctx, int bytemode, int sizeflag)
 {
-  if (mod == 3)
-    OP_E (bytemode, sizeflag);
+  if (ctx->mod == 3)
+    OP_E (ctx, bytemode, sizeflag);
   else
-    BadOp ();
+    BadOp (ctx);
 }
 
 static void
-OP_MMX (int bytemode ATTRIBUTE_UNUSED, int sizeflag ATTRIBUTE_UNUSED)
+OP_MMX (struct x86_dis_ctx *ctx,
+	int bytemode ATTRIBUTE_UNUSED, int sizeflag ATTRIBUTE_UNUSED)
 {
-  used_prefixes |= (prefixes & PREFIX_DATA);
-  if (prefixes & PREFIX_DATA)
+  ctx->used_prefixes |= (ctx->prefixes & PREFIX_DATA);
+  if (ctx->prefixes & PREFIX_DATA)
     {
       int add = 0;
       USED_REX (REX_EXTX);
-      if (rex & REX_EXTX)
+      if (ctx->rex & REX_EXTX)
 	add = 8;
-      sprintf (scratchbuf, "%%xmm%d", reg + add);
+      sprintf (ctx->scratchbuf, "%%xmm%d", ctx->reg + add);
     }
   else
-    sprintf (scratchbuf, "%%mm%d", reg);
-  oappend (scratchbuf + intel_syntax);
+    sprintf (ctx->scratchbuf, "%%mm%d", ctx->reg);
+  oappend (ctx, ctx->scratchbuf + ctx->intel_syntax);
 }
 
 static void
-OP_XMM (int bytemode ATTRIBUTE_UNUSED, int sizeflag ATTRIBUTE_UNUSED)
+OP_XMM (struct x86_dis_ctx *ctx,
+	int bytemode ATTRIBUTE_UNUSED, int sizeflag ATTRIBUTE_UNUSED)
 {
   int add = 0;
   USED_REX (REX_EXTX);
-  if (rex & REX_EXTX)
+  if (ctx->rex & REX_EXTX)
     add = 8;
-  sprintf (scratchbuf, "%%xmm%d", reg + add);
-  oappend (scratchbuf + intel_syntax);
+  sprintf (ctx->scratchbuf, "%%xmm%d", ctx->reg + add);
+  oappend (ctx, ctx->scratchbuf + ctx->intel_syntax);
 }
 
 static void
-OP_EM (int bytemode, int sizeflag)
+OP_EM (struct x86_dis_ctx *ctx, int bytemode, int sizeflag)
 {
-  if (mod != 3)
+  if (ctx->mod != 3)
     {
-      if (intel_syntax && bytemode == v_mode)
+      if (ctx->intel_syntax && bytemode == v_mode)
 	{
-	  bytemode = (prefixes & PREFIX_DATA) ? x_mode : q_mode;
-	  used_prefixes |= (prefixes & PREFIX_DATA);
+	  bytemode = (ctx->prefixes & PREFIX_DATA) ? x_mode : q_mode;
+	  ctx->used_prefixes |= (ctx->prefixes & PREFIX_DATA);
 	}
-      OP_E (bytemode, sizeflag);
+      OP_E (ctx, bytemode, sizeflag);
       return;
     }
 
   /* Skip mod/rm byte.	*/
   MODRM_CHECK;
-  codep++;
-  used_prefixes |= (prefixes & PREFIX_DATA);
-  if (prefixes & PREFIX_DATA)
+  ctx->codep++;
+  ctx->used_prefixes |= (ctx->prefixes & PREFIX_DATA);
+  if (ctx->prefixes & PREFIX_DATA)
     {
       int add = 0;
 
       USED_REX (REX_EXTZ);
-      if (rex & REX_EXTZ)
+      if (ctx->rex & REX_EXTZ)
 	add = 8;
-      sprintf (scratchbuf, "%%xmm%d", rm + add);
+      sprintf (ctx->scratchbuf, "%%xmm%d", ctx->rm + add);
     }
   else
-    sprintf (scratchbuf, "%%mm%d", rm);
-  oappend (scratchbuf + intel_syntax);
+    sprintf (ctx->scratchbuf, "%%mm%d", ctx->rm);
+  oappend (ctx, ctx->scratchbuf + ctx->intel_syntax);
 }
 
 static void
-OP_EX (int bytemode, int sizeflag)
+OP_EX (struct x86_dis_ctx *ctx, int bytemode, int sizeflag)
 {
   int add = 0;
-  if (mod != 3)
+  if (ctx->mod != 3)
     {
-      if (intel_syntax && bytemode == v_mode)
+      if (ctx->intel_syntax && bytemode == v_mode)
 	{
-	  switch (prefixes & (PREFIX_DATA|PREFIX_REPZ|PREFIX_REPNZ))
+	  switch (ctx->prefixes & (PREFIX_DATA|PREFIX_REPZ|PREFIX_REPNZ))
 	    {
 	    case 0:	       bytemode = x_mode; break;
-	    case PREFIX_REPZ:  bytemode = d_mode; used_prefixes |= PREFIX_REPZ;	 break;
-	    case PREFIX_DATA:  bytemode = x_mode; used_prefixes |= PREFIX_DATA;	 break;
-	    case PREFIX_REPNZ: bytemode = q_mode; used_prefixes |= PREFIX_REPNZ; break;
+	    case PREFIX_REPZ:  bytemode = d_mode; ctx->used_prefixes |= PREFIX_REPZ;	 break;
+	    case PREFIX_DATA:  bytemode = x_mode; ctx->used_prefixes |= PREFIX_DATA;	 break;
+	    case PREFIX_REPNZ: bytemode = q_mode; ctx->used_prefixes |= PREFIX_REPNZ; break;
 	    default:	       bytemode = 0; break;
 	    }
 	}
-      OP_E (bytemode, sizeflag);
+      OP_E (ctx, bytemode, sizeflag);
       return;
     }
   USED_REX (REX_EXTZ);
-  if (rex & REX_EXTZ)
+  if (ctx->rex & REX_EXTZ)
     add = 8;
 
   /* Skip mod/rm byte.	*/
   MODRM_CHECK;
-  codep++;
-  sprintf (scratchbuf, "%%xmm%d", rm + add);
-  oappend (scratchbuf + intel_syntax);
+  ctx->codep++;
+  sprintf (ctx->scratchbuf, "%%xmm%d", ctx->rm + add);
+  oappend (ctx, ctx->scratchbuf + ctx->intel_syntax);
 }
 
 static void
-OP_MS (int bytemode, int sizeflag)
+OP_MS (struct x86_dis_ctx *ctx, int bytemode, int sizeflag)
 {
-  if (mod == 3)
-    OP_EM (bytemode, sizeflag);
+  if (ctx->mod == 3)
+    OP_EM (ctx, bytemode, sizeflag);
   else
-    BadOp ();
+    BadOp (ctx);
 }
 
 static void
-OP_XS (int bytemode, int sizeflag)
+OP_XS (struct x86_dis_ctx *ctx, int bytemode, int sizeflag)
 {
-  if (mod == 3)
-    OP_EX (bytemode, sizeflag);
+  if (ctx->mod == 3)
+    OP_EX (ctx, bytemode, sizeflag);
   else
-    BadOp ();
+    BadOp (ctx);
 }
 
 static void
-OP_M (int bytemode, int sizeflag)
+OP_M (struct x86_dis_ctx *ctx, int bytemode, int sizeflag)
 {
-  if (mod == 3)
-    BadOp ();	/* bad lea,lds,les,lfs,lgs,lss modrm */
+  if (ctx->mod == 3)
+    BadOp (ctx);	/* bad lea,lds,les,lfs,lgs,lss modrm */
   else
-    OP_E (bytemode, sizeflag);
+    OP_E (ctx, bytemode, sizeflag);
 }
 
 static void
-OP_0f07 (int bytemode, int sizeflag)
+OP_0f07 (struct x86_dis_ctx *ctx, int bytemode, int sizeflag)
 {
-  if (mod != 3 || rm != 0)
-    BadOp ();
+  if (ctx->mod != 3 || ctx->rm != 0)
+    BadOp (ctx);
   else
-    OP_E (bytemode, sizeflag);
+    OP_E (ctx, bytemode, sizeflag);
 }
 
 static void
-OP_0fae (int bytemode, int sizeflag)
+OP_0fae (struct x86_dis_ctx *ctx, int bytemode, int sizeflag)
 {
-  if (mod == 3)
+  if (ctx->mod == 3)
     {
-      if (reg == 5)
-	strcpy (obuf + strlen (obuf) - sizeof ("xrstor") + 1, "lfence");
-      if (reg == 7)
-	strcpy (obuf + strlen (obuf) - sizeof ("clflush") + 1, "sfence");
+      if (ctx->reg == 5)
+	strcpy (ctx->obuf + strlen (ctx->obuf) - sizeof ("xrstor") + 1, "lfence");
+      if (ctx->reg == 7)
+	strcpy (ctx->obuf + strlen (ctx->obuf) - sizeof ("clflush") + 1, "sfence");
 
-      if (reg < 5 || rm != 0)
+      if (ctx->reg < 5 || ctx->rm != 0)
 	{
-	  BadOp ();	/* bad sfence, mfence, or lfence */
+	  BadOp (ctx);	/* bad sfence, mfence, or lfence */
 	  return;
 	}
     }
-  else if (reg != 5 && reg != 7)
+  else if (ctx->reg != 5 && ctx->reg != 7)
     {
-      BadOp ();		/* bad xrstor or clflush */
+      BadOp (ctx);		/* bad xrstor or clflush */
       return;
     }
 
-  OP_E (bytemode, sizeflag);
+  OP_E (ctx, bytemode, sizeflag);
 }
 
 static void
-NOP_Fixup (int bytemode ATTRIBUTE_UNUSED, int sizeflag ATTRIBUTE_UNUSED)
+NOP_Fixup (struct x86_dis_ctx *ctx,
+	   int bytemode ATTRIBUTE_UNUSED, int sizeflag ATTRIBUTE_UNUSED)
 {
   /* NOP with REPZ prefix is called PAUSE.  */
-  if (prefixes == PREFIX_REPZ)
-    strcpy (obuf, "pause");
+  if (ctx->prefixes == PREFIX_REPZ)
+    strcpy (ctx->obuf, "pause");
 }
 
 static const char *const Suffix3DNow[] = {
@@ -4351,31 +4347,32 @@ static const char *const Suffix3DNow[] = {
 };
 
 static void
-OP_3DNowSuffix (int bytemode ATTRIBUTE_UNUSED, int sizeflag ATTRIBUTE_UNUSED)
+OP_3DNowSuffix (struct x86_dis_ctx *ctx,
+		int bytemode ATTRIBUTE_UNUSED, int sizeflag ATTRIBUTE_UNUSED)
 {
   const char *mnemonic;
 
-  FETCH_DATA (the_info, codep + 1);
+  FETCH_DATA (ctx, ctx->codep + 1);
   /* AMD 3DNow! instructions are specified by an opcode suffix in the
      place where an 8-bit immediate would normally go.	ie. the last
      byte of the instruction.  */
-  obufp = obuf + strlen (obuf);
-  mnemonic = Suffix3DNow[*codep++ & 0xff];
+  ctx->obufp = ctx->obuf + strlen (ctx->obuf);
+  mnemonic = Suffix3DNow[*ctx->codep++ & 0xff];
   if (mnemonic)
-    oappend (mnemonic);
+    oappend (ctx, mnemonic);
   else
     {
       /* Since a variable sized modrm/sib chunk is between the start
 	 of the opcode (0x0f0f) and the opcode suffix, we need to do
 	 all the modrm processing first, and don't know until now that
 	 we have a bad opcode.	This necessitates some cleaning up.  */
-      op1out[0] = '\0';
-      op2out[0] = '\0';
-      BadOp ();
+      ctx->op1out[0] = '\0';
+      ctx->op2out[0] = '\0';
+      BadOp (ctx);
     }
 }
 
-static const char *simd_cmp_op[] = {
+static const char *const simd_cmp_op[] = {
   "eq",
   "lt",
   "le",
@@ -4387,53 +4384,55 @@ static const char *simd_cmp_op[] = {
 };
 
 static void
-OP_SIMD_Suffix (int bytemode ATTRIBUTE_UNUSED, int sizeflag ATTRIBUTE_UNUSED)
+OP_SIMD_Suffix (struct x86_dis_ctx *ctx,
+		int bytemode ATTRIBUTE_UNUSED, int sizeflag ATTRIBUTE_UNUSED)
 {
   unsigned int cmp_type;
 
-  FETCH_DATA (the_info, codep + 1);
-  obufp = obuf + strlen (obuf);
-  cmp_type = *codep++ & 0xff;
+  FETCH_DATA (ctx, ctx->codep + 1);
+  ctx->obufp = ctx->obuf + strlen (ctx->obuf);
+  cmp_type = *ctx->codep++ & 0xff;
   if (cmp_type < 8)
     {
       char suffix1 = 'p', suffix2 = 's';
-      used_prefixes |= (prefixes & PREFIX_REPZ);
-      if (prefixes & PREFIX_REPZ)
+      ctx->used_prefixes |= (ctx->prefixes & PREFIX_REPZ);
+      if (ctx->prefixes & PREFIX_REPZ)
 	suffix1 = 's';
       else
 	{
-	  used_prefixes |= (prefixes & PREFIX_DATA);
-	  if (prefixes & PREFIX_DATA)
+	  ctx->used_prefixes |= (ctx->prefixes & PREFIX_DATA);
+	  if (ctx->prefixes & PREFIX_DATA)
 	    suffix2 = 'd';
 	  else
 	    {
-	      used_prefixes |= (prefixes & PREFIX_REPNZ);
-	      if (prefixes & PREFIX_REPNZ)
+	      ctx->used_prefixes |= (ctx->prefixes & PREFIX_REPNZ);
+	      if (ctx->prefixes & PREFIX_REPNZ)
 		suffix1 = 's', suffix2 = 'd';
 	    }
 	}
-      sprintf (scratchbuf, "cmp%s%c%c",
+      sprintf (ctx->scratchbuf, "cmp%s%c%c",
 	       simd_cmp_op[cmp_type], suffix1, suffix2);
-      used_prefixes |= (prefixes & PREFIX_REPZ);
-      oappend (scratchbuf);
+      ctx->used_prefixes |= (ctx->prefixes & PREFIX_REPZ);
+      oappend (ctx, ctx->scratchbuf);
     }
   else
     {
       /* We have a bad extension byte.	Clean up.  */
-      op1out[0] = '\0';
-      op2out[0] = '\0';
-      BadOp ();
+      ctx->op1out[0] = '\0';
+      ctx->op2out[0] = '\0';
+      BadOp (ctx);
     }
 }
 
 static void
-SIMD_Fixup (int extrachar, int sizeflag ATTRIBUTE_UNUSED)
+SIMD_Fixup (struct x86_dis_ctx *ctx,
+	    int extrachar, int sizeflag ATTRIBUTE_UNUSED)
 {
   /* Change movlps/movhps to movhlps/movlhps for 2 register operand
      forms of these instructions.  */
-  if (mod == 3)
+  if (ctx->mod == 3)
     {
-      char *p = obuf + strlen (obuf);
+      char *p = ctx->obuf + strlen (ctx->obuf);
       *(p + 1) = '\0';
       *p       = *(p - 1);
       *(p - 1) = *(p - 2);
@@ -4443,61 +4442,62 @@ SIMD_Fixup (int extrachar, int sizeflag ATTRIBUTE_UNUSED)
 }
 
 static void
-PNI_Fixup (int extrachar ATTRIBUTE_UNUSED, int sizeflag)
+PNI_Fixup (struct x86_dis_ctx *ctx,
+	   int extrachar ATTRIBUTE_UNUSED, int sizeflag)
 {
-  if (mod == 3 && reg == 1 && rm <= 1)
+  if (ctx->mod == 3 && ctx->reg == 1 && ctx->rm <= 1)
     {
       /* Override "sidt".  */
-      char *p = obuf + strlen (obuf) - 4;
+      char *p = ctx->obuf + strlen (ctx->obuf) - 4;
 
       /* We might have a suffix when disassembling with -Msuffix.  */
       if (*p == 'i')
 	--p;
 
-      if (rm)
+      if (ctx->rm)
 	{
 	  /* mwait %eax,%ecx  */
 	  strcpy (p, "mwait");
-	  if (!intel_syntax)
-	    strcpy (op1out, names32[0]);
+	  if (!ctx->intel_syntax)
+	    strcpy (ctx->op1out, ctx->names32[0]);
 	}
       else
 	{
 	  /* monitor %eax,%ecx,%edx"  */
 	  strcpy (p, "monitor");
-	  if (!intel_syntax)
+	  if (!ctx->intel_syntax)
 	    {
-	      if (!mode_64bit)
-		strcpy (op1out, names32[0]);
-	      else if (!(prefixes & PREFIX_ADDR))
-		strcpy (op1out, names64[0]);
+	      if (!ctx->mode_64bit)
+		strcpy (ctx->op1out, ctx->names32[0]);
+	      else if (!(ctx->prefixes & PREFIX_ADDR))
+		strcpy (ctx->op1out, ctx->names64[0]);
 	      else
 		{
-		  strcpy (op1out, names32[0]);
-		  used_prefixes |= PREFIX_ADDR;
+		  strcpy (ctx->op1out, ctx->names32[0]);
+		  ctx->used_prefixes |= PREFIX_ADDR;
 		}
-	      strcpy (op3out, names32[2]);
+	      strcpy (ctx->op3out, ctx->names32[2]);
 	    }
 	}
-      if (!intel_syntax)
+      if (!ctx->intel_syntax)
 	{
-	  strcpy (op2out, names32[1]);
-	  two_source_ops = 1;
+	  strcpy (ctx->op2out, ctx->names32[1]);
+	  ctx->two_source_ops = 1;
 	}
 
-      codep++;
+      ctx->codep++;
     }
   else
-    OP_M (0, sizeflag);
+    OP_M (ctx, 0, sizeflag);
 }
 
 static void
-SVME_Fixup (int bytemode, int sizeflag)
+SVME_Fixup (struct x86_dis_ctx *ctx, int bytemode, int sizeflag)
 {
   const char *alt;
   char *p;
 
-  switch (*codep)
+  switch (*ctx->codep)
     {
     case 0xd8:
       alt = "vmrun";
@@ -4524,49 +4524,49 @@ SVME_Fixup (int bytemode, int sizeflag)
       alt = "invlpga";
       break;
     default:
-      OP_M (bytemode, sizeflag);
+      OP_M (ctx, bytemode, sizeflag);
       return;
     }
   /* Override "lidt".  */
-  p = obuf + strlen (obuf) - 4;
+  p = ctx->obuf + strlen (ctx->obuf) - 4;
   /* We might have a suffix.  */
   if (*p == 'i')
     --p;
   strcpy (p, alt);
-  if (!(prefixes & PREFIX_ADDR))
+  if (!(ctx->prefixes & PREFIX_ADDR))
     {
-      ++codep;
+      ++ctx->codep;
       return;
     }
-  used_prefixes |= PREFIX_ADDR;
-  switch (*codep++)
+  ctx->used_prefixes |= PREFIX_ADDR;
+  switch (*ctx->codep++)
     {
     case 0xdf:
-      strcpy (op2out, names32[1]);
-      two_source_ops = 1;
+      strcpy (ctx->op2out, ctx->names32[1]);
+      ctx->two_source_ops = 1;
 	  /* Fall through.  */
     case 0xd8:
     case 0xda:
     case 0xdb:
-      *obufp++ = open_char;
-      if (mode_64bit || (sizeflag & AFLAG))
-        alt = names32[0];
+      *ctx->obufp++ = ctx->open_char;
+      if (ctx->mode_64bit || (sizeflag & AFLAG))
+        alt = ctx->names32[0];
       else
-        alt = names16[0];
-      strcpy (obufp, alt);
-      obufp += strlen (alt);
-      *obufp++ = close_char;
-      *obufp = '\0';
+        alt = ctx->names16[0];
+      strcpy (ctx->obufp, alt);
+      ctx->obufp += strlen (alt);
+      *ctx->obufp++ = ctx->close_char;
+      *ctx->obufp = '\0';
       break;
     }
 }
 
 static void
-INVLPG_Fixup (int bytemode, int sizeflag)
+INVLPG_Fixup (struct x86_dis_ctx *ctx, int bytemode, int sizeflag)
 {
   const char *alt;
 
-  switch (*codep)
+  switch (*ctx->codep)
     {
     case 0xf8:
       alt = "swapgs";
@@ -4575,24 +4575,24 @@ INVLPG_Fixup (int bytemode, int sizeflag)
       alt = "rdtscp";
       break;
     default:
-      OP_M (bytemode, sizeflag);
+      OP_M (ctx, bytemode, sizeflag);
       return;
     }
   /* Override "invlpg".  */
-  strcpy (obuf + strlen (obuf) - 6, alt);
-  codep++;
+  strcpy (ctx->obuf + strlen (ctx->obuf) - 6, alt);
+  ctx->codep++;
 }
 
-static void BadOp (void)
+static void BadOp (struct x86_dis_ctx *ctx)
 {
   /* Throw away prefixes and 1st. opcode byte.  */
-  codep = insn_codep + 1;
-  oappend ("(bad)");
+  ctx->codep = ctx->insn_codep + 1;
+  oappend (ctx, "(bad)");
 }
 
-static void SEG_Fixup (int extrachar, int sizeflag)
+static void SEG_Fixup (struct x86_dis_ctx *ctx, int extrachar, int sizeflag)
 {
-  if (mod == 3)
+  if (ctx->mod == 3)
     {
       /* We need to add a proper suffix with
 
@@ -4605,17 +4605,17 @@ static void SEG_Fixup (int extrachar, int sizeflag)
        */
       const char *suffix;
 
-      if (prefixes & PREFIX_DATA)
+      if (ctx->prefixes & PREFIX_DATA)
 	suffix = "w";
       else
 	{
 	  USED_REX (REX_MODE64);
-	  if (rex & REX_MODE64)
+	  if (ctx->rex & REX_MODE64)
 	    suffix = "q";
 	  else
 	    suffix = "l";
 	}
-      strcat (obuf, suffix);
+      strcat (ctx->obuf, suffix);
     }
   else
     {
@@ -4627,7 +4627,7 @@ static void SEG_Fixup (int extrachar, int sizeflag)
 		movw (%rax),%ds
 
 	 Override "mov[l|q]".  */
-      char *p = obuf + strlen (obuf) - 1;
+      char *p = ctx->obuf + strlen (ctx->obuf) - 1;
 
       /* We might not have a suffix.  */
       if (*p == 'v')
@@ -4635,21 +4635,22 @@ static void SEG_Fixup (int extrachar, int sizeflag)
       *p = 'w';
     }
 
-  OP_E (extrachar, sizeflag);
+  OP_E (ctx, extrachar, sizeflag);
 }
 
-static void VMX_Fixup (int extrachar ATTRIBUTE_UNUSED, int sizeflag)
+static void VMX_Fixup (struct x86_dis_ctx *ctx,
+		       int extrachar ATTRIBUTE_UNUSED, int sizeflag)
 {
-  if (mod == 3 && reg == 0 && rm >=1 && rm <= 4)
+  if (ctx->mod == 3 && ctx->reg == 0 && ctx->rm >=1 && ctx->rm <= 4)
     {
       /* Override "sgdt".  */
-      char *p = obuf + strlen (obuf) - 4;
+      char *p = ctx->obuf + strlen (ctx->obuf) - 4;
 
       /* We might have a suffix when disassembling with -Msuffix.  */
       if (*p == 'g')
 	--p;
 
-      switch (rm)
+      switch (ctx->rm)
 	{
 	case 1:
 	  strcpy (p, "vmcall");
@@ -4665,21 +4666,560 @@ static void VMX_Fixup (int extrachar ATTRIBUTE_UNUSED, int sizeflag)
 	  break;
 	}
 
-      codep++;
+      ctx->codep++;
+    }
+  else
+    OP_E (ctx, 0, sizeflag);
+}
+
+static void OP_VMX (struct x86_dis_ctx *ctx, int bytemode, int sizeflag)
+{
+  ctx->used_prefixes |= (ctx->prefixes & (PREFIX_DATA | PREFIX_REPZ));
+  if (ctx->prefixes & PREFIX_DATA)
+    strcpy (ctx->obuf, "vmclear");
+  else if (ctx->prefixes & PREFIX_REPZ)
+    strcpy (ctx->obuf, "vmxon");
+  else
+    strcpy (ctx->obuf, "vmptrld");
+  OP_E (ctx, bytemode, sizeflag);
+}
+
+
+/* Structured decoding.  x86_decode_insn walks the same tables as
+   print_insn but only follows the bytes, none of the operand printers
+   or putop run.  The lengths agree with print_insn, including the odd
+   ones it gives to (bad) encodings, except that prefixes print_insn
+   shows on their own because the opcode did not use them are counted
+   in, as the cpu does.  */
+
+/* Return 0 if TEMPLATE has no valid {att|intel|att64|intel64}
+   alternative for this mode, putop prints those as (bad).  */
+
+static int
+decode_template (struct x86_dis_ctx *ctx, const char *template)
+{
+  const char *p;
+  int alt;
+
+  for (p = template; *p; p++)
+    {
+      if (*p != '{')
+	continue;
+      alt = ctx->mode_64bit ? 2 : 0;
+      while (alt != 0)
+	{
+	  while (*++p != '|')
+	    if (*p == '}' || *p == '\0')
+	      return 0;
+	  alt--;
+	}
+    }
+  return 1;
+}
+
+static void
+decode_bad (struct x86_dis_ctx *ctx, struct x86_insn *insn)
+{
+  /* As BadOp, throw away prefixes and 1st. opcode byte.  */
+  ctx->codep = ctx->insn_codep + 1;
+  insn->class = X86_INSN_BAD;
+}
+
+static bfd_signed_vma
+decode_disp (struct x86_dis_ctx *ctx, int size, struct x86_insn *insn)
+{
+  bfd_signed_vma disp;
+
+  insn->disp_offset = ctx->codep - ctx->the_buffer;
+  insn->disp_size = size;
+  switch (size)
+    {
+    case 1:
+      FETCH_DATA (ctx, ctx->codep + 1);
+      disp = *ctx->codep++;
+      if ((disp & 0x80) != 0)
+	disp -= 0x100;
+      break;
+    case 2:
+      disp = get16 (ctx);
+      if ((disp & 0x8000) != 0)
+	disp -= 0x10000;
+      break;
+    case 4:
+      disp = get32s (ctx);
+      break;
+    default:
+      disp = get64 (ctx);
+      break;
+    }
+  insn->disp = disp;
+  return disp;
+}
+
+/* The ModRM operand, see OP_E.  */
+
+static void
+decode_E (struct x86_dis_ctx *ctx, int sizeflag, struct x86_insn *insn)
+{
+  static const signed char base16[] = { 3, 3, 5, 5, 6, 7, 5, 3 };
+  static const signed char index16[] = { 6, 7, 6, 7, -1, -1, -1, -1 };
+
+  MODRM_CHECK;
+  ctx->codep++;
+  if (ctx->mod == 3)
+    return;
+
+  insn->flags |= X86_INSN_MEM;
+  insn->mem_base = -1;
+  insn->mem_index = -1;
+  insn->mem_scale = 1;
+
+  if ((sizeflag & AFLAG) || ctx->mode_64bit)
+    {
+      int havesib = 0;
+      int base = ctx->rm;
+
+      if (base == 4)
+	{
+	  int index;
+
+	  havesib = 1;
+	  FETCH_DATA (ctx, ctx->codep + 1);
+	  insn->sib = *ctx->codep;
+	  index = (*ctx->codep >> 3) & 7;
+	  if (ctx->rex & REX_EXTY)
+	    index += 8;
+	  if (index != 4)
+	    {
+	      insn->mem_index = index;
+	      insn->mem_scale = 1 << ((*ctx->codep >> 6) & 3);
+	    }
+	  base = *ctx->codep & 7;
+	  ctx->codep++;
+	}
+      if (ctx->rex & REX_EXTZ)
+	base += 8;
+
+      switch (ctx->mod)
+	{
+	case 0:
+	  if ((base & 7) == 5)
+	    {
+	      if (ctx->mode_64bit && !havesib)
+		insn->flags |= X86_INSN_RIPREL;
+	      decode_disp (ctx, 4, insn);
+	      return;
+	    }
+	  break;
+	case 1:
+	  decode_disp (ctx, 1, insn);
+	  break;
+	case 2:
+	  decode_disp (ctx, 4, insn);
+	  break;
+	}
+      insn->mem_base = base;
     }
   else
-    OP_E (0, sizeflag);
+    {
+      if (ctx->mod == 0 && ctx->rm == 6)
+	{
+	  decode_disp (ctx, 2, insn);
+	  return;
+	}
+      if (ctx->mod == 1)
+	decode_disp (ctx, 1, insn);
+      else if (ctx->mod == 2)
+	decode_disp (ctx, 2, insn);
+      insn->mem_base = base16[ctx->rm];
+      insn->mem_index = index16[ctx->rm];
+    }
 }
 
-static void OP_VMX (int bytemode, int sizeflag)
+static void
+decode_M (struct x86_dis_ctx *ctx, int sizeflag, struct x86_insn *insn)
 {
-  used_prefixes |= (prefixes & (PREFIX_DATA | PREFIX_REPZ));
-  if (prefixes & PREFIX_DATA)
-    strcpy (obuf, "vmclear");
-  else if (prefixes & PREFIX_REPZ)
-    strcpy (obuf, "vmxon");
+  if (ctx->mod == 3)
+    decode_bad (ctx, insn);
   else
-    strcpy (obuf, "vmptrld");
-  OP_E (bytemode, sizeflag);
+    decode_E (ctx, sizeflag, insn);
+}
+
+static void
+decode_imm (struct x86_dis_ctx *ctx, int size)
+{
+  FETCH_DATA (ctx, ctx->codep + size);
+  ctx->codep += size;
+}
+
+/* Follow one operand of DP.  Each case consumes the bytes the printer
+   named in the comment does.  */
+
+static void
+decode_operand (struct x86_dis_ctx *ctx, op_rtn op, int bytemode,
+		int sizeflag, struct x86_insn *insn)
+{
+  bfd_signed_vma disp;
+
+  if (op == NULL)
+    return;
+
+  if (op == OP_E || op == OP_indirE || op == OP_EM || op == OP_EX
+      || op == OP_VMX || op == SEG_Fixup)
+    decode_E (ctx, sizeflag, insn);
+  else if (op == OP_Rd || op == OP_MS || op == OP_XS)
+    {
+      if (ctx->mod == 3)
+	decode_E (ctx, sizeflag, insn);
+      else
+	decode_bad (ctx, insn);
+    }
+  else if (op == OP_M)
+    decode_M (ctx, sizeflag, insn);
+  else if (op == OP_0f07)
+    {
+      if (ctx->mod != 3 || ctx->rm != 0)
+	decode_bad (ctx, insn);
+      else
+	decode_E (ctx, sizeflag, insn);
+    }
+  else if (op == OP_0fae)
+    {
+      if (ctx->mod == 3 ? ctx->reg < 5 || ctx->rm != 0
+	  : ctx->reg != 5 && ctx->reg != 7)
+	decode_bad (ctx, insn);
+      else
+	decode_E (ctx, sizeflag, insn);
+    }
+  else if (op == VMX_Fixup)
+    {
+      if (ctx->mod == 3 && ctx->reg == 0 && ctx->rm >= 1 && ctx->rm <= 4)
+	ctx->codep++;
+      else
+	decode_E (ctx, sizeflag, insn);
+    }
+  else if (op == PNI_Fixup)
+    {
+      if (ctx->mod == 3 && ctx->reg == 1 && ctx->rm <= 1)
+	ctx->codep++;
+      else
+	decode_M (ctx, sizeflag, insn);
+    }
+  else if (op == SVME_Fixup)
+    {
+      if (*ctx->codep >= 0xd8 && *ctx->codep <= 0xdf)
+	ctx->codep++;
+      else
+	decode_M (ctx, sizeflag, insn);
+    }
+  else if (op == INVLPG_Fixup)
+    {
+      if (*ctx->codep == 0xf8 || *ctx->codep == 0xf9)
+	ctx->codep++;
+      else
+	decode_M (ctx, sizeflag, insn);
+    }
+  else if (op == OP_I || op == OP_sI || (op == OP_I64 && !ctx->mode_64bit))
+    {
+      /* OP_I, OP_sI.  */
+      switch (bytemode)
+	{
+	case b_mode:
+	  decode_imm (ctx, 1);
+	  break;
+	case q_mode:
+	case v_mode:
+	  decode_imm (ctx, (ctx->rex & REX_MODE64) || (sizeflag & DFLAG)
+			   || (bytemode == q_mode && ctx->mode_64bit)
+			   ? 4 : 2);
+	  break;
+	case w_mode:
+	  decode_imm (ctx, 2);
+	  break;
+	}
+    }
+  else if (op == OP_I64)
+    {
+      switch (bytemode)
+	{
+	case b_mode:
+	  decode_imm (ctx, 1);
+	  break;
+	case v_mode:
+	  decode_imm (ctx, (ctx->rex & REX_MODE64) ? 8
+			   : (sizeflag & DFLAG) ? 4 : 2);
+	  break;
+	case w_mode:
+	  decode_imm (ctx, 2);
+	  break;
+	}
+    }
+  else if (op == OP_J)
+    {
+      bfd_vma mask = -1;
+
+      if (bytemode == b_mode)
+	{
+	  decode_imm (ctx, 1);
+	  disp = (signed char) ctx->codep[-1];
+	}
+      else if (sizeflag & DFLAG)
+	disp = get32s (ctx);
+      else
+	{
+	  disp = get16 (ctx);
+	  mask = 0xffff;
+	}
+      insn->target = (ctx->start_pc + ctx->codep - ctx->start_codep
+		      + disp) & mask;
+      if (!ctx->mode_64bit)
+	insn->target &= 0xffffffff;
+      insn->flags |= X86_INSN_TARGET;
+    }
+  else if (op == OP_DIR)
+    {
+      insn->target = (sizeflag & DFLAG) ? get32 (ctx) : get16 (ctx);
+      get16 (ctx);
+      insn->flags |= X86_INSN_TARGET | X86_INSN_FAR;
+    }
+  else if (op == OP_OFF || op == OP_OFF64)
+    {
+      insn->flags |= X86_INSN_MEM;
+      insn->mem_base = -1;
+      insn->mem_index = -1;
+      insn->mem_scale = 1;
+      if (op == OP_OFF64 && ctx->mode_64bit)
+	decode_disp (ctx, 8, insn);
+      else if ((sizeflag & AFLAG) || ctx->mode_64bit)
+	{
+	  decode_disp (ctx, 4, insn);
+	  insn->disp &= 0xffffffff;
+	}
+      else
+	{
+	  decode_disp (ctx, 2, insn);
+	  insn->disp &= 0xffff;
+	}
+    }
+  else if (op == OP_3DNowSuffix)
+    {
+      decode_imm (ctx, 1);
+      if (Suffix3DNow[ctx->codep[-1]] == NULL)
+	decode_bad (ctx, insn);
+    }
+  else if (op == OP_SIMD_Suffix)
+    {
+      decode_imm (ctx, 1);
+      if (ctx->codep[-1] >= 8)
+	decode_bad (ctx, insn);
+    }
+  /* The register operands and fixups only print.  */
 }
 
+/* Decode the instruction at PC without formatting it.  CTX is the
+   caller's decoder state as for print_insn_i386_ctx, INFO supplies the
+   machine, options and read_memory_func.  Fill in INSN and return its
+   length, or -1 if the instruction could not be read.  */
+
+int
+x86_decode_insn (struct x86_dis_ctx *ctx, bfd_vma pc,
+		 disassemble_info *info, struct x86_insn *insn)
+{
+  const struct dis386 *dp;
+  unsigned char uses_SSE_prefix;
+  int sizeflag;
+  int opcode;
+
+  ctx->decode_only = 1;
+  ctx->fetch_error = 0;
+  ctx->intel_syntax = 0;
+  set_mode (ctx, info);
+
+  ctx->info = info;
+  ctx->max_fetched = ctx->the_buffer;
+  ctx->insn_start = pc;
+  ctx->start_pc = pc;
+  ctx->start_codep = ctx->the_buffer;
+  ctx->codep = ctx->the_buffer;
+
+  memset (insn, 0, sizeof (*insn));
+  insn->modrm = -1;
+  insn->sib = -1;
+  insn->mem_base = -1;
+  insn->mem_index = -1;
+
+#ifndef __KERNEL__
+  if (setjmp (ctx->bailout) != 0)
+    return -1;
+#endif	/* __KERNEL__ */
+
+  ckprefix (ctx);
+  insn->prefixes = ctx->prefixes;
+  insn->rex = ctx->rex;
+
+  ctx->insn_codep = ctx->codep;
+  sizeflag = ctx->orig_sizeflag;
+
+  FETCH_DATA (ctx, ctx->codep + 1);
+  if ((ctx->prefixes & PREFIX_FWAIT)
+      && ((*ctx->codep < 0xd8) || (*ctx->codep > 0xdf)))
+    {
+      /* fwait not followed by floating point instruction.  As in
+	 print_insn the first byte stands on its own.  */
+      ctx->codep = ctx->the_buffer + 1;
+      insn->prefixes = 0;
+      insn->rex = 0;
+      insn->opcode = ctx->the_buffer[0];
+      goto done;
+    }
+
+  if (*ctx->codep == 0x0f)
+    {
+      FETCH_DATA (ctx, ctx->codep + 2);
+      opcode = 0x0f00 | *++ctx->codep;
+      dp = &dis386_twobyte[*ctx->codep];
+      ctx->need_modrm = twobyte_has_modrm[*ctx->codep];
+      uses_SSE_prefix = twobyte_uses_SSE_prefix[*ctx->codep];
+    }
+  else
+    {
+      opcode = *ctx->codep;
+      dp = &dis386[*ctx->codep];
+      ctx->need_modrm = onebyte_has_modrm[*ctx->codep];
+      uses_SSE_prefix = 0;
+    }
+  ctx->codep++;
+  insn->opcode = opcode;
+
+  if (ctx->prefixes & PREFIX_ADDR)
+    sizeflag ^= AFLAG;
+  if (!uses_SSE_prefix && (ctx->prefixes & PREFIX_DATA))
+    sizeflag ^= DFLAG;
+
+  if (ctx->need_modrm)
+    {
+      FETCH_DATA (ctx, ctx->codep + 1);
+      insn->modrm = *ctx->codep;
+      ctx->mod = (*ctx->codep >> 6) & 3;
+      ctx->reg = (*ctx->codep >> 3) & 7;
+      ctx->rm = *ctx->codep & 7;
+    }
+
+  if (dp->name == NULL && dp->bytemode1 == FLOATCODE)
+    {
+      /* dofloat, the memory forms and the register forms alike only
+	 have the ModRM operand.  */
+      unsigned char floatop = ctx->codep[-1] - 0xd8;
+      const char *name;
+
+      if (ctx->mod != 3)
+	name = float_mem[floatop * 8 + ctx->reg];
+      else
+	{
+	  dp = &float_reg[floatop][ctx->reg];
+	  name = dp->name ? dp->name : fgrps[dp->bytemode1][ctx->rm];
+	}
+      if (name[0] == '(')
+	insn->class = X86_INSN_BAD;
+      decode_E (ctx, sizeflag, insn);
+      goto done;
+    }
+
+  if (dp->name == NULL)
+    {
+      switch (dp->bytemode1)
+	{
+	case USE_GROUPS:
+	  dp = &grps[dp->bytemode2][ctx->reg];
+	  break;
+
+	case USE_PREFIX_USER_TABLE:
+	  if (ctx->prefixes & PREFIX_REPZ)
+	    dp = &prefix_user_table[dp->bytemode2][1];
+	  else if (ctx->prefixes & PREFIX_DATA)
+	    dp = &prefix_user_table[dp->bytemode2][2];
+	  else if (ctx->prefixes & PREFIX_REPNZ)
+	    dp = &prefix_user_table[dp->bytemode2][3];
+	  else
+	    dp = &prefix_user_table[dp->bytemode2][0];
+	  break;
+
+	case X86_64_SPECIAL:
+	  dp = &x86_64_table[dp->bytemode2][ctx->mode_64bit];
+	  break;
+	}
+    }
+
+  if (dp->name == NULL || !decode_template (ctx, dp->name))
+    {
+      insn->class = X86_INSN_BAD;
+      goto done;
+    }
+  if (dp->name[0] == '(')
+    insn->class = X86_INSN_BAD;
+
+  decode_operand (ctx, dp->op1, dp->bytemode1, sizeflag, insn);
+  decode_operand (ctx, dp->op2, dp->bytemode2, sizeflag, insn);
+  decode_operand (ctx, dp->op3, dp->bytemode3, sizeflag, insn);
+
+  if (insn->class == X86_INSN_BAD)
+    goto done;
+
+  switch (opcode)
+    {
+    case 0xe8:
+    case 0x9a:
+      insn->class = X86_INSN_CALL;
+      break;
+    case 0xe9:
+    case 0xea:
+    case 0xeb:
+      insn->class = X86_INSN_JMP;
+      break;
+    case 0xca:
+    case 0xcb:
+      insn->flags |= X86_INSN_FAR;
+      /* Fall through.  */
+    case 0xc2:
+    case 0xc3:
+      insn->class = X86_INSN_RET;
+      break;
+    case 0xcf:
+      insn->class = X86_INSN_IRET;
+      break;
+    case 0xcc:
+    case 0xcd:
+    case 0xce:
+      insn->class = X86_INSN_INT;
+      break;
+    case 0x0f05:
+    case 0x0f07:
+    case 0x0f34:
+    case 0x0f35:
+      insn->class = X86_INSN_SYSCALL;
+      break;
+    case 0xff:
+      if (ctx->reg >= 2 && ctx->reg <= 5)
+	{
+	  insn->class = ctx->reg <= 3 ? X86_INSN_CALL : X86_INSN_JMP;
+	  insn->flags |= X86_INSN_INDIRECT;
+	  if (ctx->reg & 1)
+	    insn->flags |= X86_INSN_FAR;
+	}
+      break;
+    default:
+      if (dp->bytemode3 == cond_jump_mode || dp->bytemode3 == loop_jcxz_mode)
+	insn->class = X86_INSN_JCC;
+      break;
+    }
+
+ done:
+  if (ctx->fetch_error)
+    return -1;
+  insn->length = ctx->codep - ctx->the_buffer;
+  if (insn->class == X86_INSN_BAD)
+    insn->flags = 0;
+  if (insn->flags & X86_INSN_RIPREL)
+    insn->riprel = pc + insn->length + insn->disp;
+  return insn->length;
+}
@@ -0,0 +1,152 @@
+/* Decoder state for the i386/x86-64 disassembler in x86-dis.c.
+
+   Everything the decoder changes while it works on one instruction lives
+   in a struct x86_dis_ctx owned by the caller, the tables in x86-dis.c
+   are all const.  Two contexts can decode at the same time, for example
+   on two cpus, as long as each has its own disassemble_info.
+
+   This file is subject to the terms and conditions of the GNU General
+   Public License.  See the file "COPYING" in the main directory of this
+   archive for more details.  */
+
+#ifndef _X86_DIS_H
+#define _X86_DIS_H
+
+#ifdef __KERNEL__
+#include "../dis-asm.h"
+#else	/* __KERNEL__ */
+#include "dis-asm.h"
+#include <setjmp.h>
+#endif	/* __KERNEL__ */
+
+/* Longest instruction the decoder will fetch.  */
+#define X86_DIS_MAXLEN 20
+
+/* Prefix flags, in x86_dis_ctx.prefixes and x86_insn.prefixes.  */
+#define X86_PREFIX_REPZ 1
+#define X86_PREFIX_REPNZ 2
+#define X86_PREFIX_LOCK 4
+#define X86_PREFIX_CS 8
+#define X86_PREFIX_SS 0x10
+#define X86_PREFIX_DS 0x20
+#define X86_PREFIX_ES 0x40
+#define X86_PREFIX_FS 0x80
+#define X86_PREFIX_GS 0x100
+#define X86_PREFIX_DATA 0x200
+#define X86_PREFIX_ADDR 0x400
+#define X86_PREFIX_FWAIT 0x800
+
+/* Instruction classes, x86_insn.class.  */
+#define X86_INSN_OTHER 0
+#define X86_INSN_BAD 1		/* not a valid instruction */
+#define X86_INSN_JMP 2
+#define X86_INSN_JCC 3		/* conditional jumps, loop and jcxz */
+#define X86_INSN_CALL 4
+#define X86_INSN_RET 5
+#define X86_INSN_IRET 6
+#define X86_INSN_INT 7		/* int3, int and into */
+#define X86_INSN_SYSCALL 8	/* syscall, sysret, sysenter and sysexit */
+
+/* x86_insn.flags.  */
+#define X86_INSN_TARGET 0x1	/* direct branch, target is valid */
+#define X86_INSN_INDIRECT 0x2	/* branch through a register or memory */
+#define X86_INSN_FAR 0x4	/* far branch or return */
+#define X86_INSN_MEM 0x8	/* ModRM or moffs memory operand, see mem_* */
+#define X86_INSN_RIPREL 0x10	/* the memory operand is rip relative */
+
+/* One decoded instruction, filled in by x86_decode_insn.  Registers
+   are numbered as in the encoding, 0-15, or -1 if absent.  16 bit
+   addressing modes are reported the same way, (%bx,%si) has base 3 and
+   index 6.  String instructions and other implicit memory accesses do
+   not set X86_INSN_MEM.  */
+struct x86_insn {
+  int length;			/* in bytes, prefixes included */
+  int prefixes;			/* X86_PREFIX_* */
+  int rex;			/* REX prefix byte, 0 if none */
+  int opcode;			/* 0x00-0xff, 0x0f00-0x0fff for 0x0f xx */
+  int modrm;			/* -1 if none */
+  int sib;			/* -1 if none */
+  int class;			/* X86_INSN_* */
+  int flags;			/* X86_INSN_* flags */
+  bfd_vma target;		/* direct branch target, offset if far */
+  int mem_base;
+  int mem_index;
+  int mem_scale;		/* 1, 2, 4 or 8 */
+  int disp_offset;		/* of the displacement in the insn */
+  int disp_size;		/* 0, 1, 2, 4 or 8 bytes */
+  bfd_signed_vma disp;
+  bfd_vma riprel;		/* address of a rip relative operand */
+};
+
+struct x86_dis_ctx {
+  disassemble_info *info;
+
+  /* Fetch state.  Points to first byte not fetched.  */
+  bfd_byte *max_fetched;
+  bfd_byte the_buffer[X86_DIS_MAXLEN];
+  bfd_vma insn_start;
+  int orig_sizeflag;
+#ifndef __KERNEL__
+  jmp_buf bailout;
+#endif	/* __KERNEL__ */
+
+  /* Set by x86_decode_insn, nothing is formatted.  */
+  char decode_only;
+  /* Status of a failed read, 0 if all reads worked.  */
+  int fetch_error;
+
+  /* Set to 1 for 64bit mode disassembly.  */
+  int mode_64bit;
+  /* Flags for the prefixes for the current instruction.  */
+  int prefixes;
+  /* REX prefix the current instruction.  */
+  int rex;
+  /* Bits of REX we've already used.  */
+  int rex_used;
+  /* Flags for prefixes which we somehow handled when printing the
+     current instruction.  */
+  int used_prefixes;
+
+  char obuf[100];
+  char *obufp;
+  char scratchbuf[100];
+  unsigned char *start_codep;
+  unsigned char *insn_codep;
+  unsigned char *codep;
+  int mod;
+  int rm;
+  int reg;
+  unsigned char need_modrm;
+
+  char op1out[100], op2out[100], op3out[100];
+  int op_ad, op_index[3];
+  int two_source_ops;
+  bfd_vma op_address[3];
+  bfd_vma op_riprel[3];
+  bfd_vma start_pc;
+
+  /* Syntax, set from the mach and options for each instruction.  */
+  char intel_syntax;
+  char open_char;
+  char close_char;
+  char separator_char;
+  char scale_char;
+  const char *const *names64;
+  const char *const *names32;
+  const char *const *names16;
+  const char *const *names8;
+  const char *const *names8rex;
+  const char *const *names_seg;
+  const char *const *index16;
+};
+
+extern int print_insn_i386_ctx (struct x86_dis_ctx *, bfd_vma,
+				disassemble_info *);
+extern int print_insn_i386_att_ctx (struct x86_dis_ctx *, bfd_vma,
+				    disassemble_info *);
+extern int print_insn_i386_intel_ctx (struct x86_dis_ctx *, bfd_vma,
+				      disassemble_info *);
+extern int x86_decode_insn (struct x86_dis_ctx *, bfd_vma,
+			    disassemble_info *, struct x86_insn *);
+
+#endif	/* _X86_DIS_H */
@@ -0,0 +1,206 @@
+/* Table driven i386/x86-64 instruction length decoder, see x86-len.h.
+
+   This file is subject to the terms and conditions of the GNU General
+   Public License.  See the file "COPYING" in the main directory of this
+   archive for more details.  */
+
+#ifdef __KERNEL__
+#include <linux/compiler.h>
+#include <linux/string.h>
+#else	/* __KERNEL__ */
+#include <string.h>
+#ifndef __always_inline
+#define __always_inline inline __attribute__ ((always_inline))
+#endif
+#endif	/* __KERNEL__ */
+#include "x86-len.h"
+#include "x86-lentab.h"
+
+/* Legacy prefixes and REX, as ckprefix.  0x9b fwait is not one, it
+   is an instruction of its own here, as it is to the cpu.  */
+#define PFX_LEGACY 0x1
+#define PFX_DATA 0x2
+#define PFX_ADDR 0x4
+#define PFX_REX 0x8
+#define PFX_REXW 0x10
+
+#define REX(w) PFX_REX | (w)
+
+static const unsigned char x86_len_prefix[256] = {
+  [0x26] = PFX_LEGACY, [0x2e] = PFX_LEGACY, [0x36] = PFX_LEGACY,
+  [0x3e] = PFX_LEGACY, [0x64] = PFX_LEGACY, [0x65] = PFX_LEGACY,
+  [0xf0] = PFX_LEGACY, [0xf2] = PFX_LEGACY, [0xf3] = PFX_LEGACY,
+  [0x66] = PFX_LEGACY | PFX_DATA, [0x67] = PFX_LEGACY | PFX_ADDR,
+  [0x40] = REX (0), [0x41] = REX (0), [0x42] = REX (0), [0x43] = REX (0),
+  [0x44] = REX (0), [0x45] = REX (0), [0x46] = REX (0), [0x47] = REX (0),
+  [0x48] = REX (PFX_REXW), [0x49] = REX (PFX_REXW), [0x4a] = REX (PFX_REXW),
+  [0x4b] = REX (PFX_REXW), [0x4c] = REX (PFX_REXW), [0x4d] = REX (PFX_REXW),
+  [0x4e] = REX (PFX_REXW), [0x4f] = REX (PFX_REXW),
+};
+
+/* The decoder reads at most this far without checking, 14 prefixes,
+   an EVEX opcode with ModRM and SIB.  */
+#define X86_LEN_READ 32
+
+/* Scanning text is bound by the chain of loads from one instruction to
+   the next and by mispredicted branches.  The common path is a few
+   table lookups and masks, x86_len_op already has the group members
+   spread out by reg.  Only prefixes and the escapes branch, so that
+   with no prefix the opcode lookup does not wait for the prefix one.
+   MODE is a constant at each call, x86_insn_len has a copy per mode.  */
+
+static __always_inline int
+insn_len (const unsigned char *buf, int mode, int *flags)
+{
+  static const unsigned char rel_flags[9] = {
+    [1] = X86_LEN_REL8, [2] = X86_LEN_REL16, [4] = X86_LEN_REL32,
+  };
+  const unsigned char *p = buf, *pfx_end = buf + X86_LEN_MAX - 1;
+  unsigned int pmask = mode == 64 ? ~0U : ~(PFX_REX | PFX_REXW);
+  unsigned int pfx, last, e, c, m, modrm, state, map;
+  int imm, len, out = 0;
+
+  /* Most instructions have no prefix.  REX only counts when it is the
+     last prefix.  */
+  pfx = last = x86_len_prefix[*p] & pmask;
+  if (pfx)
+    {
+      p++;
+      while ((c = x86_len_prefix[*p] & pmask) != 0 && p < pfx_end)
+	{
+	  pfx |= c;
+	  last = c;
+	  p++;
+	}
+    }
+
+  c = *p++;
+  e = x86_len_op[0][c][(*p >> 3) & 7];
+  if (e & X86_LT_ESC)
+    {
+      if (c == 0x0f)
+	{
+	  c = *p++;
+	  e = x86_len_op[1][c][(*p >> 3) & 7];
+	  if ((c == 0x38 || c == 0x3a) && (e & X86_LT_BAD))
+	    {
+	      /* Three byte opcodes, not in the tables.  */
+	      p++;
+	      e = c == 0x38 ? X86_LT_MODRM : X86_LT_MODRM | X86_LT_IB;
+	    }
+	}
+      else if (mode == 64 || (mode == 32 && (*p & 0xc0) == 0xc0))
+	{
+	  /* VEX, EVEX.  Outside 64 bit mode these are les, lds and
+	     bound unless ModRM would be a register.  */
+	  out |= X86_LEN_VEX;
+	  if (c == 0xc5)
+	    {
+	      map = 1;
+	      p += 1;
+	    }
+	  else if (c == 0xc4)
+	    {
+	      map = *p & 0x1f;
+	      if (p[1] & 0x80)
+		last |= PFX_REXW;
+	      p += 2;
+	    }
+	  else
+	    {
+	      map = *p & 0x7;
+	      p += 3;
+	    }
+	  c = *p++;
+	  if (map == 1)
+	    e = x86_len_op[1][c][(*p >> 3) & 7];
+	  else if (map == 2 || map == 5 || map == 6)
+	    e = X86_LT_MODRM;
+	  else if (map == 3)
+	    e = X86_LT_MODRM | X86_LT_IB;
+	  else
+	    e = X86_LT_MODRM | X86_LT_BAD;
+	}
+    }
+  modrm = *p;
+
+  state = mode != 16;
+  state ^= (pfx & PFX_DATA) && !(e & X86_LT_SSE) ? X86_LS_DFLAG : 0;
+  if (mode == 64)
+    state |= X86_LS_AFLAG;
+  else
+    state |= (mode == 32) != !!(pfx & PFX_ADDR) ? X86_LS_AFLAG : 0;
+  state |= last & PFX_REXW ? X86_LS_REXW : 0;
+  if (mode == 64)
+    {
+      state |= X86_LS_64BIT;
+      e |= (e & X86_LT_BAD64) >> 1;
+    }
+
+  /* SIB and displacement, p[1] is the SIB byte if there is one.  */
+  m = x86_len_modrm[(state & X86_LS_AFLAG) != 0][modrm];
+  m = (m & ~X86_LM_SIB0) + ((m & X86_LM_SIB0) && (p[1] & 7) == 5 ? 4 : 0);
+  p += (1 + m) & -((e & X86_LT_MODRM) != 0);
+
+  imm = x86_len_imm[e & X86_LT_IMM][state];
+  len = p + imm - buf;
+
+  out |= (e & X86_LT_BRANCH) ? X86_LEN_BRANCH : 0;
+  out |= rel_flags[imm] & -((e & X86_LT_REL) != 0);
+  out |= (e & X86_LT_BAD) || len > X86_LEN_MAX ? X86_LEN_BAD : 0;
+  *flags = out;
+  return len;
+}
+
+/*
+ * x86_insn_len
+ *
+ *	Work out the length of the instruction at BUF.
+ *
+ * Inputs:
+ *	buf	Instruction bytes.
+ *	size	Number of valid bytes at buf.
+ *	mode	16, 32 or 64, the code size.
+ * Outputs:
+ *	*flags	X86_LEN_* flags for the instruction.
+ * Returns:
+ *	The length in bytes, prefixes included, or -1 if the instruction
+ *	does not fit in size bytes.
+ * Locking:
+ *	None, the tables are constant.
+ * Remarks:
+ *	The lengths match x86_decode_insn for every instruction it
+ *	decodes as valid.  The 0x0f 0x38 and 0x0f 0x3a maps, VEX and
+ *	EVEX are not in the x86-dis.c tables.  Those are sized by the
+ *	rules of their maps, every opcode has ModRM, 0x0f 0x3a and map 3
+ *	add an imm8 and map 1 is looked up in the two byte table.
+ *	Invalid encodings still get a length so that a scan can step
+ *	over them, X86_LEN_BAD says it is not to be trusted.
+ *
+ *	Near the end of buf the bytes are copied to a zero padded buffer
+ *	first, so the decoder itself never has to check how far it may
+ *	read.  Any other mode than 64 and 32 is taken as 16.
+ */
+
+int
+x86_insn_len (const unsigned char *buf, int size, int mode, int *flags)
+{
+  unsigned char tail[X86_LEN_READ];
+  int len;
+
+  if (size < X86_LEN_READ)
+    {
+      if (size <= 0)
+	return -1;
+      memset (tail, 0, sizeof (tail));
+      memcpy (tail, buf, size);
+      buf = tail;
+    }
+  if (mode == 64)
+    len = insn_len (buf, 64, flags);
+  else if (mode == 32)
+    len = insn_len (buf, 32, flags);
+  else
+    len = insn_len (buf, 16, flags);
+  return len <= size ? len : -1;
+}
@@ -0,0 +1,90 @@
+/* Table driven i386/x86-64 instruction length decoder.
+
+   x86_insn_len only works out how long an instruction is and whether
+   it transfers control, which is all that stepping, breakpoint
+   placement and text scanning need.  The opcode properties come from
+   x86-lentab.h, which x86-lengen generates at build time from the
+   dis386, dis386_twobyte and grps tables in x86-dis.c, so the lengths
+   agree with x86_decode_insn.
+
+   This file is subject to the terms and conditions of the GNU General
+   Public License.  See the file "COPYING" in the main directory of this
+   archive for more details.  */
+
+#ifndef _X86_LEN_H
+#define _X86_LEN_H
+
+/* Longest valid instruction.  */
+#define X86_LEN_MAX 15
+
+/* Flags returned by x86_insn_len.  */
+#define X86_LEN_BRANCH 0x1	/* jmp, jcc, call, ret, int, syscall ... */
+#define X86_LEN_REL8 0x2	/* ends in an 8 bit relative target */
+#define X86_LEN_REL16 0x4	/* ends in a 16 bit relative target */
+#define X86_LEN_REL32 0x8	/* ends in a 32 bit relative target */
+#define X86_LEN_BAD 0x10	/* not a valid instruction */
+#define X86_LEN_VEX 0x20	/* VEX or EVEX encoded */
+
+#define X86_LEN_REL (X86_LEN_REL8 | X86_LEN_REL16 | X86_LEN_REL32)
+
+/* Opcode properties in x86-lentab.h.  The low bits are the immediate
+   class, the sizes are for the operand and address size in effect.  */
+#define X86_LT_I0 0		/* no immediate */
+#define X86_LT_IB 1		/* 1 byte */
+#define X86_LT_IW 2		/* 2 bytes */
+#define X86_LT_IZ 3		/* 2 or 4, 4 with REX.W */
+#define X86_LT_IQ 4		/* as X86_LT_IZ, always 4 in 64 bit mode */
+#define X86_LT_IV 5		/* 2, 4 or 8 with REX.W */
+#define X86_LT_IJ 6		/* 2 or 4, REX.W ignored */
+#define X86_LT_IP 7		/* far pointer, 4 or 6 */
+#define X86_LT_IO 8		/* moffs, 2 or 4 by address size */
+#define X86_LT_IO64 9		/* as X86_LT_IO, 8 in 64 bit mode */
+#define X86_LT_IWB 10		/* enter, 2 + 1 */
+#define X86_LT_IMM 0xf
+
+#define X86_LT_MODRM 0x10	/* has a ModRM byte */
+#define X86_LT_SSE 0x20		/* 0x66 selects the insn, not the size */
+#define X86_LT_BRANCH 0x40	/* transfers control */
+#define X86_LT_REL 0x80		/* the immediate is a relative target */
+#define X86_LT_BAD 0x100	/* not valid in any mode */
+#define X86_LT_BAD64 0x200	/* not valid in 64 bit mode, BAD << 1 */
+#define X86_LT_ESC 0x400	/* 0x0f, or may start VEX or EVEX */
+
+/* x86_len_op[map][opcode][reg] holds the properties, map 0 is the one
+   byte opcodes and map 1 the ones after 0x0f.  reg is the ModRM reg
+   field, it picks the member of a group and is ignored otherwise.  */
+
+/* x86_len_imm[class][state] is the immediate size, state is made of
+   these bits.  */
+#define X86_LS_DFLAG 1		/* 32 bit operand size */
+#define X86_LS_AFLAG 2		/* 32 or 64 bit address size */
+#define X86_LS_REXW 4
+#define X86_LS_64BIT 8
+
+/* x86_len_modrm[aflag][modrm] is the number of SIB and displacement
+   bytes after ModRM.  With this bit set there is a SIB byte and mod is
+   0, a SIB base of 5 adds a 32 bit displacement.  */
+#define X86_LM_SIB0 0x80
+
+extern int x86_insn_len (const unsigned char *, int, int, int *);
+
+/* Return the target of the relative branch INSN of length LEN at PC,
+   FLAGS are the ones x86_insn_len returned for it.  */
+static inline unsigned long
+x86_len_target (const unsigned char *insn, int len, int flags,
+		unsigned long pc)
+{
+  const unsigned char *p = insn + len;
+  long disp;
+
+  if (flags & X86_LEN_REL8)
+    disp = (signed char) p[-1];
+  else if (flags & X86_LEN_REL16)
+    return (pc + len + (short) (p[-2] | p[-1] << 8)) & 0xffff;
+  else
+    disp = (int) (p[-4] | p[-3] << 8 | p[-2] << 16
+		  | (unsigned int) p[-1] << 24);
+  return pc + len + disp;
+}
+
+#endif	/* _X86_LEN_H */
@@ -0,0 +1,357 @@
+/* Generate x86-lentab.h for the length decoder in x86-len.c.
+
+   Built and run on the host.  It includes x86-dis.c itself, so the
+   opcode properties are read out of the same dis386, dis386_twobyte,
+   grps, prefix_user_table and x86_64_table entries the disassembler
+   uses.  An operand it does not know how to size stops the build
+   rather than producing a table that disagrees with the disassembler.
+
+   This file is subject to the terms and conditions of the GNU General
+   Public License.  See the file "COPYING" in the main directory of this
+   archive for more details.  */
+
+#include "x86-dis.c"
+#include "x86-len.h"
+
+#define ARRAY_SIZE(a) (sizeof (a) / sizeof ((a)[0]))
+
+/* Group number + 1 in the opcode properties, until the groups are
+   expanded into x86_len_op.  */
+#define GRP_SHIFT 11
+
+static const char *where;
+
+static void
+fail (const char *why)
+{
+  fprintf (stderr, "x86-lengen: %s: %s\n", where, why);
+  exit (1);
+}
+
+/* Name without the template letters that only change how it prints.  */
+
+static int
+name_is (const char *name, const char *prefix)
+{
+  if (*name == 'J')
+    name++;
+  return strncmp (name, prefix, strlen (prefix)) == 0;
+}
+
+static int
+bad_name (const char *name)
+{
+  return name == NULL || name[0] == '(';
+}
+
+/* Return 1 if TEMPLATE has an alternative for 64 bit mode, as
+   decode_template.  */
+
+static int
+has_64bit_alt (const char *template)
+{
+  const char *p;
+  int alt;
+
+  for (p = template; *p; p++)
+    {
+      if (*p != '{')
+	continue;
+      for (alt = 2; alt != 0; alt--)
+	while (*++p != '|')
+	  if (*p == '}' || *p == '\0')
+	    return 0;
+    }
+  return 1;
+}
+
+/* Immediate class for one operand.  */
+
+static int
+operand_imm (op_rtn op, int bytemode)
+{
+  if (op == OP_I || op == OP_sI || op == OP_I64)
+    {
+      switch (bytemode)
+	{
+	case const_1_mode:
+	  /* The implied 1 of the shifts.  */
+	  return X86_LT_I0;
+	case b_mode:
+	  return X86_LT_IB;
+	case w_mode:
+	  return X86_LT_IW;
+	case v_mode:
+	  return op == OP_I64 ? X86_LT_IV : X86_LT_IZ;
+	case q_mode:
+	  if (op != OP_I64)
+	    return X86_LT_IQ;
+	  break;
+	}
+      fail ("unknown immediate size");
+    }
+  if (op == OP_J)
+    return bytemode == b_mode ? X86_LT_IB : X86_LT_IJ;
+  if (op == OP_DIR)
+    return X86_LT_IP;
+  if (op == OP_OFF)
+    return X86_LT_IO;
+  if (op == OP_OFF64)
+    return X86_LT_IO64;
+  if (op == OP_3DNowSuffix || op == OP_SIMD_Suffix)
+    return X86_LT_IB;
+  return X86_LT_I0;
+}
+
+/* Properties of one resolved table entry, without X86_LT_MODRM.  */
+
+static int
+entry_props (const struct dis386 *dp)
+{
+  int imm[3], n = 0, e = 0, i;
+
+  if (bad_name (dp->name))
+    return X86_LT_BAD;
+  if (!has_64bit_alt (dp->name))
+    e |= X86_LT_BAD64;
+
+  imm[0] = operand_imm (dp->op1, dp->bytemode1);
+  imm[1] = operand_imm (dp->op2, dp->bytemode2);
+  imm[2] = operand_imm (dp->op3, dp->bytemode3);
+  for (i = 0; i < 3; i++)
+    if (imm[i] != X86_LT_I0)
+      imm[n++] = imm[i];
+  if (n == 1)
+    e |= imm[0];
+  else if (n == 2 && imm[0] == X86_LT_IW && imm[1] == X86_LT_IB)
+    e |= X86_LT_IWB;
+  else if (n != 0)
+    fail ("unknown immediate combination");
+
+  if (dp->op1 == OP_J || dp->op2 == OP_J || dp->op3 == OP_J)
+    e |= X86_LT_BRANCH | X86_LT_REL;
+  if (dp->op1 == OP_DIR
+      || dp->bytemode3 == cond_jump_mode || dp->bytemode3 == loop_jcxz_mode
+      || name_is (dp->name, "call") || name_is (dp->name, "jmp")
+      || name_is (dp->name, "ret") || name_is (dp->name, "lret")
+      || name_is (dp->name, "iret") || name_is (dp->name, "int")
+      || name_is (dp->name, "sys"))
+    e |= X86_LT_BRANCH;
+  return e;
+}
+
+/* Merge the alternatives of a prefix or mode dependent entry.  They
+   may differ in validity, nothing else changes the length.  */
+
+static int
+merge_props (int e, int alt)
+{
+  if (e & X86_LT_BAD)
+    return alt;
+  if (alt & X86_LT_BAD)
+    return e;
+  if ((e & ~X86_LT_BAD64) != (alt & ~X86_LT_BAD64))
+    fail ("alternatives differ");
+  return e & alt;
+}
+
+static int
+opcode_props (const struct dis386 *dp, int has_modrm, int sse)
+{
+  int e, i;
+
+  if (has_modrm)
+    e = X86_LT_MODRM;
+  else
+    e = 0;
+  if (sse)
+    e |= X86_LT_SSE;
+
+  if (dp->name != NULL)
+    {
+      e |= entry_props (dp);
+      if (sse && (e & X86_LT_IMM) != X86_LT_I0
+	  && (e & X86_LT_IMM) != X86_LT_IB)
+	fail ("operand sized immediate with a mandatory prefix");
+      return e;
+    }
+
+  switch (dp->bytemode1)
+    {
+    case FLOATCODE:
+      if (!has_modrm)
+	fail ("float without ModRM");
+      return e;
+
+    case USE_GROUPS:
+      if (!has_modrm)
+	fail ("group without ModRM");
+      return e | (dp->bytemode2 + 1) << GRP_SHIFT;
+
+    case USE_PREFIX_USER_TABLE:
+      {
+	int alt = X86_LT_BAD;
+
+	for (i = 0; i < 4; i++)
+	  alt = merge_props (alt,
+			     entry_props (&prefix_user_table[dp->bytemode2][i]));
+	if ((alt & X86_LT_IMM) != X86_LT_I0 && (alt & X86_LT_IMM) != X86_LT_IB)
+	  fail ("operand sized immediate with a mandatory prefix");
+	return e | alt;
+      }
+
+    case X86_64_SPECIAL:
+      {
+	int e32 = entry_props (&x86_64_table[dp->bytemode2][0]);
+	int e64 = entry_props (&x86_64_table[dp->bytemode2][1]);
+
+	if (e64 & X86_LT_BAD)
+	  e32 |= X86_LT_BAD64;
+	else if (e32 & X86_LT_BAD)
+	  fail ("64 bit only entry");
+	else if (e32 != (e64 & ~X86_LT_BAD64))
+	  fail ("alternatives differ");
+	return e | e32;
+      }
+    }
+  return e | X86_LT_BAD;
+}
+
+/* Immediate size of class IMM in STATE, X86_LS_* bits.  */
+
+static int
+imm_size (int imm, int state)
+{
+  int dflag = state & X86_LS_DFLAG;
+  int aflag = state & X86_LS_AFLAG;
+  int rexw = state & X86_LS_REXW;
+  int mode64 = state & X86_LS_64BIT;
+
+  switch (imm)
+    {
+    case X86_LT_IB:
+      return 1;
+    case X86_LT_IW:
+      return 2;
+    case X86_LT_IZ:
+      return rexw || dflag ? 4 : 2;
+    case X86_LT_IQ:
+      return rexw || dflag || mode64 ? 4 : 2;
+    case X86_LT_IV:
+      return rexw ? 8 : dflag ? 4 : 2;
+    case X86_LT_IJ:
+      return dflag ? 4 : 2;
+    case X86_LT_IP:
+      return dflag ? 6 : 4;
+    case X86_LT_IO:
+      return aflag ? 4 : 2;
+    case X86_LT_IO64:
+      return mode64 ? 8 : aflag ? 4 : 2;
+    case X86_LT_IWB:
+      return 3;
+    }
+  return 0;
+}
+
+/* SIB and displacement bytes after MODRM, as decode_E.  */
+
+static int
+modrm_size (int aflag, int modrm)
+{
+  int mod = modrm >> 6;
+  int rm = modrm & 7;
+
+  if (mod == 3)
+    return 0;
+  if (!aflag)
+    return mod == 0 ? (rm == 6 ? 2 : 0) : mod;
+  if (rm == 4)
+    return mod == 0 ? 1 | X86_LM_SIB0 : 1 + (mod == 1 ? 1 : 4);
+  return mod == 0 ? (rm == 5 ? 4 : 0) : mod == 1 ? 1 : 4;
+}
+
+static void
+print_bytes (const char *name, int row, int n, int (*f) (int, int))
+{
+  int i, j;
+
+  printf ("\nstatic const unsigned char %s[%d][%d] = {", name, row, n);
+  for (i = 0; i < row; i++)
+    {
+      printf ("\n  {");
+      for (j = 0; j < n; j++)
+	printf ("%s%d,", j % 16 ? " " : "\n    ", (*f) (i, j));
+      printf ("\n  },");
+    }
+  printf ("\n};\n");
+}
+
+/* Properties of OPCODE in map TABLE with ModRM reg field REG.  */
+
+static int
+expand (const unsigned short *table, unsigned short groups[][8],
+	int opcode, int reg)
+{
+  int e = table[opcode];
+
+  if (e >> GRP_SHIFT)
+    e = (e & (X86_LT_MODRM | X86_LT_SSE))
+	| groups[(e >> GRP_SHIFT) - 1][reg];
+  return e;
+}
+
+int
+main (void)
+{
+  static char buf[32];
+  unsigned short onebyte[256], twobyte[256];
+  unsigned short groups[ARRAY_SIZE (grps)][8];
+  int ngrps = ARRAY_SIZE (grps);
+  int i, j;
+
+  if (ngrps + 1 > 0xffff >> GRP_SHIFT)
+    {
+      where = "grps";
+      fail ("too many groups");
+    }
+
+  where = buf;
+  for (i = 0; i < 256; i++)
+    {
+      sprintf (buf, "opcode 0x%02x", i);
+      onebyte[i] = opcode_props (&dis386[i], onebyte_has_modrm[i], 0);
+      /* ckprefix takes fwait as a prefix of the float instruction
+	 after it, to the cpu it is an instruction of its own.  */
+      if (i == FWAIT_OPCODE)
+	onebyte[i] = 0;
+      if (i == 0x0f || i == 0x62 || i == 0xc4 || i == 0xc5)
+	onebyte[i] |= X86_LT_ESC;
+      sprintf (buf, "opcode 0x0f 0x%02x", i);
+      twobyte[i] = opcode_props (&dis386_twobyte[i], twobyte_has_modrm[i],
+				 twobyte_uses_SSE_prefix[i]);
+    }
+  for (i = 0; i < ngrps; i++)
+    for (j = 0; j < 8; j++)
+      {
+	sprintf (buf, "group %d /%d", i, j);
+	groups[i][j] = entry_props (&grps[i][j]);
+      }
+
+  printf ("/* Generated by x86-lengen from the opcode tables in x86-dis.c, "
+	  "do not edit.  */\n");
+  printf ("\nstatic const unsigned short x86_len_op[2][256][8] = {");
+  for (i = 0; i < 2 * 256; i++)
+    {
+      if (i % 256 == 0)
+	printf ("%s\n  {", i ? "\n  }," : "");
+      printf ("\n    {");
+      for (j = 0; j < 8; j++)
+	printf ("%s0x%04x", j ? ", " : " ",
+		expand (i < 256 ? onebyte : twobyte, groups, i % 256, j));
+      printf (" },\t/* %s0x%02x */", i < 256 ? "" : "0x0f ", i % 256);
+    }
+  printf ("\n  },\n};\n");
+  print_bytes ("x86_len_imm", X86_LT_IMM + 1, 16, imm_size);
+  print_bytes ("x86_len_modrm", 2, 256, modrm_size);
+  return 0;
+}